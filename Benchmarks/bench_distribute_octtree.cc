@@ -0,0 +1,182 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include<cmath>
+#include<iostream>
+#include<random>
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+#include<ORBextractor.hpp>
+
+#include"benchmark.h"
+#include"distribute_octtree_baseline.h"
+
+using namespace std;
+
+namespace
+{
+
+// Input of DistributeOctTree for one pyramid level, as ComputeKeyPointsOctTree passes it
+struct Level
+{
+    int minX, maxX, minY, maxY, nFeatures;
+    vector<cv::KeyPoint> vKeys;
+};
+
+enum class Layout
+{
+    Textured,   // FAST corners: clusters on texture plus scattered corners
+    Grid,       // Points on a regular grid, most nodes have the same size
+    Clustered   // Almost everything in a few tight blobs
+};
+
+// FAST candidates of one level: integer positions relative to (minX, minY) and integer
+// scores, so nodes of equal size and keypoints of equal response are both common.
+vector<cv::KeyPoint> Candidates(int width, int height, int n, Layout layout, mt19937 &rng)
+{
+    uniform_real_distribution<float> x(0.f, width - 1.f), y(0.f, height - 1.f);
+    uniform_int_distribution<int> score(7, 60);
+    normal_distribution<float> spread(0.f, layout == Layout::Clustered ? 4.f : 15.f);
+
+    vector<cv::Point2f> vCenters(layout == Layout::Clustered ? 4 : 40);
+    for(auto &center : vCenters)
+        center = cv::Point2f(x(rng), y(rng));
+    uniform_int_distribution<int> cluster(0, static_cast<int>(vCenters.size()) - 1);
+
+    const int step = max(1, static_cast<int>(sqrt(static_cast<float>(width) * height / n)));
+
+    vector<cv::KeyPoint> vKeys;
+    vKeys.reserve(n);
+    for(int i = 0; i < n; i++)
+    {
+        cv::Point2f pt;
+        if(layout == Layout::Grid)
+            pt = cv::Point2f((i * step) % width, (i * step) / width * step % height);
+        else if(layout == Layout::Clustered || i % 5 != 0)
+            pt = vCenters[cluster(rng)] + cv::Point2f(spread(rng), spread(rng));
+        else
+            pt = cv::Point2f(x(rng), y(rng));
+
+        pt.x = min(max(floorf(pt.x), 0.f), width - 1.f);
+        pt.y = min(max(floorf(pt.y), 0.f), height - 1.f);
+        vKeys.emplace_back(pt, 7.f, -1.f, static_cast<float>(score(rng)));
+    }
+    return vKeys;
+}
+
+// The levels of a KITTI image with nFeatures features, 8 levels and scale factor 1.2, split
+// over the levels as ORBextractor does, with about ten FAST candidates per feature.
+vector<Level> Pyramid(int nFeatures, Layout layout, mt19937 &rng)
+{
+    const int nLevels = 8;
+    const float scaleFactor = 1.2f;
+    const int EDGE_THRESHOLD = 19;
+
+    const float factor = 1.0f / scaleFactor;
+    float nDesiredFeaturesPerScale = nFeatures * (1 - factor) / (1 - pow(factor, nLevels));
+
+    vector<Level> vLevels(nLevels);
+    int sumFeatures = 0;
+    float scale = 1.f;
+    for(int level = 0; level < nLevels; level++)
+    {
+        Level &l = vLevels[level];
+        l.nFeatures = level < nLevels - 1 ? cvRound(nDesiredFeaturesPerScale) : max(nFeatures - sumFeatures, 0);
+        sumFeatures += l.nFeatures;
+        nDesiredFeaturesPerScale *= factor;
+
+        const int cols = cvRound(1241 / scale), rows = cvRound(376 / scale);
+        scale *= scaleFactor;
+
+        l.minX = EDGE_THRESHOLD - 3;
+        l.minY = l.minX;
+        l.maxX = cols - EDGE_THRESHOLD + 3;
+        l.maxY = rows - EDGE_THRESHOLD + 3;
+        l.vKeys = Candidates(l.maxX - l.minX, l.maxY - l.minY, 10 * l.nFeatures, layout, rng);
+    }
+    return vLevels;
+}
+
+bool Same(const vector<cv::KeyPoint> &a, const vector<cv::KeyPoint> &b)
+{
+    if(a.size() != b.size())
+        return false;
+    for(size_t i = 0; i < a.size(); i++)
+        if(a[i].pt != b[i].pt || a[i].response != b[i].response)
+            return false;
+    return true;
+}
+
+}  // namespace
+
+// Times ORBextractor::DistributeOctTree against the original list-based version over the
+// 8 levels of a 2000 feature KITTI frame, and checks on random inputs that both keep the same
+// keypoints in the same order. Exits with 1 if any level differs.
+int main()
+{
+    const int nFeatures = 2000;
+    const int nCheckFrames = 100;
+    const int nRepetitions = 200;
+
+    mt19937 rng(3);
+
+    // Regression check, including inputs where many nodes of equal size compete to be divided
+    // and small budgets where the last round stops halfway through them
+    int nLevels = 0, nDifferent = 0;
+    for(Layout layout : {Layout::Textured, Layout::Grid, Layout::Clustered})
+    {
+        for(int f = 0; f < nCheckFrames; f++)
+        {
+            const int nFrameFeatures = f % 2 == 0 ? nFeatures : 100 + f * 37;
+            for(const Level &l : Pyramid(nFrameFeatures, layout, rng))
+            {
+                const vector<cv::KeyPoint> vBaseline =
+                    ORB_SLAM2_Baseline::DistributeOctTree(l.vKeys, l.minX, l.maxX, l.minY, l.maxY, l.nFeatures);
+                const vector<cv::KeyPoint> vKeys =
+                    ORB_SLAM2::ORBextractor::DistributeOctTree(l.vKeys, l.minX, l.maxX, l.minY, l.maxY, l.nFeatures, 0);
+                nLevels++;
+                if(!Same(vBaseline, vKeys))
+                    nDifferent++;
+            }
+        }
+    }
+
+    const vector<Level> vLevels = Pyramid(nFeatures, Layout::Textured, rng);
+
+    size_t nKept = 0;
+    const double tBaseline = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, [&]() {
+        nKept = 0;
+        for(const Level &l : vLevels)
+            nKept += ORB_SLAM2_Baseline::DistributeOctTree(l.vKeys, l.minX, l.maxX, l.minY, l.maxY, l.nFeatures).size();
+    });
+    const double tFlat = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, [&]() {
+        nKept = 0;
+        for(const Level &l : vLevels)
+            nKept += ORB_SLAM2::ORBextractor::DistributeOctTree(l.vKeys, l.minX, l.maxX, l.minY, l.maxY, l.nFeatures, 0).size();
+    });
+
+    cout << nFeatures << " features x " << vLevels.size() << " levels (" << nKept << " kept): list " << tBaseline
+         << " us, flat " << tFlat << " us, speedup " << tBaseline / tFlat << "x" << endl;
+    cout << nDifferent << " of " << nLevels << " levels differ from the list-based version" << endl;
+    return nDifferent == 0 ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include<atomic>
+#include<cmath>
+#include<cstdlib>
+#include<functional>
+#include<iostream>
+#include<new>
+#include<random>
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+#include<Frame.hpp>
+
+#include"benchmark.h"
+
+using namespace std;
+
+// Every allocation of the program goes through here, so the benchmark can count them
+namespace
+{
+atomic<size_t> nAllocations{0};
+}
+
+void *operator new(size_t size)
+{
+    nAllocations++;
+    if(void *p = malloc(size ? size : 1))
+        return p;
+    throw bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+    free(p);
+}
+
+namespace
+{
+
+struct Query
+{
+    float x, y, r;
+    int minLevel, maxLevel;
+};
+
+// A KITTI frame with nFeatures keypoints over 8 levels (scale factor 1.2), bucketed in the grid
+// the way the Frame constructors do it.
+void SetUpFrame(ORB_SLAM2::Frame &F, int nFeatures, mt19937 &rng)
+{
+    ORB_SLAM2::Frame::mnMinX = 0.f;
+    ORB_SLAM2::Frame::mnMaxX = 1241.f;
+    ORB_SLAM2::Frame::mnMinY = 0.f;
+    ORB_SLAM2::Frame::mnMaxY = 376.f;
+    ORB_SLAM2::Frame::mfGridElementWidthInv = ORB_SLAM2::FRAME_GRID_COLS / (ORB_SLAM2::Frame::mnMaxX - ORB_SLAM2::Frame::mnMinX);
+    ORB_SLAM2::Frame::mfGridElementHeightInv = ORB_SLAM2::FRAME_GRID_ROWS / (ORB_SLAM2::Frame::mnMaxY - ORB_SLAM2::Frame::mnMinY);
+
+    uniform_real_distribution<float> x(0.f, 1241.f), y(0.f, 376.f);
+    discrete_distribution<int> octave({25, 21, 17, 14, 12, 10, 8, 7});
+
+    F.N = nFeatures;
+    F.mvKeysUn.resize(nFeatures);
+    for(auto &kp : F.mvKeysUn)
+    {
+        kp.pt = cv::Point2f(x(rng), y(rng));
+        kp.octave = octave(rng);
+    }
+
+    F.mGrid.Assign(static_cast<size_t>(F.N), [&F](size_t i, int &nGridPosX, int &nGridPosY) {
+        return F.PosInGrid(F.mvKeysUn[i], nGridPosX, nGridPosY);
+    });
+}
+
+// The windows Tracking asks for in one frame: SearchByProjection from the last frame (radius
+// 15 at the last octave, one level up and down) for nLastFrame points, then SearchLocalPoints
+// (radius 4 at the predicted level and the one below) for nLocalMap points. Most projections
+// land next to a keypoint.
+vector<Query> TrackingQueries(const ORB_SLAM2::Frame &F, int nLastFrame, int nLocalMap, mt19937 &rng)
+{
+    const float scaleFactor = 1.2f;
+    uniform_int_distribution<int> keypoint(0, F.N - 1);
+    normal_distribution<float> offset(0.f, 3.f);
+    uniform_real_distribution<float> x(0.f, 1241.f), y(0.f, 376.f), unit(0.f, 1.f);
+
+    vector<Query> vQueries;
+    for(int i = 0; i < nLastFrame + nLocalMap; i++)
+    {
+        const cv::KeyPoint &kp = F.mvKeysUn[keypoint(rng)];
+        Query q;
+        if(unit(rng) < 0.8f)
+        {
+            q.x = kp.pt.x + offset(rng);
+            q.y = kp.pt.y + offset(rng);
+        }
+        else
+        {
+            q.x = x(rng);
+            q.y = y(rng);
+        }
+
+        const float scale = pow(scaleFactor, kp.octave);
+        if(i < nLastFrame)
+        {
+            q.r = 15.f * scale;
+            q.minLevel = kp.octave - 1;
+            q.maxLevel = kp.octave + 1;
+        }
+        else
+        {
+            q.r = 4.f * scale;
+            q.minLevel = kp.octave - 1;
+            q.maxLevel = kp.octave;
+        }
+        vQueries.push_back(q);
+    }
+    return vQueries;
+}
+
+}  // namespace
+
+// Counts the allocations and times the feature area queries of one tracked frame, with a fresh
+// vector reserved to N per query as GetFeaturesInArea used to return, with the by-value
+// overload, and with one buffer reused across the queries as the matcher does now.
+int main()
+{
+    const int nFeatures = 2000;
+    const int nLastFrame = 1000;
+    const int nLocalMap = 2000;
+    const int nRepetitions = 200;
+
+    mt19937 rng(11);
+    ORB_SLAM2::Frame F;
+    SetUpFrame(F, nFeatures, rng);
+    const vector<Query> vQueries = TrackingQueries(F, nLastFrame, nLocalMap, rng);
+
+    size_t nFound = 0;
+
+    auto original = [&]() {
+        nFound = 0;
+        for(const Query &q : vQueries)
+        {
+            vector<size_t> vIndices;
+            vIndices.reserve(F.N);
+            F.GetFeaturesInArea(q.x, q.y, q.r, vIndices, q.minLevel, q.maxLevel);
+            nFound += vIndices.size();
+        }
+    };
+
+    auto byValue = [&]() {
+        nFound = 0;
+        for(const Query &q : vQueries)
+            nFound += F.GetFeaturesInArea(q.x, q.y, q.r, q.minLevel, q.maxLevel).size();
+    };
+
+    vector<size_t> vIndices;
+    auto buffer = [&]() {
+        nFound = 0;
+        for(const Query &q : vQueries)
+        {
+            F.GetFeaturesInArea(q.x, q.y, q.r, vIndices, q.minLevel, q.maxLevel);
+            nFound += vIndices.size();
+        }
+    };
+
+    cout << vQueries.size() << " queries per frame, " << nFeatures << " keypoints" << endl;
+
+    const pair<const char *, function<void()>> vVariants[] = {
+        {"vector reserved to N per query (original)", original},
+        {"by-value overload", byValue},
+        {"reused buffer", buffer}};
+
+    for(const auto &variant : vVariants)
+    {
+        // Counted on a frame after the first, as in steady-state tracking
+        variant.second();
+        const size_t nBefore = nAllocations;
+        variant.second();
+        const size_t nFrameAllocations = nAllocations - nBefore;
+
+        const double t = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, variant.second);
+
+        cout << variant.first << ": " << nFrameAllocations << " allocations per frame, " << t << " us, "
+             << nFound << " features found" << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,308 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include<algorithm>
+#include<iostream>
+#include<list>
+#include<map>
+#include<memory>
+#include<mutex>
+#include<random>
+#include<vector>
+
+#include<ObservationList.hpp>
+
+#include"benchmark.h"
+
+using namespace std;
+
+using ORB_SLAM2::KeyFrame;
+
+namespace
+{
+
+// The observation loops of KeyFrame::UpdateConnections and of the setup of
+// Optimizer::LocalBundleAdjustment, replayed on a synthetic map. Points store
+// their observations either in the std::map MapPoint used before, or in
+// ObservationList. GetObservations copies them under the feature mutex in both
+// cases, as MapPoint does.
+
+template<typename Observations>
+struct Point
+{
+    Observations GetObservations()
+    {
+        unique_lock<mutex> lock(mMutexFeatures);
+        return mObservations;
+    }
+
+    Observations mObservations;
+    unsigned long mnBALocalForKF = 0;
+    mutex mMutexFeatures;
+};
+
+template<typename Observations>
+struct Frame
+{
+    unsigned long mnId = 0;
+    unsigned long mnBALocalForKF = 0;
+    unsigned long mnBAFixedForKF = 0;
+    vector<Point<Observations>*> mvpMapPoints;
+    vector<float> mvKeysUn;
+    vector<Frame*> mvpOrderedConnectedKeyFrames;
+    map<KeyFrame*, int> mConnectedKeyFrameWeights;
+};
+
+// The observation containers are keyed by KeyFrame*, the frames stand in for them
+template<typename Observations>
+KeyFrame *ToKeyFrame(Frame<Observations> *pF)
+{
+    return reinterpret_cast<KeyFrame*>(pF);
+}
+
+template<typename Observations>
+Frame<Observations> *FromKeyFrame(KeyFrame *pKF)
+{
+    return reinterpret_cast<Frame<Observations>*>(pKF);
+}
+
+void AddObservation(map<KeyFrame*, size_t> &observations, KeyFrame *pKF, size_t idx)
+{
+    observations[pKF] = idx;
+}
+
+void AddObservation(ORB_SLAM2::ObservationList &observations, KeyFrame *pKF, size_t idx)
+{
+    observations.insert(pKF, idx);
+}
+
+// Tracks the camera for nKeyFrames keyframes. Each keyframe creates nNewPoints points that
+// stay visible for a geometric number of the following keyframes, so every keyframe sees a few
+// hundred points and most points have 2 to 8 observations, with a tail of long tracks.
+template<typename Observations>
+struct SyntheticMap
+{
+    SyntheticMap(int nKeyFrames, int nNewPoints, unsigned seed)
+    {
+        mt19937 rng(seed);
+        geometric_distribution<int> trackLength(0.2);
+        uniform_real_distribution<float> coordinate(0.f, 1241.f);
+
+        for(int i = 0; i < nKeyFrames; i++)
+        {
+            vpFrames.emplace_back(new Frame<Observations>());
+            vpFrames.back()->mnId = i;
+        }
+
+        for(int i = 0; i < nKeyFrames; i++)
+        {
+            for(int j = 0; j < nNewPoints; j++)
+            {
+                vpPoints.emplace_back(new Point<Observations>());
+                Point<Observations> *pMP = vpPoints.back().get();
+
+                const int last = min(nKeyFrames - 1, i + 1 + min(trackLength(rng), 30));
+                for(int k = i; k <= last; k++)
+                {
+                    Frame<Observations> *pF = vpFrames[k].get();
+                    AddObservation(pMP->mObservations, ToKeyFrame(pF), pF->mvpMapPoints.size());
+                    pF->mvpMapPoints.push_back(pMP);
+                    pF->mvKeysUn.push_back(coordinate(rng));
+                }
+            }
+        }
+    }
+
+    vector<unique_ptr<Frame<Observations>>> vpFrames;
+    vector<unique_ptr<Point<Observations>>> vpPoints;
+};
+
+// KeyFrame::UpdateConnections without the AddConnection calls on the other keyframes
+template<typename Observations>
+void UpdateConnections(Frame<Observations> *pF)
+{
+    map<KeyFrame*, int> KFcounter;
+
+    const vector<Point<Observations>*> vpMP = pF->mvpMapPoints;
+
+    for(auto pMP : vpMP)
+    {
+        Observations observations = pMP->GetObservations();
+
+        for(auto &observation : observations)
+        {
+            if(FromKeyFrame<Observations>(observation.first)->mnId == pF->mnId)
+                continue;
+            KFcounter[observation.first]++;
+        }
+    }
+
+    if(KFcounter.empty())
+        return;
+
+    int nmax = 0;
+    KeyFrame *pKFmax = nullptr;
+    const int th = 15;
+
+    vector<pair<int, KeyFrame*>> vPairs;
+    vPairs.reserve(KFcounter.size());
+    for(auto &mit : KFcounter)
+    {
+        if(mit.second > nmax)
+        {
+            nmax = mit.second;
+            pKFmax = mit.first;
+        }
+        if(mit.second >= th)
+            vPairs.emplace_back(mit.second, mit.first);
+    }
+
+    if(vPairs.empty())
+        vPairs.emplace_back(nmax, pKFmax);
+
+    sort(vPairs.begin(), vPairs.end());
+
+    pF->mConnectedKeyFrameWeights = KFcounter;
+    pF->mvpOrderedConnectedKeyFrames.clear();
+    for(auto vit = vPairs.rbegin(); vit != vPairs.rend(); ++vit)
+        pF->mvpOrderedConnectedKeyFrames.push_back(FromKeyFrame<Observations>(vit->second));
+}
+
+// Optimizer::LocalBundleAdjustment up to the edges: local keyframes and points, fixed keyframes
+// and one measurement per observation. nBA plays the role of pKF->mnId, it changes on every call
+// so that repeated runs start from unmarked frames and points.
+template<typename Observations>
+unsigned long LocalBundleAdjustmentSetup(Frame<Observations> *pF, unsigned long nBA)
+{
+    list<Frame<Observations>*> lLocalKeyFrames;
+
+    lLocalKeyFrames.push_back(pF);
+    pF->mnBALocalForKF = nBA;
+
+    for(Frame<Observations> *pFi : pF->mvpOrderedConnectedKeyFrames)
+    {
+        pFi->mnBALocalForKF = nBA;
+        lLocalKeyFrames.push_back(pFi);
+    }
+
+    list<Point<Observations>*> lLocalMapPoints;
+    for(Frame<Observations> *pFi : lLocalKeyFrames)
+    {
+        for(Point<Observations> *pMP : pFi->mvpMapPoints)
+        {
+            if(pMP->mnBALocalForKF != nBA)
+            {
+                lLocalMapPoints.push_back(pMP);
+                pMP->mnBALocalForKF = nBA;
+            }
+        }
+    }
+
+    list<Frame<Observations>*> lFixedCameras;
+    for(Point<Observations> *pMP : lLocalMapPoints)
+    {
+        Observations observations = pMP->GetObservations();
+        for(auto &observation : observations)
+        {
+            Frame<Observations> *pFi = FromKeyFrame<Observations>(observation.first);
+            if(pFi->mnBALocalForKF != nBA && pFi->mnBAFixedForKF != nBA)
+            {
+                pFi->mnBAFixedForKF = nBA;
+                lFixedCameras.push_back(pFi);
+            }
+        }
+    }
+
+    // Stand-in for the edges: the measurement of every observation. The returned checksum does
+    // not depend on the order of the observations, which follows the KeyFrame addresses.
+    vector<float> vMeasurements;
+    vMeasurements.reserve(lLocalMapPoints.size() * 4);
+    unsigned long checksum = lFixedCameras.size();
+    for(Point<Observations> *pMP : lLocalMapPoints)
+    {
+        const Observations observations = pMP->GetObservations();
+        for(auto &observation : observations)
+        {
+            const Frame<Observations> *pFi = FromKeyFrame<Observations>(observation.first);
+            vMeasurements.push_back(pFi->mvKeysUn[observation.second]);
+            checksum += pFi->mnId + observation.second;
+        }
+    }
+
+    return checksum + vMeasurements.size();
+}
+
+struct Result
+{
+    double tUpdateConnections;
+    double tLocalBundleAdjustment;
+    unsigned long checksum;
+};
+
+template<typename Observations>
+Result Run(int nKeyFrames, int nNewPoints, int nRepetitions)
+{
+    SyntheticMap<Observations> syntheticMap(nKeyFrames, nNewPoints, 7);
+    Result result{};
+
+    result.tUpdateConnections = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, [&]() {
+        for(auto &pF : syntheticMap.vpFrames)
+            UpdateConnections(pF.get());
+    }) / nKeyFrames;
+
+    unsigned long nBA = 0;
+    result.tLocalBundleAdjustment = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, [&]() {
+        for(auto &pF : syntheticMap.vpFrames)
+            result.checksum = LocalBundleAdjustmentSetup(pF.get(), ++nBA);
+    }) / nKeyFrames;
+
+    return result;
+}
+
+}  // namespace
+
+// Times the observation loops of UpdateConnections and of the LocalBundleAdjustment setup per
+// keyframe, with the std::map observations MapPoint had before and with ObservationList.
+// Exits with 1 if both containers do not lead to the same local problem.
+int main()
+{
+    const int nKeyFrames = 300;
+    const int nNewPoints = 150;
+    const int nRepetitions = 20;
+
+    const Result before = Run<map<KeyFrame*, size_t>>(nKeyFrames, nNewPoints, nRepetitions);
+    const Result after = Run<ORB_SLAM2::ObservationList>(nKeyFrames, nNewPoints, nRepetitions);
+
+    cout << nKeyFrames << " keyframes, " << nNewPoints << " new points per keyframe, times per keyframe" << endl;
+    cout << "UpdateConnections: std::map " << before.tUpdateConnections << " us, ObservationList "
+         << after.tUpdateConnections << " us, speedup " << before.tUpdateConnections / after.tUpdateConnections
+         << "x" << endl;
+    cout << "LocalBundleAdjustment setup: std::map " << before.tLocalBundleAdjustment << " us, ObservationList "
+         << after.tLocalBundleAdjustment << " us, speedup "
+         << before.tLocalBundleAdjustment / after.tLocalBundleAdjustment << "x" << endl;
+
+    if(before.checksum != after.checksum)
+    {
+        cout << "The local problems differ" << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include<cmath>
+#include<cstring>
+#include<iostream>
+#include<random>
+
+#include<opencv2/core/core.hpp>
+#include<opencv2/imgproc/imgproc.hpp>
+
+#include<ORBdescriptor.hpp>
+
+#include"benchmark.h"
+#include"orb_descriptor_baseline.h"
+
+using namespace std;
+
+namespace
+{
+
+struct Setup
+{
+    const char *name;
+    int cols, rows, keypoints;
+};
+
+// Sizes and feature budgets of the KITTI and TUM settings files
+const Setup vSetups[] = {{"KITTI", 1241, 376, 2000}, {"TUM", 640, 480, 1000}};
+
+// Blurred noise, as the extractor blurs each level before computing descriptors
+cv::Mat RandomImage(int cols, int rows, mt19937 &rng)
+{
+    cv::Mat image(rows, cols, CV_8UC1);
+    uniform_int_distribution<int> intensity(0, 255);
+    for(int y = 0; y < rows; y++)
+        for(int x = 0; x < cols; x++)
+            image.at<uchar>(y, x) = static_cast<uchar>(intensity(rng));
+
+    cv::GaussianBlur(image, image, cv::Size(7, 7), 2, 2, cv::BORDER_REFLECT_101);
+    return image;
+}
+
+// Keypoints anywhere the extractor can put them (EDGE_THRESHOLD = 19), with any orientation
+vector<cv::KeyPoint> RandomKeyPoints(int cols, int rows, int n, mt19937 &rng)
+{
+    const float border = 19.f;
+    uniform_real_distribution<float> x(border, cols - border), y(border, rows - border), angle(0.f, 360.f);
+
+    vector<cv::KeyPoint> vKeys(n);
+    for(auto &kp : vKeys)
+    {
+        kp.pt = cv::Point2f(x(rng), y(rng));
+        kp.angle = angle(rng);
+    }
+    return vKeys;
+}
+
+// Orientations at which rounding x*b + y*a (or x*a - y*b) with one rounding step (FMA) and
+// with two gives a different pixel for some pattern point. Random angles almost never hit
+// one, so the check puts keypoints on them to catch a kernel that rounds unlike the original.
+vector<float> RoundingSensitiveAngles(const cv::Point *pattern)
+{
+    const float factorPI = (float)(CV_PI / 180.f);
+    vector<float> vAngles;
+    for(int k = 0; k < 360000; k++)
+    {
+        const float angle = k * 0.001f;
+        const float a = (float)cos(angle * factorPI), b = (float)sin(angle * factorPI);
+        for(int i = 0; i < 512; i++)
+        {
+            const float x = (float)pattern[i].x, y = (float)pattern[i].y;
+            // volatile keeps the compiler from contracting the products itself
+            volatile float xb = x * b, ya = y * a, xa = x * a, yb = y * b;
+            if(cvRound(xb + ya) != cvRound(fma(x, b, ya)) || cvRound(xa - yb) != cvRound(fma(x, a, -yb)))
+            {
+                vAngles.push_back(angle);
+                break;
+            }
+        }
+    }
+    return vAngles;
+}
+
+int CountDifferentRows(const cv::Mat &a, const cv::Mat &b)
+{
+    int n = 0;
+    for(int i = 0; i < a.rows; i++)
+        if(memcmp(a.ptr(i), b.ptr(i), a.cols) != 0)
+            n++;
+    return n;
+}
+
+}  // namespace
+
+// Times ORBdescriptor against the original per-sample descriptor loop on KITTI and TUM sized
+// images, and checks that the kernel picked for this CPU gives the same descriptors as the
+// original code built with the same flags. Exits with 1 if any descriptor differs.
+int main()
+{
+    const int nCheckFrames = 50;
+    const int nRepetitions = 200;
+
+    const ORB_SLAM2::ORBdescriptor descriptor(ORB_SLAM2_Baseline::Pattern());
+    cout << "Kernel: " << ORB_SLAM2::ORBdescriptor::KernelName() << endl;
+
+    const vector<float> vSensitiveAngles = RoundingSensitiveAngles(ORB_SLAM2_Baseline::Pattern());
+    cout << vSensitiveAngles.size() << " orientations round differently with and without FMA" << endl;
+
+    mt19937 rng(42);
+    int nDifferent = 0;
+
+    for(const Setup &setup : vSetups)
+    {
+        cv::Mat descBaseline(setup.keypoints, 32, CV_8U), desc(setup.keypoints, 32, CV_8U);
+
+        // Check on fresh images and keypoints
+        for(int f = 0; f < nCheckFrames; f++)
+        {
+            const cv::Mat image = RandomImage(setup.cols, setup.rows, rng);
+            vector<cv::KeyPoint> vKeys = RandomKeyPoints(setup.cols, setup.rows, setup.keypoints, rng);
+            for(size_t i = 0; i < vSensitiveAngles.size(); i++)
+                vKeys[i].angle = vSensitiveAngles[i];
+
+            ORB_SLAM2_Baseline::ComputeDescriptors(image, vKeys, descBaseline);
+            descriptor.Compute(image, vKeys, desc);
+            nDifferent += CountDifferentRows(descBaseline, desc);
+        }
+
+        const cv::Mat image = RandomImage(setup.cols, setup.rows, rng);
+        const vector<cv::KeyPoint> vKeys = RandomKeyPoints(setup.cols, setup.rows, setup.keypoints, rng);
+
+        const double tBaseline = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, [&]() {
+            ORB_SLAM2_Baseline::ComputeDescriptors(image, vKeys, descBaseline);
+        });
+        const double tKernel = ORB_SLAM2_Benchmark::MedianMicroseconds(nRepetitions, [&]() {
+            descriptor.Compute(image, vKeys, desc);
+        });
+
+        cout << setup.name << " " << setup.cols << "x" << setup.rows << ", " << setup.keypoints << " keypoints: "
+             << "original " << tBaseline << " us, " << ORB_SLAM2::ORBdescriptor::KernelName() << " " << tKernel
+             << " us, speedup " << tBaseline / tKernel << "x" << endl;
+    }
+
+    cout << nDifferent << " descriptors differ from the original code" << endl;
+    return nDifferent == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include<algorithm>
+#include<chrono>
+#include<vector>
+
+namespace ORB_SLAM2_Benchmark
+{
+
+// Median wall time of one call of f over the repetitions, in microseconds.
+// One untimed call first warms caches and the worker pool.
+template<typename F>
+double MedianMicroseconds(int repetitions, F &&f)
+{
+    f();
+
+    std::vector<double> vTimes(repetitions);
+    for(int i = 0; i < repetitions; i++)
+    {
+        const auto t0 = std::chrono::steady_clock::now();
+        f();
+        const auto t1 = std::chrono::steady_clock::now();
+        vTimes[i] = std::chrono::duration<double, std::micro>(t1 - t0).count();
+    }
+
+    std::nth_element(vTimes.begin(), vTimes.begin() + repetitions / 2, vTimes.end());
+    return vTimes[repetitions / 2];
+}
+
+}  // namespace ORB_SLAM2_Benchmark
@@ -0,0 +1,314 @@
+/**
+ * This file is part of ORB-SLAM2.
+ * This file is based on the file orb.cpp from the OpenCV library (see BSD license below).
+ *
+ * Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+ * For more information see <https://github.com/raulmur/ORB_SLAM2>
+ *
+ * ORB-SLAM2 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * ORB-SLAM2 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+ */
+// DistributeOctTree of ORBextractor.cpp before the flat quadtree, kept verbatim but for the
+// tie-break. The original sorted the nodes to divide by (size, address), so nodes of equal size
+// were divided in allocation order, which the list does not guarantee. Here nodes record when
+// they were created and ties follow that order, as in the flat quadtree, so that the two can
+// be compared exactly.
+#include<list>
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+#include"distribute_octtree_baseline.h"
+
+using namespace std;
+
+namespace ORB_SLAM2_Baseline
+{
+
+namespace
+{
+
+class ExtractorNode final {
+public:
+  ExtractorNode() : bNoMore(false) {}
+
+  void DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4);
+
+  std::vector<cv::KeyPoint> vKeys;
+  cv::Point2i UL, UR, BL, BR;
+  std::list<ExtractorNode>::iterator lit;
+  bool bNoMore;
+  int nCreated = 0;
+};
+
+void ExtractorNode::DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4) {
+  const int halfX = ceil(static_cast<float>(UR.x - UL.x) / 2);
+  const int halfY = ceil(static_cast<float>(BR.y - UL.y) / 2);
+
+  //Define boundaries of childs
+  n1.UL = UL;
+  n1.UR = cv::Point2i(UL.x + halfX, UL.y);
+  n1.BL = cv::Point2i(UL.x, UL.y + halfY);
+  n1.BR = cv::Point2i(UL.x + halfX, UL.y + halfY);
+  n1.vKeys.reserve(vKeys.size());
+
+  n2.UL = n1.UR;
+  n2.UR = UR;
+  n2.BL = n1.BR;
+  n2.BR = cv::Point2i(UR.x, UL.y + halfY);
+  n2.vKeys.reserve(vKeys.size());
+
+  n3.UL = n1.BL;
+  n3.UR = n1.BR;
+  n3.BL = BL;
+  n3.BR = cv::Point2i(n1.BR.x, BL.y);
+  n3.vKeys.reserve(vKeys.size());
+
+  n4.UL = n3.UR;
+  n4.UR = n2.BR;
+  n4.BL = n3.BR;
+  n4.BR = BR;
+  n4.vKeys.reserve(vKeys.size());
+
+  //Associate points to childs
+  for(auto & kp : vKeys) {
+    if(kp.pt.x < n1.UR.x) {
+      if(kp.pt.y < n1.BR.y)
+        n1.vKeys.push_back(kp);
+      else
+        n3.vKeys.push_back(kp);
+    } else if(kp.pt.y < n1.BR.y)
+      n2.vKeys.push_back(kp);
+    else
+      n4.vKeys.push_back(kp);
+  }
+
+  if(n1.vKeys.size() == 1)
+    n1.bNoMore = true;
+  if(n2.vKeys.size() == 1)
+    n2.bNoMore = true;
+  if(n3.vKeys.size() == 1)
+    n3.bNoMore = true;
+  if(n4.vKeys.size() == 1)
+    n4.bNoMore = true;
+}
+
+}  // namespace
+
+std::vector<cv::KeyPoint> DistributeOctTree(const vector<cv::KeyPoint> &vToDistributeKeys,
+                                            const int &minX,
+                                            const int &maxX,
+                                            const int &minY,
+                                            const int &maxY,
+                                            const int &N) {
+  // Compute how many initial nodes
+  const int nIni = round(static_cast<float>(maxX - minX) / (maxY - minY));
+
+  const float hX = static_cast<float>(maxX - minX) / nIni;
+
+  list<ExtractorNode> lNodes;
+  int nCreated = 0;
+
+  vector<ExtractorNode *> vpIniNodes;
+  vpIniNodes.resize(nIni);
+
+  for(int i = 0; i < nIni; i++) {
+    ExtractorNode ni;
+    ni.UL = cv::Point2i(hX * static_cast<float>(i), 0);
+    ni.UR = cv::Point2i(hX * static_cast<float>(i + 1), 0);
+    ni.BL = cv::Point2i(ni.UL.x, maxY - minY);
+    ni.BR = cv::Point2i(ni.UR.x, maxY - minY);
+    ni.vKeys.reserve(vToDistributeKeys.size());
+
+    lNodes.push_back(ni);
+    lNodes.back().nCreated = nCreated++;
+    vpIniNodes[i] = &lNodes.back();
+  }
+
+  //Associate points to childs
+  for(const auto & kp : vToDistributeKeys) {
+    vpIniNodes[kp.pt.x / hX]->vKeys.push_back(kp);
+  }
+
+  auto lit = lNodes.begin();
+
+  while(lit != lNodes.end()) {
+    if(lit->vKeys.size() == 1) {
+      lit->bNoMore = true;
+      ++lit;
+    } else if(lit->vKeys.empty())
+      lit = lNodes.erase(lit);
+    else
+      ++lit;
+  }
+
+  bool bFinish = false;
+
+  int iteration = 0;
+
+  vector<pair<int, ExtractorNode *> > vSizeAndPointerToNode;
+  vSizeAndPointerToNode.reserve(lNodes.size() * 4);
+
+  while(!bFinish) {
+    iteration++;
+
+    int prevSize = lNodes.size();
+
+    lit = lNodes.begin();
+
+    int nToExpand = 0;
+
+    vSizeAndPointerToNode.clear();
+
+    while(lit != lNodes.end()) {
+      if(lit->bNoMore) {
+        // If node only contains one point do not subdivide and continue
+        ++lit;
+        continue;
+      } else {
+        // If more than one point, subdivide
+        ExtractorNode n1, n2, n3, n4;
+        lit->DivideNode(n1, n2, n3, n4);
+
+        // Add childs if they contain points
+        if(n1.vKeys.size() > 0) {
+          lNodes.push_front(n1);
+          lNodes.front().nCreated = nCreated++;
+          if(n1.vKeys.size() > 1) {
+            nToExpand++;
+            vSizeAndPointerToNode.emplace_back(n1.vKeys.size(), &lNodes.front());
+            lNodes.front().lit = lNodes.begin();
+          }
+        }
+        if(n2.vKeys.size() > 0) {
+          lNodes.push_front(n2);
+          lNodes.front().nCreated = nCreated++;
+          if(n2.vKeys.size() > 1) {
+            nToExpand++;
+            vSizeAndPointerToNode.emplace_back(n2.vKeys.size(), &lNodes.front());
+            lNodes.front().lit = lNodes.begin();
+          }
+        }
+        if(n3.vKeys.size() > 0) {
+          lNodes.push_front(n3);
+          lNodes.front().nCreated = nCreated++;
+          if(n3.vKeys.size() > 1) {
+            nToExpand++;
+            vSizeAndPointerToNode.emplace_back(n3.vKeys.size(), &lNodes.front());
+            lNodes.front().lit = lNodes.begin();
+          }
+        }
+        if(n4.vKeys.size() > 0) {
+          lNodes.push_front(n4);
+          lNodes.front().nCreated = nCreated++;
+          if(n4.vKeys.size() > 1) {
+            nToExpand++;
+            vSizeAndPointerToNode.emplace_back(n4.vKeys.size(), &lNodes.front());
+            lNodes.front().lit = lNodes.begin();
+          }
+        }
+
+        lit = lNodes.erase(lit);
+        continue;
+      }
+    }
+
+    // Finish if there are more nodes than required features
+    // or all nodes contain just one point
+    if((int)lNodes.size() >= N || (int)lNodes.size() == prevSize) {
+      bFinish = true;
+    } else if(((int)lNodes.size() + nToExpand * 3) > N) {
+
+      while(!bFinish) {
+
+        prevSize = lNodes.size();
+
+        vector<pair<int, ExtractorNode *> > vPrevSizeAndPointerToNode = vSizeAndPointerToNode;
+        vSizeAndPointerToNode.clear();
+
+        sort(vPrevSizeAndPointerToNode.begin(), vPrevSizeAndPointerToNode.end(),
+             [](const pair<int, ExtractorNode *> &a, const pair<int, ExtractorNode *> &b) {
+               return a.first != b.first ? a.first < b.first : a.second->nCreated < b.second->nCreated;
+             });
+        for(int j = vPrevSizeAndPointerToNode.size() - 1; j >= 0; j--) {
+          ExtractorNode n1, n2, n3, n4;
+          vPrevSizeAndPointerToNode[j].second->DivideNode(n1, n2, n3, n4);
+
+          // Add childs if they contain points
+          if(n1.vKeys.size() > 0) {
+            lNodes.push_front(n1);
+            lNodes.front().nCreated = nCreated++;
+            if(n1.vKeys.size() > 1) {
+              vSizeAndPointerToNode.emplace_back(n1.vKeys.size(), &lNodes.front());
+              lNodes.front().lit = lNodes.begin();
+            }
+          }
+          if(n2.vKeys.size() > 0) {
+            lNodes.push_front(n2);
+            lNodes.front().nCreated = nCreated++;
+            if(n2.vKeys.size() > 1) {
+              vSizeAndPointerToNode.emplace_back(n2.vKeys.size(), &lNodes.front());
+              lNodes.front().lit = lNodes.begin();
+            }
+          }
+          if(!n3.vKeys.empty()) {
+            lNodes.push_front(n3);
+            lNodes.front().nCreated = nCreated++;
+            if(n3.vKeys.size() > 1) {
+              vSizeAndPointerToNode.emplace_back(n3.vKeys.size(), &lNodes.front());
+              lNodes.front().lit = lNodes.begin();
+            }
+          }
+          if(!n4.vKeys.empty()) {
+            lNodes.push_front(n4);
+            lNodes.front().nCreated = nCreated++;
+            if(n4.vKeys.size() > 1) {
+              vSizeAndPointerToNode.emplace_back(n4.vKeys.size(), &lNodes.front());
+              lNodes.front().lit = lNodes.begin();
+            }
+          }
+
+          lNodes.erase(vPrevSizeAndPointerToNode[j].second->lit);
+
+          if((int)lNodes.size() >= N)
+            break;
+        }
+
+        if((int)lNodes.size() >= N || (int)lNodes.size() == prevSize)
+          bFinish = true;
+      }
+    }
+  }
+
+  // Retain the best point in each node
+  vector<cv::KeyPoint> vResultKeys;
+  vResultKeys.reserve(N);
+  for(const auto& vNodes : lNodes) {
+    const std::vector<cv::KeyPoint> &vNodeKeys = vNodes.vKeys;
+    const cv::KeyPoint *pKP = &vNodeKeys[0];
+    float maxResponse = pKP->response;
+
+    for(size_t k = 1; k < vNodeKeys.size(); k++) {
+      if(vNodeKeys[k].response > maxResponse) {
+        pKP = &vNodeKeys[k];
+        maxResponse = vNodeKeys[k].response;
+      }
+    }
+
+    vResultKeys.push_back(*pKP);
+  }
+
+  return vResultKeys;
+}
+
+}  // namespace ORB_SLAM2_Baseline
@@ -0,0 +1,19 @@
+#pragma once
+
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+namespace ORB_SLAM2_Baseline
+{
+
+// Keypoint distribution of the original ORBextractor, with a std::list of nodes that each own
+// a copy of their keypoints. Same arguments as ORBextractor::DistributeOctTree.
+std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint> &vToDistributeKeys,
+                                            const int &minX,
+                                            const int &maxX,
+                                            const int &minY,
+                                            const int &maxY,
+                                            const int &N);
+
+}  // namespace ORB_SLAM2_Baseline
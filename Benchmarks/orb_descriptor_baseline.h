@@ -0,0 +1,16 @@
+#pragma once
+
+#include<vector>
+
+#include<opencv2/core/core.hpp>
+
+namespace ORB_SLAM2_Baseline
+{
+
+// The 256 test pairs of the original ORBextractor.
+const cv::Point *Pattern();
+
+// Descriptors as computed by the original ORBextractor, one 32 byte row per keypoint.
+void ComputeDescriptors(const cv::Mat &image, const std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors);
+
+}  // namespace ORB_SLAM2_Baseline
@@ -0,0 +1,72 @@
+/**
+* This file is part of ORB-SLAM2.
+*
+* Copyright (C) 2014-2016 Raúl Mur-Artal <raulmur at unizar dot es> (University of Zaragoza)
+* For more information see <https://github.com/raulmur/ORB_SLAM2>
+*
+* ORB-SLAM2 is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* ORB-SLAM2 is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include<iostream>
+#include<chrono>
+
+#include<ORBVocabulary.hpp>
+
+using namespace std;
+
+// Converts a vocabulary (DBoW2 text or binary, or flat) to the flat format mapped by ORB_SLAM2::System.
+int main(int argc, char **argv)
+{
+    if(argc != 3)
+    {
+        cerr << endl << "Usage: ./convert_vocabulary path_to_vocabulary path_to_flat_vocabulary" << endl;
+        return 1;
+    }
+
+    ORB_SLAM2::ORBVocabulary vocabulary;
+
+    const auto tStart = chrono::steady_clock::now();
+    if(!vocabulary.Load(argv[1]))
+    {
+        cerr << "Failed to load " << argv[1] << endl;
+        return 1;
+    }
+    const auto tLoaded = chrono::steady_clock::now();
+
+    if(!vocabulary.SaveToFlatFile(argv[2]))
+    {
+        cerr << "Failed to write " << argv[2] << endl;
+        return 1;
+    }
+
+    // Check the written file, payload checksum included
+    ORB_SLAM2::ORBVocabulary flat;
+    const auto tFlatStart = chrono::steady_clock::now();
+    if(!flat.LoadFromFlatFile(argv[2], true) || flat.size() != vocabulary.size())
+    {
+        cerr << "Verification of " << argv[2] << " failed" << endl;
+        return 1;
+    }
+    const auto tFlatLoaded = chrono::steady_clock::now();
+
+    cout << vocabulary.size() << " words, k = " << vocabulary.getBranchingFactor()
+         << ", L = " << vocabulary.getDepthLevels() << endl;
+    cout << "Loaded " << argv[1] << " in "
+         << chrono::duration<double, milli>(tLoaded - tStart).count() << " ms" << endl;
+    cout << "Loaded and verified " << argv[2] << " in "
+         << chrono::duration<double, milli>(tFlatLoaded - tFlatStart).count() << " ms" << endl;
+
+    return 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+// DBoW2
+#include <DBoW2/BowVector.h>
+
+namespace ORB_SLAM2 {
+
+class ORBVocabulary;
+
+// Bag of words vector of a frame, sorted by word id and stored as two parallel arrays
+// (ids and values). Replaces DBoW2::BowVector (a std::map) for the vectors kept by the
+// frames and keyframes: 12 bytes per word and scores that merge two flat arrays.
+class BowVector final {
+public:
+  using WordId = DBoW2::WordId;
+  using WordValue = DBoW2::WordValue;
+
+  BowVector() = default;
+
+  void clear() noexcept {
+    mvWords.clear();
+    mvValues.clear();
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return mvWords.size(); }
+
+  [[nodiscard]] bool empty() const noexcept { return mvWords.empty(); }
+
+  // Word ids in increasing order
+  [[nodiscard]] const std::vector<WordId> &words() const noexcept { return mvWords; }
+
+  // values()[i] is the value of words()[i]
+  [[nodiscard]] const std::vector<WordValue> &values() const noexcept { return mvValues; }
+
+  // Divides the values by their L1 or L2 norm, as DBoW2::BowVector::normalize.
+  void Normalize(DBoW2::LNorm norm);
+
+  // Similarity of two vectors with the scoring of DBoW2 (ScoringObject.cpp). L1 runs on
+  // AVX2 when the CPU has it; the other scores merge the two vectors serially.
+  static double Score(DBoW2::ScoringType scoring, const BowVector &a, const BowVector &b);
+
+  // L1 score only (the scoring of ORBvoc.txt)
+  static double ScoreL1(const BowVector &a, const BowVector &b);
+
+protected:
+  // Filled by ORBVocabulary::transform
+  friend class ORBVocabulary;
+
+  std::vector<WordId> mvWords;
+  std::vector<WordValue> mvValues;
+};
+
+}  // namespace ORB_SLAM2
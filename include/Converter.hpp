@@ -27,29 +27,24 @@ namespace Converter {
 
 std::vector<cv::Mat> toDescriptorVector(const cv::Mat &Descriptors);
 
-g2o::SE3Quat toSE3Quat(const cv::Mat &cvT);
-
 g2o::SE3Quat toSE3Quat(const g2o::Sim3 &gSim3);
 
-cv::Mat toCvMat(const g2o::SE3Quat &SE3);
-
-cv::Mat toCvMat(const g2o::Sim3 &Sim3);
-
-cv::Mat toCvMat(const Eigen::Matrix<double, 4, 4> &m);
+g2o::SE3Quat toSE3Quat(const Eigen::Matrix4f &T);
 
-cv::Mat toCvMat(const Eigen::Matrix3d &m);
+cv::Mat toCvMat(const Eigen::Matrix4f &m);
 
-cv::Mat toCvMat(const Eigen::Matrix<double, 3, 1> &m);
+Eigen::Matrix4f toMatrix4f(const g2o::SE3Quat &SE3);
 
-cv::Mat toCvSE3(const Eigen::Matrix<double, 3, 3> &R, const Eigen::Matrix<double, 3, 1> &t);
+// [sR t; 0 1]
+Eigen::Matrix4f toMatrix4f(const g2o::Sim3 &Sim3);
 
-Eigen::Matrix<double, 3, 1> toVector3d(const cv::Mat &cvVector);
+Eigen::Matrix4f toMatrix4f(const Eigen::Matrix3f &R, const Eigen::Vector3f &t);
 
-Eigen::Matrix<double, 3, 1> toVector3d(const cv::Point3f &cvPoint);
+Eigen::Matrix3f toMatrix3f(const cv::Mat &cvMat3);
 
-Eigen::Matrix<double, 3, 3> toMatrix3d(const cv::Mat &cvMat3);
+Eigen::Vector3f toVector3f(const cv::Mat &cvVector);
 
-std::vector<float> toQuaternion(const cv::Mat &M);
+std::vector<float> toQuaternion(const Eigen::Matrix3f &M);
 
 }  // namespace Converter
 }  // namespace ORB_SLAM2
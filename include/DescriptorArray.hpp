@@ -0,0 +1,59 @@
+#pragma once
+
+namespace ORB_SLAM2 {
+
+// One 256 bit ORB descriptor, aligned for a single AVX2 load.
+struct alignas(32) DescriptorBlock {
+  static constexpr int BYTES = 32;
+
+  uint8_t bytes[BYTES];
+
+  [[nodiscard]] const uint8_t *data() const noexcept { return bytes; }
+
+  [[nodiscard]] uint8_t *data() noexcept { return bytes; }
+};
+
+// Descriptors of a frame or keyframe: one aligned block per keypoint, stored contiguously.
+// Rows are read as raw pointers; mat() gives a non-owning N x 32 CV_8U header on the same
+// memory for the OpenCV/DBoW2 interfaces.
+class DescriptorArray final {
+public:
+  DescriptorArray() = default;
+
+  // Copy of a N x 32 CV_8U matrix.
+  explicit DescriptorArray(const cv::Mat &descriptors) { Assign(descriptors); }
+
+  void Assign(const cv::Mat &descriptors) {
+    assert(descriptors.empty() || (descriptors.type() == CV_8U && descriptors.cols == DescriptorBlock::BYTES));
+    mvBlocks.resize(static_cast<size_t>(descriptors.rows));
+    for(int i = 0; i < descriptors.rows; i++)
+      std::memcpy(mvBlocks[i].bytes, descriptors.ptr<uint8_t>(i), DescriptorBlock::BYTES);
+  }
+
+  void resize(size_t n) { mvBlocks.resize(n); }
+
+  void clear() noexcept { mvBlocks.clear(); }
+
+  [[nodiscard]] size_t size() const noexcept { return mvBlocks.size(); }
+
+  [[nodiscard]] bool empty() const noexcept { return mvBlocks.empty(); }
+
+  [[nodiscard]] const uint8_t *row(size_t i) const { return mvBlocks[i].bytes; }
+
+  [[nodiscard]] uint8_t *row(size_t i) { return mvBlocks[i].bytes; }
+
+  [[nodiscard]] const DescriptorBlock &operator[](size_t i) const { return mvBlocks[i]; }
+
+  // View valid until the array is resized or destroyed.
+  [[nodiscard]] cv::Mat mat() const {
+    if(mvBlocks.empty())
+      return cv::Mat();
+    return cv::Mat(static_cast<int>(mvBlocks.size()), DescriptorBlock::BYTES, CV_8U,
+                   const_cast<uint8_t *>(mvBlocks.front().bytes), sizeof(DescriptorBlock));
+  }
+
+private:
+  std::vector<DescriptorBlock> mvBlocks;
+};
+
+}  // namespace ORB_SLAM2
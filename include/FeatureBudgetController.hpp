@@ -0,0 +1,46 @@
+#pragma once
+
+namespace ORB_SLAM2 {
+
+// Closed-loop controller for the number of ORB features and the FAST threshold.
+// After every frame it is fed the measured tracking time and the number of
+// tracked inliers: the budget shrinks when the frame time exceeds the target,
+// grows when too few points are tracked and there is time left, and the FAST
+// threshold is lowered once the budget alone cannot provide enough corners.
+class FeatureBudgetController final {
+public:
+  struct Settings {
+    int minFeatures;
+    int maxFeatures;
+    // Frame time to stay under, in seconds
+    double targetFrameTime;
+    // Inliers of the local map tracking considered enough for a robust pose
+    int targetInliers;
+    // Range of the initial FAST threshold, the upper bound is the configured one
+    int minIniThFAST;
+    int maxIniThFAST;
+  };
+
+  FeatureBudgetController(const Settings &settings, int nFeatures, int iniThFAST);
+
+  // Update with the last frame. bTracked is false while initializing or lost,
+  // in which case the inlier count is not meaningful and more features are requested.
+  void Update(double frameTime, int nInliers, bool bTracked);
+
+  [[nodiscard]] int GetFeatureBudget() const noexcept { return mnFeatures; }
+
+  [[nodiscard]] int GetIniThFAST() const noexcept { return mnIniThFAST; }
+
+  [[nodiscard]] double GetSmoothedFrameTime() const noexcept { return mFrameTime; }
+
+private:
+  Settings mSettings;
+
+  int mnFeatures;
+  int mnIniThFAST;
+
+  // Exponential moving average of the frame time, 0 until the first update
+  double mFrameTime = 0.0;
+};
+
+}  // namespace ORB_SLAM2
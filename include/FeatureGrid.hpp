@@ -0,0 +1,53 @@
+#pragma once
+
+namespace ORB_SLAM2 {
+
+constexpr auto FRAME_GRID_ROWS = 48;
+constexpr auto FRAME_GRID_COLS = 64;
+
+// Keypoint indices bucketed by image cell, stored in compressed sparse row form:
+// the indices of cell (x, y) are mvIndices[mvCellStart[c], mvCellStart[c + 1])
+// with c = x * FRAME_GRID_ROWS + y. Cells are column major so that a vertical run
+// of cells is one contiguous range, and indices are ascending inside each cell.
+class FeatureGrid final {
+public:
+  FeatureGrid() : mvCellStart(FRAME_GRID_COLS * FRAME_GRID_ROWS + 1, 0) {}
+
+  // Bucket the indices [0, n). cellOf(i, x, y) returns false for keypoints outside the grid.
+  template<typename CellOf>
+  void Assign(std::size_t n, CellOf cellOf) {
+    std::vector<int> vCell(n);
+    std::fill(mvCellStart.begin(), mvCellStart.end(), 0);
+
+    for(std::size_t i = 0; i < n; i++) {
+      int x, y;
+      if(cellOf(i, x, y)) {
+        vCell[i] = x * FRAME_GRID_ROWS + y;
+        mvCellStart[vCell[i] + 1]++;
+      } else {
+        vCell[i] = -1;
+      }
+    }
+
+    for(std::size_t c = 1; c < mvCellStart.size(); c++)
+      mvCellStart[c] += mvCellStart[c - 1];
+
+    mvIndices.resize(mvCellStart.back());
+    std::vector<uint32_t> vFill(mvCellStart.begin(), mvCellStart.end() - 1);
+    for(std::size_t i = 0; i < n; i++) {
+      if(vCell[i] >= 0)
+        mvIndices[vFill[vCell[i]]++] = static_cast<uint32_t>(i);
+    }
+  }
+
+  // Indices of the cells (x, minY) .. (x, maxY), in cell order.
+  [[nodiscard]] const uint32_t *Begin(int x, int minY) const { return mvIndices.data() + mvCellStart[x * FRAME_GRID_ROWS + minY]; }
+
+  [[nodiscard]] const uint32_t *End(int x, int maxY) const { return mvIndices.data() + mvCellStart[x * FRAME_GRID_ROWS + maxY + 1]; }
+
+private:
+  std::vector<uint32_t> mvCellStart;
+  std::vector<uint32_t> mvIndices;
+};
+
+}  // namespace ORB_SLAM2
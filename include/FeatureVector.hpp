@@ -0,0 +1,70 @@
+#pragma once
+
+// DBoW2
+#include <DBoW2/BowVector.h>
+
+namespace ORB_SLAM2 {
+
+class ORBVocabulary;
+
+// Features of a frame grouped by vocabulary node, in CSR form: the node ids in increasing
+// order, and for each node a range of a single array of feature indices. Replaces
+// DBoW2::FeatureVector (a map of vectors, one allocation per node).
+class FeatureVector final {
+public:
+  using NodeId = DBoW2::NodeId;
+
+  // Indices of the features of one node, in increasing order
+  class Features final {
+  public:
+    Features(const unsigned int *pBegin, const unsigned int *pEnd) noexcept : mpBegin(pBegin), mpEnd(pEnd) {}
+
+    [[nodiscard]] const unsigned int *begin() const noexcept { return mpBegin; }
+
+    [[nodiscard]] const unsigned int *end() const noexcept { return mpEnd; }
+
+    [[nodiscard]] size_t size() const noexcept { return static_cast<size_t>(mpEnd - mpBegin); }
+
+    [[nodiscard]] bool empty() const noexcept { return mpBegin == mpEnd; }
+
+    [[nodiscard]] unsigned int operator[](size_t i) const { return mpBegin[i]; }
+
+  private:
+    const unsigned int *mpBegin;
+    const unsigned int *mpEnd;
+  };
+
+  FeatureVector() = default;
+
+  void clear() noexcept {
+    mvNodes.clear();
+    mvOffsets.clear();
+    mvFeatures.clear();
+  }
+
+  // Number of nodes
+  [[nodiscard]] size_t size() const noexcept { return mvNodes.size(); }
+
+  [[nodiscard]] bool empty() const noexcept { return mvNodes.empty(); }
+
+  [[nodiscard]] NodeId node(size_t i) const { return mvNodes[i]; }
+
+  [[nodiscard]] Features features(size_t i) const {
+    return Features(mvFeatures.data() + mvOffsets[i], mvFeatures.data() + mvOffsets[i + 1]);
+  }
+
+  // Position of the first node not lower than id, searching from position first on
+  [[nodiscard]] size_t lowerBound(NodeId id, size_t first = 0) const {
+    return static_cast<size_t>(std::lower_bound(mvNodes.begin() + first, mvNodes.end(), id) - mvNodes.begin());
+  }
+
+protected:
+  // Filled by ORBVocabulary::transform
+  friend class ORBVocabulary;
+
+  std::vector<NodeId> mvNodes;
+  std::vector<uint32_t> mvOffsets;  // size() + 1 entries
+  std::vector<unsigned int> mvFeatures;
+};
+
+}  // namespace ORB_SLAM2
@@ -19,16 +19,14 @@
  */
 #pragma once
 // Internal
+#include "FeatureGrid.hpp"
+#include "BowVector.hpp"
+#include "FeatureVector.hpp"
 #include "ORBVocabulary.hpp"
-// DBoW2
-#include <DBoW2/BowVector.h>
-#include <DBoW2/FeatureVector.h>
+#include "DescriptorArray.hpp"
 
 namespace ORB_SLAM2 {
 
-constexpr auto FRAME_GRID_ROWS = 48;
-constexpr auto FRAME_GRID_COLS = 64;
-
 class MapPoint;
 class KeyFrame;
 class ORBextractor;
@@ -75,16 +73,22 @@ public:
   void ComputeBoW();
 
   // Set the camera pose.
-  void SetPose(const cv::Mat& Tcw);
+  void SetPose(const Eigen::Matrix4f &Tcw);
 
   // Computes rotation, translation and camera center matrices from the camera pose.
   void UpdatePoseMatrices();
 
+  // True once a pose has been set (frames where tracking failed have none).
+  bool HasPose() const { return mbHasPose; }
+
   // Returns the camera center.
-  cv::Mat GetCameraCenter() const { return mOw.clone(); }
+  const Eigen::Vector3f &GetCameraCenter() const { return mOw; }
 
   // Returns inverse of rotation
-  cv::Mat GetRotationInverse() const { return mRwc.clone(); }
+  const Eigen::Matrix3f &GetRotationInverse() const { return mRwc; }
+
+  // Returns the inverse of the camera pose.
+  Eigen::Matrix4f GetPoseInverse() const;
 
   // Check if a MapPoint is in the frustum of the camera
   // and fill variables of the MapPoint to be used by the tracking
@@ -95,6 +99,10 @@ public:
 
   std::vector<size_t> GetFeaturesInArea(const float &x, const float &y, const float &r, const int minLevel = -1, const int maxLevel = -1) const;
 
+  // Same as above into a caller owned buffer (cleared first), so that a buffer reused
+  // across queries does not allocate once it has grown.
+  void GetFeaturesInArea(const float &x, const float &y, const float &r, std::vector<size_t> &vIndices, const int minLevel = -1, const int maxLevel = -1) const;
+
   // Search a match for each keypoint in the left image to a keypoint in the right image.
   // If there is a match, depth is computed and the right coordinate associated to the left keypoint is stored.
   void ComputeStereoMatches();
@@ -102,8 +110,8 @@ public:
   // Associate a "right" coordinate to a keypoint if there is valid depth in the depthmap.
   void ComputeStereoFromRGBD(const cv::Mat &imDepth);
 
-  // Backprojects a keypoint (if stereo/depth info available) into 3D world coordinates.
-  cv::Mat UnprojectStereo(const int &i);
+  // Backprojects a keypoint into 3D world coordinates. Only valid if the keypoint has depth.
+  Eigen::Vector3f UnprojectStereo(const int &i) const;
 
 public:
   // Vocabulary used for relocalization.
@@ -150,11 +158,11 @@ public:
   std::vector<float> mvDepth;
 
   // Bag of Words Vector structures.
-  DBoW2::BowVector mBowVec;
-  DBoW2::FeatureVector mFeatVec;
+  BowVector mBowVec;
+  FeatureVector mFeatVec;
 
   // ORB descriptor, each row associated to a keypoint.
-  cv::Mat mDescriptors, mDescriptorsRight;
+  DescriptorArray mDescriptors, mDescriptorsRight;
 
   // MapPoints associated to keypoints, NULL pointer if no association.
   std::vector<MapPoint *> mvpMapPoints;
@@ -165,10 +173,10 @@ public:
   // Keypoints are assigned to cells in a grid to reduce matching complexity when projecting MapPoints.
   static float mfGridElementWidthInv;
   static float mfGridElementHeightInv;
-  std::vector<std::size_t> mGrid[FRAME_GRID_COLS][FRAME_GRID_ROWS];
+  FeatureGrid mGrid;
 
-  // Camera pose.
-  cv::Mat mTcw;
+  // Camera pose, only meaningful if HasPose().
+  Eigen::Matrix4f mTcw = Eigen::Matrix4f::Identity();
 
   // Current and Next Frame id.
   static long unsigned int nNextId;
@@ -207,10 +215,11 @@ private:
   void AssignFeaturesToGrid();
 
   // Rotation, translation and camera center
-  cv::Mat mRcw;
-  cv::Mat mtcw;
-  cv::Mat mRwc;
-  cv::Mat mOw;  //==mtwc
+  Eigen::Matrix3f mRcw = Eigen::Matrix3f::Identity();
+  Eigen::Vector3f mtcw = Eigen::Vector3f::Zero();
+  Eigen::Matrix3f mRwc = Eigen::Matrix3f::Identity();
+  Eigen::Vector3f mOw = Eigen::Vector3f::Zero();  //==mtwc
+  bool mbHasPose = false;
 };
 
 }  // namespace ORB_SLAM2
@@ -0,0 +1,43 @@
+#pragma once
+
+// Internal
+#include "DescriptorArray.hpp"
+
+namespace ORB_SLAM2 {
+
+// Hamming distance kernels for 256 bit ORB descriptors (32 byte rows of a DescriptorArray).
+// One query is compared against a batch of candidate rows, with AVX2 (nibble lookup
+// popcount, 4 candidates per step) or hardware popcount, chosen once at runtime.
+// Every kernel returns the exact distances of the scalar bit counting.
+class HammingDistance final {
+public:
+  static constexpr int DESCRIPTOR_BYTES = 32;
+
+  // Best and second best candidate of a query. Indices are the row indices of the
+  // candidates, -1 if there was none.
+  struct Best {
+    int dist = 256;
+    int idx = -1;
+    int dist2 = 256;
+    int idx2 = -1;
+  };
+
+  static int Distance(const uint8_t *a, const uint8_t *b);
+
+  // distances[k] = Distance(query, descriptors.row(indices[k])) for k < n.
+  static void Compute(const uint8_t *query, const DescriptorArray &descriptors, const size_t *indices, size_t n, int *distances);
+
+  // distances[k] = Distance(query, blocks[k].data()) for k < n, over consecutive blocks
+  // (the children of a vocabulary node).
+  static void ComputeContiguous(const uint8_t *query, const DescriptorBlock *blocks, size_t n, int *distances);
+
+  // Best and second best of the candidates, visited in order with the rule of the matcher loops:
+  // "if(d < dist) { dist2 = dist; dist = d; } else if(d < dist2) dist2 = d;".
+  // Distances of 256 are never selected.
+  static Best FindBest(const uint8_t *query, const DescriptorArray &descriptors, const std::vector<size_t> &vIndices);
+
+  // Name of the kernel picked for this CPU ("avx2", "popcnt" or "scalar").
+  static const char *KernelName();
+};
+
+}  // namespace ORB_SLAM2
@@ -19,10 +19,12 @@
  */
 #pragma once
 // Internal
+#include "FeatureGrid.hpp"
+#include "BowVector.hpp"
+#include "FeatureVector.hpp"
 #include "ORBVocabulary.hpp"
-// DBoW2
-#include <DBoW2/BowVector.h>
-#include <DBoW2/FeatureVector.h>
+#include "DescriptorArray.hpp"
+#include "SeqLock.hpp"
 
 namespace ORB_SLAM2 {
 
@@ -33,16 +35,26 @@ class KeyFrameDatabase;
 
 class KeyFrame final {
 public:
+  // SE3 Pose, its inverse, camera center and stereo middle point, published together.
+  struct PoseState {
+    Eigen::Matrix4f Tcw;
+    Eigen::Matrix4f Twc;
+    Eigen::Vector3f Ow;
+    Eigen::Vector3f Cw;
+  };
+
   KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB);
 
-  // Pose functions
-  void SetPose(const cv::Mat &Tcw);
-  cv::Mat GetPose();
-  cv::Mat GetPoseInverse();
-  cv::Mat GetCameraCenter();
-  cv::Mat GetStereoCenter();
-  cv::Mat GetRotation();
-  cv::Mat GetTranslation();
+  // Pose functions. Getters do not lock, they read a consistent snapshot of the last SetPose.
+  // Each getter reads its own snapshot, use GetPoseState for several parts of the same pose.
+  void SetPose(const Eigen::Matrix4f &Tcw);
+  PoseState GetPoseState() const;
+  Eigen::Matrix4f GetPose() const;
+  Eigen::Matrix4f GetPoseInverse() const;
+  Eigen::Vector3f GetCameraCenter() const;
+  Eigen::Vector3f GetStereoCenter() const;
+  Eigen::Matrix3f GetRotation() const;
+  Eigen::Vector3f GetTranslation() const;
 
   // Bag of Words Representation
   void ComputeBoW();
@@ -82,7 +94,10 @@ public:
 
   // KeyPoint functions
   std::vector<size_t> GetFeaturesInArea(const float &x, const float &y, const float &r) const;
-  cv::Mat UnprojectStereo(int i);
+  // Into a caller owned buffer (cleared first), allocation free once the buffer has grown
+  void GetFeaturesInArea(const float &x, const float &y, const float &r, std::vector<size_t> &vIndices) const;
+  // Backprojects a keypoint into 3D world coordinates. Only valid if the keypoint has depth.
+  Eigen::Vector3f UnprojectStereo(int i) const;
 
   // Image
   [[nodiscard]] bool IsInImage(const float &x, const float &y) const;
@@ -124,17 +139,9 @@ public:
   long unsigned int mnBALocalForKF = 0;
   long unsigned int mnBAFixedForKF = 0;
 
-  // Variables used by the keyframe database
-  long unsigned int mnLoopQuery = 0;
-  int mnLoopWords = 0;
-  float mLoopScore = 0;
-  long unsigned int mnRelocQuery = 0;
-  int mnRelocWords = 0;
-  float mRelocScore = 0;
-
   // Variables used by loop closing
-  cv::Mat mTcwGBA;
-  cv::Mat mTcwBefGBA;
+  Eigen::Matrix4f mTcwGBA = Eigen::Matrix4f::Identity();
+  Eigen::Matrix4f mTcwBefGBA = Eigen::Matrix4f::Identity();
   long unsigned int mnBAGlobalForKF = 0;
 
   // Calibration parameters
@@ -148,14 +155,14 @@ public:
   const std::vector<cv::KeyPoint> mvKeysUn;
   const std::vector<float> mvuRight;  // negative value for monocular points
   const std::vector<float> mvDepth;   // negative value for monocular points
-  const cv::Mat mDescriptors;
+  const DescriptorArray mDescriptors;
 
   //BoW
-  DBoW2::BowVector mBowVec;
-  DBoW2::FeatureVector mFeatVec;
+  BowVector mBowVec;
+  FeatureVector mFeatVec;
 
   // Pose relative to parent (this is computed when bad flag is activated)
-  cv::Mat mTcp;
+  Eigen::Matrix4f mTcp = Eigen::Matrix4f::Identity();
 
   // Scale
   const int mnScaleLevels;
@@ -174,12 +181,8 @@ public:
 
   // The following variables need to be accessed trough a mutex to be thread safe.
 protected:
-  // SE3 Pose and camera center
-  cv::Mat Tcw;
-  cv::Mat Twc;
-  cv::Mat Ow;
-
-  cv::Mat Cw;  // Stereo middel point. Only for visualization
+  // SE3 Pose and camera center. Cw (stereo middle point) is only for visualization.
+  SeqLock<PoseState> mPose;
 
   // MapPoints associated to keypoints
   std::vector<MapPoint *> mvpMapPoints;
@@ -189,7 +192,7 @@ protected:
   ORBVocabulary *mpORBvocabulary = nullptr;
 
   // Grid over the image to speed up feature matching
-  std::vector<std::vector<std::vector<size_t> > > mGrid;
+  FeatureGrid mGrid;
 
   std::map<KeyFrame *, int> mConnectedKeyFrameWeights;
   std::vector<KeyFrame *> mvpOrderedConnectedKeyFrames;
@@ -210,6 +213,7 @@ protected:
 
   Map *mpMap = nullptr;
 
+  // Serializes the writers of mPose
   std::mutex mMutexPose;
   std::mutex mMutexConnections;
   std::mutex mMutexFeatures;
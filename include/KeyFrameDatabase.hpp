@@ -26,32 +26,132 @@ namespace ORB_SLAM2 {
 class Frame;
 class KeyFrame;
 
+// Inverted file of the keyframe words for loop detection and relocalization.
+//
+// add, erase and clear are rare writers and serialize on a mutex. The queries take no lock:
+// the writers publish the postings of a word and the keyframe table through atomic pointers,
+// append in place when there is room and replace a buffer (growth, compaction) otherwise.
+// A query pins the epoch it started in, the replaced buffers are freed once no query pins
+// an epoch they were reachable in. A query may see a keyframe that is being added with only
+// part of its words.
 class KeyFrameDatabase final {
 public:
+  // Scratch state of the queries of one caller (tracking, loop closing), indexed by keyframe
+  // id. An entry is only valid if its stamp is the stamp of the current query, so the tables
+  // are never cleared between queries. A context serves one query at a time.
+  class QueryContext final {
+  public:
+    QueryContext() = default;
+
+  protected:
+    friend class KeyFrameDatabase;
+
+    static constexpr uint32_t EXCLUDED = std::numeric_limits<uint32_t>::max();
+
+    // Starts a new query over keyframe ids lower than nIds
+    void Begin(size_t nIds);
+
+    [[nodiscard]] bool Touched(uint32_t id) const { return id < vStamps.size() && vStamps[id] == stamp; }
+
+    uint32_t stamp = 0;
+    std::vector<uint32_t> vStamps;
+    std::vector<uint32_t> vWords;  // shared words, EXCLUDED for the keyframes left out of the query
+    std::vector<float> vScores;    // 0 unless scored
+    std::vector<uint32_t> vCandidates;  // ids of the keyframes sharing words, in order of discovery
+    std::vector<KeyFrame *> vpCandidates;
+    std::vector<size_t> vScored;  // positions of the candidates sharing enough words
+  };
+
   explicit KeyFrameDatabase(const ORBVocabulary &voc);
 
+  ~KeyFrameDatabase();
+
+  KeyFrameDatabase(const KeyFrameDatabase &) = delete;
+
+  KeyFrameDatabase &operator=(const KeyFrameDatabase &) = delete;
+
   void add(KeyFrame *pKF);
 
+  // The postings of the keyframe are left as tombstones, a word is compacted once
+  // half of its postings are tombstones
   void erase(KeyFrame *pKF);
 
   void clear();
 
   // Loop Detection
-  std::vector<KeyFrame *> DetectLoopCandidates(KeyFrame *pKF, float minScore);
+  std::vector<KeyFrame *> DetectLoopCandidates(KeyFrame *pKF, float minScore, QueryContext &context);
 
   // Relocalization
-  std::vector<KeyFrame *> DetectRelocalizationCandidates(Frame *F);
+  std::vector<KeyFrame *> DetectRelocalizationCandidates(Frame *F, QueryContext &context);
 
 protected:
+  // Keyframe ids of a word in insertion order. The ids below size are never written again,
+  // the writer appends up to the capacity and replaces the buffer beyond it.
+  struct Postings {
+    explicit Postings(size_t capacity) : vIds(capacity) {}
+
+    std::vector<uint32_t> vIds;
+    std::atomic<uint32_t> size{0};
+  };
+
+  // Keyframes by id (KeyFrame::mnId), nullptr if not in the database
+  struct KeyFrameTable {
+    explicit KeyFrameTable(size_t capacity) : vpKeyFrames(capacity) {}
+
+    std::vector<std::atomic<KeyFrame *> > vpKeyFrames;
+  };
+
+  // Epoch guard of a query
+  class ReadGuard final {
+  public:
+    explicit ReadGuard(const KeyFrameDatabase &db);
+
+    ~ReadGuard();
+
+    ReadGuard(const ReadGuard &) = delete;
+
+    ReadGuard &operator=(const ReadGuard &) = delete;
+
+  private:
+    std::atomic<uint64_t> &mSlot;
+  };
+
+  static constexpr size_t MAX_READERS = 16;
+
+  // Claims a reader slot holding the current epoch, waits while all are taken
+  std::atomic<uint64_t> &Pin() const;
+
+  // Counts the words shared with bowVec in the context and lists the keyframes that share any
+  void CollectCandidates(const BowVector &bowVec, const KeyFrameTable &table, QueryContext &context) const;
+
+  // Scores the candidates sharing more than minCommonWords words, in parallel
+  void ScoreCandidates(const BowVector &bowVec, int minCommonWords, QueryContext &context) const;
+
+  // Writer side, called with mMutex held
+  void CompactWord(BowVector::WordId wordId);
+
+  void Retire(std::shared_ptr<void> pBuffer);
+
+  // Frees the retired buffers no query can reach anymore
+  void Reclaim();
+
   // Associated vocabulary
   const ORBVocabulary *mpVoc;
 
-  // Inverted file
-  std::vector<list<KeyFrame *> > mvInvertedFile;
+  std::atomic<KeyFrameTable *> mpKeyFrameTable;
 
-  // Mutex
-  std::mutex mMutex;
+  // Inverted file: for each word, the ids of the keyframes that have it. Erased keyframes stay
+  // as tombstones (their table entry is nullptr) until the word is compacted
+  std::vector<std::atomic<Postings *> > mvInvertedFile;
+  std::vector<uint32_t> mvTombstones;
+
+  // Epochs: a buffer replaced in epoch e is freed when every pinned reader epoch is above e
+  std::atomic<uint64_t> mEpoch{1};
+  mutable std::array<std::atomic<uint64_t>, MAX_READERS> mReaderEpochs{};
+  std::vector<std::pair<uint64_t, std::shared_ptr<void> > > mvRetired;
 
+  // Writers mutex
+  std::mutex mMutex;
 };
 
 }  // namespace ORB_SLAM2
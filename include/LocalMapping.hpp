@@ -71,21 +71,31 @@ public:
   }
 
 protected:
+  // Match of the current keyframe with a neighbor that passed the triangulation checks
+  struct TriangulatedPoint {
+    size_t idx1;
+    size_t idx2;
+    Eigen::Vector3f x3D;
+  };
+
   bool CheckNewKeyFrames();
 
   void ProcessNewKeyFrame();
 
   void CreateNewMapPoints();
 
+  // Matching and triangulation with one neighbor, thread safe. Does not modify the map
+  void TriangulateWithNeighbor(KeyFrame *pKF2, std::vector<TriangulatedPoint> &vNewPoints);
+
   void MapPointCulling();
 
   void SearchInNeighbors();
 
   void KeyFrameCulling();
 
-  cv::Mat ComputeF12(KeyFrame *&pKF1, KeyFrame *&pKF2);
+  Eigen::Matrix3f ComputeF12(KeyFrame *&pKF1, KeyFrame *&pKF2);
 
-  static cv::Mat SkewSymmetricMatrix(const cv::Mat &v);
+  static Eigen::Matrix3f SkewSymmetricMatrix(const Eigen::Vector3f &v);
 
   bool mbMonocular;
 
@@ -20,6 +20,7 @@
 #pragma once
 // Internal
 #include "ORBVocabulary.hpp"
+#include "KeyFrameDatabase.hpp"
 // g2o
 #include <g2o/types/types_seven_dof_expmap.h>
 
@@ -30,7 +31,6 @@ class MapPoint;
 class Tracking;
 class KeyFrame;
 class LocalMapping;
-class KeyFrameDatabase;
 
 class LoopClosing final {
 public:
@@ -93,6 +93,7 @@ protected:
   Tracking *mpTracker{};
 
   KeyFrameDatabase *mpKeyFrameDB;
+  KeyFrameDatabase::QueryContext mLoopQuery;
   ORBVocabulary *mpORBVocabulary;
 
   LocalMapping *mpLocalMapper{};
@@ -112,7 +113,7 @@ protected:
   std::vector<KeyFrame *> mvpCurrentConnectedKFs;
   std::vector<MapPoint *> mvpCurrentMatchedPoints;
   std::vector<MapPoint *> mvpLoopMapPoints;
-  cv::Mat mScw;
+  Eigen::Matrix4f mScw;
   g2o::Sim3 mg2oScw;
 
   long unsigned int mLastLoopKFid;
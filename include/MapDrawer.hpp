@@ -36,7 +36,7 @@ public:
 
   void DrawCurrentCamera(pangolin::OpenGlMatrix &Twc) const;
 
-  void SetCurrentCameraPose(const cv::Mat &Tcw);
+  void SetCurrentCameraPose(const Eigen::Matrix4f &Tcw);
 
   /*void SetReferenceKeyFrame(KeyFrame *pKF);*/
 
@@ -50,7 +50,8 @@ private:
   float mCameraSize;
   float mCameraLineWidth;
 
-  cv::Mat mCameraPose;
+  Eigen::Matrix4f mCameraPose = Eigen::Matrix4f::Identity();
+  bool mbCameraPose = false;
 
   std::mutex mMutexCamera;
 };
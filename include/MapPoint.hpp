@@ -18,6 +18,10 @@
  * along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
  */
 #pragma once
+// Internal
+#include "DescriptorArray.hpp"
+#include "ObservationList.hpp"
+#include "SeqLock.hpp"
 
 namespace ORB_SLAM2 {
 
@@ -27,19 +31,31 @@ class KeyFrame;
 
 class MapPoint final {
 public:
-  MapPoint(const cv::Mat &Pos, KeyFrame *pRefKF, Map *pMap);
+  // Position, mean viewing direction and scale invariance distances, published together.
+  struct PositionState {
+    Eigen::Vector3f worldPos;
+    Eigen::Vector3f normal;
+    float minDistance;
+    float maxDistance;
+  };
 
-  MapPoint(const cv::Mat &Pos, Map *pMap, Frame *pFrame, const int &idxF);
+  MapPoint(const Eigen::Vector3f &Pos, KeyFrame *pRefKF, Map *pMap);
 
-  void SetWorldPos(const cv::Mat &Pos);
+  MapPoint(const Eigen::Vector3f &Pos, Map *pMap, Frame *pFrame, const int &idxF);
 
-  cv::Mat GetWorldPos();
+  void SetWorldPos(const Eigen::Vector3f &Pos);
 
-  cv::Mat GetNormal();
+  // Consistent snapshot of the last update, read without locking
+  PositionState GetPositionState() const;
+
+  Eigen::Vector3f GetWorldPos() const;
+
+  Eigen::Vector3f GetNormal() const;
 
   KeyFrame *GetReferenceKeyFrame();
 
-  std::map<KeyFrame *, size_t> GetObservations();
+  // Copy of the observations, without allocation for points seen by few keyframes
+  ObservationList GetObservations();
 
   int Observations();
 
@@ -69,7 +85,7 @@ public:
 
   void ComputeDistinctiveDescriptors();
 
-  cv::Mat GetDescriptor();
+  DescriptorBlock GetDescriptor();
 
   void UpdateNormalAndDepth();
 
@@ -81,6 +97,26 @@ public:
 
   int PredictScale(const float &currentDist, Frame *pF);
 
+protected:
+  // Descriptor of an observation and its distances to the descriptors of all the observations
+  // (itself included), sorted. The distances are only kept up to MAX_CACHED_OBSERVATIONS.
+  struct ObservedDescriptor {
+    KeyFrame *pKF;
+    DescriptorBlock descriptor;
+    std::vector<uint16_t> vDistances;
+  };
+
+  // Beyond this many observations the N x N sorted distances are dropped (64 observations
+  // already take 8 KB) and ComputeDistinctiveDescriptors computes the medians from scratch
+  static constexpr size_t MAX_CACHED_OBSERVATIONS = 64;
+
+  // Update of the observed descriptors, called with mMutexFeatures locked
+  void AddObservedDescriptor(KeyFrame *pKF, size_t idx);
+
+  void EraseObservedDescriptor(KeyFrame *pKF);
+
+  void RebuildObservedDistances();
+
 public:
   long unsigned int mnId = 0;
   static long unsigned int nNextId;
@@ -106,23 +142,27 @@ public:
   long unsigned int mnLoopPointForKF = 0;
   long unsigned int mnCorrectedByKF = 0;
   long unsigned int mnCorrectedReference = 0;
-  cv::Mat mPosGBA;
+  Eigen::Vector3f mPosGBA = Eigen::Vector3f::Zero();
   long unsigned int mnBAGlobalForKF = 0;
 
   static std::mutex mGlobalMutex;
 
 protected:
-  // Position in absolute coordinates
-  cv::Mat mWorldPos;
+  // Position in absolute coordinates, mean viewing direction and scale invariance distances.
+  // Written with mMutexPos locked.
+  SeqLock<PositionState> mPosition;
 
   // Keyframes observing the point and associated index in keyframe
-  std::map<KeyFrame *, size_t> mObservations;
-
-  // Mean viewing direction
-  cv::Mat mNormalVector;
+  ObservationList mObservations;
 
   // Best descriptor to fast matching
-  cv::Mat mDescriptor;
+  DescriptorBlock mDescriptor{};
+
+  // One entry per observation, in the KeyFrame order of mObservations. While the distances
+  // are cached, a point keeps N^2 uint16_t, adding or erasing an observation computes N
+  // distances and does N sorted inserts or erases (O(N^2) element moves), and
+  // ComputeDistinctiveDescriptors reads the medians in O(N)
+  std::vector<ObservedDescriptor> mvObservedDescriptors;
 
   // Reference KeyFrame
   KeyFrame *mpRefKF = nullptr;
@@ -135,10 +175,6 @@ protected:
   bool mbBad = false;
   MapPoint *mpReplaced = nullptr;
 
-  // Scale invariance distances
-  float mfMinDistance = 0;
-  float mfMaxDistance = 0;
-
   Map *mpMap = nullptr;
 
   std::mutex mMutexPos;
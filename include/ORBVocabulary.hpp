@@ -18,13 +18,164 @@
  * along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
  */
 #pragma once
-// DBoW2
-#include <DBoW2/FORB.h>
-#include <DBoW2/TemplatedVocabulary.h>
+// Internal
+#include "BowVector.hpp"
+#include "FeatureVector.hpp"
+#include "DescriptorArray.hpp"
+
+namespace utilities {
+class ThreadPool;
+}
 
 namespace ORB_SLAM2 {
 
-using ORBVocabulary = DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB>;
+// ORB vocabulary tree (k-means tree of 256 bit descriptors) kept as one flat image:
+// a header followed by contiguous sections for the nodes, their descriptors and the
+// word weights. Nodes are numbered breadth first, so the children of a node are a
+// contiguous range and so are their descriptors.
+//
+// The image is either memory mapped from a flat vocabulary file and used in place, or
+// built in memory from the DBoW2 text (ORBvoc.txt) and binary formats. Transform and
+// score follow TemplatedVocabulary<FORB::TDescriptor, FORB>, word ids are the ones of
+// the original file.
+class ORBVocabulary final {
+public:
+  // Flat file layout, version 1. All the sections are 64 byte aligned.
+  struct FlatHeader {
+    static constexpr char MAGIC[8] = {'O', 'R', 'B', 'V', 'O', 'C', 'F', '\0'};
+    static constexpr uint32_t VERSION = 1;
 
-}  // namespace ORB_SLAM2
+    char magic[8];
+    uint32_t version;
+    uint32_t k;
+    uint32_t L;
+    uint32_t scoring;
+    uint32_t weighting;
+    uint32_t nodes;
+    uint32_t words;
+    uint32_t reserved;
+    // Byte offsets from the start of the file
+    uint64_t nodesOffset;
+    uint64_t descriptorsOffset;
+    uint64_t wordNodesOffset;
+    uint64_t wordWeightsOffset;
+    uint64_t fileSize;
+    // Of the bytes after the header, and of the header with this field set to 0
+    uint64_t payloadChecksum;
+    uint64_t headerChecksum;
+  };
+
+  struct FlatNode {
+    uint32_t firstChild;  // 0 for a leaf (the root is never a child)
+    uint32_t childCount;
+    uint32_t parent;
+    uint32_t wordId;  // NO_WORD unless a leaf
+  };
+
+  static constexpr uint32_t NO_WORD = std::numeric_limits<uint32_t>::max();
+
+  ORBVocabulary() = default;
+
+  ~ORBVocabulary();
+
+  ORBVocabulary(const ORBVocabulary &) = delete;
+
+  ORBVocabulary &operator=(const ORBVocabulary &) = delete;
+
+  // Detects the format from the file contents: flat (by its magic), DBoW2 text or DBoW2 binary.
+  bool Load(const std::string &filename);
+
+  // Maps a flat file. The tree structure is always checked, the payload checksum reads the whole
+  // file and is only checked on request.
+  bool LoadFromFlatFile(const std::string &filename, bool bVerifyPayload = false);
+
+  bool LoadFromTextFile(const std::string &filename);
+
+  bool LoadFromBinFile(const std::string &filename);
+
+  bool SaveToFlatFile(const std::string &filename) const;
+
+  // Number of words
+  [[nodiscard]] unsigned int size() const { return mpHeader ? mpHeader->words : 0; }
+
+  [[nodiscard]] bool empty() const { return size() == 0; }
+
+  [[nodiscard]] int getBranchingFactor() const { return static_cast<int>(mpHeader->k); }
+
+  [[nodiscard]] int getDepthLevels() const { return static_cast<int>(mpHeader->L); }
 
+  // BoW vector of the descriptors (rows of a N x 32 CV_8U matrix or 1 x 32 rows), and for each
+  // feature the node "levelsup" levels over its word.
+  void transform(const std::vector<cv::Mat> &features, BowVector &v, FeatureVector &fv, int levelsup) const;
+
+  // Same as above for all the descriptors of a frame. The descriptors are pushed down the tree
+  // in parallel on pThreadPool (if given) and the vectors are filled in feature order, so the
+  // result does not depend on the number of threads.
+  void transform(const DescriptorArray &descriptors, BowVector &v, FeatureVector &fv, int levelsup,
+                 utilities::ThreadPool *pThreadPool = nullptr) const;
+
+  [[nodiscard]] double score(const BowVector &a, const BowVector &b) const {
+    return BowVector::Score(static_cast<DBoW2::ScoringType>(mpHeader->scoring), a, b);
+  }
+
+protected:
+  // Word of a descriptor, its weight and the node at level L - levelsup
+  void TransformOne(const uint8_t *descriptor, DBoW2::WordId &wordId, DBoW2::WordValue &weight, DBoW2::NodeId *nid, int levelsup) const;
+
+  // Word of each descriptor, in order
+  struct WordAssignment {
+    DBoW2::WordId wordId;
+    DBoW2::WordValue weight;
+    DBoW2::NodeId nid;
+  };
+
+  // Fills v and fv from the assignments of features 0..n-1 with the DBoW2 weighting rules.
+  // Words and nodes are sorted as (id, feature) keys in a per thread buffer, and the vectors
+  // are sized once, so a vector reused across frames does not allocate.
+  void Accumulate(const WordAssignment *pAssignments, size_t n, BowVector &v, FeatureVector &fv) const;
+
+  // Tree of a DBoW2 file, nodes in file order
+  struct ParsedTree {
+    uint32_t k = 0;
+    uint32_t L = 0;
+    uint32_t scoring = 0;
+    uint32_t weighting = 0;
+    std::vector<uint32_t> vParents;  // vParents[0] is the root
+    std::vector<uint8_t> vbLeaf;
+    std::vector<DescriptorBlock> vDescriptors;
+    std::vector<double> vWeights;
+  };
+
+  static bool ParseTextFile(const std::string &filename, ParsedTree &tree);
+
+  static bool ParseBinFile(const std::string &filename, ParsedTree &tree);
+
+  // Builds the flat image of a parsed tree into mvOwned
+  bool Build(const ParsedTree &tree);
+
+  // Points the section views to a validated image
+  bool Attach(const uint8_t *pImage, size_t size, bool bVerifyPayload);
+
+  void Release();
+
+  static uint64_t Checksum(const uint8_t *data, size_t size);
+
+protected:
+  struct alignas(64) ImageBlock {
+    uint8_t bytes[64];
+  };
+
+  // Image in memory (built from a DBoW2 file) or mapped from a flat file
+  std::vector<ImageBlock> mvOwned;
+  void *mpMapped = nullptr;
+  size_t mMappedSize = 0;
+
+  // Views into the image
+  const FlatHeader *mpHeader = nullptr;
+  const FlatNode *mpNodes = nullptr;
+  const DescriptorBlock *mpDescriptors = nullptr;
+  const uint32_t *mpWordNodes = nullptr;
+  const double *mpWordWeights = nullptr;
+};
+
+}  // namespace ORB_SLAM2
@@ -0,0 +1,39 @@
+#pragma once
+
+namespace ORB_SLAM2 {
+
+// Steered BRIEF (rBRIEF) descriptor and keypoint orientation kernels.
+// The 256 test pairs are kept in structure-of-arrays form so that the rotated
+// sample offsets can be computed and gathered in batches of 8 (AVX2) or 4 (SSE2).
+// The kernel is chosen once at runtime from the CPU features, every variant
+// produces bit-identical descriptors, the same as the original ORBextractor
+// loop built with the same flags (with or without FMA).
+class ORBdescriptor final {
+public:
+  // pattern: 512 points, two consecutive points per binary test.
+  explicit ORBdescriptor(const cv::Point *pattern);
+
+  // Compute one 32 byte descriptor per keypoint into the rows of descriptors.
+  // descriptors must be allocated as keypoints.size() x 32 CV_8U.
+  void Compute(const cv::Mat &image, const std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) const;
+
+  // Intensity centroid orientation (IC_Angle) of a batch of keypoints, in degrees.
+  // umax holds the half width of each row of the 31x31 circular patch.
+  // Rows are summed with SIMD multiply-adds, the angles are the same as the scalar loop.
+  static void ComputeOrientations(const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints, const std::vector<int> &umax);
+
+  // Name of the kernel picked for this CPU ("avx2", "sse2" or "scalar").
+  static const char *KernelName();
+
+  static constexpr int NUM_TESTS = 256;
+
+private:
+  alignas(32) float mX0[NUM_TESTS];
+  alignas(32) float mY0[NUM_TESTS];
+  alignas(32) float mX1[NUM_TESTS];
+  alignas(32) float mY1[NUM_TESTS];
+
+  std::vector<cv::Point> mPattern;
+};
+
+}  // namespace ORB_SLAM2
@@ -18,20 +18,15 @@
  * along with ORB-SLAM2. If not, see <http://www.gnu.org/licenses/>.
  */
 #pragma once
+// Internal
+#include "ORBdescriptor.hpp"
+#include "DescriptorArray.hpp"
 
-namespace ORB_SLAM2 {
-
-class ExtractorNode final {
-public:
-  ExtractorNode() : bNoMore(false) {}
+namespace utilities {
+class ThreadPool;
+}  // namespace utilities
 
-  void DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4);
-
-  std::vector<cv::KeyPoint> vKeys;
-  cv::Point2i UL, UR, BL, BR;
-  std::list<ExtractorNode>::iterator lit;
-  bool bNoMore;
-};
+namespace ORB_SLAM2 {
 
 class ORBextractor final {
 public:
@@ -43,9 +38,14 @@ public:
 
   // Compute the ORB features and descriptors on an image.
   // ORB are dispersed on the image using an octree.
-  // Mask is ignored in the current implementation.
+  // Optional mask (CV_8UC1, image size): features are only extracted where it is non-zero.
+  // FAST cells that are fully masked are skipped and the feature budget of each level is
+  // spread over its unmasked area. If empty, the mask set with SetMask is used.
   void operator()(cv::InputArray image, cv::InputArray mask, std::vector<cv::KeyPoint> &keypoints, cv::OutputArray descriptors);
 
+  // Same, with the descriptors written straight into an aligned descriptor array.
+  void operator()(cv::InputArray image, cv::InputArray mask, std::vector<cv::KeyPoint> &keypoints, DescriptorArray &descriptors);
+
   int inline GetLevels() { return nlevels; }
 
   float inline GetScaleFactor() { return scaleFactor; }
@@ -58,24 +58,70 @@ public:
 
   std::vector<float> inline GetInverseScaleSigmaSquares() { return mvInvLevelSigma2; }
 
+  // Spread FAST cells, octree distribution and descriptors of the pyramid levels
+  // over a worker pool. nullptr (the default) runs everything on the calling thread.
+  // The output is the same, in the same order, in both cases.
+  void inline SetThreadPool(utilities::ThreadPool *pThreadPool) { mpThreadPool = pThreadPool; }
+
+  // Total number of features requested per image, spread over the levels as in the constructor.
+  // Takes effect on the next call to operator().
+  void SetFeatureBudget(int nFeatures);
+
+  int inline GetFeatureBudget() const { return nfeatures; }
+
+  // FAST thresholds used for the next images (the minimum one is the fallback for empty cells).
+  void inline SetFASTThresholds(int iniTh, int minTh) {
+    iniThFAST = iniTh;
+    minThFAST = minTh;
+  }
+
+  int inline GetInitialFASTThreshold() const { return iniThFAST; }
+
+  int inline GetMinimumFASTThreshold() const { return minThFAST; }
+
+  // Mask applied to every image for which operator() gets no mask (e.g. a fixed occlusion
+  // of the camera rig). An empty mask disables it. A mask that is not CV_8UC1 of the image
+  // size is reported and ignored.
+  void inline SetMask(const cv::Mat &mask) { mMask = mask.clone(); }
+
+  // Number of pyramid buffers allocated so far. It only grows when the
+  // input resolution changes, steady-state extraction does not allocate.
+  size_t inline GetPyramidAllocations() const { return mnPyramidAllocations; }
+
+  // Spreads the keypoints of one level (coordinates relative to (minX, minY)) with a quadtree
+  // and keeps the best response of each node, about nFeatures of them.
+  static std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint> &vToDistributeKeys,
+                                                     const int &minX,
+                                                     const int &maxX,
+                                                     const int &minY,
+                                                     const int &maxY,
+                                                     const int &nFeatures,
+                                                     const int &level);
+
   std::vector<cv::Mat> mvImagePyramid;
 
 protected:
+  // Shared body of the operator() overloads, allocateDescriptors(n) returns the N x 32 CV_8U output rows.
+  void Extract(cv::InputArray image, cv::InputArray mask, std::vector<cv::KeyPoint> &keypoints,
+               const std::function<cv::Mat(int)> &allocateDescriptors);
+
+  void ComputeFeaturesPerLevel();
+
+  void AllocatePyramid(const cv::Size &imageSize, int type);
+
   void ComputePyramid(const cv::Mat& image);
 
-  void ComputeKeyPointsOctTree(std::vector<std::vector<cv::KeyPoint> > &allKeypoints);
+  void ComputeMaskPyramid(const cv::Mat &mask);
+
+  std::vector<int> ComputeMaskedFeaturesPerLevel() const;
 
-  std::vector<cv::KeyPoint> DistributeOctTree(const std::vector<cv::KeyPoint> &vToDistributeKeys,
-                                              const int &minX,
-                                              const int &maxX,
-                                              const int &minY,
-                                              const int &maxY,
-                                              const int &nFeatures,
-                                              const int &level) const;
+  void ComputeKeyPointsOctTree(std::vector<std::vector<cv::KeyPoint> > &allKeypoints, const std::vector<int> &vFeaturesPerLevel, bool bMask);
+
+  void ParallelFor(size_t n, const std::function<void(size_t)> &body) const;
 
   [[maybe_unused]] void ComputeKeyPointsOld(std::vector<std::vector<cv::KeyPoint> > &allKeypoints);
 
-  std::vector<cv::Point> pattern;
+  ORBdescriptor mDescriptor;
 
   int nfeatures;
   double scaleFactor;
@@ -91,6 +137,22 @@ protected:
   std::vector<float> mvInvScaleFactor;
   std::vector<float> mvLevelSigma2;
   std::vector<float> mvInvLevelSigma2;
+
+  utilities::ThreadPool *mpThreadPool = nullptr;
+
+  // Pyramid arena: padded level images (mvImagePyramid are ROIs into them)
+  // and the blurred levels used for the descriptors.
+  std::vector<cv::Mat> mvPyramidBuffers;
+  std::vector<cv::Mat> mvBlurredPyramid;
+  cv::Size mPyramidImageSize;
+  int mPyramidImageType = -1;
+  size_t mnPyramidAllocations = 0;
+
+  // Detection mask, default one and its pyramid
+  cv::Mat mMask;
+  std::vector<cv::Mat> mvMaskPyramid;
+  // Image size for which a mismatching mask was last reported, so it is logged once per size
+  cv::Size mRejectedMaskSize;
 };
 
 }  // namespace ORB_SLAM2
@@ -19,21 +19,30 @@
  */
 #pragma once
 
+namespace utilities {
+class ThreadPool;
+}
+
 namespace ORB_SLAM2 {
 
 class Frame;
 class MapPoint;
 class KeyFrame;
+class FeatureVector;
 
 class ORBmatcher final {
 public:
   explicit ORBmatcher(float nnratio = 0.6, bool checkOri = true);
 
+  // Pool used by the searches that run in parallel, they run on the caller if not set.
+  void inline SetThreadPool(utilities::ThreadPool *pThreadPool) { mpThreadPool = pThreadPool; }
+
   // Computes the Hamming distance between two ORB descriptors
   static int DescriptorDistance(const cv::Mat &a, const cv::Mat &b);
 
   // Search matches between Frame keypoints and projected MapPoints. Returns number of matches
-  // Used to track the local map (Tracking)
+  // Used to track the local map (Tracking). The map points are matched in parallel, the matches
+  // are the same as the ones of a sequential search
   int SearchByProjection(Frame &F, const std::vector<MapPoint *> &vpMapPoints, float th = 3);
 
   // Project MapPoints tracked in last frame into the current frame and search matches.
@@ -46,11 +55,11 @@ public:
 
   // Project MapPoints using a Similarity Transformation and search matches.
   // Used in loop detection (Loop Closing)
-  static int SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const std::vector<MapPoint *> &vpPoints, std::vector<MapPoint *> &vpMatched, int th);
+  static int SearchByProjection(KeyFrame *pKF, const Eigen::Matrix4f &Scw, const std::vector<MapPoint *> &vpPoints, std::vector<MapPoint *> &vpMatched, int th);
 
   // Search matches between MapPoints in a KeyFrame and ORB in a Frame.
   // Brute force constrained to ORB that belong to the same vocabulary node (at a certain level)
-  // Used in Relocalisation and Loop Detection
+  // Used in Relocalisation and Loop Detection. The nodes are matched in parallel
   int SearchByBoW(KeyFrame *pKF, Frame &F, std::vector<MapPoint *> &vpMapPointMatches);
 
   int SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, std::vector<MapPoint *> &vpMatches12);
@@ -59,17 +68,21 @@ public:
   int SearchForInitialization(Frame &F1, Frame &F2, std::vector<cv::Point2f> &vbPrevMatched, std::vector<int> &vnMatches12, int windowSize = 10);
 
   // Matching to triangulate new MapPoints. Check Epipolar Constraint.
-  int SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F12, std::vector<std::pair<size_t, size_t> > &vMatchedPairs, bool bOnlyStereo);
+  int SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, const Eigen::Matrix3f &F12, std::vector<std::pair<size_t, size_t> > &vMatchedPairs, bool bOnlyStereo);
 
   // Search matches between MapPoints seen in KF1 and KF2 transforming by a Sim3 [s12*R12|t12]
   // In the stereo and RGB-D case, s12=1
-  static int SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, std::vector<MapPoint *> &vpMatches12, const float &s12, const cv::Mat &R12, const cv::Mat &t12, float th);
+  static int SearchBySim3(KeyFrame *pKF1, KeyFrame *pKF2, std::vector<MapPoint *> &vpMatches12, const float &s12, const Eigen::Matrix3f &R12, const Eigen::Vector3f &t12, float th);
 
   // Project MapPoints into KeyFrame and search for duplicated MapPoints.
   static int Fuse(KeyFrame *pKF, const std::vector<MapPoint *> &vpMapPoints, float th = 3.0);
 
+  // Same for several keyframes. The projections run in parallel on the map as it is before the call,
+  // the replacements and new observations are then applied in keyframe and MapPoint order.
+  int Fuse(const std::vector<KeyFrame *> &vpKFs, const std::vector<MapPoint *> &vpMapPoints, float th = 3.0);
+
   // Project MapPoints into KeyFrame using a given Sim3 and search for duplicated MapPoints.
-  static int Fuse(KeyFrame *pKF, cv::Mat Scw, const std::vector<MapPoint *> &vpPoints, float th, std::vector<MapPoint *> &vpReplacePoint);
+  static int Fuse(KeyFrame *pKF, const Eigen::Matrix4f &Scw, const std::vector<MapPoint *> &vpPoints, float th, std::vector<MapPoint *> &vpReplacePoint);
 
 public:
   static const int TH_LOW;
@@ -77,14 +90,33 @@ public:
   static const int HISTO_LENGTH;
 
 protected:
-  static bool CheckDistEpipolarLine(const cv::KeyPoint &kp1, const cv::KeyPoint &kp2, const cv::Mat &F12, const KeyFrame *pKF);
+  static bool CheckDistEpipolarLine(const cv::KeyPoint &kp1, const cv::KeyPoint &kp2, const Eigen::Matrix3f &F12, const KeyFrame *pKF);
 
   static float RadiusByViewingCos(const float &viewCos);
 
+  // Keypoint of F matched to a local map point, -1 if none. vCandidates returns the compared keypoints
+  int MatchLocalMapPoint(const Frame &F, MapPoint *pMP, float th, std::vector<size_t> &vIndices, std::vector<size_t> &vCandidates) const;
+
+  void ParallelFor(size_t n, const std::function<void(size_t)> &body) const;
+
+  // Keypoint of pKF to fuse pMP with, -1 if none. Tcw and Ow are the pose of pKF
+  static int SearchFuse(KeyFrame *pKF, const Eigen::Matrix4f &Tcw, const Eigen::Vector3f &Ow, MapPoint *pMP, float th,
+                        std::vector<size_t> &vIndices, std::vector<size_t> &vCandidates);
+
+  // Replace the MapPoint of the keypoint or add pMP as a new observation
+  static void ApplyFuse(KeyFrame *pKF, MapPoint *pMP, int bestIdx);
+
+  // Runs matchNode(vIndices1, vIndices2, vCandidates, rotHist) in parallel for the nodes shared by both
+  // feature vectors and returns the sum of its results. rotHist receives the node histograms in node order
+  template<typename MatchNode>
+  int SearchSharedNodes(const FeatureVector &vFeatVec1, const FeatureVector &vFeatVec2, std::vector<int> *rotHist, MatchNode matchNode) const;
+
   static void ComputeThreeMaxima(std::vector<int> *histo, int L, int &ind1, int &ind2, int &ind3);
 
   float mfNNratio;
   bool mbCheckOrientation;
+
+  utilities::ThreadPool *mpThreadPool = nullptr;
 };
 
 }  // namespace ORB_SLAM2
@@ -0,0 +1,93 @@
+#pragma once
+
+namespace ORB_SLAM2 {
+
+class KeyFrame;
+
+// Observations of a MapPoint: (KeyFrame, keypoint index) pairs sorted by KeyFrame, in the order of
+// the std::map they replace. Up to INLINE_CAPACITY pairs live inside the object, so copying the
+// observations of most points is a plain copy without allocation or tree walk.
+class ObservationList final {
+public:
+  using value_type = std::pair<KeyFrame *, size_t>;
+  using const_iterator = const value_type *;
+
+  static constexpr size_t INLINE_CAPACITY = 8;
+
+  [[nodiscard]] size_t size() const noexcept { return mnSize; }
+
+  [[nodiscard]] bool empty() const noexcept { return mnSize == 0; }
+
+  [[nodiscard]] const_iterator begin() const noexcept { return data(); }
+
+  [[nodiscard]] const_iterator end() const noexcept { return data() + mnSize; }
+
+  // Observation of pKF, end() if pKF does not observe the point.
+  [[nodiscard]] const_iterator find(KeyFrame *pKF) const {
+    const const_iterator it = lowerBound(pKF);
+    return it != end() && it->first == pKF ? it : end();
+  }
+
+  [[nodiscard]] size_t count(KeyFrame *pKF) const { return find(pKF) != end() ? 1 : 0; }
+
+  // Returns false if pKF already observes the point, the index is then left unchanged.
+  bool insert(KeyFrame *pKF, size_t idx) {
+    const size_t pos = static_cast<size_t>(lowerBound(pKF) - begin());
+    if(pos < mnSize && data()[pos].first == pKF)
+      return false;
+
+    if(mnSize == INLINE_CAPACITY)
+      mvSpilled.assign(mInline, mInline + INLINE_CAPACITY);
+
+    if(mnSize >= INLINE_CAPACITY) {
+      mvSpilled.insert(mvSpilled.begin() + pos, value_type(pKF, idx));
+    } else {
+      std::move_backward(mInline + pos, mInline + mnSize, mInline + mnSize + 1);
+      mInline[pos] = value_type(pKF, idx);
+    }
+    mnSize++;
+    return true;
+  }
+
+  bool erase(KeyFrame *pKF) {
+    const const_iterator it = find(pKF);
+    if(it == end())
+      return false;
+
+    const size_t pos = static_cast<size_t>(it - begin());
+    if(mnSize > INLINE_CAPACITY) {
+      mvSpilled.erase(mvSpilled.begin() + pos);
+      if(mnSize - 1 == INLINE_CAPACITY) {
+        std::copy(mvSpilled.begin(), mvSpilled.end(), mInline);
+        mvSpilled.clear();
+      }
+    } else {
+      std::move(mInline + pos + 1, mInline + mnSize, mInline + pos);
+    }
+    mnSize--;
+    return true;
+  }
+
+  void clear() noexcept {
+    mvSpilled.clear();
+    mnSize = 0;
+  }
+
+private:
+  [[nodiscard]] const value_type *data() const noexcept {
+    return mnSize > INLINE_CAPACITY ? mvSpilled.data() : mInline;
+  }
+
+  [[nodiscard]] const_iterator lowerBound(KeyFrame *pKF) const {
+    return std::lower_bound(begin(), end(), pKF, [](const value_type &observation, KeyFrame *pKey) {
+      return std::less<KeyFrame *>()(observation.first, pKey);
+    });
+  }
+
+  value_type mInline[INLINE_CAPACITY];
+  // All the observations once there are more than INLINE_CAPACITY
+  std::vector<value_type> mvSpilled;
+  size_t mnSize = 0;
+};
+
+}  // namespace ORB_SLAM2
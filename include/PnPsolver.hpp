@@ -56,19 +56,24 @@ class MapPoint;
 
 class PnPsolver final {
 public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   PnPsolver(const Frame &F, const std::vector<MapPoint *> &vpMapPointMatches);
 
   ~PnPsolver();
 
   void SetRansacParameters(double probability = 0.99, int minInliers = 8, int maxIterations = 300, int minSet = 4, float epsilon = 0.4, float th2 = 5.991);
 
-  cv::Mat find(std::vector<bool> &vbInliers, int &nInliers);
+  bool find(std::vector<bool> &vbInliers, int &nInliers, Eigen::Matrix4f &Tcw);
 
-  cv::Mat iterate(int nIterations, bool &bNoMore, std::vector<bool> &vbInliers, int &nInliers);
+  bool iterate(int nIterations, bool &bNoMore, std::vector<bool> &vbInliers, int &nInliers, Eigen::Matrix4f &Tcw);
 
 private:
   void CheckInliers();
 
+  // Current estimation mRi, mti as a 4x4 pose
+  [[nodiscard]] Eigen::Matrix4f CurrentPose() const;
+
   bool Refine();
 
   // Functions from the original EPnP code
@@ -150,7 +155,6 @@ private:
   // Current Estimation
   double mRi[3][3] = {};
   double mti[3] = {};
-  cv::Mat mTcwi;
   std::vector<bool> mvbInliersi;
   int mnInliersi = 0;
 
@@ -158,10 +162,10 @@ private:
   int mnIterations = 0;
   std::vector<bool> mvbBestInliers;
   int mnBestInliers = 0;
-  cv::Mat mBestTcw;
+  Eigen::Matrix4f mBestTcw = Eigen::Matrix4f::Identity();
 
   // Refined
-  cv::Mat mRefinedTcw;
+  Eigen::Matrix4f mRefinedTcw = Eigen::Matrix4f::Identity();
   std::vector<bool> mvbRefinedInliers;
   int mnRefinedInliers = 0;
 
@@ -0,0 +1,60 @@
+#pragma once
+
+namespace ORB_SLAM2 {
+
+// Versioned storage for a small value copied bitwise (fixed-size Eigen matrices and plain
+// aggregates of them). Load never takes a lock: it copies the value and retries while a Store
+// is in progress or has run meanwhile. Writers are rare and must be serialized by the caller.
+template<typename T>
+class SeqLock final {
+  static_assert(std::is_trivially_destructible<T>::value, "SeqLock stores plain values");
+
+public:
+  SeqLock() = default;
+
+  explicit SeqLock(const T &value) { Write(value); }
+
+  SeqLock(const SeqLock &) = delete;
+
+  SeqLock &operator=(const SeqLock &) = delete;
+
+  void Store(const T &value) {
+    const uint32_t sequence = mSequence.load(std::memory_order_relaxed);
+    // Odd while the words are being written
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    Write(value);
+    mSequence.store(sequence + 2, std::memory_order_release);
+  }
+
+  [[nodiscard]] T Load() const {
+    uint64_t words[WORDS];
+    uint32_t before, after;
+    do {
+      before = mSequence.load(std::memory_order_acquire);
+      for(size_t i = 0; i < WORDS; i++)
+        words[i] = mWords[i].load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = mSequence.load(std::memory_order_relaxed);
+    } while((before & 1) != 0 || before != after);
+
+    T value;
+    std::memcpy(static_cast<void *>(&value), words, sizeof(T));
+    return value;
+  }
+
+private:
+  static constexpr size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+  void Write(const T &value) {
+    uint64_t words[WORDS] = {};
+    std::memcpy(words, static_cast<const void *>(&value), sizeof(T));
+    for(size_t i = 0; i < WORDS; i++)
+      mWords[i].store(words[i], std::memory_order_relaxed);
+  }
+
+  std::atomic<uint32_t> mSequence{0};
+  std::atomic<uint64_t> mWords[WORDS] = {};
+};
+
+}  // namespace ORB_SLAM2
@@ -26,38 +26,42 @@ class KeyFrame;
 
 class Sim3Solver final {
 public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
   Sim3Solver(KeyFrame *pKF1, KeyFrame *pKF2, const std::vector<MapPoint *> &vpMatched12, bool bFixScale = true);
 
   void SetRansacParameters(double probability = 0.99, int minInliers = 6, int maxIterations = 300);
 
-  cv::Mat find(std::vector<bool> &vbInliers12, int &nInliers);
+  // True, with T12 set, once a hypothesis has more than the minimum number of inliers
+  bool find(std::vector<bool> &vbInliers12, int &nInliers, Eigen::Matrix4f &T12);
 
-  cv::Mat iterate(int nIterations, bool &bNoMore, std::vector<bool> &vbInliers, int &nInliers);
+  bool iterate(int nIterations, bool &bNoMore, std::vector<bool> &vbInliers, int &nInliers, Eigen::Matrix4f &T12);
 
-  cv::Mat GetEstimatedRotation();
+  [[nodiscard]] Eigen::Matrix3f GetEstimatedRotation() const;
 
-  cv::Mat GetEstimatedTranslation();
+  [[nodiscard]] Eigen::Vector3f GetEstimatedTranslation() const;
 
   [[nodiscard]] float GetEstimatedScale() const;
 
 protected:
-  static void ComputeCentroid(cv::Mat &P, cv::Mat &Pr, cv::Mat &C);
+  // Points are the columns of P
+  static void ComputeCentroid(const Eigen::Matrix3f &P, Eigen::Matrix3f &Pr, Eigen::Vector3f &C);
 
-  void ComputeSim3(cv::Mat &P1, cv::Mat &P2);
+  void ComputeSim3(const Eigen::Matrix3f &P1, const Eigen::Matrix3f &P2);
 
   void CheckInliers();
 
-  static void Project(const std::vector<cv::Mat> &vP3Dw, std::vector<cv::Mat> &vP2D, const cv::Mat& Tcw, cv::Mat K);
+  static void Project(const std::vector<Eigen::Vector3f> &vP3Dw, std::vector<Eigen::Vector2f> &vP2D, const Eigen::Matrix4f &Tcw, const Eigen::Matrix3f &K);
 
-  static void FromCameraToImage(const std::vector<cv::Mat> &vP3Dc, std::vector<cv::Mat> &vP2D, cv::Mat K);
+  static void FromCameraToImage(const std::vector<Eigen::Vector3f> &vP3Dc, std::vector<Eigen::Vector2f> &vP2D, const Eigen::Matrix3f &K);
 
 protected:
   // KeyFrames and matches
   [[maybe_unused]] KeyFrame *mpKF1;
   [[maybe_unused]] KeyFrame *mpKF2;
 
-  std::vector<cv::Mat> mvX3Dc1;
-  std::vector<cv::Mat> mvX3Dc2;
+  std::vector<Eigen::Vector3f> mvX3Dc1;
+  std::vector<Eigen::Vector3f> mvX3Dc2;
   std::vector<MapPoint *> mvpMapPoints1;
   std::vector<MapPoint *> mvpMapPoints2;
   [[maybe_unused]] std::vector<MapPoint *> mvpMatches12;
@@ -71,11 +75,11 @@ protected:
   int mN1;
 
   // Current Estimation
-  cv::Mat mR12i;
-  cv::Mat mt12i;
+  Eigen::Matrix3f mR12i;
+  Eigen::Vector3f mt12i;
   float ms12i{};
-  cv::Mat mT12i;
-  cv::Mat mT21i;
+  Eigen::Matrix4f mT12i;
+  Eigen::Matrix4f mT21i;
   std::vector<bool> mvbInliersi;
   int mnInliersi{};
 
@@ -83,9 +87,9 @@ protected:
   int mnIterations;
   [[maybe_unused]] std::vector<bool> mvbBestInliers;
   int mnBestInliers;
-  cv::Mat mBestT12;
-  cv::Mat mBestRotation;
-  cv::Mat mBestTranslation;
+  Eigen::Matrix4f mBestT12;
+  Eigen::Matrix3f mBestRotation;
+  Eigen::Vector3f mBestTranslation;
   float mBestScale{};
 
   // Scale is fixed to 1 in the stereo/RGBD case
@@ -95,8 +99,8 @@ protected:
   std::vector<size_t> mvAllIndices;
 
   // Projections
-  std::vector<cv::Mat> mvP1im1;
-  std::vector<cv::Mat> mvP2im2;
+  std::vector<Eigen::Vector2f> mvP1im1;
+  std::vector<Eigen::Vector2f> mvP2im2;
 
   // RANSAC probability
   double mRansacProb{};
@@ -112,8 +116,8 @@ protected:
   [[maybe_unused]] float mSigma2{};
 
   // Calibration
-  cv::Mat mK1;
-  cv::Mat mK2;
+  Eigen::Matrix3f mK1;
+  Eigen::Matrix3f mK2;
 };
 
 }  // namespace ORB_SLAM2
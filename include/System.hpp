@@ -111,6 +111,9 @@ public:
 
   [[maybe_unused]] std::vector<cv::KeyPoint> GetTrackedKeyPointsUn();
 
+  // Number of ORB features the extractor will look for in the next frame
+  [[maybe_unused]] int GetFeatureBudget();
+
 private:
   // Input sensor
   eSensor mSensor;
@@ -158,6 +161,7 @@ private:
 
   // Tracking state
   int mTrackingState = 0;
+  int mFeatureBudget = 0;
   std::vector<MapPoint *> mTrackedMapPoints;
   std::vector<cv::KeyPoint> mTrackedKeyPointsUn;
   std::mutex mMutexState;
@@ -0,0 +1,97 @@
+#pragma once
+// STL
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+
+namespace utilities {
+
+// Fixed set of long-lived worker threads fed from a single FIFO queue.
+class ThreadPool final {
+public:
+  // Task queued by submitClaimable. Whichever of a worker and the waiting
+  // thread claims it first runs it.
+  class ClaimableTask final {
+  public:
+    ClaimableTask(const ClaimableTask&) = delete;
+
+    ClaimableTask& operator=(const ClaimableTask&) = delete;
+
+    ClaimableTask(ClaimableTask&&) noexcept = default;
+
+    ClaimableTask& operator=(ClaimableTask&&) = delete;
+
+    // Without a call to wait() (e.g. unwinding from an exception), a task no
+    // worker has started is dropped and a running one is waited for, so it
+    // never outlives what it captured. Its exception, if any, is discarded.
+    ~ClaimableTask() noexcept;
+
+    // Runs the task on the calling thread unless a worker has already started
+    // it, in which case waits for it. Rethrows the exception thrown by the task.
+    void wait();
+
+  private:
+    friend class ThreadPool;
+
+    struct State;
+
+    explicit ClaimableTask(std::shared_ptr<State> pState) : mpState(std::move(pState)) {}
+
+    std::shared_ptr<State> mpState;
+    bool mbWaited = false;
+  };
+
+  explicit ThreadPool(std::size_t nThreads);
+
+  ThreadPool(const ThreadPool&) = delete;
+
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ThreadPool(ThreadPool&&) = delete;
+
+  ThreadPool& operator=(ThreadPool&&) = delete;
+
+  ~ThreadPool() noexcept;
+
+  // Process-wide pool with one worker per hardware thread (minus the caller).
+  static ThreadPool& shared();
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return mWorkers.size();
+  }
+
+  // Queue a task, the future becomes ready once it has run.
+  std::future<void> submit(std::function<void()> task);
+
+  // Queue a task that the caller takes back in wait() if it is still queued,
+  // so its latency does not depend on the tasks queued before it.
+  ClaimableTask submitClaimable(std::function<void()> task);
+
+  // Run body(i) for every i in [0, n). The calling thread takes part in the
+  // work, so nested calls from inside a task cannot deadlock. Returns once
+  // all indices are done and rethrows the first exception thrown by body.
+  void parallelFor(std::size_t n, const std::function<void(std::size_t)> &body);
+
+private:
+  void run();
+
+  std::mutex mMutex;
+
+  std::condition_variable mCondition;
+
+  std::deque<std::function<void()>> mTasks;
+
+  bool mStopping = false;
+
+  std::vector<std::thread> mWorkers;
+
+};
+
+} // namespace utilities
@@ -21,6 +21,8 @@
 // Internal
 #include "Frame.hpp"
 #include "ORBVocabulary.hpp"
+#include "KeyFrameDatabase.hpp"
+#include "FeatureBudgetController.hpp"
 
 namespace ORB_SLAM2 {
 
@@ -31,7 +33,6 @@ class Initializer;
 class FrameDrawer;
 class LoopClosing;
 class LocalMapping;
-class KeyFrameDatabase;
 
 class Tracking final {
 public:
@@ -62,6 +63,9 @@ public:
   // Use this function if you have deactivated local mapping and you only want to localize the camera.
   void InformOnlyTracking(const bool &flag);
 
+  // Number of ORB features currently requested per image (adapted every frame if enabled).
+  [[nodiscard]] int GetFeatureBudget() const;
+
 public:
   // Tracking states
   enum eTrackingState : char { SYSTEM_NOT_READY = -1, NO_IMAGES_YET = 0, NOT_INITIALIZED = 1, OK = 2, LOST = 3 };
@@ -85,7 +89,7 @@ public:
 
   // Lists used to recover the full camera trajectory at the end of the execution.
   // Basically we store the reference keyframe for each frame and its relative transformation
-  list<cv::Mat> mlRelativeFramePoses;
+  list<Eigen::Matrix4f> mlRelativeFramePoses;
   list<KeyFrame *> mlpReferences;
   list<double> mlFrameTimes;
   list<bool> mlbLost;
@@ -123,6 +127,9 @@ protected:
   bool NeedNewKeyFrame();
   void CreateNewKeyFrame();
 
+  // Feed the time spent on the last frame to the feature budget controller
+  void UpdateFeatureBudget(double frameTime);
+
   // In case of performing only localization, this flag is true when there are no matches to
   // points in the map. Still tracking will continue if there are enough matches with temporal points.
   // In that case we are doing visual odometry. The system will try to do relocalization to recover
@@ -137,9 +144,14 @@ protected:
   ORBextractor *mpORBextractorLeft, *mpORBextractorRight;
   ORBextractor *mpIniORBextractor;
 
+  // Adaptive feature budget, null if disabled
+  std::unique_ptr<FeatureBudgetController> mpFeatureBudget;
+
   //BoW
   ORBVocabulary *mpORBVocabulary;
   KeyFrameDatabase *mpKeyFrameDB;
+  // Relocalization queries, they run alongside the loop detection queries
+  KeyFrameDatabase::QueryContext mRelocQuery;
 
   // Initalization (only for monocular)
   Initializer *mpInitializer;
@@ -186,7 +198,8 @@ protected:
   unsigned int mnLastRelocFrameId;
 
   //Motion Model
-  cv::Mat mVelocity;
+  Eigen::Matrix4f mVelocity = Eigen::Matrix4f::Identity();
+  bool mbVelocity = false;
 
   //Color order (true RGB, false BGR, ignored if grayscale)
   bool mbRGB;
@@ -0,0 +1,239 @@
+// Internal
+#include "BowVector.hpp"
+// SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define ORB_SLAM2_X86_KERNELS
+#  include <immintrin.h>
+#endif
+
+namespace ORB_SLAM2 {
+
+namespace {
+
+using WordId = BowVector::WordId;
+using WordValue = BowVector::WordValue;
+
+// Same as DBoW2::GeneralScoring::LOG_EPS
+const double LOG_EPS = std::log(DBL_EPSILON);
+
+// Calls match(i, j) for every a[i] == b[j], in increasing word order
+template<typename Match>
+void forEachSharedWord(const BowVector &a, const BowVector &b, Match match) {
+  const WordId *pA = a.words().data();
+  const WordId *pB = b.words().data();
+  const size_t na = a.size();
+  const size_t nb = b.size();
+
+  size_t i = 0;
+  size_t j = 0;
+  while(i < na && j < nb) {
+    if(pA[i] == pB[j]) {
+      match(i, j);
+      ++i;
+      ++j;
+    } else if(pA[i] < pB[j]) {
+      ++i;
+    } else {
+      ++j;
+    }
+  }
+}
+
+// Sum of |v - w| - |v| - |w| over the shared words, from position i of a and j of b on
+double sumL1Scalar(const BowVector &a, const BowVector &b, size_t i, size_t j) {
+  const WordId *pA = a.words().data();
+  const WordId *pB = b.words().data();
+  const WordValue *pVa = a.values().data();
+  const WordValue *pVb = b.values().data();
+  const size_t na = a.size();
+  const size_t nb = b.size();
+
+  double sum = 0;
+  while(i < na && j < nb) {
+    if(pA[i] == pB[j]) {
+      const double vi = pVa[i];
+      const double wi = pVb[j];
+      sum += std::fabs(vi - wi) - std::fabs(vi) - std::fabs(wi);
+      ++i;
+      ++j;
+    } else if(pA[i] < pB[j]) {
+      ++i;
+    } else {
+      ++j;
+    }
+  }
+  return sum;
+}
+
+#ifdef ORB_SLAM2_X86_KERNELS
+
+// Blocks of 8 word ids of a and b are compared all against all (8 rotations of the b block).
+// Each word appears once in a vector, so a lane of a matches at most one lane of b; its
+// value is gathered from b and the lanes without a match add 0. The block with the lower
+// last id is then skipped (both if equal), and the tail is merged serially.
+__attribute__((target("avx2"))) double sumL1AVX2(const BowVector &a, const BowVector &b) {
+  const WordId *pA = a.words().data();
+  const WordId *pB = b.words().data();
+  const WordValue *pVa = a.values().data();
+  const WordValue *pVb = b.values().data();
+  const size_t na = a.size();
+  const size_t nb = b.size();
+
+  const __m256i rotate = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+  const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  const __m256d signBit = _mm256_set1_pd(-0.0);
+
+  __m256d acc = _mm256_setzero_pd();
+  size_t i = 0;
+  size_t j = 0;
+  while(i + 8 <= na && j + 8 <= nb) {
+    const __m256i idsA = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pA + i));
+    __m256i idsB = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pB + j));
+    __m256i lanesB = lanes;
+
+    // matched[k] is all ones if a[i + k] is in the b block, at position where[k]
+    __m256i matched = _mm256_setzero_si256();
+    __m256i where = _mm256_setzero_si256();
+    for(int r = 0; r < 8; r++) {
+      const __m256i eq = _mm256_cmpeq_epi32(idsA, idsB);
+      matched = _mm256_or_si256(matched, eq);
+      where = _mm256_or_si256(where, _mm256_and_si256(eq, lanesB));
+      idsB = _mm256_permutevar8x32_epi32(idsB, rotate);
+      lanesB = _mm256_permutevar8x32_epi32(lanesB, rotate);
+    }
+
+    if(!_mm256_testz_si256(matched, matched)) {
+      for(int half = 0; half < 2; half++) {
+        const __m128i matched4 = half == 0 ? _mm256_castsi256_si128(matched) : _mm256_extracti128_si256(matched, 1);
+        const __m128i where4 = half == 0 ? _mm256_castsi256_si128(where) : _mm256_extracti128_si256(where, 1);
+        const __m256d mask = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(matched4));
+
+        const __m256d v = _mm256_and_pd(_mm256_loadu_pd(pVa + i + 4 * half), mask);
+        const __m256d w = _mm256_mask_i32gather_pd(_mm256_setzero_pd(), pVb + j, where4, mask, sizeof(double));
+
+        const __m256d absDiff = _mm256_andnot_pd(signBit, _mm256_sub_pd(v, w));
+        const __m256d absV = _mm256_andnot_pd(signBit, v);
+        const __m256d absW = _mm256_andnot_pd(signBit, w);
+        acc = _mm256_add_pd(acc, _mm256_sub_pd(_mm256_sub_pd(absDiff, absV), absW));
+      }
+    }
+
+    const WordId lastA = pA[i + 7];
+    const WordId lastB = pB[j + 7];
+    if(lastA <= lastB)
+      i += 8;
+    if(lastB <= lastA)
+      j += 8;
+  }
+
+  const __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+  const double sum = _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+  return sum + sumL1Scalar(a, b, i, j);
+}
+
+#endif  // ORB_SLAM2_X86_KERNELS
+
+bool detectAVX2() {
+#ifdef ORB_SLAM2_X86_KERNELS
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+bool hasAVX2() {
+  static const bool bAVX2 = detectAVX2();
+  return bAVX2;
+}
+
+}  // namespace
+
+void BowVector::Normalize(DBoW2::LNorm norm) {
+  double sum = 0.0;
+  if(norm == DBoW2::L1) {
+    for(const WordValue value : mvValues)
+      sum += std::fabs(value);
+  } else {
+    for(const WordValue value : mvValues)
+      sum += value * value;
+    sum = std::sqrt(sum);
+  }
+
+  if(sum > 0.0) {
+    for(WordValue &value : mvValues)
+      value /= sum;
+  }
+}
+
+double BowVector::ScoreL1(const BowVector &a, const BowVector &b) {
+  double sum;
+#ifdef ORB_SLAM2_X86_KERNELS
+  if(hasAVX2())
+    sum = sumL1AVX2(a, b);
+  else
+#endif
+    sum = sumL1Scalar(a, b, 0, 0);
+
+  // ||v - w||_{L1} = 2 + Sum(|v_i - w_i| - |v_i| - |w_i|) for all i | v_i != 0 and w_i != 0
+  // (Nister, 2006), scaled to [0..1] as 1 - 0.5 * ||v - w||_{L1}
+  return -sum / 2.0;
+}
+
+double BowVector::Score(DBoW2::ScoringType scoring, const BowVector &a, const BowVector &b) {
+  const WordValue *pVa = a.values().data();
+  const WordValue *pVb = b.values().data();
+  double score = 0;
+
+  switch(scoring) {
+  case DBoW2::L1_NORM: return ScoreL1(a, b);
+
+  case DBoW2::L2_NORM:
+    forEachSharedWord(a, b, [&](size_t i, size_t j) { score += pVa[i] * pVb[j]; });
+    // ||v - w||_{L2} = sqrt(2 - 2 * Sum(v_i * w_i)), rounding errors can exceed 1
+    return score >= 1 ? 1.0 : 1.0 - std::sqrt(1.0 - score);
+
+  case DBoW2::CHI_SQUARE:
+    forEachSharedWord(a, b, [&](size_t i, size_t j) {
+      // (v-w)^2/(v+w) - v - w = -4 vw/(v+w), the -4 is moved out
+      if(pVa[i] + pVb[j] != 0.0)
+        score += pVa[i] * pVb[j] / (pVa[i] + pVb[j]);
+    });
+    return 2. * score;
+
+  case DBoW2::KL: {
+    // Every word of a counts, the ones missing from b against epsilon
+    const WordId *pA = a.words().data();
+    const WordId *pB = b.words().data();
+    size_t i = 0;
+    size_t j = 0;
+    while(i < a.size()) {
+      while(j < b.size() && pB[j] < pA[i])
+        ++j;
+
+      const double vi = pVa[i];
+      if(j < b.size() && pB[j] == pA[i]) {
+        if(vi != 0 && pVb[j] != 0)
+          score += vi * std::log(vi / pVb[j]);
+        ++j;
+      } else if(vi != 0) {
+        score += vi * (std::log(vi) - LOG_EPS);
+      }
+      ++i;
+    }
+    return score;
+  }
+
+  case DBoW2::BHATTACHARYYA:
+    forEachSharedWord(a, b, [&](size_t i, size_t j) { score += std::sqrt(pVa[i] * pVb[j]); });
+    return score;
+
+  case DBoW2::DOT_PRODUCT:
+    forEachSharedWord(a, b, [&](size_t i, size_t j) { score += pVa[i] * pVb[j]; });
+    return score;
+  }
+
+  return score;
+}
+
+}  // namespace ORB_SLAM2
@@ -33,105 +33,61 @@ std::vector<cv::Mat> toDescriptorVector(const cv::Mat &Descriptors) {
   return vDesc;
 }
 
-g2o::SE3Quat toSE3Quat(const cv::Mat &cvT) {
-  Eigen::Matrix<double, 3, 3> R;
-  R << static_cast<double>(cvT.at<float>(0, 0)), static_cast<double>(cvT.at<float>(0, 1)), static_cast<double>(cvT.at<float>(0, 2)),
-    static_cast<double>(cvT.at<float>(1, 0)), static_cast<double>(cvT.at<float>(1, 1)), static_cast<double>(cvT.at<float>(1, 2)),
-    static_cast<double>(cvT.at<float>(2, 0)), static_cast<double>(cvT.at<float>(2, 1)), static_cast<double>(cvT.at<float>(2, 2));
-
-  const Eigen::Matrix<double, 3, 1> t(
-    static_cast<double>(cvT.at<float>(0, 3)), static_cast<double>(cvT.at<float>(1, 3)), static_cast<double>(cvT.at<float>(2, 3)));
+g2o::SE3Quat toSE3Quat(const Eigen::Matrix4f &T) {
+  const Eigen::Matrix<double, 3, 3> R = T.topLeftCorner<3, 3>().cast<double>();
+  const Eigen::Matrix<double, 3, 1> t = T.topRightCorner<3, 1>().cast<double>();
 
   return g2o::SE3Quat(R, t);
 }
 
-cv::Mat toCvMat(const g2o::SE3Quat &SE3) {
-  const Eigen::Matrix<double, 4, 4> eigMat = SE3.to_homogeneous_matrix();
-  return toCvMat(eigMat);
-}
-
-cv::Mat toCvMat(const g2o::Sim3 &Sim3) {
-  const Eigen::Matrix3d eigR = Sim3.rotation().toRotationMatrix();
-  const Eigen::Vector3d &eigt = Sim3.translation();
-  const double s = Sim3.scale();
-  return toCvSE3(s * eigR, eigt);
-}
-
-cv::Mat toCvMat(const Eigen::Matrix<double, 4, 4> &m) {
+cv::Mat toCvMat(const Eigen::Matrix4f &m) {
   cv::Mat cvMat(4, 4, CV_32F);
   for(int i = 0; i < 4; i++) {
     for(int j = 0; j < 4; j++) {
-      cvMat.at<float>(i, j) = static_cast<float>(m(i, j));
+      cvMat.at<float>(i, j) = m(i, j);
     }
   }
 
-  return cvMat.clone();
+  return cvMat;
 }
 
-cv::Mat toCvMat(const Eigen::Matrix3d &m) {
-  cv::Mat cvMat(3, 3, CV_32F);
-  for(int i = 0; i < 3; i++) {
-    for(int j = 0; j < 3; j++) {
-      cvMat.at<float>(i, j) = static_cast<float>(m(i, j));
-    }
-  }
+Eigen::Matrix4f toMatrix4f(const g2o::SE3Quat &SE3) {
+  return SE3.to_homogeneous_matrix().cast<float>();
+}
+
+Eigen::Matrix4f toMatrix4f(const g2o::Sim3 &Sim3) {
+  Eigen::Matrix4f M = Eigen::Matrix4f::Identity();
+  M.topLeftCorner<3, 3>() = (Sim3.scale() * Sim3.rotation().toRotationMatrix()).cast<float>();
+  M.topRightCorner<3, 1>() = Sim3.translation().cast<float>();
 
-  return cvMat.clone();
+  return M;
 }
 
-cv::Mat toCvMat(const Eigen::Matrix<double, 3, 1> &m) {
-  cv::Mat cvMat(3, 1, CV_32F);
-  for(int i = 0; i < 3; i++) {
-    cvMat.at<float>(i) = static_cast<float>(m(i));
-  }
+Eigen::Matrix4f toMatrix4f(const Eigen::Matrix3f &R, const Eigen::Vector3f &t) {
+  Eigen::Matrix4f M = Eigen::Matrix4f::Identity();
+  M.topLeftCorner<3, 3>() = R;
+  M.topRightCorner<3, 1>() = t;
 
-  return cvMat.clone();
+  return M;
 }
 
-cv::Mat toCvSE3(const Eigen::Matrix<double, 3, 3> &R, const Eigen::Matrix<double, 3, 1> &t) {
-  cv::Mat cvMat = cv::Mat::eye(4, 4, CV_32F);
+Eigen::Matrix3f toMatrix3f(const cv::Mat &cvMat3) {
+  Eigen::Matrix3f M;
   for(int i = 0; i < 3; i++) {
     for(int j = 0; j < 3; j++) {
-      cvMat.at<float>(i, j) = static_cast<float>(R(i, j));
+      M(i, j) = cvMat3.at<float>(i, j);
     }
   }
 
-  for(int i = 0; i < 3; i++) {
-    cvMat.at<float>(i, 3) = static_cast<float>(t(i));
-  }
-
-  return cvMat.clone();
-}
-
-Eigen::Matrix<double, 3, 1> toVector3d(const cv::Mat &cvVector) {
-  Eigen::Matrix<double, 3, 1> v;
-  v << static_cast<double>(cvVector.at<float>(0)), static_cast<double>(cvVector.at<float>(1)), static_cast<double>(cvVector.at<float>(2));
-
-  return v;
-}
-
-Eigen::Matrix<double, 3, 1> toVector3d(const cv::Point3f &cvPoint) {
-  Eigen::Matrix<double, 3, 1> v;
-  v << static_cast<double>(cvPoint.x), static_cast<double>(cvPoint.y), static_cast<double>(cvPoint.z);
-
-  return v;
+  return M;
 }
 
-Eigen::Matrix<double, 3, 3> toMatrix3d(const cv::Mat &cvMat3) {
-  Eigen::Matrix<double, 3, 3> M;
-
-  M << static_cast<double>(cvMat3.at<float>(0, 0)), static_cast<double>(cvMat3.at<float>(0, 1)),
-    static_cast<double>(cvMat3.at<float>(0, 2)), static_cast<double>(cvMat3.at<float>(1, 0)),
-    static_cast<double>(cvMat3.at<float>(1, 1)), static_cast<double>(cvMat3.at<float>(1, 2)),
-    static_cast<double>(cvMat3.at<float>(2, 0)), static_cast<double>(cvMat3.at<float>(2, 1)),
-    static_cast<double>(cvMat3.at<float>(2, 2));
-
-  return M;
+Eigen::Vector3f toVector3f(const cv::Mat &cvVector) {
+  return Eigen::Vector3f(cvVector.at<float>(0), cvVector.at<float>(1), cvVector.at<float>(2));
 }
 
-std::vector<float> toQuaternion(const cv::Mat &M) {
-  const Eigen::Matrix<double, 3, 3> eigMat = toMatrix3d(M);
-  const Eigen::Quaterniond q(eigMat);
+std::vector<float> toQuaternion(const Eigen::Matrix3f &M) {
+  const Eigen::Quaterniond q(M.cast<double>());
 
   return {static_cast<float>(q.x()), static_cast<float>(q.y()), static_cast<float>(q.z()), static_cast<float>(q.w())};
 }
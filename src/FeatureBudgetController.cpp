@@ -0,0 +1,62 @@
+// Internal
+#include "FeatureBudgetController.hpp"
+
+namespace ORB_SLAM2 {
+
+namespace {
+
+// Weight of the newest frame in the moving average of the frame time
+constexpr double FRAME_TIME_SMOOTHING = 0.3;
+
+// The budget only grows while the frame time is below this fraction of the target
+constexpr double GROW_HEADROOM = 0.85;
+
+// Largest relative change of the budget per frame
+constexpr double MAX_SHRINK = 0.8;
+constexpr double GROW_STEP = 1.1;
+constexpr double EASY_SHRINK_STEP = 0.95;
+
+}  // namespace
+
+FeatureBudgetController::FeatureBudgetController(const Settings &settings, int nFeatures, int iniThFAST) :
+    mSettings(settings),
+    mnFeatures(std::clamp(nFeatures, settings.minFeatures, settings.maxFeatures)),
+    mnIniThFAST(std::clamp(iniThFAST, settings.minIniThFAST, settings.maxIniThFAST)) {}
+
+void FeatureBudgetController::Update(double frameTime, int nInliers, bool bTracked) {
+  if(mFrameTime <= 0.0)
+    mFrameTime = frameTime;
+  else
+    mFrameTime += FRAME_TIME_SMOOTHING * (frameTime - mFrameTime);
+
+  const double load = mFrameTime / mSettings.targetFrameTime;
+  double scale = 1.0;
+
+  if(load > 1.0) {
+    // Over the deadline: the extraction and matching cost is roughly linear in the
+    // number of features, so scale towards the target. Once at the lower bound
+    // make FAST more selective.
+    scale = std::max(1.0 / load, MAX_SHRINK);
+    if(mnFeatures <= mSettings.minFeatures)
+      mnIniThFAST = std::min(mnIniThFAST + 1, mSettings.maxIniThFAST);
+  } else if(!bTracked || nInliers < mSettings.targetInliers) {
+    // Weak tracking: ask for more features while there is time left, then for weaker corners
+    if(load < GROW_HEADROOM) {
+      if(mnFeatures < mSettings.maxFeatures)
+        scale = GROW_STEP;
+      else
+        mnIniThFAST = std::max(mnIniThFAST - 1, mSettings.minIniThFAST);
+    }
+  } else if(nInliers > 2 * mSettings.targetInliers) {
+    // Easy scene: first restore the FAST threshold, then give back features
+    if(mnIniThFAST < mSettings.maxIniThFAST)
+      mnIniThFAST++;
+    else
+      scale = EASY_SHRINK_STEP;
+  }
+
+  const int nFeatures = static_cast<int>(std::lround(mnFeatures * scale));
+  mnFeatures = std::clamp(nFeatures, mSettings.minFeatures, mSettings.maxFeatures);
+}
+
+}  // namespace ORB_SLAM2
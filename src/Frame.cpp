@@ -25,6 +25,8 @@
 #include "ORBmatcher.hpp"
 #include "Converter.hpp"
 #include "ORBextractor.hpp"
+#include "ThreadPool.hpp"
+#include "HammingDistance.hpp"
 
 namespace ORB_SLAM2 {
 
@@ -42,17 +44,12 @@ Frame::Frame(const Frame &frame) :
     mTimeStamp(frame.mTimeStamp), mK(frame.mK.clone()), mDistCoef(frame.mDistCoef.clone()), mbf(frame.mbf), mb(frame.mb),
     mThDepth(frame.mThDepth), N(frame.N), mvKeys(frame.mvKeys), mvKeysRight(frame.mvKeysRight), mvKeysUn(frame.mvKeysUn),
     mvuRight(frame.mvuRight), mvDepth(frame.mvDepth), mBowVec(frame.mBowVec), mFeatVec(frame.mFeatVec),
-    mDescriptors(frame.mDescriptors.clone()), mDescriptorsRight(frame.mDescriptorsRight.clone()), mvpMapPoints(frame.mvpMapPoints),
+    mDescriptors(frame.mDescriptors), mDescriptorsRight(frame.mDescriptorsRight), mvpMapPoints(frame.mvpMapPoints),
     mvbOutlier(frame.mvbOutlier), mnId(frame.mnId), mpReferenceKF(frame.mpReferenceKF), mnScaleLevels(frame.mnScaleLevels),
     mfScaleFactor(frame.mfScaleFactor), mfLogScaleFactor(frame.mfLogScaleFactor), mvScaleFactors(frame.mvScaleFactors),
-    mvInvScaleFactors(frame.mvInvScaleFactors), mvLevelSigma2(frame.mvLevelSigma2), mvInvLevelSigma2(frame.mvInvLevelSigma2) {
-  for(int i = 0; i < FRAME_GRID_COLS; i++) {
-    for(int j = 0; j < FRAME_GRID_ROWS; j++) {
-      mGrid[i][j] = frame.mGrid[i][j];
-    }
-  }
-
-  if(!frame.mTcw.empty()) {
+    mvInvScaleFactors(frame.mvInvScaleFactors), mvLevelSigma2(frame.mvLevelSigma2), mvInvLevelSigma2(frame.mvInvLevelSigma2),
+    mGrid(frame.mGrid) {
+  if(frame.HasPose()) {
     SetPose(frame.mTcw);
   }
 }
@@ -75,8 +72,8 @@ const Frame& Frame::operator=(const Frame &frame) {
   mvDepth = frame.mvDepth;
   mBowVec = frame.mBowVec;
   mFeatVec = frame.mFeatVec;
-  mDescriptors = frame.mDescriptors.clone();
-  mDescriptorsRight = frame.mDescriptorsRight.clone();
+  mDescriptors = frame.mDescriptors;
+  mDescriptorsRight = frame.mDescriptorsRight;
   mvpMapPoints = frame.mvpMapPoints;
   mvbOutlier = frame.mvbOutlier;
   mnId = frame.mnId;
@@ -88,15 +85,12 @@ const Frame& Frame::operator=(const Frame &frame) {
   mvInvScaleFactors = frame.mvInvScaleFactors;
   mvLevelSigma2 = frame.mvLevelSigma2;
   mvInvLevelSigma2 = frame.mvInvLevelSigma2;
+  mGrid = frame.mGrid;
 
-  for(int i = 0; i < FRAME_GRID_COLS; i++) {
-    for(int j = 0; j < FRAME_GRID_ROWS; j++) {
-      mGrid[i][j] = frame.mGrid[i][j];
-    }
-  }
-
-  if(!frame.mTcw.empty()) {
+  if(frame.HasPose()) {
     SetPose(frame.mTcw);
+  } else {
+    mbHasPose = false;
   }
 
   return *this;
@@ -127,11 +121,14 @@ Frame::Frame(const cv::Mat &imLeft,
   mvLevelSigma2 = mpORBextractorLeft->GetScaleSigmaSquares();
   mvInvLevelSigma2 = mpORBextractorLeft->GetInverseScaleSigmaSquares();
 
-  // ORB extraction
-  thread threadLeft(&Frame::ExtractORB, this, 0, imLeft);
-  thread threadRight(&Frame::ExtractORB, this, 1, imRight);
-  threadLeft.join();
-  threadRight.join();
+  // ORB extraction: the left image on this thread, the right one on the shared worker pool.
+  // If local mapping keeps the workers busy, this thread takes the right image back once
+  // the left one is done. If the left extraction throws, the destructor of rightExtraction
+  // drops or waits for the right one before this frame and imRight go away
+  utilities::ThreadPool::ClaimableTask rightExtraction =
+    utilities::ThreadPool::shared().submitClaimable([this, &imRight]() { ExtractORB(1, imRight); });
+  ExtractORB(0, imLeft);
+  rightExtraction.wait();
 
   N = static_cast<int>(mvKeys.size());
 
@@ -292,22 +289,9 @@ Frame::Frame(const cv::Mat &imGray,
 }
 
 void Frame::AssignFeaturesToGrid() {
-  const auto nReserve = static_cast<size_t>(0.5F * static_cast<float>(N) / (FRAME_GRID_COLS * FRAME_GRID_ROWS));
-  for(auto & i : mGrid) {
-    for(unsigned int j = 0; j < FRAME_GRID_ROWS; j++) {
-      i[j].reserve(nReserve);
-    }
-  }
-
-  const auto count = static_cast<size_t>(N);
-  for(uint32_t i = 0; i < count; i++) {
-    const cv::KeyPoint &kp = mvKeysUn[i];
-
-    int nGridPosX, nGridPosY;
-    if(PosInGrid(kp, nGridPosX, nGridPosY)) {
-      mGrid[nGridPosX][nGridPosY].push_back(i);
-    }
-  }
+  mGrid.Assign(static_cast<size_t>(N), [this](size_t i, int &nGridPosX, int &nGridPosY) {
+    return PosInGrid(mvKeysUn[i], nGridPosX, nGridPosY);
+  });
 }
 
 void Frame::ExtractORB(int flag, const cv::Mat &im) {
@@ -318,29 +302,40 @@ void Frame::ExtractORB(int flag, const cv::Mat &im) {
   }
 }
 
-void Frame::SetPose(const cv::Mat& Tcw) {
-  mTcw = Tcw.clone();
+void Frame::SetPose(const Eigen::Matrix4f &Tcw) {
+  mTcw = Tcw;
+  mbHasPose = true;
   UpdatePoseMatrices();
 }
 
 void Frame::UpdatePoseMatrices() {
-  mRcw = mTcw.rowRange(0, 3).colRange(0, 3);
-  mRwc = mRcw.t();
-  mtcw = mTcw.rowRange(0, 3).col(3);
-  mOw = -mRcw.t() * mtcw;
+  mRcw = mTcw.topLeftCorner<3, 3>();
+  mRwc = mRcw.transpose();
+  mtcw = mTcw.topRightCorner<3, 1>();
+  mOw = -mRwc * mtcw;
+}
+
+Eigen::Matrix4f Frame::GetPoseInverse() const {
+  Eigen::Matrix4f Twc = Eigen::Matrix4f::Identity();
+  Twc.topLeftCorner<3, 3>() = mRwc;
+  Twc.topRightCorner<3, 1>() = mOw;
+  return Twc;
 }
 
 bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit) {
   pMP->mbTrackInView = false;
 
+  // Position, normal and distances of the same update of the MapPoint
+  const MapPoint::PositionState position = pMP->GetPositionState();
+
   // 3D in absolute coordinates
-  cv::Mat P = pMP->GetWorldPos();
+  const Eigen::Vector3f &P = position.worldPos;
 
   // 3D in camera coordinates
-  const cv::Mat Pc = mRcw * P + mtcw;
-  const auto &PcX = Pc.at<float>(0);
-  const auto &PcY = Pc.at<float>(1);
-  const auto &PcZ = Pc.at<float>(2);
+  const Eigen::Vector3f Pc = mRcw * P + mtcw;
+  const float PcX = Pc(0);
+  const float PcY = Pc(1);
+  const float PcZ = Pc(2);
 
   // Check positive depth
   if(PcZ < 0.0f)
@@ -357,18 +352,16 @@ bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit) {
     return false;
 
   // Check distance is in the scale invariance region of the MapPoint
-  const float maxDistance = pMP->GetMaxDistanceInvariance();
-  const float minDistance = pMP->GetMinDistanceInvariance();
-  const cv::Mat PO = P - mOw;
-  const float dist = static_cast<float>(cv::norm(PO));
+  const float maxDistance = 1.2f * position.maxDistance;
+  const float minDistance = 0.8f * position.minDistance;
+  const Eigen::Vector3f PO = P - mOw;
+  const float dist = PO.norm();
 
   if(dist < minDistance || dist > maxDistance)
     return false;
 
   // Check viewing angle
-  cv::Mat Pn = pMP->GetNormal();
-
-  const float viewCos = static_cast<float>(PO.dot(Pn) / static_cast<double>(dist));
+  const float viewCos = PO.dot(position.normal) / dist;
 
   if(viewCos < viewingCosLimit) {
     return false;
@@ -391,61 +384,61 @@ bool Frame::isInFrustum(MapPoint *pMP, float viewingCosLimit) {
 std::vector<size_t> Frame::GetFeaturesInArea(const float &x, const float &y, const float &r, const int minLevel, const int maxLevel) const {
   vector<size_t> vIndices;
   vIndices.reserve(N);
+  GetFeaturesInArea(x, y, r, vIndices, minLevel, maxLevel);
+  return vIndices;
+}
+
+void Frame::GetFeaturesInArea(const float &x, const float &y, const float &r, vector<size_t> &vIndices, const int minLevel, const int maxLevel) const {
+  vIndices.clear();
 
   const int nMinCellX = max(0, static_cast<int>(floor((x - mnMinX - r) * mfGridElementWidthInv)));
   if(nMinCellX >= FRAME_GRID_COLS) {
-    return vIndices;
+    return;
   }
 
   const int nMaxCellX = min(static_cast<int>(FRAME_GRID_COLS) - 1, static_cast<int>(ceil((x - mnMinX + r) * mfGridElementWidthInv)));
   if(nMaxCellX < 0) {
-    return vIndices;
+    return;
   }
 
   const int nMinCellY = max(0, static_cast<int>(floor((y - mnMinY - r) * mfGridElementHeightInv)));
   if(nMinCellY >= FRAME_GRID_ROWS) {
-    return vIndices;
+    return;
   }
 
   const int nMaxCellY = min(static_cast<int>(FRAME_GRID_ROWS) - 1, static_cast<int>(ceil((y - mnMinY + r) * mfGridElementHeightInv)));
   if(nMaxCellY < 0) {
-    return vIndices;
+    return;
   }
 
   const bool bCheckLevels = (minLevel > 0) || (maxLevel >= 0);
 
+  // The cells of one grid column are contiguous
   for(int ix = nMinCellX; ix <= nMaxCellX; ix++) {
-    for(int iy = nMinCellY; iy <= nMaxCellY; iy++) {
-      const vector<size_t> vCell = mGrid[ix][iy];
-      if(vCell.empty()) {
-        continue;
-      }
+    const uint32_t *pEnd = mGrid.End(ix, nMaxCellY);
+    for(const uint32_t *pIdx = mGrid.Begin(ix, nMinCellY); pIdx != pEnd; ++pIdx) {
+      const size_t j = *pIdx;
+      const cv::KeyPoint &kpUn = mvKeysUn[j];
+      if(bCheckLevels) {
+        if(kpUn.octave < minLevel) {
+          continue;
+        }
 
-      for(unsigned long j : vCell) {
-        const cv::KeyPoint &kpUn = mvKeysUn[j];
-        if(bCheckLevels) {
-          if(kpUn.octave < minLevel) {
+        if(maxLevel >= 0) {
+          if(kpUn.octave > maxLevel) {
             continue;
           }
-
-          if(maxLevel >= 0) {
-            if(kpUn.octave > maxLevel) {
-              continue;
-            }
-          }
         }
+      }
 
-        const float distx = kpUn.pt.x - x;
-        const float disty = kpUn.pt.y - y;
+      const float distx = kpUn.pt.x - x;
+      const float disty = kpUn.pt.y - y;
 
-        if(fabs(distx) < r && fabs(disty) < r) {
-          vIndices.push_back(j);
-        }
+      if(fabs(distx) < r && fabs(disty) < r) {
+        vIndices.push_back(j);
       }
     }
   }
-
-  return vIndices;
 }
 
 bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY) {
@@ -462,8 +455,7 @@ bool Frame::PosInGrid(const cv::KeyPoint &kp, int &posX, int &posY) {
 
 void Frame::ComputeBoW() {
   if(mBowVec.empty()) {
-    std::vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
-    mpORBvocabulary->transform(vCurrentDesc, mBowVec, mFeatVec, 4);
+    mpORBvocabulary->transform(mDescriptors, mBowVec, mFeatVec, 4, &utilities::ThreadPool::shared());
   }
 }
 
@@ -586,7 +578,7 @@ void Frame::ComputeStereoMatches() {
     int bestDist = ORBmatcher::TH_HIGH;
     size_t bestIdxR = 0;
 
-    const cv::Mat &dL = mDescriptors.row(iL);
+    const uint8_t *dL = mDescriptors.row(iL);
 
     // Compare descriptor to right keypoints
     for(unsigned long iR : vCandidates) {
@@ -599,8 +591,7 @@ void Frame::ComputeStereoMatches() {
       const float &uR = kpR.pt.x;
 
       if(uR >= minU && uR <= maxU) {
-        const cv::Mat &dR = mDescriptorsRight.row(iR);
-        const int dist = ORBmatcher::DescriptorDistance(dL, dR);
+        const int dist = HammingDistance::Distance(dL, mDescriptorsRight.row(iR));
 
         if(dist < bestDist) {
           bestDist = dist;
@@ -716,18 +707,15 @@ void Frame::ComputeStereoFromRGBD(const cv::Mat &imDepth) {
   }
 }
 
-cv::Mat Frame::UnprojectStereo(const int &i) {
+Eigen::Vector3f Frame::UnprojectStereo(const int &i) const {
   const float z = mvDepth[static_cast<size_t>(i)];
-  if(z > 0) {
-    const auto &key = mvKeysUn[static_cast<size_t>(i)];
-    const float u = key.pt.x;
-    const float v = key.pt.y;
-    const float x = (u - cx) * z * invfx;
-    const float y = (v - cy) * z * invfy;
-    cv::Mat x3Dc = (cv::Mat_<float>(3, 1) << x, y, z);
-    return mRwc * x3Dc + mOw;
-  }
-  return cv::Mat();
+  assert(z > 0);
+  const auto &key = mvKeysUn[static_cast<size_t>(i)];
+  const float u = key.pt.x;
+  const float v = key.pt.y;
+  const float x = (u - cx) * z * invfx;
+  const float y = (v - cy) * z * invfy;
+  return mRwc * Eigen::Vector3f(x, y, z) + mOw;
 }
 
 }  // namespace ORB_SLAM2
@@ -0,0 +1,228 @@
+// Internal
+#include "HammingDistance.hpp"
+// SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define ORB_SLAM2_X86_KERNELS
+#  include <immintrin.h>
+#endif
+
+namespace ORB_SLAM2 {
+
+namespace {
+
+// Candidates scored per FindBest chunk, the distances live on the stack
+constexpr size_t CHUNK = 64;
+
+// Bit set count operation from
+// http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+int distanceScalar(const uint8_t *a, const uint8_t *b) {
+  int dist = 0;
+
+  for(int i = 0; i < HammingDistance::DESCRIPTOR_BYTES; i += 4) {
+    uint32_t wa, wb;
+    std::memcpy(&wa, a + i, sizeof(wa));
+    std::memcpy(&wb, b + i, sizeof(wb));
+    uint32_t v = wa ^ wb;
+    v = v - ((v >> 1) & 0x55555555);
+    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+    dist += static_cast<int>((((v + (v >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24);
+  }
+
+  return dist;
+}
+
+void computeScalar(const uint8_t *query, const DescriptorArray &descriptors, const size_t *indices, size_t n, int *distances) {
+  for(size_t k = 0; k < n; ++k)
+    distances[k] = distanceScalar(query, descriptors.row(indices[k]));
+}
+
+void computeContiguousScalar(const uint8_t *query, const DescriptorBlock *blocks, size_t n, int *distances) {
+  for(size_t k = 0; k < n; ++k)
+    distances[k] = distanceScalar(query, blocks[k].data());
+}
+
+#ifdef ORB_SLAM2_X86_KERNELS
+
+__attribute__((target("popcnt"))) int distancePopcnt(const uint8_t *a, const uint8_t *b) {
+  int dist = 0;
+
+  for(int i = 0; i < HammingDistance::DESCRIPTOR_BYTES; i += 8) {
+    uint64_t wa, wb;
+    std::memcpy(&wa, a + i, sizeof(wa));
+    std::memcpy(&wb, b + i, sizeof(wb));
+    dist += __builtin_popcountll(wa ^ wb);
+  }
+
+  return dist;
+}
+
+__attribute__((target("popcnt"))) void computePopcnt(const uint8_t *query, const DescriptorArray &descriptors, const size_t *indices, size_t n, int *distances) {
+  for(size_t k = 0; k < n; ++k)
+    distances[k] = distancePopcnt(query, descriptors.row(indices[k]));
+}
+
+__attribute__((target("popcnt"))) void computeContiguousPopcnt(const uint8_t *query, const DescriptorBlock *blocks, size_t n, int *distances) {
+  for(size_t k = 0; k < n; ++k)
+    distances[k] = distancePopcnt(query, blocks[k].data());
+}
+
+// Bit count of each 64 bit lane of q ^ c, from a 4 bit lookup table.
+__attribute__((target("avx2"))) __m256i laneCountsAVX2(__m256i q, __m256i c) {
+  const __m256i lut = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                       0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i lowMask = _mm256_set1_epi8(0x0F);
+
+  const __m256i v = _mm256_xor_si256(q, c);
+  const __m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, lowMask));
+  const __m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask));
+  return _mm256_sad_epu8(_mm256_add_epi8(lo, hi), _mm256_setzero_si256());
+}
+
+// Sum the four lanes of a and of b into the two low 32 bit words.
+__attribute__((target("avx2"))) __m128i pairSumAVX2(__m256i a, __m256i b) {
+  // Lane counts are at most 64, so two of them fit in one 64 bit lane
+  const __m256i ab = _mm256_or_si256(a, _mm256_slli_epi64(b, 32));
+  const __m128i halves = _mm_add_epi32(_mm256_castsi256_si128(ab), _mm256_extracti128_si256(ab, 1));
+  return _mm_add_epi32(halves, _mm_unpackhi_epi64(halves, halves));
+}
+
+__attribute__((target("avx2"))) int distanceAVX2(const uint8_t *a, const uint8_t *b) {
+  const __m256i counts = laneCountsAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(a)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)));
+  return _mm_cvtsi128_si32(pairSumAVX2(counts, _mm256_setzero_si256()));
+}
+
+// Rows of a DescriptorArray are 32 byte aligned
+__attribute__((target("avx2"))) __m256i loadRowAVX2(const DescriptorArray &descriptors, size_t i) {
+  return _mm256_load_si256(reinterpret_cast<const __m256i *>(descriptors.row(i)));
+}
+
+__attribute__((target("avx2"))) void computeAVX2(const uint8_t *query, const DescriptorArray &descriptors, const size_t *indices, size_t n, int *distances) {
+  const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(query));
+
+  size_t k = 0;
+  for(; k + 4 <= n; k += 4) {
+    const __m256i c0 = laneCountsAVX2(q, loadRowAVX2(descriptors, indices[k]));
+    const __m256i c1 = laneCountsAVX2(q, loadRowAVX2(descriptors, indices[k + 1]));
+    const __m256i c2 = laneCountsAVX2(q, loadRowAVX2(descriptors, indices[k + 2]));
+    const __m256i c3 = laneCountsAVX2(q, loadRowAVX2(descriptors, indices[k + 3]));
+    const __m128i sums = _mm_unpacklo_epi64(pairSumAVX2(c0, c1), pairSumAVX2(c2, c3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(distances + k), sums);
+  }
+
+  for(; k < n; ++k) {
+    const __m256i counts = laneCountsAVX2(q, loadRowAVX2(descriptors, indices[k]));
+    distances[k] = _mm_cvtsi128_si32(pairSumAVX2(counts, _mm256_setzero_si256()));
+  }
+}
+
+// DescriptorBlocks are 32 byte aligned and the candidates are consecutive, so the
+// loads are sequential and need no index indirection.
+__attribute__((target("avx2"))) void computeContiguousAVX2(const uint8_t *query, const DescriptorBlock *blocks, size_t n, int *distances) {
+  const __m256i q = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(query));
+  const auto *rows = reinterpret_cast<const __m256i *>(blocks);
+
+  size_t k = 0;
+  for(; k + 4 <= n; k += 4) {
+    const __m256i c0 = laneCountsAVX2(q, _mm256_load_si256(rows + k));
+    const __m256i c1 = laneCountsAVX2(q, _mm256_load_si256(rows + k + 1));
+    const __m256i c2 = laneCountsAVX2(q, _mm256_load_si256(rows + k + 2));
+    const __m256i c3 = laneCountsAVX2(q, _mm256_load_si256(rows + k + 3));
+    const __m128i sums = _mm_unpacklo_epi64(pairSumAVX2(c0, c1), pairSumAVX2(c2, c3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(distances + k), sums);
+  }
+
+  for(; k < n; ++k) {
+    const __m256i counts = laneCountsAVX2(q, _mm256_load_si256(rows + k));
+    distances[k] = _mm_cvtsi128_si32(pairSumAVX2(counts, _mm256_setzero_si256()));
+  }
+}
+
+#endif  // ORB_SLAM2_X86_KERNELS
+
+enum class Isa { SCALAR, POPCNT, AVX2 };
+
+Isa detectIsa() {
+#ifdef ORB_SLAM2_X86_KERNELS
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    return Isa::AVX2;
+  }
+  if(__builtin_cpu_supports("popcnt")) {
+    return Isa::POPCNT;
+  }
+#endif
+  return Isa::SCALAR;
+}
+
+Isa isa() {
+  static const Isa detected = detectIsa();
+  return detected;
+}
+
+}  // namespace
+
+int HammingDistance::Distance(const uint8_t *a, const uint8_t *b) {
+  switch(isa()) {
+#ifdef ORB_SLAM2_X86_KERNELS
+  case Isa::AVX2: return distanceAVX2(a, b);
+  case Isa::POPCNT: return distancePopcnt(a, b);
+#endif
+  default: return distanceScalar(a, b);
+  }
+}
+
+void HammingDistance::Compute(const uint8_t *query, const DescriptorArray &descriptors, const size_t *indices, size_t n, int *distances) {
+  switch(isa()) {
+#ifdef ORB_SLAM2_X86_KERNELS
+  case Isa::AVX2: computeAVX2(query, descriptors, indices, n, distances); break;
+  case Isa::POPCNT: computePopcnt(query, descriptors, indices, n, distances); break;
+#endif
+  default: computeScalar(query, descriptors, indices, n, distances); break;
+  }
+}
+
+void HammingDistance::ComputeContiguous(const uint8_t *query, const DescriptorBlock *blocks, size_t n, int *distances) {
+  switch(isa()) {
+#ifdef ORB_SLAM2_X86_KERNELS
+  case Isa::AVX2: computeContiguousAVX2(query, blocks, n, distances); break;
+  case Isa::POPCNT: computeContiguousPopcnt(query, blocks, n, distances); break;
+#endif
+  default: computeContiguousScalar(query, blocks, n, distances); break;
+  }
+}
+
+HammingDistance::Best HammingDistance::FindBest(const uint8_t *query, const DescriptorArray &descriptors, const std::vector<size_t> &vIndices) {
+  Best best;
+  int distances[CHUNK];
+
+  for(size_t first = 0; first < vIndices.size(); first += CHUNK) {
+    const size_t n = std::min(CHUNK, vIndices.size() - first);
+    Compute(query, descriptors, vIndices.data() + first, n, distances);
+
+    for(size_t k = 0; k < n; ++k) {
+      const int dist = distances[k];
+      if(dist < best.dist) {
+        best.dist2 = best.dist;
+        best.idx2 = best.idx;
+        best.dist = dist;
+        best.idx = static_cast<int>(vIndices[first + k]);
+      } else if(dist < best.dist2) {
+        best.dist2 = dist;
+        best.idx2 = static_cast<int>(vIndices[first + k]);
+      }
+    }
+  }
+
+  return best;
+}
+
+const char *HammingDistance::KernelName() {
+  switch(isa()) {
+  case Isa::AVX2: return "avx2";
+  case Isa::POPCNT: return "popcnt";
+  default: return "scalar";
+  }
+}
+
+}  // namespace ORB_SLAM2
@@ -27,6 +27,7 @@
 #include "ORBmatcher.hpp"
 #include "ORBextractor.hpp"
 #include "KeyFrameDatabase.hpp"
+#include "ThreadPool.hpp"
 
 namespace ORB_SLAM2 {
 
@@ -35,78 +36,68 @@ long unsigned int KeyFrame::nNextId = 0;
 KeyFrame::KeyFrame(Frame &F, Map *pMap, KeyFrameDatabase *pKFDB) :
     mnFrameId(F.mnId), mTimeStamp(F.mTimeStamp), mnGridCols(FRAME_GRID_COLS), mnGridRows(FRAME_GRID_ROWS),
     mfGridElementWidthInv(F.mfGridElementWidthInv), mfGridElementHeightInv(F.mfGridElementHeightInv), mnTrackReferenceForFrame(0),
-    mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0), mnLoopQuery(0), mnLoopWords(0), mnRelocQuery(0), mnRelocWords(0),
-    mnBAGlobalForKF(0), fx(F.fx), fy(F.fy), cx(F.cx), cy(F.cy), invfx(F.invfx), invfy(F.invfy), mbf(F.mbf), mb(F.mb),
+    mnFuseTargetForKF(0), mnBALocalForKF(0), mnBAFixedForKF(0), mnBAGlobalForKF(0),
+    fx(F.fx), fy(F.fy), cx(F.cx), cy(F.cy), invfx(F.invfx), invfy(F.invfy), mbf(F.mbf), mb(F.mb),
     mThDepth(F.mThDepth), N(F.N), mvKeys(F.mvKeys), mvKeysUn(F.mvKeysUn), mvuRight(F.mvuRight), mvDepth(F.mvDepth),
-    mDescriptors(F.mDescriptors.clone()), mBowVec(F.mBowVec), mFeatVec(F.mFeatVec), mnScaleLevels(F.mnScaleLevels),
+    mDescriptors(F.mDescriptors), mBowVec(F.mBowVec), mFeatVec(F.mFeatVec), mnScaleLevels(F.mnScaleLevels),
     mfScaleFactor(F.mfScaleFactor), mfLogScaleFactor(F.mfLogScaleFactor), mvScaleFactors(F.mvScaleFactors),
     mvLevelSigma2(F.mvLevelSigma2), mvInvLevelSigma2(F.mvInvLevelSigma2), mnMinX(F.mnMinX), mnMinY(F.mnMinY), mnMaxX(F.mnMaxX),
-    mnMaxY(F.mnMaxY), mK(F.mK), mvpMapPoints(F.mvpMapPoints), mpKeyFrameDB(pKFDB), mpORBvocabulary(F.mpORBvocabulary),
+    mnMaxY(F.mnMaxY), mK(F.mK), mvpMapPoints(F.mvpMapPoints), mpKeyFrameDB(pKFDB), mpORBvocabulary(F.mpORBvocabulary), mGrid(F.mGrid),
     mbFirstConnection(true), mpParent(nullptr), mbNotErase(false), mbToBeErased(false), mbBad(false), mHalfBaseline(F.mb / 2), mpMap(pMap) {
   mnId = nNextId++;
 
-  mGrid.resize(mnGridCols);
-  for(int i = 0; i < mnGridCols; i++) {
-    mGrid[i].resize(mnGridRows);
-    for(int j = 0; j < mnGridRows; j++)
-      mGrid[i][j] = F.mGrid[i][j];
-  }
-
   SetPose(F.mTcw);
 }
 
 void KeyFrame::ComputeBoW() {
   if(mBowVec.empty() || mFeatVec.empty()) {
-    vector<cv::Mat> vCurrentDesc = Converter::toDescriptorVector(mDescriptors);
     // Feature vector associate features with nodes in the 4th level (from leaves up)
     // We assume the vocabulary tree has 6 levels, change the 4 otherwise
-    mpORBvocabulary->transform(vCurrentDesc, mBowVec, mFeatVec, 4);
+    mpORBvocabulary->transform(mDescriptors, mBowVec, mFeatVec, 4, &utilities::ThreadPool::shared());
   }
 }
 
-void KeyFrame::SetPose(const cv::Mat &Tcw_) {
+void KeyFrame::SetPose(const Eigen::Matrix4f &Tcw_) {
+  PoseState pose;
+  pose.Tcw = Tcw_;
+  const Eigen::Matrix3f Rwc = pose.Tcw.topLeftCorner<3, 3>().transpose();
+  pose.Ow = -Rwc * pose.Tcw.topRightCorner<3, 1>();
+
+  pose.Twc.setIdentity();
+  pose.Twc.topLeftCorner<3, 3>() = Rwc;
+  pose.Twc.topRightCorner<3, 1>() = pose.Ow;
+  pose.Cw = pose.Ow + Rwc.col(0) * mHalfBaseline;
+
   unique_lock<mutex> lock(mMutexPose);
-  Tcw_.copyTo(Tcw);
-  cv::Mat Rcw = Tcw.rowRange(0, 3).colRange(0, 3);
-  cv::Mat tcw = Tcw.rowRange(0, 3).col(3);
-  cv::Mat Rwc = Rcw.t();
-  Ow = -Rwc * tcw;
+  mPose.Store(pose);
+}
 
-  Twc = cv::Mat::eye(4, 4, Tcw.type());
-  Rwc.copyTo(Twc.rowRange(0, 3).colRange(0, 3));
-  Ow.copyTo(Twc.rowRange(0, 3).col(3));
-  cv::Mat center = (cv::Mat_<float>(4, 1) << mHalfBaseline, 0, 0, 1);
-  Cw = Twc * center;
+KeyFrame::PoseState KeyFrame::GetPoseState() const {
+  return mPose.Load();
 }
 
-cv::Mat KeyFrame::GetPose() {
-  unique_lock<mutex> lock(mMutexPose);
-  return Tcw.clone();
+Eigen::Matrix4f KeyFrame::GetPose() const {
+  return GetPoseState().Tcw;
 }
 
-cv::Mat KeyFrame::GetPoseInverse() {
-  unique_lock<mutex> lock(mMutexPose);
-  return Twc.clone();
+Eigen::Matrix4f KeyFrame::GetPoseInverse() const {
+  return GetPoseState().Twc;
 }
 
-cv::Mat KeyFrame::GetCameraCenter() {
-  unique_lock<mutex> lock(mMutexPose);
-  return Ow.clone();
+Eigen::Vector3f KeyFrame::GetCameraCenter() const {
+  return GetPoseState().Ow;
 }
 
-cv::Mat KeyFrame::GetStereoCenter() {
-  unique_lock<mutex> lock(mMutexPose);
-  return Cw.clone();
+Eigen::Vector3f KeyFrame::GetStereoCenter() const {
+  return GetPoseState().Cw;
 }
 
-cv::Mat KeyFrame::GetRotation() {
-  unique_lock<mutex> lock(mMutexPose);
-  return Tcw.rowRange(0, 3).colRange(0, 3).clone();
+Eigen::Matrix3f KeyFrame::GetRotation() const {
+  return GetPoseState().Tcw.topLeftCorner<3, 3>();
 }
 
-cv::Mat KeyFrame::GetTranslation() {
-  unique_lock<mutex> lock(mMutexPose);
-  return Tcw.rowRange(0, 3).col(3).clone();
+Eigen::Vector3f KeyFrame::GetTranslation() const {
+  return GetPoseState().Tcw.topRightCorner<3, 1>();
 }
 
 void KeyFrame::AddConnection(KeyFrame *pKF, const int &weight) {
@@ -269,7 +260,7 @@ void KeyFrame::UpdateConnections() {
     if(pMP->isBad())
       continue;
 
-    map<KeyFrame *, size_t> observations = pMP->GetObservations();
+    ObservationList observations = pMP->GetObservations();
 
     for(auto & observation : observations) {
       if(observation.first->mnId == mnId)
@@ -464,7 +455,7 @@ void KeyFrame::SetBadFlag() {
       }
 
     mpParent->EraseChild(this);
-    mTcp = Tcw * mpParent->GetPoseInverse();
+    mTcp = GetPoseState().Tcw * mpParent->GetPoseState().Twc;
     mbBad = true;
   }
 
@@ -494,78 +485,69 @@ void KeyFrame::EraseConnection(KeyFrame *pKF) {
 vector<size_t> KeyFrame::GetFeaturesInArea(const float &x, const float &y, const float &r) const {
   vector<size_t> vIndices;
   vIndices.reserve(N);
+  GetFeaturesInArea(x, y, r, vIndices);
+  return vIndices;
+}
+
+void KeyFrame::GetFeaturesInArea(const float &x, const float &y, const float &r, vector<size_t> &vIndices) const {
+  vIndices.clear();
 
   const int nMinCellX = max(0, static_cast<int>(floor((x - mnMinX - r)) * mfGridElementWidthInv));
   if(nMinCellX >= mnGridCols)
-    return vIndices;
+    return;
 
   const int nMaxCellX = min(static_cast<int>(mnGridCols) - 1, static_cast<int>(ceil((x - mnMinX + r) * mfGridElementWidthInv)));
   if(nMaxCellX < 0)
-    return vIndices;
+    return;
 
   const int nMinCellY = max(0, static_cast<int>(floor((y - mnMinY - r) * mfGridElementHeightInv)));
   if(nMinCellY >= mnGridRows)
-    return vIndices;
+    return;
 
   const int nMaxCellY = min(static_cast<int>(mnGridRows) - 1, static_cast<int>(ceil((y - mnMinY + r) * mfGridElementHeightInv)));
   if(nMaxCellY < 0)
-    return vIndices;
+    return;
 
   for(int ix = nMinCellX; ix <= nMaxCellX; ix++) {
-    for(int iy = nMinCellY; iy <= nMaxCellY; iy++) {
-      const vector<size_t> vCell = mGrid[ix][iy];
-      for(unsigned long j : vCell) {
-        const cv::KeyPoint &kpUn = mvKeysUn[j];
-        const float distx = kpUn.pt.x - x;
-        const float disty = kpUn.pt.y - y;
-
-        if(fabs(distx) < r && fabs(disty) < r)
-          vIndices.push_back(j);
-      }
+    const uint32_t *pEnd = mGrid.End(ix, nMaxCellY);
+    for(const uint32_t *pIdx = mGrid.Begin(ix, nMinCellY); pIdx != pEnd; ++pIdx) {
+      const size_t j = *pIdx;
+      const cv::KeyPoint &kpUn = mvKeysUn[j];
+      const float distx = kpUn.pt.x - x;
+      const float disty = kpUn.pt.y - y;
+
+      if(fabs(distx) < r && fabs(disty) < r)
+        vIndices.push_back(j);
     }
   }
-
-  return vIndices;
 }
 
 bool KeyFrame::IsInImage(const float &x, const float &y) const {
   return (x >= mnMinX && x < mnMaxX && y >= mnMinY && y < mnMaxY);
 }
 
-cv::Mat KeyFrame::UnprojectStereo(int i) {
+Eigen::Vector3f KeyFrame::UnprojectStereo(int i) const {
   const float z = mvDepth[i];
-  if(z > 0) {
-    const float u = mvKeys[i].pt.x;
-    const float v = mvKeys[i].pt.y;
-    const float x = (u - cx) * z * invfx;
-    const float y = (v - cy) * z * invfy;
-    cv::Mat x3Dc = (cv::Mat_<float>(3, 1) << x, y, z);
-
-    unique_lock<mutex> lock(mMutexPose);
-    return Twc.rowRange(0, 3).colRange(0, 3) * x3Dc + Twc.rowRange(0, 3).col(3);
-  } else
-    return cv::Mat();
+  assert(z > 0);
+  const float u = mvKeys[i].pt.x;
+  const float v = mvKeys[i].pt.y;
+  const float x = (u - cx) * z * invfx;
+  const float y = (v - cy) * z * invfy;
+  const Eigen::Matrix4f Twc = GetPoseState().Twc;
+  return Twc.topLeftCorner<3, 3>() * Eigen::Vector3f(x, y, z) + Twc.topRightCorner<3, 1>();
 }
 
 float KeyFrame::ComputeSceneMedianDepth(const int q) {
-  vector<MapPoint *> vpMapPoints;
-  cv::Mat Tcw_;
-  {
-    unique_lock<mutex> lock(mMutexFeatures);
-    unique_lock<mutex> lock2(mMutexPose);
-    //vpMapPoints = mvpMapPoints;
-    Tcw_ = Tcw.clone();
-  }
+  const Eigen::Matrix4f Tcw = GetPoseState().Tcw;
 
   vector<float> vDepths;
   vDepths.reserve(N);
-  cv::Mat Rcw2 = Tcw_.row(2).colRange(0, 3);
-  Rcw2 = Rcw2.t();
-  float zcw = Tcw_.at<float>(2, 3);
+  const Eigen::Vector3f Rcw2 = Tcw.block<1, 3>(2, 0).transpose();
+  const float zcw = Tcw(2, 3);
   for(int i = 0; i < N; i++) {
     if(mvpMapPoints[i]) {
       MapPoint *pMP = mvpMapPoints[i];
-      cv::Mat x3Dw = pMP->GetWorldPos();
+      const Eigen::Vector3f x3Dw = pMP->GetPositionState().worldPos;
       float z = Rcw2.dot(x3Dw) + zcw;
       vDepths.push_back(z);
     }
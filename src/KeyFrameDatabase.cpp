@@ -21,104 +21,282 @@
 #include "Frame.hpp"
 #include "KeyFrame.hpp"
 #include "KeyFrameDatabase.hpp"
-#include "Thirdparty/DBoW2/DBoW2/BowVector.h"
+#include "ThreadPool.hpp"
 
 namespace ORB_SLAM2 {
 
-KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary &voc) : mpVoc(&voc) { mvInvertedFile.resize(voc.size()); }
+namespace {
+
+// Candidates scored per task of the thread pool
+constexpr size_t SCORES_PER_TASK = 16;
+
+}  // namespace
+
+void KeyFrameDatabase::QueryContext::Begin(size_t nIds) {
+  if(vStamps.size() < nIds) {
+    vStamps.resize(nIds, 0);
+    vWords.resize(nIds, 0);
+    vScores.resize(nIds, 0);
+  }
+
+  // Stamp 0 marks the entries never touched, restart when the stamps wrap around
+  if(++stamp == 0) {
+    std::fill(vStamps.begin(), vStamps.end(), 0);
+    stamp = 1;
+  }
+
+  vCandidates.clear();
+  vpCandidates.clear();
+  vScored.clear();
+}
+
+KeyFrameDatabase::ReadGuard::ReadGuard(const KeyFrameDatabase &db) : mSlot(db.Pin()) {}
+
+KeyFrameDatabase::ReadGuard::~ReadGuard() {
+  mSlot.store(0);
+}
+
+KeyFrameDatabase::KeyFrameDatabase(const ORBVocabulary &voc) :
+    mpVoc(&voc), mpKeyFrameTable(new KeyFrameTable(0)), mvInvertedFile(voc.size()), mvTombstones(voc.size(), 0) {
+  for(auto &readerEpoch : mReaderEpochs)
+    readerEpoch.store(0);
+}
+
+KeyFrameDatabase::~KeyFrameDatabase() {
+  for(auto &pPostings : mvInvertedFile)
+    delete pPostings.load();
+  delete mpKeyFrameTable.load();
+}
+
+std::atomic<uint64_t> &KeyFrameDatabase::Pin() const {
+  // The tracking and loop closing threads spread over the slots
+  const size_t first = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_READERS;
+  for(;;) {
+    const uint64_t epoch = mEpoch.load();
+    for(size_t i = 0; i < MAX_READERS; i++) {
+      std::atomic<uint64_t> &slot = mReaderEpochs[(first + i) % MAX_READERS];
+      uint64_t expected = 0;
+      if(slot.compare_exchange_strong(expected, epoch))
+        return slot;
+    }
+    std::this_thread::yield();
+  }
+}
+
+void KeyFrameDatabase::Retire(std::shared_ptr<void> pBuffer) {
+  mvRetired.emplace_back(mEpoch.fetch_add(1), std::move(pBuffer));
+}
+
+void KeyFrameDatabase::Reclaim() {
+  if(mvRetired.empty())
+    return;
+
+  // A query pinned in epoch e loaded its pointers after the buffers retired before e were
+  // unpublished, so those are unreachable once every pinned epoch is above their tag
+  uint64_t minEpoch = std::numeric_limits<uint64_t>::max();
+  for(const auto &readerEpoch : mReaderEpochs) {
+    const uint64_t epoch = readerEpoch.load();
+    if(epoch != 0)
+      minEpoch = std::min(minEpoch, epoch);
+  }
+
+  mvRetired.erase(std::remove_if(mvRetired.begin(), mvRetired.end(), [minEpoch](const auto &retired) { return retired.first < minEpoch; }),
+                  mvRetired.end());
+}
 
 void KeyFrameDatabase::add(KeyFrame *pKF) {
   unique_lock<mutex> lock(mMutex);
 
-  for(const auto key : pKF->mBowVec) {
-    mvInvertedFile[key.first].push_back(pKF);
+  // The table grows before the postings, a query skips the ids beyond the table it pinned
+  const auto id = static_cast<uint32_t>(pKF->mnId);
+  KeyFrameTable *pTable = mpKeyFrameTable.load();
+  if(pTable->vpKeyFrames.size() <= id) {
+    auto *pGrown = new KeyFrameTable(std::max<size_t>(id + 1, 2 * pTable->vpKeyFrames.size()));
+    for(size_t i = 0; i < pTable->vpKeyFrames.size(); i++)
+      pGrown->vpKeyFrames[i].store(pTable->vpKeyFrames[i].load());
+    mpKeyFrameTable.store(pGrown);
+    Retire(std::shared_ptr<KeyFrameTable>(pTable));
+    pTable = pGrown;
+  }
+  pTable->vpKeyFrames[id].store(pKF);
+
+  for(const BowVector::WordId wordId : pKF->mBowVec.words()) {
+    Postings *pPostings = mvInvertedFile[wordId].load();
+    const uint32_t size = pPostings ? pPostings->size.load() : 0;
+
+    // Full: the ids move to a buffer twice as large, the queries still reading the old one
+    // keep it until they finish
+    if(!pPostings || size == pPostings->vIds.size()) {
+      auto *pGrown = new Postings(std::max<size_t>(4, 2 * size));
+      if(pPostings)
+        std::copy_n(pPostings->vIds.begin(), size, pGrown->vIds.begin());
+      pGrown->size.store(size);
+      mvInvertedFile[wordId].store(pGrown);
+      if(pPostings)
+        Retire(std::shared_ptr<Postings>(pPostings));
+      pPostings = pGrown;
+    }
+
+    // The id is written before the size that makes it visible
+    pPostings->vIds[size] = id;
+    pPostings->size.store(size + 1);
   }
+
+  Reclaim();
 }
 
 void KeyFrameDatabase::erase(KeyFrame *pKF) {
   std::unique_lock<std::mutex> lock(mMutex);
 
-  // Erase elements in the Inverse File for the entry
-  for(auto vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end(); vit != vend; ++vit) {
-    // List of keyframes that share the word
-    auto &lKFs = mvInvertedFile[vit->first];
+  const auto id = static_cast<uint32_t>(pKF->mnId);
+  KeyFrameTable *pTable = mpKeyFrameTable.load();
+  if(id >= pTable->vpKeyFrames.size() || pTable->vpKeyFrames[id].load() != pKF)
+    return;
+  pTable->vpKeyFrames[id].store(nullptr);
+
+  // The postings of the keyframe become tombstones
+  for(const BowVector::WordId wordId : pKF->mBowVec.words()) {
+    if(2 * ++mvTombstones[wordId] >= mvInvertedFile[wordId].load()->size.load())
+      CompactWord(wordId);
+  }
+
+  Reclaim();
+}
+
+void KeyFrameDatabase::clear() {
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  Retire(std::shared_ptr<KeyFrameTable>(mpKeyFrameTable.exchange(new KeyFrameTable(0))));
+  for(auto &pPostings : mvInvertedFile) {
+    if(Postings *pOld = pPostings.exchange(nullptr))
+      Retire(std::shared_ptr<Postings>(pOld));
+  }
+  mvTombstones.assign(mpVoc->size(), 0);
+
+  Reclaim();
+}
+
+void KeyFrameDatabase::CompactWord(BowVector::WordId wordId) {
+  // Keeps the insertion order, the queries visit the candidates in that order. The live ids
+  // go to a new buffer, the queries reading the old one keep it until they finish
+  const KeyFrameTable &table = *mpKeyFrameTable.load();
+  Postings *pPostings = mvInvertedFile[wordId].load();
+  const uint32_t size = pPostings->size.load();
+
+  auto *pCompacted = new Postings(size);
+  uint32_t nLive = 0;
+  for(uint32_t i = 0; i < size; i++) {
+    const uint32_t id = pPostings->vIds[i];
+    if(table.vpKeyFrames[id].load())
+      pCompacted->vIds[nLive++] = id;
+  }
+  pCompacted->size.store(nLive);
+
+  mvInvertedFile[wordId].store(pCompacted);
+  Retire(std::shared_ptr<Postings>(pPostings));
+  mvTombstones[wordId] = 0;
+}
+
+void KeyFrameDatabase::CollectCandidates(const BowVector &bowVec, const KeyFrameTable &table, QueryContext &context) const {
+  const size_t nIds = table.vpKeyFrames.size();
+  for(const BowVector::WordId wordId : bowVec.words()) {
+    const Postings *pPostings = mvInvertedFile[wordId].load();
+    if(!pPostings)
+      continue;
+
+    const uint32_t size = pPostings->size.load();
+    for(uint32_t i = 0; i < size; i++) {
+      const uint32_t id = pPostings->vIds[i];
+      if(id >= nIds)
+        continue;
+
+      KeyFrame *pKFi = table.vpKeyFrames[id].load();
+      if(!pKFi)
+        continue;
 
-    for(auto lit = lKFs.begin(), lend = lKFs.end(); lit != lend; ++lit) {
-      if(pKF == *lit) {
-        lKFs.erase(lit);
-        break;
+      if(context.vStamps[id] != context.stamp) {
+        context.vStamps[id] = context.stamp;
+        context.vWords[id] = 1;
+        context.vScores[id] = 0;
+        context.vCandidates.push_back(id);
+        context.vpCandidates.push_back(pKFi);
+      } else if(context.vWords[id] != QueryContext::EXCLUDED) {
+        context.vWords[id]++;
       }
     }
   }
 }
 
-void KeyFrameDatabase::clear() {
-  mvInvertedFile.clear();
-  mvInvertedFile.resize(mpVoc->size());
+void KeyFrameDatabase::ScoreCandidates(const BowVector &bowVec, int minCommonWords, QueryContext &context) const {
+  for(size_t i = 0; i < context.vCandidates.size(); i++) {
+    if(context.vWords[context.vCandidates[i]] > static_cast<uint32_t>(minCommonWords))
+      context.vScored.push_back(i);
+  }
+
+  // Keyframes are never deleted and their BoW vectors do not change once they are in the
+  // database, so the candidates are scored outside the epoch guard. Each task writes the scores of its own ids
+  const size_t nTasks = (context.vScored.size() + SCORES_PER_TASK - 1) / SCORES_PER_TASK;
+  utilities::ThreadPool::shared().parallelFor(nTasks, [&](size_t t) {
+    const size_t end = min(context.vScored.size(), (t + 1) * SCORES_PER_TASK);
+    for(size_t i = t * SCORES_PER_TASK; i < end; i++) {
+      const size_t candidate = context.vScored[i];
+      const float score = static_cast<float>(mpVoc->score(bowVec, context.vpCandidates[candidate]->mBowVec));
+      context.vScores[context.vCandidates[candidate]] = score;
+    }
+  });
 }
 
-vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float minScore) {
+vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float minScore, QueryContext &context) {
   set<KeyFrame *> spConnectedKeyFrames = pKF->GetConnectedKeyFrames();
-  list<KeyFrame *> lKFsSharingWords;
 
   // Search all keyframes that share a word with current keyframes
   // Discard keyframes connected to the query keyframe
   {
-    unique_lock<mutex> lock(mMutex);
-
-    for(auto vit = pKF->mBowVec.begin(), vend = pKF->mBowVec.end(); vit != vend; ++vit) {
-      list<KeyFrame *> &lKFs = mvInvertedFile[vit->first];
-
-      for(auto pKFi : lKFs) {
-        if(pKFi->mnLoopQuery != pKF->mnId) {
-          pKFi->mnLoopWords = 0;
-          if(!spConnectedKeyFrames.count(pKFi)) {
-            pKFi->mnLoopQuery = pKF->mnId;
-            lKFsSharingWords.push_back(pKFi);
-          }
-        }
-        pKFi->mnLoopWords++;
+    ReadGuard guard(*this);
+    const KeyFrameTable &table = *mpKeyFrameTable.load();
+
+    context.Begin(table.vpKeyFrames.size());
+    for(KeyFrame *pKFi : spConnectedKeyFrames) {
+      const auto id = static_cast<uint32_t>(pKFi->mnId);
+      if(id < table.vpKeyFrames.size()) {
+        context.vStamps[id] = context.stamp;
+        context.vWords[id] = QueryContext::EXCLUDED;
+        context.vScores[id] = 0;
       }
     }
+
+    CollectCandidates(pKF->mBowVec, table, context);
   }
 
-  if(lKFsSharingWords.empty())
+  if(context.vCandidates.empty())
     return vector<KeyFrame *>();
 
-  list<pair<float, KeyFrame *> > lScoreAndMatch;
-
   // Only compare against those keyframes that share enough words
-  int maxCommonWords = 0;
-  for(auto & lKFsSharingWord : lKFsSharingWords) {
-    if(lKFsSharingWord->mnLoopWords > maxCommonWords)
-      maxCommonWords = lKFsSharingWord->mnLoopWords;
-  }
+  uint32_t maxCommonWords = 0;
+  for(const uint32_t id : context.vCandidates)
+    maxCommonWords = max(maxCommonWords, context.vWords[id]);
 
   int minCommonWords = maxCommonWords * 0.8f;
 
-  int nscores = 0;
-
   // Compute similarity score. Retain the matches whose score is higher than minScore
-  for(auto pKFi : lKFsSharingWords) {
-    if(pKFi->mnLoopWords > minCommonWords) {
-      nscores++;
+  ScoreCandidates(pKF->mBowVec, minCommonWords, context);
 
-      float si = mpVoc->score(pKF->mBowVec, pKFi->mBowVec);
-
-      pKFi->mLoopScore = si;
-      if(si >= minScore)
-        lScoreAndMatch.emplace_back(si, pKFi);
-    }
+  vector<pair<float, KeyFrame *> > vScoreAndMatch;
+  for(const size_t candidate : context.vScored) {
+    const float si = context.vScores[context.vCandidates[candidate]];
+    if(si >= minScore)
+      vScoreAndMatch.emplace_back(si, context.vpCandidates[candidate]);
   }
 
-  if(lScoreAndMatch.empty())
+  if(vScoreAndMatch.empty())
     return vector<KeyFrame *>();
 
-  list<pair<float, KeyFrame *> > lAccScoreAndMatch;
+  vector<pair<float, KeyFrame *> > vAccScoreAndMatch;
+  vAccScoreAndMatch.reserve(vScoreAndMatch.size());
   float bestAccScore = minScore;
 
   // Lets now accumulate score by covisibility
-  for(auto & it : lScoreAndMatch) {
+  for(auto & it : vScoreAndMatch) {
     KeyFrame *pKFi = it.second;
     vector<KeyFrame *> vpNeighs = pKFi->GetBestCovisibilityKeyFrames(10);
 
@@ -126,16 +304,18 @@ vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float m
     float accScore = it.first;
     KeyFrame *pBestKF = pKFi;
     for(auto pKF2 : vpNeighs) {
-      if(pKF2->mnLoopQuery == pKF->mnId && pKF2->mnLoopWords > minCommonWords) {
-        accScore += pKF2->mLoopScore;
-        if(pKF2->mLoopScore > bestScore) {
+      const auto id2 = static_cast<uint32_t>(pKF2->mnId);
+      if(context.Touched(id2) && context.vWords[id2] != QueryContext::EXCLUDED &&
+         context.vWords[id2] > static_cast<uint32_t>(minCommonWords)) {
+        accScore += context.vScores[id2];
+        if(context.vScores[id2] > bestScore) {
           pBestKF = pKF2;
-          bestScore = pKF2->mLoopScore;
+          bestScore = context.vScores[id2];
         }
       }
     }
 
-    lAccScoreAndMatch.emplace_back(accScore, pBestKF);
+    vAccScoreAndMatch.emplace_back(accScore, pBestKF);
     if(accScore > bestAccScore)
       bestAccScore = accScore;
   }
@@ -145,9 +325,9 @@ vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float m
 
   set<KeyFrame *> spAlreadyAddedKF;
   vector<KeyFrame *> vpLoopCandidates;
-  vpLoopCandidates.reserve(lAccScoreAndMatch.size());
+  vpLoopCandidates.reserve(vAccScoreAndMatch.size());
 
-  for(auto & it : lAccScoreAndMatch) {
+  for(auto & it : vAccScoreAndMatch) {
     if(it.first > minScoreToRetain) {
       KeyFrame *pKFi = it.second;
       if(!spAlreadyAddedKF.count(pKFi)) {
@@ -160,77 +340,56 @@ vector<KeyFrame *> KeyFrameDatabase::DetectLoopCandidates(KeyFrame *pKF, float m
   return vpLoopCandidates;
 }
 
-vector<KeyFrame *> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F) {
-  list<KeyFrame *> lKFsSharingWords;
-
+vector<KeyFrame *> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F, QueryContext &context) {
   // Search all keyframes that share a word with current frame
   {
-    unique_lock<mutex> lock(mMutex);
-
-    for(auto vit = F->mBowVec.begin(), vend = F->mBowVec.end(); vit != vend; ++vit) {
-      list<KeyFrame *> &lKFs = mvInvertedFile[vit->first];
+    ReadGuard guard(*this);
+    const KeyFrameTable &table = *mpKeyFrameTable.load();
 
-      for(auto pKFi : lKFs) {
-        if(pKFi->mnRelocQuery != F->mnId) {
-          pKFi->mnRelocWords = 0;
-          pKFi->mnRelocQuery = F->mnId;
-          lKFsSharingWords.push_back(pKFi);
-        }
-        pKFi->mnRelocWords++;
-      }
-    }
+    context.Begin(table.vpKeyFrames.size());
+    CollectCandidates(F->mBowVec, table, context);
   }
-  if(lKFsSharingWords.empty())
+  if(context.vCandidates.empty())
     return vector<KeyFrame *>();
 
   // Only compare against those keyframes that share enough words
-  int maxCommonWords = 0;
-  for(auto & lKFsSharingWord : lKFsSharingWords) {
-    if(lKFsSharingWord->mnRelocWords > maxCommonWords)
-      maxCommonWords = lKFsSharingWord->mnRelocWords;
-  }
+  uint32_t maxCommonWords = 0;
+  for(const uint32_t id : context.vCandidates)
+    maxCommonWords = max(maxCommonWords, context.vWords[id]);
 
   int minCommonWords = maxCommonWords * 0.8f;
 
-  list<pair<float, KeyFrame *> > lScoreAndMatch;
-
-  int nscores = 0;
-
   // Compute similarity score.
-  for(auto pKFi : lKFsSharingWords) {
-    if(pKFi->mnRelocWords > minCommonWords) {
-      nscores++;
-      float si = mpVoc->score(F->mBowVec, pKFi->mBowVec);
-      pKFi->mRelocScore = si;
-      lScoreAndMatch.emplace_back(si, pKFi);
-    }
-  }
+  ScoreCandidates(F->mBowVec, minCommonWords, context);
 
-  if(lScoreAndMatch.empty())
+  if(context.vScored.empty())
     return vector<KeyFrame *>();
 
-  list<pair<float, KeyFrame *> > lAccScoreAndMatch;
+  vector<pair<float, KeyFrame *> > vAccScoreAndMatch;
+  vAccScoreAndMatch.reserve(context.vScored.size());
   float bestAccScore = 0;
 
-  // Lets now accumulate score by covisibility
-  for(auto & it : lScoreAndMatch) {
-    KeyFrame *pKFi = it.second;
+  // Lets now accumulate score by covisibility. Neighbors sharing too few words to be
+  // scored count as 0
+  for(const size_t candidate : context.vScored) {
+    KeyFrame *pKFi = context.vpCandidates[candidate];
     vector<KeyFrame *> vpNeighs = pKFi->GetBestCovisibilityKeyFrames(10);
 
-    float bestScore = it.first;
+    float bestScore = context.vScores[context.vCandidates[candidate]];
     float accScore = bestScore;
     KeyFrame *pBestKF = pKFi;
     for(auto pKF2 : vpNeighs) {
-      if(pKF2->mnRelocQuery != F->mnId)
+      const auto id2 = static_cast<uint32_t>(pKF2->mnId);
+      if(!context.Touched(id2))
         continue;
 
-      accScore += pKF2->mRelocScore;
-      if(pKF2->mRelocScore > bestScore) {
+      accScore += context.vScores[id2];
+      if(context.vScores[id2] > bestScore) {
         pBestKF = pKF2;
-        bestScore = pKF2->mRelocScore;
+        bestScore = context.vScores[id2];
       }
     }
-    lAccScoreAndMatch.emplace_back(accScore, pBestKF);
+    vAccScoreAndMatch.emplace_back(accScore, pBestKF);
     if(accScore > bestAccScore)
       bestAccScore = accScore;
   }
@@ -239,8 +398,8 @@ vector<KeyFrame *> KeyFrameDatabase::DetectRelocalizationCandidates(Frame *F) {
   float minScoreToRetain = 0.75f * bestAccScore;
   set<KeyFrame *> spAlreadyAddedKF;
   vector<KeyFrame *> vpRelocCandidates;
-  vpRelocCandidates.reserve(lAccScoreAndMatch.size());
-  for(auto & it : lAccScoreAndMatch) {
+  vpRelocCandidates.reserve(vAccScoreAndMatch.size());
+  for(auto & it : vAccScoreAndMatch) {
     const float &si = it.first;
     if(si > minScoreToRetain) {
       KeyFrame *pKFi = it.second;
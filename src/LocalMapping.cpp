@@ -25,8 +25,10 @@
 #include "MapPoint.hpp"
 #include "KeyFrame.hpp"
 #include "Tracking.hpp"
+#include "Converter.hpp"
 #include "Optimizer.hpp"
 #include "ORBmatcher.hpp"
+#include "ThreadPool.hpp"
 #include "LoopClosing.hpp"
 #include "KeyFrameDatabase.hpp"
 
@@ -182,15 +184,64 @@ void LocalMapping::CreateNewMapPoints() {
     nn = 20;
   const vector<KeyFrame *> vpNeighKFs = mpCurrentKeyFrame->GetBestCovisibilityKeyFrames(nn);
 
+  // Search matches with epipolar restriction and triangulate, one task per neighbor.
+  // The tasks only read the keyframes, the map points are created below
+  vector<vector<TriangulatedPoint> > vvNewPoints(vpNeighKFs.size());
+  vector<uint8_t> vbSkipped(vpNeighKFs.size(), false);
+
+  utilities::ThreadPool::shared().parallelFor(vpNeighKFs.size(), [&](size_t i) {
+    if(i > 0 && CheckNewKeyFrames()) {
+      vbSkipped[i] = true;
+      return;
+    }
+    TriangulateWithNeighbor(vpNeighKFs[i], vvNewPoints[i]);
+  });
+
+  int nnew = 0;
+
+  // Create the map points in neighbor order. The matching skips keypoints of the current keyframe that
+  // already have a MapPoint, so a keypoint also triangulated with an earlier neighbor is skipped here.
+  // Neighbors are matched independently otherwise, which gives the points of a sequential pass
+  for(size_t i = 0; i < vpNeighKFs.size(); i++) {
+    if(i > 0 && (vbSkipped[i] || CheckNewKeyFrames()))
+      return;
+
+    KeyFrame *pKF2 = vpNeighKFs[i];
+
+    for(const TriangulatedPoint &point : vvNewPoints[i]) {
+      if(mpCurrentKeyFrame->GetMapPoint(point.idx1))
+        continue;
+
+      // Triangulation is succesfull
+      auto *pMP = new MapPoint(point.x3D, mpCurrentKeyFrame, mpMap);
+
+      pMP->AddObservation(mpCurrentKeyFrame, point.idx1);
+      pMP->AddObservation(pKF2, point.idx2);
+
+      mpCurrentKeyFrame->AddMapPoint(pMP, point.idx1);
+      pKF2->AddMapPoint(pMP, point.idx2);
+
+      pMP->ComputeDistinctiveDescriptors();
+
+      pMP->UpdateNormalAndDepth();
+
+      mpMap->AddMapPoint(pMP);
+      mlpRecentAddedMapPoints.push_back(pMP);
+
+      nnew++;
+    }
+  }
+}
+
+void LocalMapping::TriangulateWithNeighbor(KeyFrame *pKF2, vector<TriangulatedPoint> &vNewPoints) {
   ORBmatcher matcher(0.6, false);
 
-  cv::Mat Rcw1 = mpCurrentKeyFrame->GetRotation();
-  cv::Mat Rwc1 = Rcw1.t();
-  cv::Mat tcw1 = mpCurrentKeyFrame->GetTranslation();
-  cv::Mat Tcw1(3, 4, CV_32F);
-  Rcw1.copyTo(Tcw1.colRange(0, 3));
-  tcw1.copyTo(Tcw1.col(3));
-  cv::Mat Ow1 = mpCurrentKeyFrame->GetCameraCenter();
+  const KeyFrame::PoseState pose1 = mpCurrentKeyFrame->GetPoseState();
+  const Eigen::Matrix<float, 3, 4> Tcw1 = pose1.Tcw.topRows<3>();
+  const Eigen::Matrix3f Rcw1 = Tcw1.leftCols<3>();
+  const Eigen::Matrix3f Rwc1 = Rcw1.transpose();
+  const Eigen::Vector3f tcw1 = Tcw1.col(3);
+  const Eigen::Vector3f &Ow1 = pose1.Ow;
 
   const float &fx1 = mpCurrentKeyFrame->fx;
   const float &fy1 = mpCurrentKeyFrame->fy;
@@ -201,206 +252,174 @@ void LocalMapping::CreateNewMapPoints() {
 
   const float ratioFactor = 1.5f * mpCurrentKeyFrame->mfScaleFactor;
 
-  int nnew = 0;
+  // Check first that baseline is not too short
+  const KeyFrame::PoseState pose2 = pKF2->GetPoseState();
+  const Eigen::Vector3f &Ow2 = pose2.Ow;
+  const float baseline = (Ow2 - Ow1).norm();
 
-  // Search matches with epipolar restriction and triangulate
-  for(size_t i = 0; i < vpNeighKFs.size(); i++) {
-    if(i > 0 && CheckNewKeyFrames())
+  if(!mbMonocular) {
+    if(baseline < pKF2->mb)
       return;
+  } else {
+    const float medianDepthKF2 = pKF2->ComputeSceneMedianDepth(2);
+    const float ratioBaselineDepth = baseline / medianDepthKF2;
 
-    KeyFrame *pKF2 = vpNeighKFs[i];
-
-    // Check first that baseline is not too short
-    cv::Mat Ow2 = pKF2->GetCameraCenter();
-    cv::Mat vBaseline = Ow2 - Ow1;
-    const float baseline = cv::norm(vBaseline);
-
-    if(!mbMonocular) {
-      if(baseline < pKF2->mb)
-        continue;
-    } else {
-      const float medianDepthKF2 = pKF2->ComputeSceneMedianDepth(2);
-      const float ratioBaselineDepth = baseline / medianDepthKF2;
-
-      if(ratioBaselineDepth < 0.01)
-        continue;
-    }
-
-    // Compute Fundamental Matrix
-    cv::Mat F12 = ComputeF12(mpCurrentKeyFrame, pKF2);
-
-    // Search matches that fullfil epipolar constraint
-    vector<pair<size_t, size_t> > vMatchedIndices;
-    matcher.SearchForTriangulation(mpCurrentKeyFrame, pKF2, F12, vMatchedIndices, false);
-
-    cv::Mat Rcw2 = pKF2->GetRotation();
-    cv::Mat Rwc2 = Rcw2.t();
-    cv::Mat tcw2 = pKF2->GetTranslation();
-    cv::Mat Tcw2(3, 4, CV_32F);
-    Rcw2.copyTo(Tcw2.colRange(0, 3));
-    tcw2.copyTo(Tcw2.col(3));
-
-    const float &fx2 = pKF2->fx;
-    const float &fy2 = pKF2->fy;
-    const float &cx2 = pKF2->cx;
-    const float &cy2 = pKF2->cy;
-    const float &invfx2 = pKF2->invfx;
-    const float &invfy2 = pKF2->invfy;
-
-    // Triangulate each match
-    const int nmatches = vMatchedIndices.size();
-    for(int ikp = 0; ikp < nmatches; ikp++) {
-      const int &idx1 = vMatchedIndices[ikp].first;
-      const int &idx2 = vMatchedIndices[ikp].second;
-
-      const cv::KeyPoint &kp1 = mpCurrentKeyFrame->mvKeysUn[idx1];
-      const float kp1_ur = mpCurrentKeyFrame->mvuRight[idx1];
-      bool bStereo1 = kp1_ur >= 0;
-
-      const cv::KeyPoint &kp2 = pKF2->mvKeysUn[idx2];
-      const float kp2_ur = pKF2->mvuRight[idx2];
-      bool bStereo2 = kp2_ur >= 0;
-
-      // Check parallax between rays
-      cv::Mat xn1 = (cv::Mat_<float>(3, 1) << (kp1.pt.x - cx1) * invfx1, (kp1.pt.y - cy1) * invfy1, 1.0);
-      cv::Mat xn2 = (cv::Mat_<float>(3, 1) << (kp2.pt.x - cx2) * invfx2, (kp2.pt.y - cy2) * invfy2, 1.0);
-
-      cv::Mat ray1 = Rwc1 * xn1;
-      cv::Mat ray2 = Rwc2 * xn2;
-      const float cosParallaxRays = ray1.dot(ray2) / (cv::norm(ray1) * cv::norm(ray2));
-
-      float cosParallaxStereo = cosParallaxRays + 1;
-      float cosParallaxStereo1 = cosParallaxStereo;
-      float cosParallaxStereo2 = cosParallaxStereo;
-
-      if(bStereo1)
-        cosParallaxStereo1 = cos(2 * atan2(mpCurrentKeyFrame->mb / 2, mpCurrentKeyFrame->mvDepth[idx1]));
-      else if(bStereo2)
-        cosParallaxStereo2 = cos(2 * atan2(pKF2->mb / 2, pKF2->mvDepth[idx2]));
-
-      cosParallaxStereo = min(cosParallaxStereo1, cosParallaxStereo2);
-
-      cv::Mat x3D;
-      if(cosParallaxRays < cosParallaxStereo && cosParallaxRays > 0 && (bStereo1 || bStereo2 || cosParallaxRays < 0.9998)) {
-        // Linear Triangulation Method
-        cv::Mat A(4, 4, CV_32F);
-        A.row(0) = xn1.at<float>(0) * Tcw1.row(2) - Tcw1.row(0);
-        A.row(1) = xn1.at<float>(1) * Tcw1.row(2) - Tcw1.row(1);
-        A.row(2) = xn2.at<float>(0) * Tcw2.row(2) - Tcw2.row(0);
-        A.row(3) = xn2.at<float>(1) * Tcw2.row(2) - Tcw2.row(1);
-
-        cv::Mat w, u, vt;
-        cv::SVD::compute(A, w, u, vt, cv::SVD::MODIFY_A | cv::SVD::FULL_UV);
-
-        x3D = vt.row(3).t();
-
-        if(x3D.at<float>(3) == 0)
-          continue;
-
-        // Euclidean coordinates
-        x3D = x3D.rowRange(0, 3) / x3D.at<float>(3);
-
-      } else if(bStereo1 && cosParallaxStereo1 < cosParallaxStereo2) {
-        x3D = mpCurrentKeyFrame->UnprojectStereo(idx1);
-      } else if(bStereo2 && cosParallaxStereo2 < cosParallaxStereo1) {
-        x3D = pKF2->UnprojectStereo(idx2);
-      } else
-        continue;  //No stereo and very low parallax
-
-      cv::Mat x3Dt = x3D.t();
-
-      //Check triangulation in front of cameras
-      float z1 = Rcw1.row(2).dot(x3Dt) + tcw1.at<float>(2);
-      if(z1 <= 0)
-        continue;
+    if(ratioBaselineDepth < 0.01)
+      return;
+  }
 
-      float z2 = Rcw2.row(2).dot(x3Dt) + tcw2.at<float>(2);
-      if(z2 <= 0)
+  // Compute Fundamental Matrix
+  const Eigen::Matrix3f F12 = ComputeF12(mpCurrentKeyFrame, pKF2);
+
+  // Search matches that fullfil epipolar constraint
+  vector<pair<size_t, size_t> > vMatchedIndices;
+  matcher.SearchForTriangulation(mpCurrentKeyFrame, pKF2, F12, vMatchedIndices, false);
+
+  const Eigen::Matrix<float, 3, 4> Tcw2 = pose2.Tcw.topRows<3>();
+  const Eigen::Matrix3f Rcw2 = Tcw2.leftCols<3>();
+  const Eigen::Matrix3f Rwc2 = Rcw2.transpose();
+  const Eigen::Vector3f tcw2 = Tcw2.col(3);
+
+  const float &fx2 = pKF2->fx;
+  const float &fy2 = pKF2->fy;
+  const float &cx2 = pKF2->cx;
+  const float &cy2 = pKF2->cy;
+  const float &invfx2 = pKF2->invfx;
+  const float &invfy2 = pKF2->invfy;
+
+  // Triangulate each match
+  const int nmatches = vMatchedIndices.size();
+  for(int ikp = 0; ikp < nmatches; ikp++) {
+    const int &idx1 = vMatchedIndices[ikp].first;
+    const int &idx2 = vMatchedIndices[ikp].second;
+
+    const cv::KeyPoint &kp1 = mpCurrentKeyFrame->mvKeysUn[idx1];
+    const float kp1_ur = mpCurrentKeyFrame->mvuRight[idx1];
+    bool bStereo1 = kp1_ur >= 0;
+
+    const cv::KeyPoint &kp2 = pKF2->mvKeysUn[idx2];
+    const float kp2_ur = pKF2->mvuRight[idx2];
+    bool bStereo2 = kp2_ur >= 0;
+
+    // Check parallax between rays
+    const Eigen::Vector3f xn1((kp1.pt.x - cx1) * invfx1, (kp1.pt.y - cy1) * invfy1, 1.0f);
+    const Eigen::Vector3f xn2((kp2.pt.x - cx2) * invfx2, (kp2.pt.y - cy2) * invfy2, 1.0f);
+
+    const Eigen::Vector3f ray1 = Rwc1 * xn1;
+    const Eigen::Vector3f ray2 = Rwc2 * xn2;
+    const float cosParallaxRays = ray1.dot(ray2) / (ray1.norm() * ray2.norm());
+
+    float cosParallaxStereo = cosParallaxRays + 1;
+    float cosParallaxStereo1 = cosParallaxStereo;
+    float cosParallaxStereo2 = cosParallaxStereo;
+
+    if(bStereo1)
+      cosParallaxStereo1 = cos(2 * atan2(mpCurrentKeyFrame->mb / 2, mpCurrentKeyFrame->mvDepth[idx1]));
+    else if(bStereo2)
+      cosParallaxStereo2 = cos(2 * atan2(pKF2->mb / 2, pKF2->mvDepth[idx2]));
+
+    cosParallaxStereo = min(cosParallaxStereo1, cosParallaxStereo2);
+
+    Eigen::Vector3f x3D;
+    if(cosParallaxRays < cosParallaxStereo && cosParallaxRays > 0 && (bStereo1 || bStereo2 || cosParallaxRays < 0.9998)) {
+      // Linear Triangulation Method
+      Eigen::Matrix4f A;
+      A.row(0) = xn1(0) * Tcw1.row(2) - Tcw1.row(0);
+      A.row(1) = xn1(1) * Tcw1.row(2) - Tcw1.row(1);
+      A.row(2) = xn2(0) * Tcw2.row(2) - Tcw2.row(0);
+      A.row(3) = xn2(1) * Tcw2.row(2) - Tcw2.row(1);
+
+      const Eigen::JacobiSVD<Eigen::Matrix4f> svd(A, Eigen::ComputeFullV);
+      const Eigen::Vector4f x3Dh = svd.matrixV().col(3);
+
+      if(x3Dh(3) == 0)
         continue;
 
-      //Check reprojection error in first keyframe
-      const float &sigmaSquare1 = mpCurrentKeyFrame->mvLevelSigma2[kp1.octave];
-      const float x1 = Rcw1.row(0).dot(x3Dt) + tcw1.at<float>(0);
-      const float y1 = Rcw1.row(1).dot(x3Dt) + tcw1.at<float>(1);
-      const float invz1 = 1.0 / z1;
-
-      if(!bStereo1) {
-        float u1 = fx1 * x1 * invz1 + cx1;
-        float v1 = fy1 * y1 * invz1 + cy1;
-        float errX1 = u1 - kp1.pt.x;
-        float errY1 = v1 - kp1.pt.y;
-        if((errX1 * errX1 + errY1 * errY1) > 5.991 * sigmaSquare1)
-          continue;
-      } else {
-        float u1 = fx1 * x1 * invz1 + cx1;
-        float u1_r = u1 - mpCurrentKeyFrame->mbf * invz1;
-        float v1 = fy1 * y1 * invz1 + cy1;
-        float errX1 = u1 - kp1.pt.x;
-        float errY1 = v1 - kp1.pt.y;
-        float errX1_r = u1_r - kp1_ur;
-        if((errX1 * errX1 + errY1 * errY1 + errX1_r * errX1_r) > 7.8 * sigmaSquare1)
-          continue;
-      }
+      // Euclidean coordinates
+      x3D = x3Dh.head<3>() / x3Dh(3);
 
-      //Check reprojection error in second keyframe
-      const float sigmaSquare2 = pKF2->mvLevelSigma2[kp2.octave];
-      const float x2 = Rcw2.row(0).dot(x3Dt) + tcw2.at<float>(0);
-      const float y2 = Rcw2.row(1).dot(x3Dt) + tcw2.at<float>(1);
-      const float invz2 = 1.0 / z2;
-      if(!bStereo2) {
-        float u2 = fx2 * x2 * invz2 + cx2;
-        float v2 = fy2 * y2 * invz2 + cy2;
-        float errX2 = u2 - kp2.pt.x;
-        float errY2 = v2 - kp2.pt.y;
-        if((errX2 * errX2 + errY2 * errY2) > 5.991 * sigmaSquare2)
-          continue;
-      } else {
-        float u2 = fx2 * x2 * invz2 + cx2;
-        float u2_r = u2 - mpCurrentKeyFrame->mbf * invz2;
-        float v2 = fy2 * y2 * invz2 + cy2;
-        float errX2 = u2 - kp2.pt.x;
-        float errY2 = v2 - kp2.pt.y;
-        float errX2_r = u2_r - kp2_ur;
-        if((errX2 * errX2 + errY2 * errY2 + errX2_r * errX2_r) > 7.8 * sigmaSquare2)
-          continue;
-      }
+    } else if(bStereo1 && cosParallaxStereo1 < cosParallaxStereo2) {
+      x3D = mpCurrentKeyFrame->UnprojectStereo(idx1);
+    } else if(bStereo2 && cosParallaxStereo2 < cosParallaxStereo1) {
+      x3D = pKF2->UnprojectStereo(idx2);
+    } else
+      continue;  //No stereo and very low parallax
 
-      //Check scale consistency
-      cv::Mat normal1 = x3D - Ow1;
-      float dist1 = cv::norm(normal1);
+    //Check triangulation in front of cameras
+    const Eigen::Vector3f x3Dc1 = Rcw1 * x3D + tcw1;
+    float z1 = x3Dc1(2);
+    if(z1 <= 0)
+      continue;
 
-      cv::Mat normal2 = x3D - Ow2;
-      float dist2 = cv::norm(normal2);
+    const Eigen::Vector3f x3Dc2 = Rcw2 * x3D + tcw2;
+    float z2 = x3Dc2(2);
+    if(z2 <= 0)
+      continue;
 
-      if(dist1 == 0 || dist2 == 0)
+    //Check reprojection error in first keyframe
+    const float &sigmaSquare1 = mpCurrentKeyFrame->mvLevelSigma2[kp1.octave];
+    const float x1 = x3Dc1(0);
+    const float y1 = x3Dc1(1);
+    const float invz1 = 1.0 / z1;
+
+    if(!bStereo1) {
+      float u1 = fx1 * x1 * invz1 + cx1;
+      float v1 = fy1 * y1 * invz1 + cy1;
+      float errX1 = u1 - kp1.pt.x;
+      float errY1 = v1 - kp1.pt.y;
+      if((errX1 * errX1 + errY1 * errY1) > 5.991 * sigmaSquare1)
         continue;
-
-      const float ratioDist = dist2 / dist1;
-      const float ratioOctave = mpCurrentKeyFrame->mvScaleFactors[kp1.octave] / pKF2->mvScaleFactors[kp2.octave];
-
-      /*if(fabs(ratioDist-ratioOctave)>ratioFactor)
-                continue;*/
-      if(ratioDist * ratioFactor < ratioOctave || ratioDist > ratioOctave * ratioFactor)
+    } else {
+      float u1 = fx1 * x1 * invz1 + cx1;
+      float u1_r = u1 - mpCurrentKeyFrame->mbf * invz1;
+      float v1 = fy1 * y1 * invz1 + cy1;
+      float errX1 = u1 - kp1.pt.x;
+      float errY1 = v1 - kp1.pt.y;
+      float errX1_r = u1_r - kp1_ur;
+      if((errX1 * errX1 + errY1 * errY1 + errX1_r * errX1_r) > 7.8 * sigmaSquare1)
         continue;
+    }
 
-      // Triangulation is succesfull
-      auto *pMP = new MapPoint(x3D, mpCurrentKeyFrame, mpMap);
+    //Check reprojection error in second keyframe
+    const float sigmaSquare2 = pKF2->mvLevelSigma2[kp2.octave];
+    const float x2 = x3Dc2(0);
+    const float y2 = x3Dc2(1);
+    const float invz2 = 1.0 / z2;
+    if(!bStereo2) {
+      float u2 = fx2 * x2 * invz2 + cx2;
+      float v2 = fy2 * y2 * invz2 + cy2;
+      float errX2 = u2 - kp2.pt.x;
+      float errY2 = v2 - kp2.pt.y;
+      if((errX2 * errX2 + errY2 * errY2) > 5.991 * sigmaSquare2)
+        continue;
+    } else {
+      float u2 = fx2 * x2 * invz2 + cx2;
+      float u2_r = u2 - mpCurrentKeyFrame->mbf * invz2;
+      float v2 = fy2 * y2 * invz2 + cy2;
+      float errX2 = u2 - kp2.pt.x;
+      float errY2 = v2 - kp2.pt.y;
+      float errX2_r = u2_r - kp2_ur;
+      if((errX2 * errX2 + errY2 * errY2 + errX2_r * errX2_r) > 7.8 * sigmaSquare2)
+        continue;
+    }
 
-      pMP->AddObservation(mpCurrentKeyFrame, idx1);
-      pMP->AddObservation(pKF2, idx2);
+    //Check scale consistency
+    float dist1 = (x3D - Ow1).norm();
 
-      mpCurrentKeyFrame->AddMapPoint(pMP, idx1);
-      pKF2->AddMapPoint(pMP, idx2);
+    float dist2 = (x3D - Ow2).norm();
 
-      pMP->ComputeDistinctiveDescriptors();
+    if(dist1 == 0 || dist2 == 0)
+      continue;
 
-      pMP->UpdateNormalAndDepth();
+    const float ratioDist = dist2 / dist1;
+    const float ratioOctave = mpCurrentKeyFrame->mvScaleFactors[kp1.octave] / pKF2->mvScaleFactors[kp2.octave];
 
-      mpMap->AddMapPoint(pMP);
-      mlpRecentAddedMapPoints.push_back(pMP);
+    /*if(fabs(ratioDist-ratioOctave)>ratioFactor)
+              continue;*/
+    if(ratioDist * ratioFactor < ratioOctave || ratioDist > ratioOctave * ratioFactor)
+      continue;
 
-      nnew++;
-    }
+    vNewPoints.push_back({static_cast<size_t>(idx1), static_cast<size_t>(idx2), x3D});
   }
 }
 
@@ -428,10 +447,9 @@ void LocalMapping::SearchInNeighbors() {
 
   // Search matches by projection from current KF in target KFs
   ORBmatcher matcher;
+  matcher.SetThreadPool(&utilities::ThreadPool::shared());
   vector<MapPoint *> vpMapPointMatches = mpCurrentKeyFrame->GetMapPointMatches();
-  for(auto pKFi : vpTargetKFs) {
-    matcher.Fuse(pKFi, vpMapPointMatches);
-  }
+  matcher.Fuse(vpTargetKFs, vpMapPointMatches);
 
   // Search matches by projection from target KFs in current KF
   vector<MapPoint *> vpFuseCandidates;
@@ -450,7 +468,7 @@ void LocalMapping::SearchInNeighbors() {
     }
   }
 
-  matcher.Fuse(mpCurrentKeyFrame, vpFuseCandidates);
+  matcher.Fuse(vector<KeyFrame *>(1, mpCurrentKeyFrame), vpFuseCandidates);
 
   // Update points
   vpMapPointMatches = mpCurrentKeyFrame->GetMapPointMatches();
@@ -467,21 +485,23 @@ void LocalMapping::SearchInNeighbors() {
   mpCurrentKeyFrame->UpdateConnections();
 }
 
-cv::Mat LocalMapping::ComputeF12(KeyFrame *&pKF1, KeyFrame *&pKF2) {
-  cv::Mat R1w = pKF1->GetRotation();
-  cv::Mat t1w = pKF1->GetTranslation();
-  cv::Mat R2w = pKF2->GetRotation();
-  cv::Mat t2w = pKF2->GetTranslation();
+Eigen::Matrix3f LocalMapping::ComputeF12(KeyFrame *&pKF1, KeyFrame *&pKF2) {
+  const Eigen::Matrix4f T1w = pKF1->GetPose();
+  const Eigen::Matrix4f T2w = pKF2->GetPose();
+  const Eigen::Matrix3f R1w = T1w.topLeftCorner<3, 3>();
+  const Eigen::Vector3f t1w = T1w.topRightCorner<3, 1>();
+  const Eigen::Matrix3f R2w = T2w.topLeftCorner<3, 3>();
+  const Eigen::Vector3f t2w = T2w.topRightCorner<3, 1>();
 
-  cv::Mat R12 = R1w * R2w.t();
-  cv::Mat t12 = -R1w * R2w.t() * t2w + t1w;
+  const Eigen::Matrix3f R12 = R1w * R2w.transpose();
+  const Eigen::Vector3f t12 = -R1w * R2w.transpose() * t2w + t1w;
 
-  cv::Mat t12x = SkewSymmetricMatrix(t12);
+  const Eigen::Matrix3f t12x = SkewSymmetricMatrix(t12);
 
-  const cv::Mat &K1 = pKF1->mK;
-  const cv::Mat &K2 = pKF2->mK;
+  const Eigen::Matrix3f K1 = Converter::toMatrix3f(pKF1->mK);
+  const Eigen::Matrix3f K2 = Converter::toMatrix3f(pKF2->mK);
 
-  return K1.t().inv() * t12x * R12 * K2.inv();
+  return K1.transpose().inverse() * t12x * R12 * K2.inverse();
 }
 
 void LocalMapping::RequestStop() {
@@ -577,7 +597,7 @@ void LocalMapping::KeyFrameCulling() {
           nMPs++;
           if(pMP->Observations() > thObs) {
             const int &scaleLevel = pKF->mvKeysUn[i].octave;
-            const map<KeyFrame *, size_t> observations = pMP->GetObservations();
+            const ObservationList observations = pMP->GetObservations();
             int nObs = 0;
             for(auto observation : observations) {
               KeyFrame *pKFi = observation.first;
@@ -604,8 +624,10 @@ void LocalMapping::KeyFrameCulling() {
   }
 }
 
-cv::Mat LocalMapping::SkewSymmetricMatrix(const cv::Mat &v) {
-  return (cv::Mat_<float>(3, 3) << 0, -v.at<float>(2), v.at<float>(1), v.at<float>(2), 0, -v.at<float>(0), -v.at<float>(1), v.at<float>(0), 0);
+Eigen::Matrix3f LocalMapping::SkewSymmetricMatrix(const Eigen::Vector3f &v) {
+  Eigen::Matrix3f M;
+  M << 0, -v(2), v(1), v(2), 0, -v(0), -v(1), v(0), 0;
+  return M;
 }
 
 void LocalMapping::RequestReset() {
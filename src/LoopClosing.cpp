@@ -29,6 +29,7 @@
 #include "Converter.hpp"
 #include "Sim3Solver.hpp"
 #include "ORBmatcher.hpp"
+#include "ThreadPool.hpp"
 #include "LocalMapping.hpp"
 #include "KeyFrameDatabase.hpp"
 
@@ -104,12 +105,12 @@ bool LoopClosing::DetectLoop() {
   // This is the lowest score to a connected keyframe in the covisibility graph
   // We will impose loop candidates to have a higher similarity than this
   const vector<KeyFrame *> vpConnectedKeyFrames = mpCurrentKF->GetVectorCovisibleKeyFrames();
-  const DBoW2::BowVector &CurrentBowVec = mpCurrentKF->mBowVec;
+  const BowVector &CurrentBowVec = mpCurrentKF->mBowVec;
   float minScore = 1;
   for(auto pKF : vpConnectedKeyFrames) {
     if(pKF->isBad())
       continue;
-    const DBoW2::BowVector &BowVec = pKF->mBowVec;
+    const BowVector &BowVec = pKF->mBowVec;
 
     float score = mpORBVocabulary->score(CurrentBowVec, BowVec);
 
@@ -118,7 +119,7 @@ bool LoopClosing::DetectLoop() {
   }
 
   // Query the database imposing the minimum score
-  vector<KeyFrame *> vpCandidateKFs = mpKeyFrameDB->DetectLoopCandidates(mpCurrentKF, minScore);
+  vector<KeyFrame *> vpCandidateKFs = mpKeyFrameDB->DetectLoopCandidates(mpCurrentKF, minScore, mLoopQuery);
 
   // If there are no loop candidates, just add new keyframe and return false
   if(vpCandidateKFs.empty()) {
@@ -197,6 +198,7 @@ bool LoopClosing::ComputeSim3() {
   // We compute first ORB matches for each candidate
   // If enough matches are found, we setup a Sim3Solver
   ORBmatcher matcher(0.75, true);
+  matcher.SetThreadPool(&utilities::ThreadPool::shared());
 
   vector<Sim3Solver *> vpSim3Solvers;
   vpSim3Solvers.resize(nInitialCandidates);
@@ -251,7 +253,8 @@ bool LoopClosing::ComputeSim3() {
       bool bNoMore;
 
       Sim3Solver *pSolver = vpSim3Solvers[i];
-      cv::Mat Scm = pSolver->iterate(5, bNoMore, vbInliers, nInliers);
+      Eigen::Matrix4f Scm;
+      const bool bFound = pSolver->iterate(5, bNoMore, vbInliers, nInliers, Scm);
 
       // If Ransac reachs max. iterations discard keyframe
       if(bNoMore) {
@@ -260,28 +263,29 @@ bool LoopClosing::ComputeSim3() {
       }
 
       // If RANSAC returns a Sim3, perform a guided matching and optimize with all correspondences
-      if(!Scm.empty()) {
+      if(bFound) {
         vector<MapPoint *> vpMapPointMatches(vvpMapPointMatches[i].size(), nullptr);
         for(size_t j = 0, jend = vbInliers.size(); j < jend; j++) {
           if(vbInliers[j])
             vpMapPointMatches[j] = vvpMapPointMatches[i][j];
         }
 
-        cv::Mat R = pSolver->GetEstimatedRotation();
-        cv::Mat t = pSolver->GetEstimatedTranslation();
+        const Eigen::Matrix3f R = pSolver->GetEstimatedRotation();
+        const Eigen::Vector3f t = pSolver->GetEstimatedTranslation();
         const float s = pSolver->GetEstimatedScale();
         matcher.SearchBySim3(mpCurrentKF, pKF, vpMapPointMatches, s, R, t, 7.5);
 
-        g2o::Sim3 gScm(Converter::toMatrix3d(R), Converter::toVector3d(t), s);
+        g2o::Sim3 gScm(R.cast<double>(), t.cast<double>(), s);
         const int nInliers2 = Optimizer::OptimizeSim3(mpCurrentKF, pKF, vpMapPointMatches, gScm, 10, mbFixScale);
 
         // If optimization is succesful stop ransacs and continue
         if(nInliers2 >= 20) {
           bMatch = true;
           mpMatchedKF = pKF;
-          g2o::Sim3 gSmw(Converter::toMatrix3d(pKF->GetRotation()), Converter::toVector3d(pKF->GetTranslation()), 1.0);
+          const Eigen::Matrix4f Tmw = pKF->GetPose();
+          g2o::Sim3 gSmw(Tmw.topLeftCorner<3, 3>().cast<double>(), Tmw.topRightCorner<3, 1>().cast<double>(), 1.0);
           mg2oScw = gScm * gSmw;
-          mScw = Converter::toCvMat(mg2oScw);
+          mScw = Converter::toMatrix4f(mg2oScw);
 
           mvpCurrentMatchedPoints = vpMapPointMatches;
           break;
@@ -370,28 +374,24 @@ void LoopClosing::CorrectLoop() {
 
   KeyFrameAndPose CorrectedSim3, NonCorrectedSim3;
   CorrectedSim3[mpCurrentKF] = mg2oScw;
-  cv::Mat Twc = mpCurrentKF->GetPoseInverse();
+  const Eigen::Matrix4f Twc = mpCurrentKF->GetPoseInverse();
 
   {
     // Get Map Mutex
     unique_lock<mutex> lock(mpMap->mMutexMapUpdate);
 
     for(auto pKFi : mvpCurrentConnectedKFs) {
-      cv::Mat Tiw = pKFi->GetPose();
+      const Eigen::Matrix4f Tiw = pKFi->GetPose();
 
       if(pKFi != mpCurrentKF) {
-        cv::Mat Tic = Tiw * Twc;
-        cv::Mat Ric = Tic.rowRange(0, 3).colRange(0, 3);
-        cv::Mat tic = Tic.rowRange(0, 3).col(3);
-        g2o::Sim3 g2oSic(Converter::toMatrix3d(Ric), Converter::toVector3d(tic), 1.0);
+        const Eigen::Matrix4f Tic = Tiw * Twc;
+        g2o::Sim3 g2oSic(Tic.topLeftCorner<3, 3>().cast<double>(), Tic.topRightCorner<3, 1>().cast<double>(), 1.0);
         g2o::Sim3 g2oCorrectedSiw = g2oSic * mg2oScw;
         //Pose corrected with the Sim3 of the loop closure
         CorrectedSim3[pKFi] = g2oCorrectedSiw;
       }
 
-      cv::Mat Riw = Tiw.rowRange(0, 3).colRange(0, 3);
-      cv::Mat tiw = Tiw.rowRange(0, 3).col(3);
-      g2o::Sim3 g2oSiw(Converter::toMatrix3d(Riw), Converter::toVector3d(tiw), 1.0);
+      g2o::Sim3 g2oSiw(Tiw.topLeftCorner<3, 3>().cast<double>(), Tiw.topRightCorner<3, 1>().cast<double>(), 1.0);
       //Pose without correction
       NonCorrectedSim3[pKFi] = g2oSiw;
     }
@@ -414,12 +414,10 @@ void LoopClosing::CorrectLoop() {
           continue;
 
         // Project with non-corrected pose and project back with corrected pose
-        cv::Mat P3Dw = pMPi->GetWorldPos();
-        Eigen::Matrix<double, 3, 1> eigP3Dw = Converter::toVector3d(P3Dw);
-        Eigen::Matrix<double, 3, 1> eigCorrectedP3Dw = g2oCorrectedSwi.map(g2oSiw.map(eigP3Dw));
+        const Eigen::Vector3d eigP3Dw = pMPi->GetWorldPos().cast<double>();
+        const Eigen::Vector3d eigCorrectedP3Dw = g2oCorrectedSwi.map(g2oSiw.map(eigP3Dw));
 
-        cv::Mat cvCorrectedP3Dw = Converter::toCvMat(eigCorrectedP3Dw);
-        pMPi->SetWorldPos(cvCorrectedP3Dw);
+        pMPi->SetWorldPos(eigCorrectedP3Dw.cast<float>());
         pMPi->mnCorrectedByKF = mpCurrentKF->mnId;
         pMPi->mnCorrectedReference = pKFi->mnId;
         pMPi->UpdateNormalAndDepth();
@@ -432,7 +430,9 @@ void LoopClosing::CorrectLoop() {
 
       eigt *= (1. / s);  //[R t/s;0 1]
 
-      cv::Mat correctedTiw = Converter::toCvSE3(eigR, eigt);
+      Eigen::Matrix4f correctedTiw = Eigen::Matrix4f::Identity();
+      correctedTiw.topLeftCorner<3, 3>() = eigR.cast<float>();
+      correctedTiw.topRightCorner<3, 1>() = eigt.cast<float>();
 
       pKFi->SetPose(correctedTiw);
 
@@ -508,10 +508,10 @@ void LoopClosing::SearchAndFuse(const KeyFrameAndPose &CorrectedPosesMap) {
     KeyFrame *pKF = mit.first;
 
     g2o::Sim3 g2oScw = mit.second;
-    cv::Mat cvScw = Converter::toCvMat(g2oScw);
+    const Eigen::Matrix4f Scw = Converter::toMatrix4f(g2oScw);
 
     vector<MapPoint *> vpReplacePoints(mvpLoopMapPoints.size(), nullptr);
-    matcher.Fuse(pKF, cvScw, mvpLoopMapPoints, 4, vpReplacePoints);
+    matcher.Fuse(pKF, Scw, mvpLoopMapPoints, 4, vpReplacePoints);
 
     // Get Map Mutex
     unique_lock<mutex> lock(mpMap->mMutexMapUpdate);
@@ -585,10 +585,10 @@ void LoopClosing::RunGlobalBundleAdjustment(unsigned long nLoopKF) {
       while(!lpKFtoCheck.empty()) {
         KeyFrame *pKF = lpKFtoCheck.front();
         const std::set<KeyFrame *> sChilds = pKF->GetChilds();
-        cv::Mat Twc = pKF->GetPoseInverse();
+        const Eigen::Matrix4f Twc = pKF->GetPoseInverse();
         for(auto pChild : sChilds) {
           if(pChild->mnBAGlobalForKF != nLoopKF) {
-            cv::Mat Tchildc = pChild->GetPose() * Twc;
+            const Eigen::Matrix4f Tchildc = pChild->GetPose() * Twc;
             pChild->mTcwGBA = Tchildc * pKF->mTcwGBA;  //*Tcorc*pKF->mTcwGBA;
             pChild->mnBAGlobalForKF = nLoopKF;
           }
@@ -619,14 +619,14 @@ void LoopClosing::RunGlobalBundleAdjustment(unsigned long nLoopKF) {
             continue;
 
           // Map to non-corrected camera
-          cv::Mat Rcw = pRefKF->mTcwBefGBA.rowRange(0, 3).colRange(0, 3);
-          cv::Mat tcw = pRefKF->mTcwBefGBA.rowRange(0, 3).col(3);
-          cv::Mat Xc = Rcw * pMP->GetWorldPos() + tcw;
+          const Eigen::Matrix3f Rcw = pRefKF->mTcwBefGBA.topLeftCorner<3, 3>();
+          const Eigen::Vector3f tcw = pRefKF->mTcwBefGBA.topRightCorner<3, 1>();
+          const Eigen::Vector3f Xc = Rcw * pMP->GetWorldPos() + tcw;
 
           // Backproject using corrected camera
-          cv::Mat Twc = pRefKF->GetPoseInverse();
-          cv::Mat Rwc = Twc.rowRange(0, 3).colRange(0, 3);
-          cv::Mat twc = Twc.rowRange(0, 3).col(3);
+          const Eigen::Matrix4f Twc = pRefKF->GetPoseInverse();
+          const Eigen::Matrix3f Rwc = Twc.topLeftCorner<3, 3>();
+          const Eigen::Vector3f twc = Twc.topRightCorner<3, 1>();
 
           pMP->SetWorldPos(Rwc * Xc + twc);
         }
@@ -53,8 +53,8 @@ void MapDrawer::DrawMapPoints() const {
   for(auto vpMP : vpMPs) {
     if(vpMP->isBad() || spRefMPs.count(vpMP))
       continue;
-    cv::Mat pos = vpMP->GetWorldPos();
-    glVertex3f(pos.at<float>(0), pos.at<float>(1), pos.at<float>(2));
+    const Eigen::Vector3f pos = vpMP->GetWorldPos();
+    glVertex3f(pos(0), pos(1), pos(2));
   }
   glEnd();
 
@@ -65,8 +65,8 @@ void MapDrawer::DrawMapPoints() const {
   for(auto spRefMP : spRefMPs) {
     if(spRefMP->isBad())
       continue;
-    cv::Mat pos = spRefMP->GetWorldPos();
-    glVertex3f(pos.at<float>(0), pos.at<float>(1), pos.at<float>(2));
+    const Eigen::Vector3f pos = spRefMP->GetWorldPos();
+    glVertex3f(pos(0), pos(1), pos(2));
   }
 
   glEnd();
@@ -81,11 +81,12 @@ void MapDrawer::DrawKeyFrames(bool bDrawKF, bool bDrawGraph) const {
 
   if(bDrawKF) {
     for(auto pKF : vpKFs) {
-      cv::Mat Twc = pKF->GetPoseInverse().t();
+      // Eigen is column-major like OpenGL, no transpose needed
+      const Eigen::Matrix4f Twc = pKF->GetPoseInverse();
 
       glPushMatrix();
 
-      glMultMatrixf(Twc.ptr<GLfloat>(0));
+      glMultMatrixf(Twc.data());
 
       glLineWidth(mKeyFrameLineWidth);
       glColor3f(0.0f, 0.0f, 1.0f);
@@ -124,23 +125,23 @@ void MapDrawer::DrawKeyFrames(bool bDrawKF, bool bDrawGraph) const {
     for(auto vpKF : vpKFs) {
       // Covisibility Graph
       const vector<KeyFrame *> vCovKFs = vpKF->GetCovisiblesByWeight(100);
-      cv::Mat Ow = vpKF->GetCameraCenter();
+      const Eigen::Vector3f Ow = vpKF->GetCameraCenter();
       if(!vCovKFs.empty()) {
         for(auto vCovKF : vCovKFs) {
           if(vCovKF->mnId < vpKF->mnId)
             continue;
-          cv::Mat Ow2 = vCovKF->GetCameraCenter();
-          glVertex3f(Ow.at<float>(0), Ow.at<float>(1), Ow.at<float>(2));
-          glVertex3f(Ow2.at<float>(0), Ow2.at<float>(1), Ow2.at<float>(2));
+          const Eigen::Vector3f Ow2 = vCovKF->GetCameraCenter();
+          glVertex3f(Ow(0), Ow(1), Ow(2));
+          glVertex3f(Ow2(0), Ow2(1), Ow2(2));
         }
       }
 
       // Spanning tree
       KeyFrame *pParent = vpKF->GetParent();
       if(pParent) {
-        cv::Mat Owp = pParent->GetCameraCenter();
-        glVertex3f(Ow.at<float>(0), Ow.at<float>(1), Ow.at<float>(2));
-        glVertex3f(Owp.at<float>(0), Owp.at<float>(1), Owp.at<float>(2));
+        const Eigen::Vector3f Owp = pParent->GetCameraCenter();
+        glVertex3f(Ow(0), Ow(1), Ow(2));
+        glVertex3f(Owp(0), Owp(1), Owp(2));
       }
 
       // Loops
@@ -148,9 +149,9 @@ void MapDrawer::DrawKeyFrames(bool bDrawKF, bool bDrawGraph) const {
       for(auto sLoopKF : sLoopKFs) {
         if(sLoopKF->mnId < vpKF->mnId)
           continue;
-        cv::Mat Owl = sLoopKF->GetCameraCenter();
-        glVertex3f(Ow.at<float>(0), Ow.at<float>(1), Ow.at<float>(2));
-        glVertex3f(Owl.at<float>(0), Owl.at<float>(1), Owl.at<float>(2));
+        const Eigen::Vector3f Owl = sLoopKF->GetCameraCenter();
+        glVertex3f(Ow(0), Ow(1), Ow(2));
+        glVertex3f(Owl(0), Owl(1), Owl(2));
       }
     }
 
@@ -199,42 +200,44 @@ void MapDrawer::DrawCurrentCamera(pangolin::OpenGlMatrix &Twc) const {
   glPopMatrix();
 }
 
-void MapDrawer::SetCurrentCameraPose(const cv::Mat &Tcw) {
+void MapDrawer::SetCurrentCameraPose(const Eigen::Matrix4f &Tcw) {
   unique_lock<mutex> lock(mMutexCamera);
-  mCameraPose = Tcw.clone();
+  mCameraPose = Tcw;
+  mbCameraPose = true;
 }
 
 void MapDrawer::GetCurrentOpenGLCameraMatrix(pangolin::OpenGlMatrix &M) {
-  if(!mCameraPose.empty()) {
-    cv::Mat Rwc(3, 3, CV_32F);
-    cv::Mat twc(3, 1, CV_32F);
-    {
-      unique_lock<mutex> lock(mMutexCamera);
-      Rwc = mCameraPose.rowRange(0, 3).colRange(0, 3).t();
-      twc = -Rwc * mCameraPose.rowRange(0, 3).col(3);
+  Eigen::Matrix3f Rwc;
+  Eigen::Vector3f twc;
+  {
+    unique_lock<mutex> lock(mMutexCamera);
+    if(!mbCameraPose) {
+      M.SetIdentity();
+      return;
     }
+    Rwc = mCameraPose.topLeftCorner<3, 3>().transpose();
+    twc = -Rwc * mCameraPose.topRightCorner<3, 1>();
+  }
 
-    M.m[0] = Rwc.at<float>(0, 0);
-    M.m[1] = Rwc.at<float>(1, 0);
-    M.m[2] = Rwc.at<float>(2, 0);
-    M.m[3] = 0.0;
-
-    M.m[4] = Rwc.at<float>(0, 1);
-    M.m[5] = Rwc.at<float>(1, 1);
-    M.m[6] = Rwc.at<float>(2, 1);
-    M.m[7] = 0.0;
-
-    M.m[8] = Rwc.at<float>(0, 2);
-    M.m[9] = Rwc.at<float>(1, 2);
-    M.m[10] = Rwc.at<float>(2, 2);
-    M.m[11] = 0.0;
-
-    M.m[12] = twc.at<float>(0);
-    M.m[13] = twc.at<float>(1);
-    M.m[14] = twc.at<float>(2);
-    M.m[15] = 1.0;
-  } else
-    M.SetIdentity();
+  M.m[0] = Rwc(0, 0);
+  M.m[1] = Rwc(1, 0);
+  M.m[2] = Rwc(2, 0);
+  M.m[3] = 0.0;
+
+  M.m[4] = Rwc(0, 1);
+  M.m[5] = Rwc(1, 1);
+  M.m[6] = Rwc(2, 1);
+  M.m[7] = 0.0;
+
+  M.m[8] = Rwc(0, 2);
+  M.m[9] = Rwc(1, 2);
+  M.m[10] = Rwc(2, 2);
+  M.m[11] = 0.0;
+
+  M.m[12] = twc(0);
+  M.m[13] = twc(1);
+  M.m[14] = twc(2);
+  M.m[15] = 1.0;
 }
 
 }  // namespace ORB_SLAM2
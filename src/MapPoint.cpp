@@ -23,65 +23,105 @@
 #include "Map.hpp"
 #include "Frame.hpp"
 #include "KeyFrame.hpp"
+#include "Converter.hpp"
 #include "ORBmatcher.hpp"
+#include "HammingDistance.hpp"
 
 namespace ORB_SLAM2 {
 
+namespace {
+
+// Orders the observed descriptors as the KeyFrames of mObservations
+struct ByKeyFrame {
+  template<typename Observed>
+  bool operator()(const Observed &observed, KeyFrame *pKF) const { return less<KeyFrame *>()(observed.pKF, pKF); }
+};
+
+constexpr ByKeyFrame byKeyFrame{};
+
+// Median of the distances of each descriptor to all of them
+vector<int> medianDistances(const vector<DescriptorBlock> &vDescriptors) {
+  const size_t N = vDescriptors.size();
+
+  vector<int> vDistances(N * N);
+  for(size_t i = 0; i < N; i++) {
+    vDistances[i * N + i] = 0;
+    for(size_t j = i + 1; j < N; j++) {
+      const int distij = HammingDistance::Distance(vDescriptors[i].data(), vDescriptors[j].data());
+      vDistances[i * N + j] = distij;
+      vDistances[j * N + i] = distij;
+    }
+  }
+
+  vector<int> vMedians(N);
+  for(size_t i = 0; i < N; i++) {
+    auto first = vDistances.begin() + i * N;
+    nth_element(first, first + (N - 1) / 2, first + N);
+    vMedians[i] = first[(N - 1) / 2];
+  }
+
+  return vMedians;
+}
+
+}  // namespace
+
 long unsigned int MapPoint::nNextId = 0;
 mutex MapPoint::mGlobalMutex;
 
-MapPoint::MapPoint(const cv::Mat &Pos, KeyFrame *pRefKF, Map *pMap) :
+MapPoint::MapPoint(const Eigen::Vector3f &Pos, KeyFrame *pRefKF, Map *pMap) :
     mnFirstKFid(pRefKF->mnId), mnFirstFrame(pRefKF->mnFrameId), nObs(0), mnTrackReferenceForFrame(0), mnLastFrameSeen(0),
     mnBALocalForKF(0), mnFuseCandidateForKF(0), mnLoopPointForKF(0), mnCorrectedByKF(0), mnCorrectedReference(0),
-    mnBAGlobalForKF(0), mpRefKF(pRefKF), mnVisible(1), mnFound(1), mbBad(false), mpReplaced(nullptr),
-    mfMinDistance(0), mfMaxDistance(0), mpMap(pMap) {
-  Pos.copyTo(mWorldPos);
-  mNormalVector = cv::Mat::zeros(3, 1, CV_32F);
+    mnBAGlobalForKF(0), mpRefKF(pRefKF), mnVisible(1), mnFound(1), mbBad(false), mpReplaced(nullptr), mpMap(pMap) {
+  mPosition.Store({Pos, Eigen::Vector3f::Zero(), 0, 0});
 
   // MapPoints can be created from Tracking and Local Mapping. This mutex avoid conflicts with id.
   unique_lock<mutex> lock(mpMap->mMutexPointCreation);
   mnId = nNextId++;
 }
 
-MapPoint::MapPoint(const cv::Mat &Pos, Map *pMap, Frame *pFrame, const int &idxF) :
+MapPoint::MapPoint(const Eigen::Vector3f &Pos, Map *pMap, Frame *pFrame, const int &idxF) :
     mnFirstKFid(-1), mnFirstFrame(pFrame->mnId), nObs(0), mnTrackReferenceForFrame(0), mnLastFrameSeen(0), mnBALocalForKF(0),
     mnFuseCandidateForKF(0), mnLoopPointForKF(0), mnCorrectedByKF(0), mnCorrectedReference(0), mnBAGlobalForKF(0),
     mpRefKF(nullptr), mnVisible(1), mnFound(1), mbBad(false), mpReplaced(nullptr), mpMap(pMap) {
-  Pos.copyTo(mWorldPos);
-  cv::Mat Ow = pFrame->GetCameraCenter();
-  mNormalVector = mWorldPos - Ow;
-  mNormalVector = mNormalVector / cv::norm(mNormalVector);
+  PositionState position;
+  position.worldPos = Pos;
+  const Eigen::Vector3f PC = position.worldPos - pFrame->GetCameraCenter();
+  const float dist = PC.norm();
+  position.normal = PC / dist;
 
-  cv::Mat PC = Pos - Ow;
-  const float dist = cv::norm(PC);
   const int level = pFrame->mvKeysUn[idxF].octave;
   const float levelScaleFactor = pFrame->mvScaleFactors[level];
   const int nLevels = pFrame->mnScaleLevels;
 
-  mfMaxDistance = dist * levelScaleFactor;
-  mfMinDistance = mfMaxDistance / pFrame->mvScaleFactors[nLevels - 1];
+  position.maxDistance = dist * levelScaleFactor;
+  position.minDistance = position.maxDistance / pFrame->mvScaleFactors[nLevels - 1];
+  mPosition.Store(position);
 
-  pFrame->mDescriptors.row(idxF).copyTo(mDescriptor);
+  mDescriptor = pFrame->mDescriptors[idxF];
 
   // MapPoints can be created from Tracking and Local Mapping. This mutex avoid conflicts with id.
   unique_lock<mutex> lock(mpMap->mMutexPointCreation);
   mnId = nNextId++;
 }
 
-void MapPoint::SetWorldPos(const cv::Mat &Pos) {
+void MapPoint::SetWorldPos(const Eigen::Vector3f &Pos) {
   unique_lock<mutex> lock2(mGlobalMutex);
   unique_lock<mutex> lock(mMutexPos);
-  Pos.copyTo(mWorldPos);
+  PositionState position = mPosition.Load();
+  position.worldPos = Pos;
+  mPosition.Store(position);
 }
 
-cv::Mat MapPoint::GetWorldPos() {
-  unique_lock<mutex> lock(mMutexPos);
-  return mWorldPos.clone();
+MapPoint::PositionState MapPoint::GetPositionState() const {
+  return mPosition.Load();
 }
 
-cv::Mat MapPoint::GetNormal() {
-  unique_lock<mutex> lock(mMutexPos);
-  return mNormalVector.clone();
+Eigen::Vector3f MapPoint::GetWorldPos() const {
+  return GetPositionState().worldPos;
+}
+
+Eigen::Vector3f MapPoint::GetNormal() const {
+  return GetPositionState().normal;
 }
 
 KeyFrame *MapPoint::GetReferenceKeyFrame() {
@@ -91,9 +131,9 @@ KeyFrame *MapPoint::GetReferenceKeyFrame() {
 
 void MapPoint::AddObservation(KeyFrame *pKF, size_t idx) {
   unique_lock<mutex> lock(mMutexFeatures);
-  if(mObservations.count(pKF))
+  if(!mObservations.insert(pKF, idx))
     return;
-  mObservations[pKF] = idx;
+  AddObservedDescriptor(pKF, idx);
 
   if(pKF->mvuRight[idx] >= 0)
     nObs += 2;
@@ -105,14 +145,16 @@ void MapPoint::EraseObservation(KeyFrame *pKF) {
   bool bBad = false;
   {
     unique_lock<mutex> lock(mMutexFeatures);
-    if(mObservations.count(pKF)) {
-      int idx = mObservations[pKF];
+    const auto it = mObservations.find(pKF);
+    if(it != mObservations.end()) {
+      const size_t idx = it->second;
       if(pKF->mvuRight[idx] >= 0)
         nObs -= 2;
       else
         nObs--;
 
       mObservations.erase(pKF);
+      EraseObservedDescriptor(pKF);
 
       if(mpRefKF == pKF)
         mpRefKF = mObservations.begin()->first;
@@ -127,7 +169,7 @@ void MapPoint::EraseObservation(KeyFrame *pKF) {
     SetBadFlag();
 }
 
-map<KeyFrame *, size_t> MapPoint::GetObservations() {
+ObservationList MapPoint::GetObservations() {
   unique_lock<mutex> lock(mMutexFeatures);
   return mObservations;
 }
@@ -138,13 +180,14 @@ int MapPoint::Observations() {
 }
 
 void MapPoint::SetBadFlag() {
-  map<KeyFrame *, size_t> obs;
+  ObservationList obs;
   {
     unique_lock<mutex> lock1(mMutexFeatures);
     unique_lock<mutex> lock2(mMutexPos);
     mbBad = true;
     obs = mObservations;
     mObservations.clear();
+    mvObservedDescriptors.clear();
   }
   for(auto & ob : obs) {
     KeyFrame *pKF = ob.first;
@@ -165,12 +208,13 @@ void MapPoint::Replace(MapPoint *pMP) {
     return;
 
   int nvisible, nfound;
-  map<KeyFrame *, size_t> obs;
+  ObservationList obs;
   {
     unique_lock<mutex> lock1(mMutexFeatures);
     unique_lock<mutex> lock2(mMutexPos);
     obs = mObservations;
     mObservations.clear();
+    mvObservedDescriptors.clear();
     mbBad = true;
     nvisible = mnVisible;
     nfound = mnFound;
@@ -217,75 +261,146 @@ float MapPoint::GetFoundRatio() {
 }
 
 void MapPoint::ComputeDistinctiveDescriptors() {
-  // Retrieve all observed descriptors
-  vector<cv::Mat> vDescriptors;
-
-  map<KeyFrame *, size_t> observations;
+  // Retrieve all observed descriptors and their median distance to the rest
+  vector<KeyFrame *> vpKFs;
+  vector<DescriptorBlock> vDescriptors;
+  vector<int> vMedians;
 
   {
     unique_lock<mutex> lock1(mMutexFeatures);
     if(mbBad)
       return;
-    observations = mObservations;
-  }
-
-  if(observations.empty())
-    return;
-
-  vDescriptors.reserve(observations.size());
-
-  for(auto & observation : observations) {
-    KeyFrame *pKF = observation.first;
 
-    if(!pKF->isBad())
-      vDescriptors.push_back(pKF->mDescriptors.row(observation.second));
+    const size_t N = mvObservedDescriptors.size();
+    const bool bCached = N <= MAX_CACHED_OBSERVATIONS;
+    vpKFs.reserve(N);
+    vDescriptors.reserve(N);
+    vMedians.reserve(bCached ? N : 0);
+    for(const ObservedDescriptor &observed : mvObservedDescriptors) {
+      vpKFs.push_back(observed.pKF);
+      vDescriptors.push_back(observed.descriptor);
+      if(bCached)
+        vMedians.push_back(observed.vDistances[(N - 1) / 2]);
+    }
   }
 
   if(vDescriptors.empty())
     return;
 
-  // Compute distances between them
-  const size_t N = vDescriptors.size();
-
-  float Distances[N][N];
-  for(size_t i = 0; i < N; i++) {
-    Distances[i][i] = 0;
-    for(size_t j = i + 1; j < N; j++) {
-      int distij = ORBmatcher::DescriptorDistance(vDescriptors[i], vDescriptors[j]);
-      Distances[i][j] = distij;
-      Distances[j][i] = distij;
+  // Descriptors of bad keyframes are left out, the medians of the others are then computed again
+  if(any_of(vpKFs.begin(), vpKFs.end(), [](KeyFrame *pKF) { return pKF->isBad(); })) {
+    vector<DescriptorBlock> vGoodDescriptors;
+    for(size_t i = 0; i < vpKFs.size(); i++) {
+      if(!vpKFs[i]->isBad())
+        vGoodDescriptors.push_back(vDescriptors[i]);
     }
+
+    if(vGoodDescriptors.empty())
+      return;
+
+    vDescriptors.swap(vGoodDescriptors);
+    vMedians = medianDistances(vDescriptors);
+  } else if(vMedians.empty()) {
+    vMedians = medianDistances(vDescriptors);
   }
 
   // Take the descriptor with least median distance to the rest
   int BestMedian = INT_MAX;
   int BestIdx = 0;
-  for(size_t i = 0; i < N; i++) {
-    vector<int> vDists(Distances[i], Distances[i] + N);
-    sort(vDists.begin(), vDists.end());
-    int median = vDists[0.5 * (N - 1)];
-
-    if(median < BestMedian) {
-      BestMedian = median;
+  for(size_t i = 0; i < vDescriptors.size(); i++) {
+    if(vMedians[i] < BestMedian) {
+      BestMedian = vMedians[i];
       BestIdx = i;
     }
   }
 
   {
     unique_lock<mutex> lock(mMutexFeatures);
-    mDescriptor = vDescriptors[BestIdx].clone();
+    mDescriptor = vDescriptors[BestIdx];
   }
 }
 
-cv::Mat MapPoint::GetDescriptor() {
+void MapPoint::AddObservedDescriptor(KeyFrame *pKF, size_t idx) {
+  ObservedDescriptor observed{pKF, pKF->mDescriptors[idx], {}};
+  const auto pos = lower_bound(mvObservedDescriptors.begin(), mvObservedDescriptors.end(), pKF, byKeyFrame);
+
+  const size_t N = mvObservedDescriptors.size() + 1;
+  if(N > MAX_CACHED_OBSERVATIONS) {
+    // Crossing the limit releases the distances of the other observations
+    if(N == MAX_CACHED_OBSERVATIONS + 1) {
+      for(ObservedDescriptor &other : mvObservedDescriptors)
+        vector<uint16_t>().swap(other.vDistances);
+    }
+    mvObservedDescriptors.insert(pos, std::move(observed));
+    return;
+  }
+
+  observed.vDistances.reserve(N);
+  observed.vDistances.push_back(0);
+
+  for(ObservedDescriptor &other : mvObservedDescriptors) {
+    const auto dist = static_cast<uint16_t>(HammingDistance::Distance(observed.descriptor.data(), other.descriptor.data()));
+    other.vDistances.insert(upper_bound(other.vDistances.begin(), other.vDistances.end(), dist), dist);
+    observed.vDistances.push_back(dist);
+  }
+  sort(observed.vDistances.begin(), observed.vDistances.end());
+
+  mvObservedDescriptors.insert(pos, std::move(observed));
+}
+
+void MapPoint::EraseObservedDescriptor(KeyFrame *pKF) {
+  auto it = lower_bound(mvObservedDescriptors.begin(), mvObservedDescriptors.end(), pKF, byKeyFrame);
+  if(it == mvObservedDescriptors.end() || it->pKF != pKF)
+    return;
+
+  const DescriptorBlock descriptor = it->descriptor;
+  mvObservedDescriptors.erase(it);
+
+  const size_t N = mvObservedDescriptors.size();
+  if(N == MAX_CACHED_OBSERVATIONS) {
+    // Back under the limit, the distances are computed again
+    RebuildObservedDistances();
+    return;
+  }
+  if(N > MAX_CACHED_OBSERVATIONS)
+    return;
+
+  for(ObservedDescriptor &other : mvObservedDescriptors) {
+    const auto dist = static_cast<uint16_t>(HammingDistance::Distance(descriptor.data(), other.descriptor.data()));
+    other.vDistances.erase(lower_bound(other.vDistances.begin(), other.vDistances.end(), dist));
+  }
+}
+
+void MapPoint::RebuildObservedDistances() {
+  const size_t N = mvObservedDescriptors.size();
+  for(ObservedDescriptor &observed : mvObservedDescriptors) {
+    observed.vDistances.clear();
+    observed.vDistances.reserve(N);
+  }
+
+  for(size_t i = 0; i < N; i++) {
+    ObservedDescriptor &observed = mvObservedDescriptors[i];
+    observed.vDistances.push_back(0);
+    for(size_t j = i + 1; j < N; j++) {
+      ObservedDescriptor &other = mvObservedDescriptors[j];
+      const auto dist = static_cast<uint16_t>(HammingDistance::Distance(observed.descriptor.data(), other.descriptor.data()));
+      observed.vDistances.push_back(dist);
+      other.vDistances.push_back(dist);
+    }
+    sort(observed.vDistances.begin(), observed.vDistances.end());
+  }
+}
+
+DescriptorBlock MapPoint::GetDescriptor() {
   unique_lock<mutex> lock(mMutexFeatures);
-  return mDescriptor.clone();
+  return mDescriptor;
 }
 
 int MapPoint::GetIndexInKeyFrame(KeyFrame *pKF) {
   unique_lock<mutex> lock(mMutexFeatures);
-  if(mObservations.count(pKF))
-    return mObservations[pKF];
+  const auto it = mObservations.find(pKF);
+  if(it != mObservations.end())
+    return it->second;
   else
     return -1;
 }
@@ -296,9 +411,9 @@ bool MapPoint::IsInKeyFrame(KeyFrame *pKF) {
 }
 
 void MapPoint::UpdateNormalAndDepth() {
-  map<KeyFrame *, size_t> observations;
+  ObservationList observations;
   KeyFrame *pRefKF;
-  cv::Mat Pos;
+  Eigen::Vector3f Pos;
   {
     unique_lock<mutex> lock1(mMutexFeatures);
     unique_lock<mutex> lock2(mMutexPos);
@@ -306,52 +421,49 @@ void MapPoint::UpdateNormalAndDepth() {
       return;
     observations = mObservations;
     pRefKF = mpRefKF;
-    Pos = mWorldPos.clone();
+    Pos = mPosition.Load().worldPos;
   }
 
   if(observations.empty())
     return;
 
-  cv::Mat normal = cv::Mat::zeros(3, 1, CV_32F);
+  Eigen::Vector3f normal = Eigen::Vector3f::Zero();
   int n = 0;
   for(auto & observation : observations) {
     KeyFrame *pKF = observation.first;
-    cv::Mat Owi = pKF->GetCameraCenter();
-    cv::Mat normali = mWorldPos - Owi;
-    normal = normal + normali / cv::norm(normali);
+    const Eigen::Vector3f normali = Pos - pKF->GetPoseState().Ow;
+    normal += normali / normali.norm();
     n++;
   }
 
-  cv::Mat PC = Pos - pRefKF->GetCameraCenter();
-  const float dist = cv::norm(PC);
-  const int level = pRefKF->mvKeysUn[observations[pRefKF]].octave;
+  const Eigen::Vector3f PC = Pos - pRefKF->GetPoseState().Ow;
+  const float dist = PC.norm();
+  const auto refObservation = observations.find(pRefKF);
+  const size_t refIdx = refObservation != observations.end() ? refObservation->second : 0;
+  const int level = pRefKF->mvKeysUn[refIdx].octave;
   const float levelScaleFactor = pRefKF->mvScaleFactors[level];
   const int nLevels = pRefKF->mnScaleLevels;
 
   {
     unique_lock<mutex> lock3(mMutexPos);
-    mfMaxDistance = dist * levelScaleFactor;
-    mfMinDistance = mfMaxDistance / pRefKF->mvScaleFactors[nLevels - 1];
-    mNormalVector = normal / n;
+    PositionState position = mPosition.Load();
+    position.maxDistance = dist * levelScaleFactor;
+    position.minDistance = position.maxDistance / pRefKF->mvScaleFactors[nLevels - 1];
+    position.normal = normal / n;
+    mPosition.Store(position);
   }
 }
 
 float MapPoint::GetMinDistanceInvariance() {
-  unique_lock<mutex> lock(mMutexPos);
-  return 0.8f * mfMinDistance;
+  return 0.8f * GetPositionState().minDistance;
 }
 
 float MapPoint::GetMaxDistanceInvariance() {
-  unique_lock<mutex> lock(mMutexPos);
-  return 1.2f * mfMaxDistance;
+  return 1.2f * GetPositionState().maxDistance;
 }
 
 int MapPoint::PredictScale(const float &currentDist, KeyFrame *pKF) {
-  float ratio;
-  {
-    unique_lock<mutex> lock(mMutexPos);
-    ratio = mfMaxDistance / currentDist;
-  }
+  const float ratio = GetPositionState().maxDistance / currentDist;
 
   int nScale = ceil(log(ratio) / pKF->mfLogScaleFactor);
   if(nScale < 0)
@@ -363,11 +475,7 @@ int MapPoint::PredictScale(const float &currentDist, KeyFrame *pKF) {
 }
 
 int MapPoint::PredictScale(const float &currentDist, Frame *pF) {
-  float ratio;
-  {
-    unique_lock<mutex> lock(mMutexPos);
-    ratio = mfMaxDistance / currentDist;
-  }
+  const float ratio = GetPositionState().maxDistance / currentDist;
 
   int nScale = ceil(log(ratio) / pF->mfLogScaleFactor);
   if(nScale < 0)
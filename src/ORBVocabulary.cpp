@@ -0,0 +1,623 @@
+// Internal
+#include "ORBVocabulary.hpp"
+#include "HammingDistance.hpp"
+#include "ThreadPool.hpp"
+// POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace ORB_SLAM2 {
+
+namespace {
+
+constexpr size_t SECTION_ALIGNMENT = 64;
+
+// Largest branching factor accepted, bounds the distances of the children of a node
+constexpr uint32_t MAX_BRANCHING = 20;
+
+// Descriptors transformed per task of the thread pool
+constexpr size_t TRANSFORM_CHUNK = 64;
+
+// Bytes of a node in the DBoW2 binary format: parent, leaf flag, descriptor, weight
+constexpr size_t BIN_RECORD_BYTES = sizeof(uint32_t) + 1 + DescriptorBlock::BYTES + sizeof(double);
+
+size_t alignSection(size_t offset) {
+  return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+bool readFile(const std::string &filename, std::string &contents) {
+  std::ifstream f(filename, std::ios::binary);
+  if(!f.is_open())
+    return false;
+
+  f.seekg(0, std::ios::end);
+  contents.resize(static_cast<size_t>(f.tellg()));
+  f.seekg(0, std::ios::beg);
+  f.read(&contents[0], static_cast<std::streamsize>(contents.size()));
+  return !f.fail();
+}
+
+bool validParameters(uint32_t k, uint32_t L, uint32_t scoring, uint32_t weighting) {
+  return k >= 2 && k <= MAX_BRANCHING && L >= 1 && L <= 10 && scoring <= DBoW2::DOT_PRODUCT && weighting <= DBoW2::BINARY;
+}
+
+// Scorings that expect normalized vectors, and the norm (DBoW2 ScoringObject.h)
+bool mustNormalize(uint32_t scoring, DBoW2::LNorm &norm) {
+  norm = scoring == DBoW2::L2_NORM ? DBoW2::L2 : DBoW2::L1;
+  return scoring != DBoW2::DOT_PRODUCT;
+}
+
+// Structure of the node and word sections of a flat image, checked once so the descent never
+// leaves the image: a parent has at most MAX_BRANCHING children, inside the node section and
+// numbered after it (breadth first order), so every walk down the tree ends at a leaf. The
+// words and their nodes must point at each other.
+bool validTree(const ORBVocabulary::FlatHeader &header, const ORBVocabulary::FlatNode *pNodes, const uint32_t *pWordNodes) {
+  if(pNodes[0].childCount == 0)
+    return false;
+
+  for(uint32_t id = 0; id < header.nodes; id++) {
+    const ORBVocabulary::FlatNode &node = pNodes[id];
+    if(node.childCount > MAX_BRANCHING)
+      return false;
+    if(node.childCount > 0 && (node.firstChild <= id || uint64_t(node.firstChild) + node.childCount > header.nodes))
+      return false;
+    if(node.wordId != ORBVocabulary::NO_WORD && (node.wordId >= header.words || node.childCount > 0))
+      return false;
+  }
+
+  for(uint32_t w = 0; w < header.words; w++) {
+    if(pWordNodes[w] >= header.nodes || pNodes[pWordNodes[w]].wordId != w)
+      return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
+ORBVocabulary::~ORBVocabulary() { Release(); }
+
+bool ORBVocabulary::Load(const std::string &filename) {
+  char magic[sizeof(FlatHeader::MAGIC)] = {};
+  {
+    std::ifstream f(filename, std::ios::binary);
+    if(!f.is_open()) {
+      spdlog::error("Could not open vocabulary {}", filename);
+      return false;
+    }
+    f.read(magic, sizeof(magic));
+  }
+
+  if(std::memcmp(magic, FlatHeader::MAGIC, sizeof(magic)) == 0)
+    return LoadFromFlatFile(filename);
+
+  // The text format starts with "k L scoring weighting" in ASCII, the binary one with the
+  // same four values as 32 bit integers, which have zero bytes
+  if(std::memchr(magic, '\0', sizeof(magic)) != nullptr)
+    return LoadFromBinFile(filename);
+  return LoadFromTextFile(filename);
+}
+
+bool ORBVocabulary::LoadFromFlatFile(const std::string &filename, bool bVerifyPayload) {
+  Release();
+
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0) {
+    spdlog::error("Could not open vocabulary {}", filename);
+    return false;
+  }
+
+  struct stat st {};
+  if(::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FlatHeader)) {
+    ::close(fd);
+    spdlog::error("Vocabulary {} is not a flat vocabulary", filename);
+    return false;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  void *pMapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(pMapped == MAP_FAILED) {
+    spdlog::error("Could not map vocabulary {}", filename);
+    return false;
+  }
+
+  mpMapped = pMapped;
+  mMappedSize = size;
+
+  if(!Attach(static_cast<const uint8_t *>(pMapped), size, bVerifyPayload)) {
+    spdlog::error("Vocabulary {} is corrupted or of an unsupported version", filename);
+    Release();
+    return false;
+  }
+
+  return true;
+}
+
+bool ORBVocabulary::LoadFromTextFile(const std::string &filename) {
+  ParsedTree tree;
+  if(!ParseTextFile(filename, tree)) {
+    spdlog::error("Vocabulary loading failure: {} is not a correct text file", filename);
+    return false;
+  }
+  return Build(tree);
+}
+
+bool ORBVocabulary::LoadFromBinFile(const std::string &filename) {
+  ParsedTree tree;
+  if(!ParseBinFile(filename, tree)) {
+    spdlog::error("Vocabulary loading failure: {} is not a correct binary file", filename);
+    return false;
+  }
+  return Build(tree);
+}
+
+bool ORBVocabulary::SaveToFlatFile(const std::string &filename) const {
+  if(!mpHeader)
+    return false;
+
+  std::ofstream f(filename, std::ios::binary | std::ios::trunc);
+  if(!f.is_open())
+    return false;
+
+  f.write(reinterpret_cast<const char *>(mpHeader), static_cast<std::streamsize>(mpHeader->fileSize));
+  return !f.fail();
+}
+
+void ORBVocabulary::transform(const std::vector<cv::Mat> &features, BowVector &v, FeatureVector &fv, int levelsup) const {
+  v.clear();
+  fv.clear();
+
+  if(empty())
+    return;
+
+  thread_local std::vector<WordAssignment> vAssignments;
+  vAssignments.resize(features.size());
+  for(size_t i = 0; i < features.size(); i++) {
+    WordAssignment &assignment = vAssignments[i];
+    assignment.nid = 0;
+    TransformOne(features[i].ptr<uint8_t>(), assignment.wordId, assignment.weight, &assignment.nid, levelsup);
+  }
+
+  Accumulate(vAssignments.data(), vAssignments.size(), v, fv);
+}
+
+void ORBVocabulary::transform(const DescriptorArray &descriptors, BowVector &v, FeatureVector &fv, int levelsup,
+                              utilities::ThreadPool *pThreadPool) const {
+  v.clear();
+  fv.clear();
+
+  if(empty() || descriptors.empty())
+    return;
+
+  // Buffer of the calling thread, the workers write into it through pAssignments
+  const size_t n = descriptors.size();
+  thread_local std::vector<WordAssignment> vAssignments;
+  vAssignments.resize(n);
+  WordAssignment *pAssignments = vAssignments.data();
+  const auto transformRange = [&](size_t first, size_t last) {
+    for(size_t i = first; i < last; i++) {
+      WordAssignment &assignment = pAssignments[i];
+      assignment.nid = 0;
+      TransformOne(descriptors.row(i), assignment.wordId, assignment.weight, &assignment.nid, levelsup);
+    }
+  };
+
+  const size_t nChunks = (n + TRANSFORM_CHUNK - 1) / TRANSFORM_CHUNK;
+  if(pThreadPool && nChunks > 1) {
+    pThreadPool->parallelFor(nChunks, [&](size_t chunk) {
+      const size_t first = chunk * TRANSFORM_CHUNK;
+      transformRange(first, std::min(n, first + TRANSFORM_CHUNK));
+    });
+  } else {
+    transformRange(0, n);
+  }
+
+  Accumulate(pAssignments, n, v, fv);
+}
+
+void ORBVocabulary::Accumulate(const WordAssignment *pAssignments, size_t n, BowVector &v, FeatureVector &fv) const {
+  DBoW2::LNorm norm;
+  const bool bMustNormalize = mustNormalize(mpHeader->scoring, norm);
+  const auto weighting = static_cast<DBoW2::WeightingType>(mpHeader->weighting);
+  const bool bAccumulate = weighting == DBoW2::TF || weighting == DBoW2::TF_IDF;
+
+  // (word, feature) and (node, feature) keys of the weighted features, sorted
+  thread_local std::vector<uint64_t> vWordKeys;
+  thread_local std::vector<uint64_t> vNodeKeys;
+  vWordKeys.clear();
+  vNodeKeys.clear();
+  for(size_t i = 0; i < n; i++) {
+    // Stopped words have no weight
+    if(pAssignments[i].weight <= 0)
+      continue;
+    vWordKeys.push_back(uint64_t(pAssignments[i].wordId) << 32 | i);
+    vNodeKeys.push_back(uint64_t(pAssignments[i].nid) << 32 | i);
+  }
+  std::sort(vWordKeys.begin(), vWordKeys.end());
+  std::sort(vNodeKeys.begin(), vNodeKeys.end());
+
+  const auto keyId = [](uint64_t key) { return static_cast<uint32_t>(key >> 32); };
+  const auto keyFeature = [](uint64_t key) { return static_cast<uint32_t>(key); };
+
+  // Words, the features of a word are consecutive and in feature order
+  size_t nWords = 0;
+  for(size_t k = 0; k < vWordKeys.size(); k++)
+    nWords += k == 0 || keyId(vWordKeys[k]) != keyId(vWordKeys[k - 1]);
+  v.mvWords.resize(nWords);
+  v.mvValues.resize(nWords);
+
+  size_t w = 0;
+  for(size_t k = 0; k < vWordKeys.size(); w++) {
+    const uint32_t wordId = keyId(vWordKeys[k]);
+    // w is the idf value if TF_IDF, 1 if TF, idf if IDF, or 1 if BINARY. TF and TF_IDF add it
+    // once per feature, the others keep it once
+    double value = pAssignments[keyFeature(vWordKeys[k])].weight;
+    for(++k; k < vWordKeys.size() && keyId(vWordKeys[k]) == wordId; ++k) {
+      if(bAccumulate)
+        value += pAssignments[keyFeature(vWordKeys[k])].weight;
+    }
+    v.mvWords[w] = wordId;
+    v.mvValues[w] = value;
+  }
+
+  // Nodes
+  size_t nNodes = 0;
+  for(size_t k = 0; k < vNodeKeys.size(); k++)
+    nNodes += k == 0 || keyId(vNodeKeys[k]) != keyId(vNodeKeys[k - 1]);
+  fv.mvNodes.resize(nNodes);
+  fv.mvOffsets.resize(nNodes + 1);
+  fv.mvFeatures.resize(vNodeKeys.size());
+
+  size_t node = 0;
+  for(size_t k = 0; k < vNodeKeys.size(); k++) {
+    if(k == 0 || keyId(vNodeKeys[k]) != keyId(vNodeKeys[k - 1])) {
+      fv.mvNodes[node] = keyId(vNodeKeys[k]);
+      fv.mvOffsets[node++] = static_cast<uint32_t>(k);
+    }
+    fv.mvFeatures[k] = keyFeature(vNodeKeys[k]);
+  }
+  fv.mvOffsets[nNodes] = static_cast<uint32_t>(vNodeKeys.size());
+
+  if(bAccumulate && !v.empty() && !bMustNormalize) {
+    // unnecessary when normalizing
+    const double nd = static_cast<double>(v.size());
+    for(auto &value : v.mvValues)
+      value /= nd;
+  }
+
+  if(bMustNormalize)
+    v.Normalize(norm);
+}
+
+void ORBVocabulary::TransformOne(const uint8_t *descriptor, DBoW2::WordId &wordId, DBoW2::WordValue &weight, DBoW2::NodeId *nid, int levelsup) const {
+  // level at which the node must be stored in nid, if given
+  const int nidLevel = static_cast<int>(mpHeader->L) - levelsup;
+  if(nid && nidLevel <= 0)
+    *nid = 0;
+
+  // Propagate the descriptor down the tree. The children of a node are consecutive, their
+  // distances are computed in one batch and the first of equally close children wins.
+  int distances[MAX_BRANCHING];
+  uint32_t node = 0;
+  int level = 0;
+  do {
+    ++level;
+    const FlatNode &parent = mpNodes[node];
+    const uint32_t first = parent.firstChild;
+    const uint32_t count = parent.childCount;
+    HammingDistance::ComputeContiguous(descriptor, mpDescriptors + first, count, distances);
+
+    uint32_t best = 0;
+    for(uint32_t c = 1; c < count; c++) {
+      if(distances[c] < distances[best])
+        best = c;
+    }
+    node = first + best;
+
+    if(nid && level == nidLevel)
+      *nid = node;
+  } while(mpNodes[node].childCount > 0);
+
+  wordId = mpNodes[node].wordId;
+  weight = wordId != NO_WORD ? mpWordWeights[wordId] : 0.0;
+}
+
+bool ORBVocabulary::ParseTextFile(const std::string &filename, ParsedTree &tree) {
+  std::string contents;
+  if(!readFile(filename, contents))
+    return false;
+
+  const char *p = contents.c_str();
+  char *end = nullptr;
+
+  // Header line: k L scoring weighting
+  uint32_t header[4];
+  for(uint32_t &value : header) {
+    const long parsed = std::strtol(p, &end, 10);
+    if(end == p || parsed < 0)
+      return false;
+    value = static_cast<uint32_t>(parsed);
+    p = end;
+  }
+  tree.k = header[0];
+  tree.L = header[1];
+  tree.scoring = header[2];
+  tree.weighting = header[3];
+
+  if(!validParameters(tree.k, tree.L, tree.scoring, tree.weighting))
+    return false;
+
+  tree.vParents.assign(1, 0);
+  tree.vbLeaf.assign(1, 0);
+  tree.vDescriptors.assign(1, DescriptorBlock{});
+  tree.vWeights.assign(1, 0.0);
+
+  // One node per line: parent, leaf flag, descriptor bytes and weight. Blank trailing lines are skipped.
+  while(true) {
+    const long parent = std::strtol(p, &end, 10);
+    if(end == p)
+      break;
+    p = end;
+
+    const long bLeaf = std::strtol(p, &end, 10);
+    if(end == p || parent < 0 || static_cast<size_t>(parent) >= tree.vParents.size())
+      return false;
+    p = end;
+
+    DescriptorBlock descriptor;
+    for(uint8_t &byte : descriptor.bytes) {
+      const long value = std::strtol(p, &end, 10);
+      if(end == p || value < 0 || value > 255)
+        return false;
+      byte = static_cast<uint8_t>(value);
+      p = end;
+    }
+
+    const double weight = std::strtod(p, &end);
+    if(end == p)
+      return false;
+    p = end;
+
+    tree.vParents.push_back(static_cast<uint32_t>(parent));
+    tree.vbLeaf.push_back(bLeaf > 0 ? 1 : 0);
+    tree.vDescriptors.push_back(descriptor);
+    tree.vWeights.push_back(weight);
+  }
+
+  // Nothing but white space may follow the last node
+  while(*p != '\0' && std::isspace(static_cast<unsigned char>(*p)))
+    ++p;
+  return *p == '\0' && tree.vParents.size() > 1;
+}
+
+bool ORBVocabulary::ParseBinFile(const std::string &filename, ParsedTree &tree) {
+  std::string contents;
+  if(!readFile(filename, contents) || contents.size() < 4 * sizeof(int32_t))
+    return false;
+
+  const char *p = contents.data();
+  int32_t header[4];
+  std::memcpy(header, p, sizeof(header));
+  p += sizeof(header);
+
+  if(header[0] < 0 || header[1] < 0 || header[2] < 0 || header[3] < 0)
+    return false;
+  tree.k = static_cast<uint32_t>(header[0]);
+  tree.L = static_cast<uint32_t>(header[1]);
+  tree.scoring = static_cast<uint32_t>(header[2]);
+  tree.weighting = static_cast<uint32_t>(header[3]);
+
+  if(!validParameters(tree.k, tree.L, tree.scoring, tree.weighting))
+    return false;
+
+  const size_t nRecords = (contents.size() - sizeof(header)) / BIN_RECORD_BYTES;
+  tree.vParents.assign(1, 0);
+  tree.vbLeaf.assign(1, 0);
+  tree.vDescriptors.assign(1, DescriptorBlock{});
+  tree.vWeights.assign(1, 0.0);
+  tree.vParents.reserve(nRecords + 1);
+  tree.vbLeaf.reserve(nRecords + 1);
+  tree.vDescriptors.reserve(nRecords + 1);
+  tree.vWeights.reserve(nRecords + 1);
+
+  // Only complete records, the writer of the old format could leave a partial one
+  for(size_t i = 0; i < nRecords; i++) {
+    uint32_t parent;
+    std::memcpy(&parent, p, sizeof(parent));
+    p += sizeof(parent);
+    if(parent >= tree.vParents.size())
+      return false;
+
+    const uint8_t bLeaf = static_cast<uint8_t>(*p);
+    p += 1;
+
+    DescriptorBlock descriptor;
+    std::memcpy(descriptor.bytes, p, DescriptorBlock::BYTES);
+    p += DescriptorBlock::BYTES;
+
+    double weight;
+    std::memcpy(&weight, p, sizeof(weight));
+    p += sizeof(weight);
+
+    tree.vParents.push_back(parent);
+    tree.vbLeaf.push_back(bLeaf > 0 ? 1 : 0);
+    tree.vDescriptors.push_back(descriptor);
+    tree.vWeights.push_back(weight);
+  }
+
+  return tree.vParents.size() > 1;
+}
+
+bool ORBVocabulary::Build(const ParsedTree &tree) {
+  Release();
+
+  const size_t nNodes = tree.vParents.size();
+
+  // Children of each node in file order (CSR), the order decides ties in TransformOne
+  std::vector<uint32_t> vChildStart(nNodes + 1, 0);
+  for(size_t i = 1; i < nNodes; i++)
+    vChildStart[tree.vParents[i] + 1]++;
+  for(size_t i = 0; i < nNodes; i++) {
+    // The children of a node are compared in one batch of at most MAX_BRANCHING
+    if(vChildStart[i + 1] > MAX_BRANCHING)
+      return false;
+    vChildStart[i + 1] += vChildStart[i];
+  }
+  std::vector<uint32_t> vChildren(nNodes - 1);
+  {
+    std::vector<uint32_t> vFill(vChildStart.begin(), vChildStart.end() - 1);
+    for(size_t i = 1; i < nNodes; i++)
+      vChildren[vFill[tree.vParents[i]]++] = static_cast<uint32_t>(i);
+  }
+
+  // Breadth first numbering: vOrder[new id] = file id
+  std::vector<uint32_t> vOrder;
+  std::vector<uint32_t> vNewId(nNodes, 0);
+  vOrder.reserve(nNodes);
+  vOrder.push_back(0);
+  for(size_t head = 0; head < vOrder.size(); head++) {
+    const uint32_t fileId = vOrder[head];
+    for(uint32_t c = vChildStart[fileId]; c < vChildStart[fileId + 1]; c++) {
+      vNewId[vChildren[c]] = static_cast<uint32_t>(vOrder.size());
+      vOrder.push_back(vChildren[c]);
+    }
+  }
+
+  // Words keep the ids of the DBoW2 loader: leaves numbered in file order
+  std::vector<uint32_t> vWordOfNode(nNodes, NO_WORD);
+  uint32_t nWords = 0;
+  for(size_t i = 1; i < nNodes; i++) {
+    if(tree.vbLeaf[i])
+      vWordOfNode[i] = nWords++;
+  }
+
+  if(nWords == 0)
+    return false;
+
+  // Layout of the image
+  FlatHeader header{};
+  std::memcpy(header.magic, FlatHeader::MAGIC, sizeof(header.magic));
+  header.version = FlatHeader::VERSION;
+  header.k = tree.k;
+  header.L = tree.L;
+  header.scoring = tree.scoring;
+  header.weighting = tree.weighting;
+  header.nodes = static_cast<uint32_t>(nNodes);
+  header.words = nWords;
+  header.nodesOffset = alignSection(sizeof(FlatHeader));
+  header.descriptorsOffset = alignSection(header.nodesOffset + nNodes * sizeof(FlatNode));
+  header.wordNodesOffset = alignSection(header.descriptorsOffset + nNodes * sizeof(DescriptorBlock));
+  header.wordWeightsOffset = alignSection(header.wordNodesOffset + nWords * sizeof(uint32_t));
+  header.fileSize = alignSection(header.wordWeightsOffset + nWords * sizeof(double));
+
+  mvOwned.assign(header.fileSize / sizeof(ImageBlock), ImageBlock{});
+  uint8_t *pImage = mvOwned.front().bytes;
+
+  auto *pNodes = reinterpret_cast<FlatNode *>(pImage + header.nodesOffset);
+  auto *pDescriptors = reinterpret_cast<DescriptorBlock *>(pImage + header.descriptorsOffset);
+  auto *pWordNodes = reinterpret_cast<uint32_t *>(pImage + header.wordNodesOffset);
+  auto *pWordWeights = reinterpret_cast<double *>(pImage + header.wordWeightsOffset);
+
+  for(uint32_t id = 0; id < nNodes; id++) {
+    const uint32_t fileId = vOrder[id];
+    const uint32_t nChildren = vChildStart[fileId + 1] - vChildStart[fileId];
+
+    FlatNode &node = pNodes[id];
+    node.firstChild = nChildren > 0 ? vNewId[vChildren[vChildStart[fileId]]] : 0;
+    node.childCount = nChildren;
+    node.parent = vNewId[tree.vParents[fileId]];
+    node.wordId = vWordOfNode[fileId];
+    pDescriptors[id] = tree.vDescriptors[fileId];
+
+    if(node.wordId != NO_WORD) {
+      pWordNodes[node.wordId] = id;
+      pWordWeights[node.wordId] = tree.vWeights[fileId];
+    }
+  }
+
+  header.payloadChecksum = Checksum(pImage + sizeof(FlatHeader), header.fileSize - sizeof(FlatHeader));
+  header.headerChecksum = Checksum(reinterpret_cast<const uint8_t *>(&header), sizeof(FlatHeader));
+  std::memcpy(pImage, &header, sizeof(FlatHeader));
+
+  return Attach(pImage, header.fileSize, false);
+}
+
+bool ORBVocabulary::Attach(const uint8_t *pImage, size_t size, bool bVerifyPayload) {
+  FlatHeader header;
+  std::memcpy(&header, pImage, sizeof(FlatHeader));
+
+  if(std::memcmp(header.magic, FlatHeader::MAGIC, sizeof(header.magic)) != 0 || header.version != FlatHeader::VERSION)
+    return false;
+
+  const uint64_t headerChecksum = header.headerChecksum;
+  header.headerChecksum = 0;
+  if(Checksum(reinterpret_cast<const uint8_t *>(&header), sizeof(FlatHeader)) != headerChecksum)
+    return false;
+
+  if(header.fileSize != size || !validParameters(header.k, header.L, header.scoring, header.weighting) ||
+     header.nodes == 0 || header.words == 0 || header.words > header.nodes)
+    return false;
+
+  // Every section must be aligned and inside the image
+  const auto sectionFits = [&](uint64_t offset, uint64_t bytes) {
+    return offset % SECTION_ALIGNMENT == 0 && offset >= sizeof(FlatHeader) && offset <= size && bytes <= size - offset;
+  };
+  if(!sectionFits(header.nodesOffset, uint64_t(header.nodes) * sizeof(FlatNode)) ||
+     !sectionFits(header.descriptorsOffset, uint64_t(header.nodes) * sizeof(DescriptorBlock)) ||
+     !sectionFits(header.wordNodesOffset, uint64_t(header.words) * sizeof(uint32_t)) ||
+     !sectionFits(header.wordWeightsOffset, uint64_t(header.words) * sizeof(double)))
+    return false;
+
+  if(bVerifyPayload && Checksum(pImage + sizeof(FlatHeader), size - sizeof(FlatHeader)) != header.payloadChecksum)
+    return false;
+
+  if(!validTree(header, reinterpret_cast<const FlatNode *>(pImage + header.nodesOffset),
+                reinterpret_cast<const uint32_t *>(pImage + header.wordNodesOffset)))
+    return false;
+
+  mpHeader = reinterpret_cast<const FlatHeader *>(pImage);
+  mpNodes = reinterpret_cast<const FlatNode *>(pImage + header.nodesOffset);
+  mpDescriptors = reinterpret_cast<const DescriptorBlock *>(pImage + header.descriptorsOffset);
+  mpWordNodes = reinterpret_cast<const uint32_t *>(pImage + header.wordNodesOffset);
+  mpWordWeights = reinterpret_cast<const double *>(pImage + header.wordWeightsOffset);
+
+  return true;
+}
+
+void ORBVocabulary::Release() {
+  mpHeader = nullptr;
+  mpNodes = nullptr;
+  mpDescriptors = nullptr;
+  mpWordNodes = nullptr;
+  mpWordWeights = nullptr;
+
+  mvOwned.clear();
+  mvOwned.shrink_to_fit();
+  if(mpMapped) {
+    ::munmap(mpMapped, mMappedSize);
+    mpMapped = nullptr;
+    mMappedSize = 0;
+  }
+}
+
+uint64_t ORBVocabulary::Checksum(const uint8_t *data, size_t size) {
+  // FNV-1a over 64 bit words, then over the remaining bytes
+  constexpr uint64_t PRIME = 0x100000001b3ULL;
+  uint64_t hash = 0xcbf29ce484222325ULL;
+
+  size_t i = 0;
+  for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    hash = (hash ^ word) * PRIME;
+  }
+  for(; i < size; i++)
+    hash = (hash ^ data[i]) * PRIME;
+
+  return hash;
+}
+
+}  // namespace ORB_SLAM2
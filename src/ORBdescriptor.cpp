@@ -0,0 +1,415 @@
+// Internal
+#include "ORBdescriptor.hpp"
+// SIMD
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define ORB_SLAM2_X86_KERNELS
+#  include <immintrin.h>
+#endif
+
+namespace ORB_SLAM2 {
+
+namespace {
+
+const float factorPI = static_cast<float>(CV_PI / 180.f);
+
+const int HALF_PATCH_SIZE = 15;
+
+// Rotation of a pattern point by the keypoint angle, u = x * a - y * b and v = x * b + y * a.
+// Builds with FMA (-march=native on any recent x86) used to contract the first product of
+// the original GET_VALUE into an FMA, so do the same explicitly: the rounding of u, v decides
+// which pixel is sampled. This file is built with -ffp-contract=off so that only these
+// helpers decide how the rotation is rounded.
+inline float rotateU(float x, float y, float a, float b) {
+#ifdef __FMA__
+  return std::fma(x, a, -(y * b));
+#else
+  return x * a - y * b;
+#endif
+}
+
+inline float rotateV(float x, float y, float a, float b) {
+#ifdef __FMA__
+  return std::fma(x, b, y * a);
+#else
+  return x * b + y * a;
+#endif
+}
+
+struct PatternView {
+  const float *x0;
+  const float *y0;
+  const float *x1;
+  const float *y1;
+  const cv::Point *points;
+};
+
+// Reference implementation, one sample at a time.
+void computeDescriptorsScalar(const cv::Mat &img, const std::vector<cv::KeyPoint> &keypoints, const PatternView &p, cv::Mat &descriptors) {
+  const int step = static_cast<int>(img.step);
+
+  for(size_t i = 0; i < keypoints.size(); ++i) {
+    const cv::KeyPoint &kpt = keypoints[i];
+    const float angle = kpt.angle * factorPI;
+    const float a = std::cos(angle), b = std::sin(angle);
+
+    const uchar *center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
+    const cv::Point *pattern = p.points;
+    uchar *desc = descriptors.ptr(static_cast<int>(i));
+
+#define GET_VALUE(idx)                                                                                                           \
+  center[cvRound(rotateV(static_cast<float>(pattern[idx].x), static_cast<float>(pattern[idx].y), a, b)) * step +                 \
+         cvRound(rotateU(static_cast<float>(pattern[idx].x), static_cast<float>(pattern[idx].y), a, b))]
+
+    for(int j = 0; j < 32; ++j, pattern += 16) {
+      int val = 0;
+      for(int k = 0; k < 8; ++k) {
+        const int t0 = GET_VALUE(2 * k);
+        const int t1 = GET_VALUE(2 * k + 1);
+        val |= (t0 < t1) << k;
+      }
+      desc[j] = static_cast<uchar>(val);
+    }
+
+#undef GET_VALUE
+  }
+}
+
+// Reference implementation of the intensity centroid orientation (IC_Angle).
+void computeOrientationsScalar(const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints, const std::vector<int> &umax) {
+  const int step = static_cast<int>(image.step1());
+
+  for(auto &keypoint : keypoints) {
+    int m_01 = 0, m_10 = 0;
+
+    const uchar *center = &image.at<uchar>(cvRound(keypoint.pt.y), cvRound(keypoint.pt.x));
+
+    // Treat the center line differently, v=0
+    for(int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
+      m_10 += u * center[u];
+
+    // Go line by line in the circular patch
+    for(int v = 1; v <= HALF_PATCH_SIZE; ++v) {
+      // Proceed over the two lines
+      int v_sum = 0;
+      const int d = umax[v];
+      for(int u = -d; u <= d; ++u) {
+        const int val_plus = center[u + v * step], val_minus = center[u - v * step];
+        v_sum += (val_plus - val_minus);
+        m_10 += u * (val_plus + val_minus);
+      }
+      m_01 += v * v_sum;
+    }
+
+    keypoint.angle = cv::fastAtan2(static_cast<float>(m_01), static_cast<float>(m_10));
+  }
+}
+
+#ifdef ORB_SLAM2_X86_KERNELS
+
+__attribute__((target("sse2"))) inline __m128 rotateU(__m128 x, __m128 y, __m128 a, __m128 b) {
+#  ifdef __FMA__
+  return _mm_fmsub_ps(x, a, _mm_mul_ps(y, b));
+#  else
+  return _mm_sub_ps(_mm_mul_ps(x, a), _mm_mul_ps(y, b));
+#  endif
+}
+
+__attribute__((target("sse2"))) inline __m128 rotateV(__m128 x, __m128 y, __m128 a, __m128 b) {
+#  ifdef __FMA__
+  return _mm_fmadd_ps(x, b, _mm_mul_ps(y, a));
+#  else
+  return _mm_add_ps(_mm_mul_ps(x, b), _mm_mul_ps(y, a));
+#  endif
+}
+
+__attribute__((target("avx2"))) inline __m256 rotateU(__m256 x, __m256 y, __m256 a, __m256 b) {
+#  ifdef __FMA__
+  return _mm256_fmsub_ps(x, a, _mm256_mul_ps(y, b));
+#  else
+  return _mm256_sub_ps(_mm256_mul_ps(x, a), _mm256_mul_ps(y, b));
+#  endif
+}
+
+__attribute__((target("avx2"))) inline __m256 rotateV(__m256 x, __m256 y, __m256 a, __m256 b) {
+#  ifdef __FMA__
+  return _mm256_fmadd_ps(x, b, _mm256_mul_ps(y, a));
+#  else
+  return _mm256_add_ps(_mm256_mul_ps(x, b), _mm256_mul_ps(y, a));
+#  endif
+}
+
+// Rotated offsets are computed 4 tests at a time, the lookups stay scalar.
+// _mm_cvtps_epi32 rounds to nearest even, exactly like cvRound.
+__attribute__((target("sse2"))) void computeDescriptorsSSE2(const cv::Mat &img,
+                                                             const std::vector<cv::KeyPoint> &keypoints,
+                                                             const PatternView &p,
+                                                             cv::Mat &descriptors) {
+  const int step = static_cast<int>(img.step);
+
+  alignas(16) int u0[ORBdescriptor::NUM_TESTS];
+  alignas(16) int v0[ORBdescriptor::NUM_TESTS];
+  alignas(16) int u1[ORBdescriptor::NUM_TESTS];
+  alignas(16) int v1[ORBdescriptor::NUM_TESTS];
+
+  for(size_t i = 0; i < keypoints.size(); ++i) {
+    const cv::KeyPoint &kpt = keypoints[i];
+    const float angle = kpt.angle * factorPI;
+    const __m128 a = _mm_set1_ps(std::cos(angle));
+    const __m128 b = _mm_set1_ps(std::sin(angle));
+
+    for(int n = 0; n < ORBdescriptor::NUM_TESTS; n += 4) {
+      const __m128 x0 = _mm_load_ps(p.x0 + n), y0 = _mm_load_ps(p.y0 + n);
+      const __m128 x1 = _mm_load_ps(p.x1 + n), y1 = _mm_load_ps(p.y1 + n);
+      _mm_store_si128(reinterpret_cast<__m128i *>(u0 + n), _mm_cvtps_epi32(rotateU(x0, y0, a, b)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(v0 + n), _mm_cvtps_epi32(rotateV(x0, y0, a, b)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(u1 + n), _mm_cvtps_epi32(rotateU(x1, y1, a, b)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(v1 + n), _mm_cvtps_epi32(rotateV(x1, y1, a, b)));
+    }
+
+    const uchar *center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
+    uchar *desc = descriptors.ptr(static_cast<int>(i));
+
+    for(int j = 0, n = 0; j < 32; ++j) {
+      int val = 0;
+      for(int k = 0; k < 8; ++k, ++n) {
+        const int t0 = center[v0[n] * step + u0[n]];
+        const int t1 = center[v1[n] * step + u1[n]];
+        val |= (t0 < t1) << k;
+      }
+      desc[j] = static_cast<uchar>(val);
+    }
+  }
+}
+
+// One descriptor byte per iteration: 8 rotated offsets per point of the test
+// pair, two 32 bit gathers and a compare whose sign mask is the byte itself.
+// Gathers read 4 bytes from each sample, this stays inside the image because
+// keypoints are at least EDGE_THRESHOLD - 3 pixels away from the border, which
+// leaves a row below the lowest sample of the rotated patch.
+__attribute__((target("avx2"))) void computeDescriptorsAVX2(const cv::Mat &img,
+                                                             const std::vector<cv::KeyPoint> &keypoints,
+                                                             const PatternView &p,
+                                                             cv::Mat &descriptors) {
+  const __m256i step = _mm256_set1_epi32(static_cast<int>(img.step));
+  const __m256i lowByte = _mm256_set1_epi32(0xFF);
+
+  for(size_t i = 0; i < keypoints.size(); ++i) {
+    const cv::KeyPoint &kpt = keypoints[i];
+    const float angle = kpt.angle * factorPI;
+    const __m256 a = _mm256_set1_ps(std::cos(angle));
+    const __m256 b = _mm256_set1_ps(std::sin(angle));
+
+    const auto *center = reinterpret_cast<const int *>(&img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x)));
+    uchar *desc = descriptors.ptr(static_cast<int>(i));
+
+    for(int j = 0; j < 32; ++j) {
+      const int n = 8 * j;
+      const __m256 x0 = _mm256_load_ps(p.x0 + n), y0 = _mm256_load_ps(p.y0 + n);
+      const __m256 x1 = _mm256_load_ps(p.x1 + n), y1 = _mm256_load_ps(p.y1 + n);
+
+      const __m256i u0 = _mm256_cvtps_epi32(rotateU(x0, y0, a, b));
+      const __m256i v0 = _mm256_cvtps_epi32(rotateV(x0, y0, a, b));
+      const __m256i u1 = _mm256_cvtps_epi32(rotateU(x1, y1, a, b));
+      const __m256i v1 = _mm256_cvtps_epi32(rotateV(x1, y1, a, b));
+
+      const __m256i off0 = _mm256_add_epi32(_mm256_mullo_epi32(v0, step), u0);
+      const __m256i off1 = _mm256_add_epi32(_mm256_mullo_epi32(v1, step), u1);
+
+      const __m256i t0 = _mm256_and_si256(_mm256_i32gather_epi32(center, off0, 1), lowByte);
+      const __m256i t1 = _mm256_and_si256(_mm256_i32gather_epi32(center, off1, 1), lowByte);
+
+      desc[j] = static_cast<uchar>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(t1, t0))));
+    }
+  }
+}
+
+// Orientation weights of the 31x31 circular patch. Column c of a row is u = c - HALF_PATCH_SIZE,
+// columns outside the patch (|u| > umax[v], and the padding column u = 16) weigh zero.
+// Row v of weightV is v inside the patch so that m_01 is a plain dot product.
+struct OrientationWeights {
+  explicit OrientationWeights(const std::vector<int> &umax) {
+    for(int v = 0; v <= HALF_PATCH_SIZE; ++v) {
+      const int d = v == 0 ? HALF_PATCH_SIZE : umax[v];
+      for(int c = 0; c < 2 * (HALF_PATCH_SIZE + 1); ++c) {
+        const int u = c - HALF_PATCH_SIZE;
+        const bool inside = u >= -d && u <= d;
+        weightU[v][c] = static_cast<int16_t>(inside ? u : 0);
+        weightV[v][c] = static_cast<int16_t>(inside ? v : 0);
+      }
+    }
+  }
+
+  alignas(32) int16_t weightU[HALF_PATCH_SIZE + 1][2 * (HALF_PATCH_SIZE + 1)];
+  alignas(32) int16_t weightV[HALF_PATCH_SIZE + 1][2 * (HALF_PATCH_SIZE + 1)];
+};
+
+__attribute__((target("sse2"))) int horizontalSum(__m128i v) {
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+// Widen the 32 pixels u = -15..16 of a patch row to four vectors of 8 x 16 bit.
+__attribute__((target("sse2"))) void loadRowSSE2(const uchar *row, __m128i out[4]) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row - HALF_PATCH_SIZE));
+  const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row - HALF_PATCH_SIZE + 16));
+  out[0] = _mm_unpacklo_epi8(lo, zero);
+  out[1] = _mm_unpackhi_epi8(lo, zero);
+  out[2] = _mm_unpacklo_epi8(hi, zero);
+  out[3] = _mm_unpackhi_epi8(hi, zero);
+}
+
+// Each patch row is 32 bytes wide (u = -15..16), widened to 4x8 16 bit lanes.
+// m_10 and m_01 are accumulated with multiply-add against the weight tables,
+// all arithmetic is integer so the result is exactly that of IC_Angle.
+__attribute__((target("sse2"))) void computeOrientationsSSE2(const cv::Mat &image,
+                                                             std::vector<cv::KeyPoint> &keypoints,
+                                                             const std::vector<int> &umax) {
+  const OrientationWeights w(umax);
+  const int step = static_cast<int>(image.step1());
+
+  for(auto &keypoint : keypoints) {
+    const uchar *center = &image.at<uchar>(cvRound(keypoint.pt.y), cvRound(keypoint.pt.x));
+
+    __m128i m10 = _mm_setzero_si128(), m01 = _mm_setzero_si128();
+
+    // Treat the center line differently, v=0
+    __m128i c[4];
+    loadRowSSE2(center, c);
+    for(int k = 0; k < 4; ++k) {
+      const __m128i wu = _mm_load_si128(reinterpret_cast<const __m128i *>(w.weightU[0] + 8 * k));
+      m10 = _mm_add_epi32(m10, _mm_madd_epi16(c[k], wu));
+    }
+
+    for(int v = 1; v <= HALF_PATCH_SIZE; ++v) {
+      __m128i plus[4], minus[4];
+      loadRowSSE2(center + v * step, plus);
+      loadRowSSE2(center - v * step, minus);
+
+      for(int k = 0; k < 4; ++k) {
+        const __m128i wu = _mm_load_si128(reinterpret_cast<const __m128i *>(w.weightU[v] + 8 * k));
+        const __m128i wv = _mm_load_si128(reinterpret_cast<const __m128i *>(w.weightV[v] + 8 * k));
+        m10 = _mm_add_epi32(m10, _mm_madd_epi16(_mm_add_epi16(plus[k], minus[k]), wu));
+        m01 = _mm_add_epi32(m01, _mm_madd_epi16(_mm_sub_epi16(plus[k], minus[k]), wv));
+      }
+    }
+
+    keypoint.angle = cv::fastAtan2(static_cast<float>(horizontalSum(m01)), static_cast<float>(horizontalSum(m10)));
+  }
+}
+
+// Widen the 32 pixels u = -15..16 of a patch row to two vectors of 16 x 16 bit.
+__attribute__((target("avx2"))) void loadRowAVX2(const uchar *row, __m256i out[2]) {
+  out[0] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row - HALF_PATCH_SIZE)));
+  out[1] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row - HALF_PATCH_SIZE + 16)));
+}
+
+// Same as the SSE2 kernel with a patch row in two vectors of 16 x 16 bit.
+__attribute__((target("avx2"))) void computeOrientationsAVX2(const cv::Mat &image,
+                                                             std::vector<cv::KeyPoint> &keypoints,
+                                                             const std::vector<int> &umax) {
+  const OrientationWeights w(umax);
+  const int step = static_cast<int>(image.step1());
+
+  for(auto &keypoint : keypoints) {
+    const uchar *center = &image.at<uchar>(cvRound(keypoint.pt.y), cvRound(keypoint.pt.x));
+
+    __m256i m10 = _mm256_setzero_si256(), m01 = _mm256_setzero_si256();
+
+    // Treat the center line differently, v=0
+    __m256i c[2];
+    loadRowAVX2(center, c);
+    for(int k = 0; k < 2; ++k) {
+      const __m256i wu = _mm256_load_si256(reinterpret_cast<const __m256i *>(w.weightU[0] + 16 * k));
+      m10 = _mm256_add_epi32(m10, _mm256_madd_epi16(c[k], wu));
+    }
+
+    for(int v = 1; v <= HALF_PATCH_SIZE; ++v) {
+      __m256i plus[2], minus[2];
+      loadRowAVX2(center + v * step, plus);
+      loadRowAVX2(center - v * step, minus);
+
+      for(int k = 0; k < 2; ++k) {
+        const __m256i wu = _mm256_load_si256(reinterpret_cast<const __m256i *>(w.weightU[v] + 16 * k));
+        const __m256i wv = _mm256_load_si256(reinterpret_cast<const __m256i *>(w.weightV[v] + 16 * k));
+        m10 = _mm256_add_epi32(m10, _mm256_madd_epi16(_mm256_add_epi16(plus[k], minus[k]), wu));
+        m01 = _mm256_add_epi32(m01, _mm256_madd_epi16(_mm256_sub_epi16(plus[k], minus[k]), wv));
+      }
+    }
+
+    const int sum10 = horizontalSum(_mm_add_epi32(_mm256_castsi256_si128(m10), _mm256_extracti128_si256(m10, 1)));
+    const int sum01 = horizontalSum(_mm_add_epi32(_mm256_castsi256_si128(m01), _mm256_extracti128_si256(m01, 1)));
+    keypoint.angle = cv::fastAtan2(static_cast<float>(sum01), static_cast<float>(sum10));
+  }
+}
+
+#endif  // ORB_SLAM2_X86_KERNELS
+
+enum class Isa { SCALAR, SSE2, AVX2 };
+
+Isa detectIsa() {
+#ifdef ORB_SLAM2_X86_KERNELS
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2")) {
+    return Isa::AVX2;
+  }
+  if(__builtin_cpu_supports("sse2")) {
+    return Isa::SSE2;
+  }
+#endif
+  return Isa::SCALAR;
+}
+
+Isa isa() {
+  static const Isa detected = detectIsa();
+  return detected;
+}
+
+}  // namespace
+
+ORBdescriptor::ORBdescriptor(const cv::Point *pattern) : mPattern(pattern, pattern + 2 * NUM_TESTS) {
+  for(int n = 0; n < NUM_TESTS; ++n) {
+    mX0[n] = static_cast<float>(pattern[2 * n].x);
+    mY0[n] = static_cast<float>(pattern[2 * n].y);
+    mX1[n] = static_cast<float>(pattern[2 * n + 1].x);
+    mY1[n] = static_cast<float>(pattern[2 * n + 1].y);
+  }
+}
+
+void ORBdescriptor::Compute(const cv::Mat &image, const std::vector<cv::KeyPoint> &keypoints, cv::Mat &descriptors) const {
+  assert(image.type() == CV_8UC1);
+  assert(descriptors.rows == static_cast<int>(keypoints.size()) && descriptors.cols == 32);
+
+  const PatternView view{mX0, mY0, mX1, mY1, mPattern.data()};
+  switch(isa()) {
+#ifdef ORB_SLAM2_X86_KERNELS
+  case Isa::AVX2: computeDescriptorsAVX2(image, keypoints, view, descriptors); break;
+  case Isa::SSE2: computeDescriptorsSSE2(image, keypoints, view, descriptors); break;
+#endif
+  default: computeDescriptorsScalar(image, keypoints, view, descriptors); break;
+  }
+}
+
+void ORBdescriptor::ComputeOrientations(const cv::Mat &image, std::vector<cv::KeyPoint> &keypoints, const std::vector<int> &umax) {
+  assert(image.type() == CV_8UC1);
+  assert(umax.size() == HALF_PATCH_SIZE + 1);
+
+  switch(isa()) {
+#ifdef ORB_SLAM2_X86_KERNELS
+  case Isa::AVX2: computeOrientationsAVX2(image, keypoints, umax); break;
+  case Isa::SSE2: computeOrientationsSSE2(image, keypoints, umax); break;
+#endif
+  default: computeOrientationsScalar(image, keypoints, umax); break;
+  }
+}
+
+const char *ORBdescriptor::KernelName() {
+  switch(isa()) {
+  case Isa::AVX2: return "avx2";
+  case Isa::SSE2: return "sse2";
+  default: return "scalar";
+  }
+}
+
+}  // namespace ORB_SLAM2
@@ -54,6 +54,7 @@
  */
 // Internal
 #include "ORBextractor.hpp"
+#include "ThreadPool.hpp"
 
 using namespace cv;
 using namespace std;
@@ -64,76 +65,6 @@ const int PATCH_SIZE = 31;
 const int HALF_PATCH_SIZE = 15;
 const int EDGE_THRESHOLD = 19;
 
-static float IC_Angle(const Mat &image, const Point2f& pt, const vector<int> &u_max) {
-  int m_01 = 0, m_10 = 0;
-
-  const uchar *center = &image.at<uchar>(cvRound(pt.y), cvRound(pt.x));
-
-  // Treat the center line differently, v=0
-  for(int u = -HALF_PATCH_SIZE; u <= HALF_PATCH_SIZE; ++u)
-    m_10 += u * center[u];
-
-  // Go line by line in the circuI853lar patch
-  int step = static_cast<int>(image.step1());
-  for(int v = 1; v <= HALF_PATCH_SIZE; ++v) {
-    // Proceed over the two lines
-    int v_sum = 0;
-    int d = u_max[v];
-    for(int u = -d; u <= d; ++u) {
-      int val_plus = center[u + v * step], val_minus = center[u - v * step];
-      v_sum += (val_plus - val_minus);
-      m_10 += u * (val_plus + val_minus);
-    }
-    m_01 += v * v_sum;
-  }
-
-  return fastAtan2((float)m_01, (float)m_10);
-}
-
-const float factorPI = (float)(CV_PI / 180.f);
-static void computeOrbDescriptor(const KeyPoint &kpt, const Mat &img, const Point *pattern, uchar *desc) {
-  float angle = (float)kpt.angle * factorPI;
-  float a = (float)cos(angle), b = (float)sin(angle);
-
-  const uchar *center = &img.at<uchar>(cvRound(kpt.pt.y), cvRound(kpt.pt.x));
-  const int step = (int)img.step;
-
-#define GET_VALUE(idx)                                                                                                           \
-  center[cvRound(pattern[idx].x * b + pattern[idx].y * a) * step + cvRound(pattern[idx].x * a - pattern[idx].y * b)]
-
-  for(int i = 0; i < 32; ++i, pattern += 16) {
-    int t0, t1, val;
-    t0 = GET_VALUE(0);
-    t1 = GET_VALUE(1);
-    val = t0 < t1;
-    t0 = GET_VALUE(2);
-    t1 = GET_VALUE(3);
-    val |= (t0 < t1) << 1;
-    t0 = GET_VALUE(4);
-    t1 = GET_VALUE(5);
-    val |= (t0 < t1) << 2;
-    t0 = GET_VALUE(6);
-    t1 = GET_VALUE(7);
-    val |= (t0 < t1) << 3;
-    t0 = GET_VALUE(8);
-    t1 = GET_VALUE(9);
-    val |= (t0 < t1) << 4;
-    t0 = GET_VALUE(10);
-    t1 = GET_VALUE(11);
-    val |= (t0 < t1) << 5;
-    t0 = GET_VALUE(12);
-    t1 = GET_VALUE(13);
-    val |= (t0 < t1) << 6;
-    t0 = GET_VALUE(14);
-    t1 = GET_VALUE(15);
-    val |= (t0 < t1) << 7;
-
-    desc[i] = (uchar)val;
-  }
-
-#undef GET_VALUE
-}
-
 static int bit_pattern_31_[256 * 4] = {
   8,   -3,  9,   5 /*mean (0), correlation (0)*/,
   4,   2,   7,   -12 /*mean (1.12461e-05), correlation (0.0437584)*/,
@@ -394,6 +325,7 @@ static int bit_pattern_31_[256 * 4] = {
 };
 
 ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels, int _iniThFAST, int _minThFAST) :
+    mDescriptor(reinterpret_cast<const Point *>(bit_pattern_31_)),
     nfeatures(_nfeatures), scaleFactor(_scaleFactor), nlevels(_nlevels), iniThFAST(_iniThFAST), minThFAST(_minThFAST) {
   mvScaleFactor.resize(nlevels);
   mvLevelSigma2.resize(nlevels);
@@ -413,21 +345,7 @@ ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels, int
 
   mvImagePyramid.resize(nlevels);
 
-  mnFeaturesPerLevel.resize(nlevels);
-  float factor = 1.0f / scaleFactor;
-  float nDesiredFeaturesPerScale = nfeatures * (1 - factor) / (1 - (float)pow((double)factor, (double)nlevels));
-
-  int sumFeatures = 0;
-  for(int level = 0; level < nlevels - 1; level++) {
-    mnFeaturesPerLevel[level] = cvRound(nDesiredFeaturesPerScale);
-    sumFeatures += mnFeaturesPerLevel[level];
-    nDesiredFeaturesPerScale *= factor;
-  }
-  mnFeaturesPerLevel[nlevels - 1] = std::max(nfeatures - sumFeatures, 0);
-
-  const int npoints = 512;
-  const auto *pattern0 = (const Point *)bit_pattern_31_;
-  std::copy(pattern0, pattern0 + npoints, std::back_inserter(pattern));
+  ComputeFeaturesPerLevel();
 
   //This is for orientation
   // pre-compute the end of a row in a circular patch
@@ -448,63 +366,25 @@ ORBextractor::ORBextractor(int _nfeatures, float _scaleFactor, int _nlevels, int
   }
 }
 
-static void computeOrientation(const Mat &image, vector<KeyPoint> &keypoints, const vector<int> &umax) {
-  for(auto & keypoint : keypoints) {
-    keypoint.angle = IC_Angle(image, keypoint.pt, umax);
-  }
-}
+namespace {
 
-void ExtractorNode::DivideNode(ExtractorNode &n1, ExtractorNode &n2, ExtractorNode &n3, ExtractorNode &n4) {
-  const int halfX = ceil(static_cast<float>(UR.x - UL.x) / 2);
-  const int halfY = ceil(static_cast<float>(BR.y - UL.y) / 2);
-
-  //Define boundaries of childs
-  n1.UL = UL;
-  n1.UR = cv::Point2i(UL.x + halfX, UL.y);
-  n1.BL = cv::Point2i(UL.x, UL.y + halfY);
-  n1.BR = cv::Point2i(UL.x + halfX, UL.y + halfY);
-  n1.vKeys.reserve(vKeys.size());
-
-  n2.UL = n1.UR;
-  n2.UR = UR;
-  n2.BL = n1.BR;
-  n2.BR = cv::Point2i(UR.x, UL.y + halfY);
-  n2.vKeys.reserve(vKeys.size());
-
-  n3.UL = n1.BL;
-  n3.UR = n1.BR;
-  n3.BL = BL;
-  n3.BR = cv::Point2i(n1.BR.x, BL.y);
-  n3.vKeys.reserve(vKeys.size());
-
-  n4.UL = n3.UR;
-  n4.UR = n2.BR;
-  n4.BL = n3.BR;
-  n4.BR = BR;
-  n4.vKeys.reserve(vKeys.size());
-
-  //Associate points to childs
-  for(auto & kp : vKeys) {
-    if(kp.pt.x < n1.UR.x) {
-      if(kp.pt.y < n1.BR.y)
-        n1.vKeys.push_back(kp);
-      else
-        n3.vKeys.push_back(kp);
-    } else if(kp.pt.y < n1.BR.y)
-      n2.vKeys.push_back(kp);
-    else
-      n4.vKeys.push_back(kp);
-  }
+// Node of the flat quadtree used to distribute keypoints. Nodes live in one array and are
+// referred to by index; the keypoints of a node are the range [begin, end) of a shared
+// keypoint index array, which is partitioned in place when the node is divided.
+struct QuadTreeNode {
+  QuadTreeNode(int _minX, int _minY, int _maxX, int _maxY, int _begin, int _end) :
+      minX(_minX), minY(_minY), maxX(_maxX), maxY(_maxY), begin(_begin), end(_end), bNoMore(_end - _begin == 1), bAlive(true) {}
 
-  if(n1.vKeys.size() == 1)
-    n1.bNoMore = true;
-  if(n2.vKeys.size() == 1)
-    n2.bNoMore = true;
-  if(n3.vKeys.size() == 1)
-    n3.bNoMore = true;
-  if(n4.vKeys.size() == 1)
-    n4.bNoMore = true;
-}
+  int Size() const { return end - begin; }
+
+  // Bounds, UL = (minX, minY) and BR = (maxX, maxY)
+  int minX, minY, maxX, maxY;
+  int begin, end;
+  bool bNoMore;
+  bool bAlive;
+};
+
+}  // namespace
 
 std::vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPoint> &vToDistributeKeys,
                                                      const int &minX,
@@ -512,168 +392,159 @@ std::vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPo
                                                      const int &minY,
                                                      const int &maxY,
                                                      const int &N,
-                                                     [[maybe_unused]] const int &level) const {
+                                                     [[maybe_unused]] const int &level) {
   // Compute how many initial nodes
   const int nIni = round(static_cast<float>(maxX - minX) / (maxY - minY));
 
   const float hX = static_cast<float>(maxX - minX) / nIni;
 
-  list<ExtractorNode> lNodes;
+  const int nKeys = static_cast<int>(vToDistributeKeys.size());
 
-  vector<ExtractorNode *> vpIniNodes;
-  vpIniNodes.resize(nIni);
+  vector<QuadTreeNode> vNodes;
+  vNodes.reserve(nIni + 4 * nKeys);
 
-  for(int i = 0; i < nIni; i++) {
-    ExtractorNode ni;
-    ni.UL = cv::Point2i(hX * static_cast<float>(i), 0);
-    ni.UR = cv::Point2i(hX * static_cast<float>(i + 1), 0);
-    ni.BL = cv::Point2i(ni.UL.x, maxY - minY);
-    ni.BR = cv::Point2i(ni.UR.x, maxY - minY);
-    ni.vKeys.reserve(vToDistributeKeys.size());
+  // Keypoint indices, grouped by node. vScratch is used to partition a node range.
+  vector<int> vKeyIdx(nKeys);
+  vector<int> vScratch(nKeys);
 
-    lNodes.push_back(ni);
-    vpIniNodes[i] = &lNodes.back();
-  }
+  // Node list in reverse order: the front of the list is the back of vSeq, so that adding
+  // children in front of the list is a push_back. Divided nodes are only flagged as dead.
+  vector<int> vSeq;
+  vSeq.reserve(nIni + 4 * nKeys);
+  int nAlive = 0;
 
-  //Associate points to childs
-  for(const auto & kp : vToDistributeKeys) {
-    vpIniNodes[kp.pt.x / hX]->vKeys.push_back(kp);
-  }
+  // Associate points to the initial nodes (stable counting sort)
+  {
+    vector<int> vStart(nIni + 1, 0);
+    for(const auto & kp : vToDistributeKeys)
+      vStart[static_cast<int>(kp.pt.x / hX) + 1]++;
+    for(int i = 0; i < nIni; i++)
+      vStart[i + 1] += vStart[i];
+
+    vector<int> vPos(vStart.begin(), vStart.end() - 1);
+    for(int k = 0; k < nKeys; k++)
+      vKeyIdx[vPos[static_cast<int>(vToDistributeKeys[k].pt.x / hX)]++] = k;
 
-  auto lit = lNodes.begin();
+    // Empty nodes are discarded
+    for(int i = nIni - 1; i >= 0; i--) {
+      if(vStart[i + 1] == vStart[i])
+        continue;
 
-  while(lit != lNodes.end()) {
-    if(lit->vKeys.size() == 1) {
-      lit->bNoMore = true;
-      ++lit;
-    } else if(lit->vKeys.empty())
-      lit = lNodes.erase(lit);
-    else
-      ++lit;
+      vNodes.emplace_back(static_cast<int>(hX * static_cast<float>(i)), 0, static_cast<int>(hX * static_cast<float>(i + 1)), maxY - minY, vStart[i], vStart[i + 1]);
+      vSeq.push_back(static_cast<int>(vNodes.size()) - 1);
+      nAlive++;
+    }
   }
 
-  bool bFinish = false;
+  // Divide a node in four, add the non-empty children in front of the list (n1 first, n4 ends up
+  // at the very front) and retire the parent. Children with more than one point are recorded in
+  // vSizeAndNode. Returns how many of those were added.
+  auto divideNode = [&](const int idx, vector<pair<int, int> > &vSizeAndNode) {
+    vNodes[idx].bAlive = false;
+    nAlive--;
+
+    const QuadTreeNode parent = vNodes[idx];
+    const int halfX = ceil(static_cast<float>(parent.maxX - parent.minX) / 2);
+    const int halfY = ceil(static_cast<float>(parent.maxY - parent.minY) / 2);
+    const int midX = parent.minX + halfX;
+    const int midY = parent.minY + halfY;
+
+    // Child of a point: 0 UL, 1 UR, 2 BL, 3 BR
+    auto quadrant = [&](const int k) {
+      const cv::Point2f &pt = vToDistributeKeys[k].pt;
+      if(pt.x < midX)
+        return pt.y < midY ? 0 : 2;
+      return pt.y < midY ? 1 : 3;
+    };
+
+    int count[4] = {0, 0, 0, 0};
+    for(int k = parent.begin; k < parent.end; k++)
+      count[quadrant(vKeyIdx[k])]++;
+
+    int pos[4];
+    pos[0] = parent.begin;
+    for(int c = 1; c < 4; c++)
+      pos[c] = pos[c - 1] + count[c - 1];
+    const int start[4] = {pos[0], pos[1], pos[2], pos[3]};
+
+    for(int k = parent.begin; k < parent.end; k++)
+      vScratch[pos[quadrant(vKeyIdx[k])]++] = vKeyIdx[k];
+    std::copy(vScratch.begin() + parent.begin, vScratch.begin() + parent.end, vKeyIdx.begin() + parent.begin);
+
+    const int bounds[4][4] = {{parent.minX, parent.minY, midX, midY},
+                              {midX, parent.minY, parent.maxX, midY},
+                              {parent.minX, midY, midX, parent.maxY},
+                              {midX, midY, parent.maxX, parent.maxY}};
+
+    int nToExpand = 0;
+    for(int c = 0; c < 4; c++) {
+      if(count[c] == 0)
+        continue;
 
-  int iteration = 0;
+      const int childIdx = static_cast<int>(vNodes.size());
+      vNodes.emplace_back(bounds[c][0], bounds[c][1], bounds[c][2], bounds[c][3], start[c], start[c] + count[c]);
+      vSeq.push_back(childIdx);
+      nAlive++;
 
-  vector<pair<int, ExtractorNode *> > vSizeAndPointerToNode;
-  vSizeAndPointerToNode.reserve(lNodes.size() * 4);
+      if(count[c] > 1) {
+        nToExpand++;
+        vSizeAndNode.emplace_back(count[c], childIdx);
+      }
+    }
 
-  while(!bFinish) {
-    iteration++;
+    return nToExpand;
+  };
+
+  bool bFinish = false;
+
+  vector<pair<int, int> > vSizeAndNode;
+  vector<pair<int, int> > vPrevSizeAndNode;
+  vSizeAndNode.reserve(vSeq.size() * 4);
+  vPrevSizeAndNode.reserve(vSeq.size() * 4);
 
-    int prevSize = lNodes.size();
+  while(!bFinish) {
+    int prevSize = nAlive;
 
-    lit = lNodes.begin();
+    // Drop the retired nodes of the previous round
+    vSeq.erase(remove_if(vSeq.begin(), vSeq.end(), [&vNodes](const int idx) { return !vNodes[idx].bAlive; }), vSeq.end());
 
     int nToExpand = 0;
 
-    vSizeAndPointerToNode.clear();
+    vSizeAndNode.clear();
 
-    while(lit != lNodes.end()) {
-      if(lit->bNoMore) {
-        // If node only contains one point do not subdivide and continue
-        ++lit;
+    // Walk the list from the front, children added meanwhile are not visited
+    for(int s = static_cast<int>(vSeq.size()) - 1; s >= 0; s--) {
+      // If node only contains one point do not subdivide and continue
+      if(vNodes[vSeq[s]].bNoMore)
         continue;
-      } else {
-        // If more than one point, subdivide
-        ExtractorNode n1, n2, n3, n4;
-        lit->DivideNode(n1, n2, n3, n4);
-
-        // Add childs if they contain points
-        if(n1.vKeys.size() > 0) {
-          lNodes.push_front(n1);
-          if(n1.vKeys.size() > 1) {
-            nToExpand++;
-            vSizeAndPointerToNode.emplace_back(n1.vKeys.size(), &lNodes.front());
-            lNodes.front().lit = lNodes.begin();
-          }
-        }
-        if(n2.vKeys.size() > 0) {
-          lNodes.push_front(n2);
-          if(n2.vKeys.size() > 1) {
-            nToExpand++;
-            vSizeAndPointerToNode.emplace_back(n2.vKeys.size(), &lNodes.front());
-            lNodes.front().lit = lNodes.begin();
-          }
-        }
-        if(n3.vKeys.size() > 0) {
-          lNodes.push_front(n3);
-          if(n3.vKeys.size() > 1) {
-            nToExpand++;
-            vSizeAndPointerToNode.emplace_back(n3.vKeys.size(), &lNodes.front());
-            lNodes.front().lit = lNodes.begin();
-          }
-        }
-        if(n4.vKeys.size() > 0) {
-          lNodes.push_front(n4);
-          if(n4.vKeys.size() > 1) {
-            nToExpand++;
-            vSizeAndPointerToNode.emplace_back(n4.vKeys.size(), &lNodes.front());
-            lNodes.front().lit = lNodes.begin();
-          }
-        }
 
-        lit = lNodes.erase(lit);
-        continue;
-      }
+      // If more than one point, subdivide
+      nToExpand += divideNode(vSeq[s], vSizeAndNode);
     }
 
     // Finish if there are more nodes than required features
     // or all nodes contain just one point
-    if((int)lNodes.size() >= N || (int)lNodes.size() == prevSize) {
+    if(nAlive >= N || nAlive == prevSize) {
       bFinish = true;
-    } else if(((int)lNodes.size() + nToExpand * 3) > N) {
+    } else if((nAlive + nToExpand * 3) > N) {
 
       while(!bFinish) {
 
-        prevSize = lNodes.size();
+        prevSize = nAlive;
 
-        vector<pair<int, ExtractorNode *> > vPrevSizeAndPointerToNode = vSizeAndPointerToNode;
-        vSizeAndPointerToNode.clear();
+        vPrevSizeAndNode.swap(vSizeAndNode);
+        vSizeAndNode.clear();
 
-        sort(vPrevSizeAndPointerToNode.begin(), vPrevSizeAndPointerToNode.end());
-        for(int j = vPrevSizeAndPointerToNode.size() - 1; j >= 0; j--) {
-          ExtractorNode n1, n2, n3, n4;
-          vPrevSizeAndPointerToNode[j].second->DivideNode(n1, n2, n3, n4);
+        // Biggest nodes first, ties are broken by creation order
+        sort(vPrevSizeAndNode.begin(), vPrevSizeAndNode.end());
+        for(int j = static_cast<int>(vPrevSizeAndNode.size()) - 1; j >= 0; j--) {
+          divideNode(vPrevSizeAndNode[j].second, vSizeAndNode);
 
-          // Add childs if they contain points
-          if(n1.vKeys.size() > 0) {
-            lNodes.push_front(n1);
-            if(n1.vKeys.size() > 1) {
-              vSizeAndPointerToNode.emplace_back(n1.vKeys.size(), &lNodes.front());
-              lNodes.front().lit = lNodes.begin();
-            }
-          }
-          if(n2.vKeys.size() > 0) {
-            lNodes.push_front(n2);
-            if(n2.vKeys.size() > 1) {
-              vSizeAndPointerToNode.emplace_back(n2.vKeys.size(), &lNodes.front());
-              lNodes.front().lit = lNodes.begin();
-            }
-          }
-          if(!n3.vKeys.empty()) {
-            lNodes.push_front(n3);
-            if(n3.vKeys.size() > 1) {
-              vSizeAndPointerToNode.emplace_back(n3.vKeys.size(), &lNodes.front());
-              lNodes.front().lit = lNodes.begin();
-            }
-          }
-          if(!n4.vKeys.empty()) {
-            lNodes.push_front(n4);
-            if(n4.vKeys.size() > 1) {
-              vSizeAndPointerToNode.emplace_back(n4.vKeys.size(), &lNodes.front());
-              lNodes.front().lit = lNodes.begin();
-            }
-          }
-
-          lNodes.erase(vPrevSizeAndPointerToNode[j].second->lit);
-
-          if((int)lNodes.size() >= N)
+          if(nAlive >= N)
             break;
         }
 
-        if((int)lNodes.size() >= N || (int)lNodes.size() == prevSize)
+        if(nAlive >= N || nAlive == prevSize)
           bFinish = true;
       }
     }
@@ -681,16 +552,20 @@ std::vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPo
 
   // Retain the best point in each node
   vector<cv::KeyPoint> vResultKeys;
-  vResultKeys.reserve(nfeatures);
-  for(const auto& vNodes : lNodes) {
-    const std::vector<cv::KeyPoint> &vNodeKeys = vNodes.vKeys;
-    const cv::KeyPoint *pKP = &vNodeKeys[0];
+  vResultKeys.reserve(N);
+  for(int s = static_cast<int>(vSeq.size()) - 1; s >= 0; s--) {
+    const QuadTreeNode &node = vNodes[vSeq[s]];
+    if(!node.bAlive)
+      continue;
+
+    const cv::KeyPoint *pKP = &vToDistributeKeys[vKeyIdx[node.begin]];
     float maxResponse = pKP->response;
 
-    for(size_t k = 1; k < vNodeKeys.size(); k++) {
-      if(vNodeKeys[k].response > maxResponse) {
-        pKP = &vNodeKeys[k];
-        maxResponse = vNodeKeys[k].response;
+    for(int k = node.begin + 1; k < node.end; k++) {
+      const cv::KeyPoint &kp = vToDistributeKeys[vKeyIdx[k]];
+      if(kp.response > maxResponse) {
+        pKP = &kp;
+        maxResponse = kp.response;
       }
     }
 
@@ -700,82 +575,137 @@ std::vector<cv::KeyPoint> ORBextractor::DistributeOctTree(const vector<cv::KeyPo
   return vResultKeys;
 }
 
-void ORBextractor::ComputeKeyPointsOctTree(vector<vector<KeyPoint> > &allKeypoints) {
+namespace {
+
+// Layout of the FAST detection cells of one pyramid level.
+struct CellGrid {
+  explicit CellGrid(const Mat &image) :
+      minBorderX(EDGE_THRESHOLD - 3), minBorderY(minBorderX), maxBorderX(image.cols - EDGE_THRESHOLD + 3),
+      maxBorderY(image.rows - EDGE_THRESHOLD + 3) {
+    const float width = (maxBorderX - minBorderX);
+    const float height = (maxBorderY - minBorderY);
+
+    nCols = width / W;
+    nRows = height / W;
+    wCell = ceil(width / nCols);
+    hCell = ceil(height / nRows);
+  }
+
+  static constexpr float W = 30;
+
+  int minBorderX, minBorderY, maxBorderX, maxBorderY;
+  int nCols, nRows, wCell, hCell;
+};
+
+}  // namespace
+
+void ORBextractor::ComputeKeyPointsOctTree(vector<vector<KeyPoint> > &allKeypoints, const vector<int> &vFeaturesPerLevel, bool bMask) {
   allKeypoints.resize(nlevels);
 
-  const float W = 30;
+  vector<CellGrid> vGrids;
+  vGrids.reserve(nlevels);
 
+  // Every row of cells of every level is an independent FAST job
+  vector<pair<int, int> > vCellRows;
+  vector<size_t> vFirstCellRow(nlevels + 1, 0);
   for(int level = 0; level < nlevels; ++level) {
-    const int minBorderX = EDGE_THRESHOLD - 3;
-    const int minBorderY = minBorderX;
-    const int maxBorderX = mvImagePyramid[level].cols - EDGE_THRESHOLD + 3;
-    const int maxBorderY = mvImagePyramid[level].rows - EDGE_THRESHOLD + 3;
+    vGrids.emplace_back(mvImagePyramid[level]);
+    for(int i = 0; i < vGrids[level].nRows; i++)
+      vCellRows.emplace_back(level, i);
+    vFirstCellRow[level + 1] = vCellRows.size();
+  }
 
-    vector<cv::KeyPoint> vToDistributeKeys;
-    vToDistributeKeys.reserve(nfeatures * 10);
+  vector<vector<KeyPoint> > vRowKeys(vCellRows.size());
 
-    const float width = (maxBorderX - minBorderX);
-    const float height = (maxBorderY - minBorderY);
+  ParallelFor(vCellRows.size(), [&](size_t r) {
+    const int level = vCellRows[r].first;
+    const int i = vCellRows[r].second;
+    const CellGrid &grid = vGrids[level];
 
-    const int nCols = width / W;
-    const int nRows = height / W;
-    const int wCell = ceil(width / nCols);
-    const int hCell = ceil(height / nRows);
+    const float iniY = grid.minBorderY + i * grid.hCell;
+    float maxY = iniY + grid.hCell + 6;
 
-    for(int i = 0; i < nRows; i++) {
-      const float iniY = minBorderY + i * hCell;
-      float maxY = iniY + hCell + 6;
+    if(iniY >= grid.maxBorderY - 3)
+      return;
+    if(maxY > grid.maxBorderY)
+      maxY = grid.maxBorderY;
 
-      if(iniY >= maxBorderY - 3)
-        continue;
-      if(maxY > maxBorderY)
-        maxY = maxBorderY;
+    vector<cv::KeyPoint> &vKeysRow = vRowKeys[r];
 
-      for(int j = 0; j < nCols; j++) {
-        const float iniX = minBorderX + j * wCell;
-        float maxX = iniX + wCell + 6;
-        if(iniX >= maxBorderX - 6)
+    for(int j = 0; j < grid.nCols; j++) {
+      const float iniX = grid.minBorderX + j * grid.wCell;
+      float maxX = iniX + grid.wCell + 6;
+      if(iniX >= grid.maxBorderX - 6)
+        continue;
+      if(maxX > grid.maxBorderX)
+        maxX = grid.maxBorderX;
+
+      // Fully masked cells are skipped, partially masked cells are filtered per pixel
+      Mat cellMask;
+      if(bMask) {
+        cellMask = mvMaskPyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX);
+        const int nUnmasked = countNonZero(cellMask);
+        if(nUnmasked == 0)
           continue;
-        if(maxX > maxBorderX)
-          maxX = maxBorderX;
+        if(nUnmasked == cellMask.rows * cellMask.cols)
+          cellMask.release();
+      }
 
-        vector<cv::KeyPoint> vKeysCell;
-        FAST(mvImagePyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX), vKeysCell, iniThFAST, true);
+      auto filterMasked = [&cellMask](vector<cv::KeyPoint> &vKeys) {
+        if(cellMask.empty())
+          return;
+        vKeys.erase(remove_if(vKeys.begin(), vKeys.end(), [&cellMask](const cv::KeyPoint &kp) {
+          return cellMask.at<uchar>(cvRound(kp.pt.y), cvRound(kp.pt.x)) == 0;
+        }), vKeys.end());
+      };
+
+      vector<cv::KeyPoint> vKeysCell;
+      FAST(mvImagePyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX), vKeysCell, iniThFAST, true);
+      filterMasked(vKeysCell);
+
+      if(vKeysCell.empty()) {
+        FAST(mvImagePyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX), vKeysCell, minThFAST, true);
+        filterMasked(vKeysCell);
+      }
 
-        if(vKeysCell.empty()) {
-          FAST(mvImagePyramid[level].rowRange(iniY, maxY).colRange(iniX, maxX), vKeysCell, minThFAST, true);
-        }
-
-        if(!vKeysCell.empty()) {
-          for(auto & vit : vKeysCell) {
-            vit.pt.x += j * wCell;
-            vit.pt.y += i * hCell;
-            vToDistributeKeys.push_back(vit);
-          }
+      if(!vKeysCell.empty()) {
+        for(auto & vit : vKeysCell) {
+          vit.pt.x += j * grid.wCell;
+          vit.pt.y += i * grid.hCell;
+          vKeysRow.push_back(vit);
         }
       }
     }
+  });
+
+  // Octree distribution and orientation, one job per level
+  ParallelFor(nlevels, [&](size_t l) {
+    const int level = static_cast<int>(l);
+    const CellGrid &grid = vGrids[level];
+
+    vector<cv::KeyPoint> vToDistributeKeys;
+    vToDistributeKeys.reserve(nfeatures * 10);
+
+    // Concatenate in row order, as the serial scan would have produced them
+    for(size_t r = vFirstCellRow[level]; r < vFirstCellRow[level + 1]; r++)
+      vToDistributeKeys.insert(vToDistributeKeys.end(), vRowKeys[r].begin(), vRowKeys[r].end());
 
     vector<KeyPoint> &keypoints = allKeypoints[level];
     keypoints.reserve(nfeatures);
 
-    keypoints = DistributeOctTree(vToDistributeKeys, minBorderX, maxBorderX, minBorderY, maxBorderY, mnFeaturesPerLevel[level], level);
+    keypoints = DistributeOctTree(vToDistributeKeys, grid.minBorderX, grid.maxBorderX, grid.minBorderY, grid.maxBorderY, vFeaturesPerLevel[level], level);
 
     const int scaledPatchSize = PATCH_SIZE * mvScaleFactor[level];
 
     // Add border to coordinates and scale information
     const int nkps = keypoints.size();
     for(int i = 0; i < nkps; i++) {
-      keypoints[i].pt.x += minBorderX;
-      keypoints[i].pt.y += minBorderY;
+      keypoints[i].pt.x += grid.minBorderX;
+      keypoints[i].pt.y += grid.minBorderY;
       keypoints[i].octave = level;
       keypoints[i].size = scaledPatchSize;
     }
-  }
-
-  // compute orientations
-  for(int level = 0; level < nlevels; ++level)
-    computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
+  });
 }
 
 void ORBextractor::ComputeKeyPointsOld(std::vector<std::vector<KeyPoint> > &allKeypoints) {
@@ -920,65 +850,83 @@ void ORBextractor::ComputeKeyPointsOld(std::vector<std::vector<KeyPoint> > &allK
       keypoints.resize(nDesiredFeatures);
     }
   }
-
-  // and compute orientations
-  for(int level = 0; level < nlevels; ++level)
-    computeOrientation(mvImagePyramid[level], allKeypoints[level], umax);
 }
 
-static void computeDescriptors(const Mat &image, vector<KeyPoint> &keypoints, Mat &descriptors, const vector<Point> &pattern) {
-  descriptors = Mat::zeros((int)keypoints.size(), 32, CV_8UC1);
+void ORBextractor::operator()(InputArray _image, InputArray _mask, vector<KeyPoint> &_keypoints, OutputArray _descriptors) {
+  Extract(_image, _mask, _keypoints, [&_descriptors](int nkeypoints) {
+    if(nkeypoints == 0) {
+      _descriptors.release();
+      return Mat();
+    }
+    _descriptors.create(nkeypoints, 32, CV_8U);
+    return _descriptors.getMat();
+  });
+}
 
-  for(size_t i = 0; i < keypoints.size(); i++)
-    computeOrbDescriptor(keypoints[i], image, &pattern[0], descriptors.ptr((int)i));
+void ORBextractor::operator()(InputArray _image, InputArray _mask, vector<KeyPoint> &_keypoints, DescriptorArray &_descriptors) {
+  Extract(_image, _mask, _keypoints, [&_descriptors](int nkeypoints) {
+    _descriptors.resize(static_cast<size_t>(nkeypoints));
+    return _descriptors.mat();
+  });
 }
 
-void ORBextractor::operator()(InputArray _image, [[maybe_unused]] InputArray _mask, vector<KeyPoint> &_keypoints, OutputArray _descriptors) {
+void ORBextractor::Extract(InputArray _image, InputArray _mask, vector<KeyPoint> &_keypoints, const std::function<Mat(int)> &allocateDescriptors) {
   if(_image.empty())
     return;
 
   Mat image = _image.getMat();
   assert(image.type() == CV_8UC1);
 
+  Mat mask = _mask.empty() ? mMask : _mask.getMat();
+  if(!mask.empty() && (mask.type() != CV_8UC1 || mask.size() != image.size())) {
+    if(image.size() != mRejectedMaskSize) {
+      spdlog::error("ORB extractor mask ({}x{}, type {}) does not match the {}x{} CV_8UC1 image, ignoring it",
+                    mask.cols, mask.rows, mask.type(), image.cols, image.rows);
+      mRejectedMaskSize = image.size();
+    }
+    mask.release();
+  }
+  const bool bMask = !mask.empty();
+  assert(!bMask || (mask.type() == CV_8UC1 && mask.size() == image.size()));
+
   // Pre-compute the scale pyramid
   ComputePyramid(image);
 
   vector<vector<KeyPoint> > allKeypoints;
-  ComputeKeyPointsOctTree(allKeypoints);
+  if(bMask) {
+    ComputeMaskPyramid(mask);
+    ComputeKeyPointsOctTree(allKeypoints, ComputeMaskedFeaturesPerLevel(), true);
+  } else {
+    ComputeKeyPointsOctTree(allKeypoints, mnFeaturesPerLevel, false);
+  }
   //ComputeKeyPointsOld(allKeypoints);
 
-  Mat descriptors;
-
-  int nkeypoints = 0;
+  // Orientation and descriptors, one job per level. Each level writes its own block of descriptor rows
+  vector<int> vLevelOffset(nlevels + 1, 0);
   for(int level = 0; level < nlevels; ++level)
-    nkeypoints += (int)allKeypoints[level].size();
-  if(nkeypoints == 0)
-    _descriptors.release();
-  else {
-    _descriptors.create(nkeypoints, 32, CV_8U);
-    descriptors = _descriptors.getMat();
-  }
+    vLevelOffset[level + 1] = vLevelOffset[level] + (int)allKeypoints[level].size();
 
-  _keypoints.clear();
-  _keypoints.reserve(nkeypoints);
+  const int nkeypoints = vLevelOffset[nlevels];
+  Mat descriptors = allocateDescriptors(nkeypoints);
 
-  int offset = 0;
-  for(int level = 0; level < nlevels; ++level) {
+  ParallelFor(nlevels, [&](size_t l) {
+    const int level = static_cast<int>(l);
     vector<KeyPoint> &keypoints = allKeypoints[level];
-    int nkeypointsLevel = (int)keypoints.size();
 
-    if(nkeypointsLevel == 0)
-      continue;
+    if(keypoints.empty())
+      return;
 
-    // preprocess the resized image
-    Mat workingMat = mvImagePyramid[level].clone();
-    GaussianBlur(workingMat, workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101);
+    // compute orientations
+    ORBdescriptor::ComputeOrientations(mvImagePyramid[level], keypoints, umax);
 
-    // Compute the descriptors
-    Mat desc = descriptors.rowRange(offset, offset + nkeypointsLevel);
-    computeDescriptors(workingMat, keypoints, desc, pattern);
+    // preprocess the resized image, the level is blurred as an isolated image
+    // (like a copy of it would be) into its persistent buffer
+    Mat &workingMat = mvBlurredPyramid[level];
+    GaussianBlur(mvImagePyramid[level], workingMat, Size(7, 7), 2, 2, BORDER_REFLECT_101 + BORDER_ISOLATED);
 
-    offset += nkeypointsLevel;
+    // Compute the descriptors
+    Mat desc = descriptors.rowRange(vLevelOffset[level], vLevelOffset[level + 1]);
+    mDescriptor.Compute(workingMat, keypoints, desc);
 
     // Scale keypoint coordinates
     if(level != 0) {
@@ -986,22 +934,119 @@ void ORBextractor::operator()(InputArray _image, [[maybe_unused]] InputArray _ma
       for(auto & keypoint : keypoints)
         keypoint.pt *= scale;
     }
-    // And add the keypoints to the output
-    _keypoints.insert(_keypoints.end(), keypoints.begin(), keypoints.end());
+  });
+
+  // And add the keypoints to the output
+  _keypoints.clear();
+  _keypoints.reserve(nkeypoints);
+  for(int level = 0; level < nlevels; ++level)
+    _keypoints.insert(_keypoints.end(), allKeypoints[level].begin(), allKeypoints[level].end());
+}
+
+void ORBextractor::ParallelFor(size_t n, const std::function<void(size_t)> &body) const {
+  if(mpThreadPool) {
+    mpThreadPool->parallelFor(n, body);
+  } else {
+    for(size_t i = 0; i < n; ++i)
+      body(i);
   }
 }
 
-void ORBextractor::ComputePyramid(const cv::Mat& image) {
+void ORBextractor::AllocatePyramid(const cv::Size &imageSize, int type) {
+  mvPyramidBuffers.resize(nlevels);
+  mvBlurredPyramid.resize(nlevels);
+
   for(int level = 0; level < nlevels; ++level) {
     float scale = mvInvScaleFactor[level];
-    Size sz(cvRound((float)image.cols * scale), cvRound((float)image.rows * scale));
+    Size sz(cvRound((float)imageSize.width * scale), cvRound((float)imageSize.height * scale));
     Size wholeSize(sz.width + EDGE_THRESHOLD * 2, sz.height + EDGE_THRESHOLD * 2);
-    Mat temp(wholeSize, image.type()), masktemp;
-    mvImagePyramid[level] = temp(Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
 
-    // Compute the resized image
+    mvPyramidBuffers[level].create(wholeSize, type);
+    mvImagePyramid[level] = mvPyramidBuffers[level](Rect(EDGE_THRESHOLD, EDGE_THRESHOLD, sz.width, sz.height));
+    mvBlurredPyramid[level].create(sz, type);
+    mnPyramidAllocations += 2;
+  }
+
+  mPyramidImageSize = imageSize;
+  mPyramidImageType = type;
+}
+
+void ORBextractor::SetFeatureBudget(int nFeatures) {
+  if(nFeatures == nfeatures)
+    return;
+
+  nfeatures = nFeatures;
+  ComputeFeaturesPerLevel();
+}
+
+void ORBextractor::ComputeFeaturesPerLevel() {
+  mnFeaturesPerLevel.resize(nlevels);
+  float factor = 1.0f / scaleFactor;
+  float nDesiredFeaturesPerScale = nfeatures * (1 - factor) / (1 - (float)pow((double)factor, (double)nlevels));
+
+  int sumFeatures = 0;
+  for(int level = 0; level < nlevels - 1; level++) {
+    mnFeaturesPerLevel[level] = cvRound(nDesiredFeaturesPerScale);
+    sumFeatures += mnFeaturesPerLevel[level];
+    nDesiredFeaturesPerScale *= factor;
+  }
+  mnFeaturesPerLevel[nlevels - 1] = std::max(nfeatures - sumFeatures, 0);
+}
+
+void ORBextractor::ComputeMaskPyramid(const cv::Mat &mask) {
+  mvMaskPyramid.resize(nlevels);
+  mvMaskPyramid[0] = mask;
+
+  // Nearest neighbour keeps the mask binary, each level is resized from the full resolution
+  for(int level = 1; level < nlevels; ++level) {
+    const Size sz = mvImagePyramid[level].size();
+    if(mvMaskPyramid[level].size() != sz || mvMaskPyramid[level].type() != mask.type()) {
+      mvMaskPyramid[level].create(sz, mask.type());
+      mnPyramidAllocations++;
+    }
+    resize(mask, mvMaskPyramid[level], sz, 0, 0, INTER_NEAREST);
+  }
+}
+
+vector<int> ORBextractor::ComputeMaskedFeaturesPerLevel() const {
+  // Same geometric split as in the constructor, each level weighted by its unmasked area
+  const float factor = 1.0f / scaleFactor;
+  vector<float> vWeights(nlevels);
+  float sumWeights = 0;
+  float levelFactor = 1.0f;
+  for(int level = 0; level < nlevels; ++level) {
+    const Mat &levelMask = mvMaskPyramid[level];
+    const float unmaskedRatio = static_cast<float>(countNonZero(levelMask)) / (levelMask.rows * levelMask.cols);
+    vWeights[level] = levelFactor * unmaskedRatio;
+    sumWeights += vWeights[level];
+    levelFactor *= factor;
+  }
+
+  vector<int> vFeaturesPerLevel(nlevels, 0);
+  if(sumWeights <= 0)
+    return vFeaturesPerLevel;
+
+  int sumFeatures = 0;
+  for(int level = 0; level < nlevels - 1; level++) {
+    vFeaturesPerLevel[level] = cvRound(nfeatures * vWeights[level] / sumWeights);
+    sumFeatures += vFeaturesPerLevel[level];
+  }
+  vFeaturesPerLevel[nlevels - 1] = std::max(nfeatures - sumFeatures, 0);
+
+  return vFeaturesPerLevel;
+}
+
+void ORBextractor::ComputePyramid(const cv::Mat& image) {
+  // Buffers are only (re)allocated when the input resolution changes
+  if(image.size() != mPyramidImageSize || image.type() != mPyramidImageType)
+    AllocatePyramid(image.size(), image.type());
+
+  for(int level = 0; level < nlevels; ++level) {
+    Mat &temp = mvPyramidBuffers[level];
+
+    // Compute the resized image, resize and copyMakeBorder write into the preallocated buffers
     if(level != 0) {
-      resize(mvImagePyramid[level - 1], mvImagePyramid[level], sz, 0, 0, INTER_LINEAR);
+      resize(mvImagePyramid[level - 1], mvImagePyramid[level], mvImagePyramid[level].size(), 0, 0, INTER_LINEAR);
 
       copyMakeBorder(mvImagePyramid[level], temp, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, EDGE_THRESHOLD, BORDER_REFLECT_101 + BORDER_ISOLATED);
     } else {
@@ -23,8 +23,9 @@
 #include "Frame.hpp"
 #include "MapPoint.hpp"
 #include "KeyFrame.hpp"
+#include "HammingDistance.hpp"
+#include "ThreadPool.hpp"
 // DBoW2
-#include <DBoW2/FeatureVector.h>
 
 using namespace std;
 
@@ -34,80 +35,174 @@ const int ORBmatcher::TH_HIGH = 100;
 const int ORBmatcher::TH_LOW = 50;
 const int ORBmatcher::HISTO_LENGTH = 30;
 
+namespace {
+
+// Local map points matched per task by SearchByProjection(Frame, vector)
+constexpr size_t LOCAL_MAP_CHUNK = 64;
+
+// Vocabulary nodes matched per task by SearchByBoW
+constexpr size_t BOW_NODES_PER_TASK = 8;
+
+// Map points projected per task by Fuse(vector, vector)
+constexpr size_t FUSE_CHUNK = 256;
+
+}  // namespace
+
 ORBmatcher::ORBmatcher(float nnratio, bool checkOri) : mfNNratio(nnratio), mbCheckOrientation(checkOri) {}
 
 int ORBmatcher::SearchByProjection(Frame &F, const vector<MapPoint *> &vpMapPoints, const float th) {
+  const size_t N = vpMapPoints.size();
+  const size_t nChunks = (N + LOCAL_MAP_CHUNK - 1) / LOCAL_MAP_CHUNK;
+
+  // Match every map point against the keypoints as they are before the search, one task per chunk.
+  // The candidates of point i are vChunkCandidates[i / LOCAL_MAP_CHUNK][begin(i), vCandidatesEnd[i])
+  vector<int> vBestIdx(N, -1);
+  vector<size_t> vCandidatesEnd(N, 0);
+  vector<vector<size_t> > vChunkCandidates(nChunks);
+
+  ParallelFor(nChunks, [&](size_t c) {
+    vector<size_t> vIndices;
+    vector<size_t> vCandidates;
+    vector<size_t> &vChunk = vChunkCandidates[c];
+
+    const size_t end = min(N, (c + 1) * LOCAL_MAP_CHUNK);
+    for(size_t i = c * LOCAL_MAP_CHUNK; i < end; i++) {
+      vBestIdx[i] = MatchLocalMapPoint(F, vpMapPoints[i], th, vIndices, vCandidates);
+      vChunk.insert(vChunk.end(), vCandidates.begin(), vCandidates.end());
+      vCandidatesEnd[i] = vChunk.size();
+    }
+  });
+
+  // Commit in map point order. A keypoint matched earlier in the pass is no longer a candidate for the
+  // following points, so a point that compared against such a keypoint is matched again on the current
+  // state. This gives the matches of a sequential search, whatever the number of threads.
   int nmatches = 0;
+  vector<bool> vbMatched(F.mvpMapPoints.size(), false);
+  vector<size_t> vIndices;
+  vector<size_t> vCandidates;
 
-  const bool bFactor = th != 1.0;
+  for(size_t i = 0; i < N; i++) {
+    const vector<size_t> &vChunk = vChunkCandidates[i / LOCAL_MAP_CHUNK];
+    const size_t begin = i % LOCAL_MAP_CHUNK == 0 ? 0 : vCandidatesEnd[i - 1];
 
-  for(auto pMP : vpMapPoints) {
-    if(!pMP->mbTrackInView)
-      continue;
+    int bestIdx = vBestIdx[i];
+    if(any_of(vChunk.begin() + begin, vChunk.begin() + vCandidatesEnd[i], [&vbMatched](size_t idx) { return vbMatched[idx]; }))
+      bestIdx = MatchLocalMapPoint(F, vpMapPoints[i], th, vIndices, vCandidates);
 
-    if(pMP->isBad())
+    if(bestIdx < 0)
       continue;
 
-    const int &nPredictedLevel = pMP->mnTrackScaleLevel;
+    F.mvpMapPoints[bestIdx] = vpMapPoints[i];
+    vbMatched[bestIdx] = true;
+    nmatches++;
+  }
 
-    // The size of the window will depend on the viewing direction
-    float r = RadiusByViewingCos(pMP->mTrackViewCos);
+  return nmatches;
+}
 
-    if(bFactor)
-      r *= th;
+int ORBmatcher::MatchLocalMapPoint(const Frame &F, MapPoint *pMP, const float th, vector<size_t> &vIndices, vector<size_t> &vCandidates) const {
+  vCandidates.clear();
 
-    const vector<size_t> vIndices =
-      F.GetFeaturesInArea(pMP->mTrackProjX, pMP->mTrackProjY, r * F.mvScaleFactors[nPredictedLevel], nPredictedLevel - 1, nPredictedLevel);
+  if(!pMP->mbTrackInView)
+    return -1;
 
-    if(vIndices.empty())
-      continue;
+  if(pMP->isBad())
+    return -1;
 
-    const cv::Mat MPdescriptor = pMP->GetDescriptor();
+  const int &nPredictedLevel = pMP->mnTrackScaleLevel;
 
-    int bestDist = 256;
-    int bestLevel = -1;
-    int bestDist2 = 256;
-    int bestLevel2 = -1;
-    int bestIdx = -1;
+  // The size of the window will depend on the viewing direction
+  float r = RadiusByViewingCos(pMP->mTrackViewCos);
 
-    // Get best and second matches with near keypoints
-    for(unsigned long idx : vIndices) {
-      if(F.mvpMapPoints[idx])
-        if(F.mvpMapPoints[idx]->Observations() > 0)
-          continue;
+  if(th != 1.0)
+    r *= th;
 
-      if(F.mvuRight[idx] > 0) {
-        const float er = fabs(pMP->mTrackProjXR - F.mvuRight[idx]);
-        if(er > r * F.mvScaleFactors[nPredictedLevel])
-          continue;
-      }
+  F.GetFeaturesInArea(pMP->mTrackProjX, pMP->mTrackProjY, r * F.mvScaleFactors[nPredictedLevel], vIndices, nPredictedLevel - 1, nPredictedLevel);
 
-      const cv::Mat &d = F.mDescriptors.row(idx);
+  if(vIndices.empty())
+    return -1;
 
-      const int dist = DescriptorDistance(MPdescriptor, d);
+  const DescriptorBlock MPdescriptor = pMP->GetDescriptor();
 
-      if(dist < bestDist) {
-        bestDist2 = bestDist;
-        bestDist = dist;
-        bestLevel2 = bestLevel;
-        bestLevel = F.mvKeysUn[idx].octave;
-        bestIdx = idx;
-      } else if(dist < bestDist2) {
-        bestLevel2 = F.mvKeysUn[idx].octave;
-        bestDist2 = dist;
-      }
-    }
+  // Get best and second matches with near keypoints
+  for(unsigned long idx : vIndices) {
+    if(F.mvpMapPoints[idx])
+      if(F.mvpMapPoints[idx]->Observations() > 0)
+        continue;
 
-    // Apply ratio to second match (only if best and second are in the same scale level)
-    if(bestDist <= TH_HIGH) {
-      if(bestLevel == bestLevel2 && bestDist > mfNNratio * bestDist2)
+    if(F.mvuRight[idx] > 0) {
+      const float er = fabs(pMP->mTrackProjXR - F.mvuRight[idx]);
+      if(er > r * F.mvScaleFactors[nPredictedLevel])
         continue;
+    }
 
-      F.mvpMapPoints[bestIdx] = pMP;
-      nmatches++;
+    vCandidates.push_back(idx);
+  }
+
+  const HammingDistance::Best best = HammingDistance::FindBest(MPdescriptor.data(), F.mDescriptors, vCandidates);
+
+  // Apply ratio to second match (only if best and second are in the same scale level)
+  if(best.dist > TH_HIGH)
+    return -1;
+
+  const int bestLevel = F.mvKeysUn[best.idx].octave;
+  const int bestLevel2 = best.idx2 >= 0 ? F.mvKeysUn[best.idx2].octave : -1;
+  if(bestLevel == bestLevel2 && best.dist > mfNNratio * best.dist2)
+    return -1;
+
+  return best.idx;
+}
+
+void ORBmatcher::ParallelFor(size_t n, const std::function<void(size_t)> &body) const {
+  if(mpThreadPool) {
+    mpThreadPool->parallelFor(n, body);
+  } else {
+    for(size_t i = 0; i < n; ++i)
+      body(i);
+  }
+}
+
+template<typename MatchNode>
+int ORBmatcher::SearchSharedNodes(const FeatureVector &vFeatVec1, const FeatureVector &vFeatVec2, vector<int> *rotHist, MatchNode matchNode) const {
+  // Nodes present in both feature vectors, in node order
+  vector<pair<FeatureVector::Features, FeatureVector::Features> > vNodes;
+
+  size_t i1 = 0;
+  size_t i2 = 0;
+  while(i1 < vFeatVec1.size() && i2 < vFeatVec2.size()) {
+    const FeatureVector::NodeId node1 = vFeatVec1.node(i1);
+    const FeatureVector::NodeId node2 = vFeatVec2.node(i2);
+    if(node1 == node2) {
+      vNodes.emplace_back(vFeatVec1.features(i1), vFeatVec2.features(i2));
+      ++i1;
+      ++i2;
+    } else if(node1 < node2) {
+      i1 = vFeatVec1.lowerBound(node2, i1);
+    } else {
+      i2 = vFeatVec2.lowerBound(node1, i2);
     }
   }
 
+  // A keypoint belongs to a single node, so the nodes only share the rotation histogram.
+  // Every task fills its own histogram, they are concatenated in node order afterwards
+  const size_t nTasks = (vNodes.size() + BOW_NODES_PER_TASK - 1) / BOW_NODES_PER_TASK;
+  vector<int> vTaskMatches(nTasks, 0);
+  vector<vector<vector<int> > > vTaskRotHist(nTasks, vector<vector<int> >(HISTO_LENGTH));
+
+  ParallelFor(nTasks, [&](size_t t) {
+    vector<size_t> vCandidates;
+    const size_t end = min(vNodes.size(), (t + 1) * BOW_NODES_PER_TASK);
+    for(size_t n = t * BOW_NODES_PER_TASK; n < end; n++)
+      vTaskMatches[t] += matchNode(vNodes[n].first, vNodes[n].second, vCandidates, vTaskRotHist[t].data());
+  });
+
+  int nmatches = 0;
+  for(size_t t = 0; t < nTasks; t++) {
+    nmatches += vTaskMatches[t];
+    for(int i = 0; i < HISTO_LENGTH; i++)
+      rotHist[i].insert(rotHist[i].end(), vTaskRotHist[t][i].begin(), vTaskRotHist[t][i].end());
+  }
+
   return nmatches;
 }
 
@@ -118,11 +213,11 @@ float ORBmatcher::RadiusByViewingCos(const float &viewCos) {
     return 4.0;
 }
 
-bool ORBmatcher::CheckDistEpipolarLine(const cv::KeyPoint &kp1, const cv::KeyPoint &kp2, const cv::Mat &F12, const KeyFrame *pKF2) {
+bool ORBmatcher::CheckDistEpipolarLine(const cv::KeyPoint &kp1, const cv::KeyPoint &kp2, const Eigen::Matrix3f &F12, const KeyFrame *pKF2) {
   // Epipolar line in second image l = x1'F12 = [a b c]
-  const float a = kp1.pt.x * F12.at<float>(0, 0) + kp1.pt.y * F12.at<float>(1, 0) + F12.at<float>(2, 0);
-  const float b = kp1.pt.x * F12.at<float>(0, 1) + kp1.pt.y * F12.at<float>(1, 1) + F12.at<float>(2, 1);
-  const float c = kp1.pt.x * F12.at<float>(0, 2) + kp1.pt.y * F12.at<float>(1, 2) + F12.at<float>(2, 2);
+  const float a = kp1.pt.x * F12(0, 0) + kp1.pt.y * F12(1, 0) + F12(2, 0);
+  const float b = kp1.pt.x * F12(0, 1) + kp1.pt.y * F12(1, 1) + F12(2, 1);
+  const float c = kp1.pt.x * F12(0, 2) + kp1.pt.y * F12(1, 2) + F12(2, 2);
 
   const float num = a * kp2.pt.x + b * kp2.pt.y + c;
 
@@ -141,25 +236,13 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF, Frame &F, vector<MapPoint *> &vpMapPo
 
   vpMapPointMatches = vector<MapPoint *>(F.N, nullptr);
 
-  const DBoW2::FeatureVector &vFeatVecKF = pKF->mFeatVec;
-
-  int nmatches = 0;
-
   vector<int> rotHist[HISTO_LENGTH];
-  for(auto & i : rotHist)
-    i.reserve(500);
   const float factor = 1.0f / HISTO_LENGTH;
 
   // We perform the matching over ORB that belong to the same vocabulary node (at a certain level)
-  auto KFit = vFeatVecKF.begin();
-  auto Fit = F.mFeatVec.begin();
-  auto KFend = vFeatVecKF.end();
-  auto Fend = F.mFeatVec.end();
-
-  while(KFit != KFend && Fit != Fend) {
-    if(KFit->first == Fit->first) {
-      const vector<unsigned int> vIndicesKF = KFit->second;
-      const vector<unsigned int> vIndicesF = Fit->second;
+  int nmatches = SearchSharedNodes(pKF->mFeatVec, F.mFeatVec, rotHist,
+    [&](const FeatureVector::Features &vIndicesKF, const FeatureVector::Features &vIndicesF, vector<size_t> &vCandidates, vector<int> *rotHistNode) {
+      int nNodeMatches = 0;
 
       for(unsigned int realIdxKF : vIndicesKF) {
         MapPoint *pMP = vpMapPointsKF[realIdxKF];
@@ -170,31 +253,20 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF, Frame &F, vector<MapPoint *> &vpMapPo
         if(pMP->isBad())
           continue;
 
-        const cv::Mat &dKF = pKF->mDescriptors.row(realIdxKF);
-
-        int bestDist1 = 256;
-        int bestIdxF = -1;
-        int bestDist2 = 256;
-
+        // Unmatched keypoints of the frame in the current node
+        vCandidates.clear();
         for(unsigned int realIdxF : vIndicesF) {
           if(vpMapPointMatches[realIdxF])
             continue;
 
-          const cv::Mat &dF = F.mDescriptors.row(realIdxF);
-
-          const int dist = DescriptorDistance(dKF, dF);
-
-          if(dist < bestDist1) {
-            bestDist2 = bestDist1;
-            bestDist1 = dist;
-            bestIdxF = realIdxF;
-          } else if(dist < bestDist2) {
-            bestDist2 = dist;
-          }
+          vCandidates.push_back(realIdxF);
         }
 
-        if(bestDist1 <= TH_LOW) {
-          if(static_cast<float>(bestDist1) < mfNNratio * static_cast<float>(bestDist2)) {
+        const HammingDistance::Best best = HammingDistance::FindBest(pKF->mDescriptors.row(realIdxKF), F.mDescriptors, vCandidates);
+        const int bestIdxF = best.idx;
+
+        if(best.dist <= TH_LOW) {
+          if(static_cast<float>(best.dist) < mfNNratio * static_cast<float>(best.dist2)) {
             vpMapPointMatches[bestIdxF] = pMP;
 
             const cv::KeyPoint &kp = pKF->mvKeysUn[realIdxKF];
@@ -207,21 +279,15 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF, Frame &F, vector<MapPoint *> &vpMapPo
               if(bin == HISTO_LENGTH)
                 bin = 0;
               assert(bin >= 0 && bin < HISTO_LENGTH);
-              rotHist[bin].push_back(bestIdxF);
+              rotHistNode[bin].push_back(bestIdxF);
             }
-            nmatches++;
+            nNodeMatches++;
           }
         }
       }
 
-      ++KFit;
-      ++Fit;
-    } else if(KFit->first < Fit->first) {
-      KFit = vFeatVecKF.lower_bound(Fit->first);
-    } else {
-      Fit = F.mFeatVec.lower_bound(KFit->first);
-    }
-  }
+      return nNodeMatches;
+    });
 
   if(mbCheckOrientation) {
     int ind1 = -1;
@@ -243,7 +309,7 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF, Frame &F, vector<MapPoint *> &vpMapPo
   return nmatches;
 }
 
-int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoints, vector<MapPoint *> &vpMatched, int th) {
+int ORBmatcher::SearchByProjection(KeyFrame *pKF, const Eigen::Matrix4f &Scw, const vector<MapPoint *> &vpPoints, vector<MapPoint *> &vpMatched, int th) {
   // Get Calibration Parameters for later projection
   const float &fx = pKF->fx;
   const float &fy = pKF->fy;
@@ -251,11 +317,11 @@ int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapP
   const float &cy = pKF->cy;
 
   // Decompose Scw
-  cv::Mat sRcw = Scw.rowRange(0, 3).colRange(0, 3);
-  const float scw = sqrt(sRcw.row(0).dot(sRcw.row(0)));
-  cv::Mat Rcw = sRcw / scw;
-  cv::Mat tcw = Scw.rowRange(0, 3).col(3) / scw;
-  cv::Mat Ow = -Rcw.t() * tcw;
+  const Eigen::Matrix3f sRcw = Scw.topLeftCorner<3, 3>();
+  const float scw = sRcw.row(0).norm();
+  const Eigen::Matrix3f Rcw = sRcw / scw;
+  const Eigen::Vector3f tcw = Scw.topRightCorner<3, 1>() / scw;
+  const Eigen::Vector3f Ow = -Rcw.transpose() * tcw;
 
   // Set of MapPoints already found in the KeyFrame
   set<MapPoint *> spAlreadyFound(vpMatched.begin(), vpMatched.end());
@@ -263,6 +329,10 @@ int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapP
 
   int nmatches = 0;
 
+  // Candidates of one query, the buffers are reused by all of them
+  vector<size_t> vIndices;
+  vector<size_t> vCandidates;
+
   // For each Candidate MapPoint Project and Match
   for(auto pMP : vpPoints) {
     // Discard Bad MapPoints and already found
@@ -270,19 +340,20 @@ int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapP
       continue;
 
     // Get 3D Coords.
-    cv::Mat p3Dw = pMP->GetWorldPos();
+    const MapPoint::PositionState position = pMP->GetPositionState();
+    const Eigen::Vector3f &p3Dw = position.worldPos;
 
     // Transform into Camera Coords.
-    cv::Mat p3Dc = Rcw * p3Dw + tcw;
+    const Eigen::Vector3f p3Dc = Rcw * p3Dw + tcw;
 
     // Depth must be positive
-    if(p3Dc.at<float>(2) < 0.0)
+    if(p3Dc(2) < 0.0)
       continue;
 
     // Project into Image
-    const float invz = 1 / p3Dc.at<float>(2);
-    const float x = p3Dc.at<float>(0) * invz;
-    const float y = p3Dc.at<float>(1) * invz;
+    const float invz = 1 / p3Dc(2);
+    const float x = p3Dc(0) * invz;
+    const float y = p3Dc(1) * invz;
 
     const float u = fx * x + cx;
     const float v = fy * y + cy;
@@ -292,18 +363,16 @@ int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapP
       continue;
 
     // Depth must be inside the scale invariance region of the point
-    const float maxDistance = pMP->GetMaxDistanceInvariance();
-    const float minDistance = pMP->GetMinDistanceInvariance();
-    cv::Mat PO = p3Dw - Ow;
-    const float dist = cv::norm(PO);
+    const float maxDistance = 1.2f * position.maxDistance;
+    const float minDistance = 0.8f * position.minDistance;
+    const Eigen::Vector3f PO = p3Dw - Ow;
+    const float dist = PO.norm();
 
     if(dist < minDistance || dist > maxDistance)
       continue;
 
     // Viewing angle must be less than 60 deg
-    cv::Mat Pn = pMP->GetNormal();
-
-    if(PO.dot(Pn) < 0.5 * dist)
+    if(PO.dot(position.normal) < 0.5 * dist)
       continue;
 
     int nPredictedLevel = pMP->PredictScale(dist, pKF);
@@ -311,16 +380,15 @@ int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapP
     // Search in a radius
     const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-    const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+    pKF->GetFeaturesInArea(u, v, radius, vIndices);
 
     if(vIndices.empty())
       continue;
 
     // Match to the most similar keypoint in the radius
-    const cv::Mat dMP = pMP->GetDescriptor();
+    const DescriptorBlock dMP = pMP->GetDescriptor();
 
-    int bestDist = 256;
-    int bestIdx = -1;
+    vCandidates.clear();
     for(unsigned long idx : vIndices) {
       if(vpMatched[idx])
         continue;
@@ -330,18 +398,13 @@ int ORBmatcher::SearchByProjection(KeyFrame *pKF, cv::Mat Scw, const vector<MapP
       if(kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
         continue;
 
-      const cv::Mat &dKF = pKF->mDescriptors.row(idx);
-
-      const int dist = DescriptorDistance(dMP, dKF);
-
-      if(dist < bestDist) {
-        bestDist = dist;
-        bestIdx = idx;
-      }
+      vCandidates.push_back(idx);
     }
 
-    if(bestDist <= TH_LOW) {
-      vpMatched[bestIdx] = pMP;
+    const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), pKF->mDescriptors, vCandidates);
+
+    if(best.dist <= TH_LOW) {
+      vpMatched[best.idx] = pMP;
       nmatches++;
     }
   }
@@ -361,27 +424,31 @@ int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f
   vector<int> vMatchedDistance(F2.mvKeysUn.size(), INT_MAX);
   vector<int> vnMatches21(F2.mvKeysUn.size(), -1);
 
+  // Candidates of one query and their distances, the buffers are reused by all of them
+  vector<size_t> vIndices2;
+  vector<int> vDistances;
+
   for(size_t i1 = 0, iend1 = F1.mvKeysUn.size(); i1 < iend1; i1++) {
     cv::KeyPoint kp1 = F1.mvKeysUn[i1];
     int level1 = kp1.octave;
     if(level1 > 0)
       continue;
 
-    vector<size_t> vIndices2 = F2.GetFeaturesInArea(vbPrevMatched[i1].x, vbPrevMatched[i1].y, windowSize, level1, level1);
+    F2.GetFeaturesInArea(vbPrevMatched[i1].x, vbPrevMatched[i1].y, windowSize, vIndices2, level1, level1);
 
     if(vIndices2.empty())
       continue;
 
-    cv::Mat d1 = F1.mDescriptors.row(i1);
+    vDistances.resize(vIndices2.size());
+    HammingDistance::Compute(F1.mDescriptors.row(i1), F2.mDescriptors, vIndices2.data(), vIndices2.size(), vDistances.data());
 
     int bestDist = INT_MAX;
     int bestDist2 = INT_MAX;
     int bestIdx2 = -1;
 
-    for(unsigned long i2 : vIndices2) {
-      cv::Mat d2 = F2.mDescriptors.row(i2);
-
-      int dist = DescriptorDistance(d1, d2);
+    for(size_t k = 0; k < vIndices2.size(); k++) {
+      const size_t i2 = vIndices2[k];
+      const int dist = vDistances[k];
 
       if(vMatchedDistance[i2] <= dist)
         continue;
@@ -449,49 +516,34 @@ int ORBmatcher::SearchForInitialization(Frame &F1, Frame &F2, vector<cv::Point2f
 
 int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &vpMatches12) {
   const vector<cv::KeyPoint> &vKeysUn1 = pKF1->mvKeysUn;
-  const DBoW2::FeatureVector &vFeatVec1 = pKF1->mFeatVec;
   const vector<MapPoint *> vpMapPoints1 = pKF1->GetMapPointMatches();
-  const cv::Mat &Descriptors1 = pKF1->mDescriptors;
+  const DescriptorArray &Descriptors1 = pKF1->mDescriptors;
 
   const vector<cv::KeyPoint> &vKeysUn2 = pKF2->mvKeysUn;
-  const DBoW2::FeatureVector &vFeatVec2 = pKF2->mFeatVec;
   const vector<MapPoint *> vpMapPoints2 = pKF2->GetMapPointMatches();
-  const cv::Mat &Descriptors2 = pKF2->mDescriptors;
+  const DescriptorArray &Descriptors2 = pKF2->mDescriptors;
 
   vpMatches12 = vector<MapPoint *>(vpMapPoints1.size(), nullptr);
-  vector<bool> vbMatched2(vpMapPoints2.size(), false);
+  // Not a vector<bool>: the nodes write their flags concurrently
+  vector<uint8_t> vbMatched2(vpMapPoints2.size(), false);
 
   vector<int> rotHist[HISTO_LENGTH];
-  for(auto & i : rotHist)
-    i.reserve(500);
-
   const float factor = 1.0f / HISTO_LENGTH;
 
-  int nmatches = 0;
-
-  auto f1it = vFeatVec1.begin();
-  auto f2it = vFeatVec2.begin();
-  auto f1end = vFeatVec1.end();
-  auto f2end = vFeatVec2.end();
-
-  while(f1it != f1end && f2it != f2end) {
-    if(f1it->first == f2it->first) {
-      for(size_t i1 = 0, iend1 = f1it->second.size(); i1 < iend1; i1++) {
-        const size_t idx1 = f1it->second[i1];
+  int nmatches = SearchSharedNodes(pKF1->mFeatVec, pKF2->mFeatVec, rotHist,
+    [&](const FeatureVector::Features &vIndices1, const FeatureVector::Features &vIndices2, vector<size_t> &vCandidates, vector<int> *rotHistNode) {
+      int nNodeMatches = 0;
 
+      for(unsigned int idx1 : vIndices1) {
         MapPoint *pMP1 = vpMapPoints1[idx1];
         if(!pMP1)
           continue;
         if(pMP1->isBad())
           continue;
 
-        const cv::Mat &d1 = Descriptors1.row(idx1);
-
-        int bestDist1 = 256;
-        int bestIdx2 = -1;
-        int bestDist2 = 256;
-
-        for(unsigned long idx2 : f2it->second) {
+        // Unmatched keypoints of the second keyframe in the current node
+        vCandidates.clear();
+        for(unsigned int idx2 : vIndices2) {
           MapPoint *pMP2 = vpMapPoints2[idx2];
 
           if(vbMatched2[idx2] || !pMP2)
@@ -500,21 +552,14 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
           if(pMP2->isBad())
             continue;
 
-          const cv::Mat &d2 = Descriptors2.row(idx2);
-
-          int dist = DescriptorDistance(d1, d2);
-
-          if(dist < bestDist1) {
-            bestDist2 = bestDist1;
-            bestDist1 = dist;
-            bestIdx2 = idx2;
-          } else if(dist < bestDist2) {
-            bestDist2 = dist;
-          }
+          vCandidates.push_back(idx2);
         }
 
-        if(bestDist1 < TH_LOW) {
-          if(static_cast<float>(bestDist1) < mfNNratio * static_cast<float>(bestDist2)) {
+        const HammingDistance::Best best = HammingDistance::FindBest(Descriptors1.row(idx1), Descriptors2, vCandidates);
+        const int bestIdx2 = best.idx;
+
+        if(best.dist < TH_LOW) {
+          if(static_cast<float>(best.dist) < mfNNratio * static_cast<float>(best.dist2)) {
             vpMatches12[idx1] = vpMapPoints2[bestIdx2];
             vbMatched2[bestIdx2] = true;
 
@@ -526,21 +571,15 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
               if(bin == HISTO_LENGTH)
                 bin = 0;
               assert(bin >= 0 && bin < HISTO_LENGTH);
-              rotHist[bin].push_back(idx1);
+              rotHistNode[bin].push_back(idx1);
             }
-            nmatches++;
+            nNodeMatches++;
           }
         }
       }
 
-      ++f1it;
-      ++f2it;
-    } else if(f1it->first < f2it->first) {
-      f1it = vFeatVec1.lower_bound(f2it->first);
-    } else {
-      f2it = vFeatVec2.lower_bound(f1it->first);
-    }
-  }
+      return nNodeMatches;
+    });
 
   if(mbCheckOrientation) {
     int ind1 = -1;
@@ -562,18 +601,17 @@ int ORBmatcher::SearchByBoW(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &
   return nmatches;
 }
 
-int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F12, vector<pair<size_t, size_t> > &vMatchedPairs, const bool bOnlyStereo) {
-  const DBoW2::FeatureVector &vFeatVec1 = pKF1->mFeatVec;
-  const DBoW2::FeatureVector &vFeatVec2 = pKF2->mFeatVec;
+int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, const Eigen::Matrix3f &F12, vector<pair<size_t, size_t> > &vMatchedPairs, const bool bOnlyStereo) {
+  const FeatureVector &vFeatVec1 = pKF1->mFeatVec;
+  const FeatureVector &vFeatVec2 = pKF2->mFeatVec;
 
   //Compute epipole in second image
-  cv::Mat Cw = pKF1->GetCameraCenter();
-  cv::Mat R2w = pKF2->GetRotation();
-  cv::Mat t2w = pKF2->GetTranslation();
-  cv::Mat C2 = R2w * Cw + t2w;
-  const float invz = 1.0f / C2.at<float>(2);
-  const float ex = pKF2->fx * C2.at<float>(0) * invz + pKF2->cx;
-  const float ey = pKF2->fy * C2.at<float>(1) * invz + pKF2->cy;
+  const Eigen::Vector3f Cw = pKF1->GetCameraCenter();
+  const Eigen::Matrix4f T2w = pKF2->GetPose();
+  const Eigen::Vector3f C2 = T2w.topLeftCorner<3, 3>() * Cw + T2w.topRightCorner<3, 1>();
+  const float invz = 1.0f / C2(2);
+  const float ex = pKF2->fx * C2(0) * invz + pKF2->cx;
+  const float ey = pKF2->fy * C2(1) * invz + pKF2->cy;
 
   // Find matches between not tracked keypoints
   // Matching speed-up by ORB Vocabulary
@@ -589,15 +627,20 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
 
   const float factor = 1.0f / HISTO_LENGTH;
 
-  auto f1it = vFeatVec1.begin();
-  auto f2it = vFeatVec2.begin();
-  auto f1end = vFeatVec1.end();
-  auto f2end = vFeatVec2.end();
+  // Keypoints of the second keyframe in the current node that can still be matched, and their distances
+  vector<size_t> vCandidates;
+  vector<int> vDistances;
+
+  size_t n1 = 0;
+  size_t n2 = 0;
 
-  while(f1it != f1end && f2it != f2end) {
-    if(f1it->first == f2it->first) {
-      for(size_t i1 = 0, iend1 = f1it->second.size(); i1 < iend1; i1++) {
-        const size_t idx1 = f1it->second[i1];
+  while(n1 < vFeatVec1.size() && n2 < vFeatVec2.size()) {
+    const FeatureVector::NodeId node1 = vFeatVec1.node(n1);
+    const FeatureVector::NodeId node2 = vFeatVec2.node(n2);
+    if(node1 == node2) {
+      const FeatureVector::Features vIndices1 = vFeatVec1.features(n1);
+      const FeatureVector::Features vIndices2 = vFeatVec2.features(n2);
+      for(const unsigned int idx1 : vIndices1) {
 
         MapPoint *pMP1 = pKF1->GetMapPoint(idx1);
 
@@ -613,31 +656,36 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
 
         const cv::KeyPoint &kp1 = pKF1->mvKeysUn[idx1];
 
-        const cv::Mat &d1 = pKF1->mDescriptors.row(idx1);
-
-        int bestDist = TH_LOW;
-        int bestIdx2 = -1;
-
-        for(unsigned long idx2 : f2it->second) {
+        vCandidates.clear();
+        for(unsigned long idx2 : vIndices2) {
           MapPoint *pMP2 = pKF2->GetMapPoint(idx2);
 
           // If we have already matched or there is a MapPoint skip
           if(vbMatched2[idx2] || pMP2)
             continue;
 
-          const bool bStereo2 = pKF2->mvuRight[idx2] >= 0;
-
           if(bOnlyStereo)
-            if(!bStereo2)
+            if(pKF2->mvuRight[idx2] < 0)
               continue;
 
-          const cv::Mat &d2 = pKF2->mDescriptors.row(idx2);
+          vCandidates.push_back(idx2);
+        }
+
+        vDistances.resize(vCandidates.size());
+        HammingDistance::Compute(pKF1->mDescriptors.row(idx1), pKF2->mDescriptors, vCandidates.data(), vCandidates.size(), vDistances.data());
+
+        int bestDist = TH_LOW;
+        int bestIdx2 = -1;
 
-          const int dist = DescriptorDistance(d1, d2);
+        for(size_t k = 0; k < vCandidates.size(); k++) {
+          const size_t idx2 = vCandidates[k];
+          const int dist = vDistances[k];
 
           if(dist > TH_LOW || dist > bestDist)
             continue;
 
+          const bool bStereo2 = pKF2->mvuRight[idx2] >= 0;
+
           const cv::KeyPoint &kp2 = pKF2->mvKeysUn[idx2];
 
           if(!bStereo1 && !bStereo2) {
@@ -671,12 +719,12 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
         }
       }
 
-      ++f1it;
-      ++f2it;
-    } else if(f1it->first < f2it->first) {
-      f1it = vFeatVec1.lower_bound(f2it->first);
+      ++n1;
+      ++n2;
+    } else if(node1 < node2) {
+      n1 = vFeatVec1.lowerBound(node2, n1);
     } else {
-      f2it = vFeatVec2.lower_bound(f1it->first);
+      n2 = vFeatVec2.lowerBound(node1, n2);
     }
   }
 
@@ -710,144 +758,189 @@ int ORBmatcher::SearchForTriangulation(KeyFrame *pKF1, KeyFrame *pKF2, cv::Mat F
 }
 
 int ORBmatcher::Fuse(KeyFrame *pKF, const vector<MapPoint *> &vpMapPoints, const float th) {
-  cv::Mat Rcw = pKF->GetRotation();
-  cv::Mat tcw = pKF->GetTranslation();
+  const KeyFrame::PoseState pose = pKF->GetPoseState();
 
-  const float &fx = pKF->fx;
-  const float &fy = pKF->fy;
-  const float &cx = pKF->cx;
-  const float &cy = pKF->cy;
-  const float &bf = pKF->mbf;
+  int nFused = 0;
+
+  // Candidates of one query, the buffers are reused by all of them
+  vector<size_t> vIndices;
+  vector<size_t> vCandidates;
+
+  for(auto pMP : vpMapPoints) {
+    const int bestIdx = SearchFuse(pKF, pose.Tcw, pose.Ow, pMP, th, vIndices, vCandidates);
+    if(bestIdx < 0)
+      continue;
+
+    ApplyFuse(pKF, pMP, bestIdx);
+    nFused++;
+  }
 
-  cv::Mat Ow = pKF->GetCameraCenter();
+  return nFused;
+}
+
+int ORBmatcher::Fuse(const vector<KeyFrame *> &vpKFs, const vector<MapPoint *> &vpMapPoints, const float th) {
+  const size_t nChunks = (vpMapPoints.size() + FUSE_CHUNK - 1) / FUSE_CHUNK;
+  const size_t nTasks = vpKFs.size() * nChunks;
+
+  // Search, one task per keyframe and chunk of map points, against the map as it is before the fuse
+  vector<vector<pair<MapPoint *, int> > > vTaskMatches(nTasks);
+
+  ParallelFor(nTasks, [&](size_t t) {
+    KeyFrame *pKF = vpKFs[t / nChunks];
+    const size_t first = (t % nChunks) * FUSE_CHUNK;
+    const size_t end = min(vpMapPoints.size(), first + FUSE_CHUNK);
+
+    const KeyFrame::PoseState pose = pKF->GetPoseState();
+
+    vector<size_t> vIndices;
+    vector<size_t> vCandidates;
+    for(size_t i = first; i < end; i++) {
+      const int bestIdx = SearchFuse(pKF, pose.Tcw, pose.Ow, vpMapPoints[i], th, vIndices, vCandidates);
+      if(bestIdx >= 0)
+        vTaskMatches[t].emplace_back(vpMapPoints[i], bestIdx);
+    }
+  });
 
+  // Apply in keyframe and map point order, as the sequential calls would. A map point replaced or
+  // added to the keyframe by an earlier match is skipped, the MapPoint of the keypoint is read again
   int nFused = 0;
+  for(size_t t = 0; t < nTasks; t++) {
+    KeyFrame *pKF = vpKFs[t / nChunks];
+    for(const auto &match : vTaskMatches[t]) {
+      MapPoint *pMP = match.first;
+      if(pMP->isBad() || pMP->IsInKeyFrame(pKF))
+        continue;
 
-  const int nMPs = vpMapPoints.size();
+      ApplyFuse(pKF, pMP, match.second);
+      nFused++;
+    }
+  }
 
-  for(int i = 0; i < nMPs; i++) {
-    MapPoint *pMP = vpMapPoints[i];
+  return nFused;
+}
 
-    if(!pMP)
-      continue;
+int ORBmatcher::SearchFuse(KeyFrame *pKF, const Eigen::Matrix4f &Tcw, const Eigen::Vector3f &Ow, MapPoint *pMP, const float th,
+                           vector<size_t> &vIndices, vector<size_t> &vCandidates) {
+  if(!pMP)
+    return -1;
 
-    if(pMP->isBad() || pMP->IsInKeyFrame(pKF))
-      continue;
+  if(pMP->isBad() || pMP->IsInKeyFrame(pKF))
+    return -1;
 
-    cv::Mat p3Dw = pMP->GetWorldPos();
-    cv::Mat p3Dc = Rcw * p3Dw + tcw;
+  const float &fx = pKF->fx;
+  const float &fy = pKF->fy;
+  const float &cx = pKF->cx;
+  const float &cy = pKF->cy;
+  const float &bf = pKF->mbf;
 
-    // Depth must be positive
-    if(p3Dc.at<float>(2) < 0.0f)
-      continue;
+  const MapPoint::PositionState position = pMP->GetPositionState();
+  const Eigen::Vector3f &p3Dw = position.worldPos;
+  const Eigen::Vector3f p3Dc = Tcw.topLeftCorner<3, 3>() * p3Dw + Tcw.topRightCorner<3, 1>();
 
-    const float invz = 1 / p3Dc.at<float>(2);
-    const float x = p3Dc.at<float>(0) * invz;
-    const float y = p3Dc.at<float>(1) * invz;
+  // Depth must be positive
+  if(p3Dc(2) < 0.0f)
+    return -1;
 
-    const float u = fx * x + cx;
-    const float v = fy * y + cy;
+  const float invz = 1 / p3Dc(2);
+  const float x = p3Dc(0) * invz;
+  const float y = p3Dc(1) * invz;
 
-    // Point must be inside the image
-    if(!pKF->IsInImage(u, v))
-      continue;
+  const float u = fx * x + cx;
+  const float v = fy * y + cy;
 
-    const float ur = u - bf * invz;
+  // Point must be inside the image
+  if(!pKF->IsInImage(u, v))
+    return -1;
 
-    const float maxDistance = pMP->GetMaxDistanceInvariance();
-    const float minDistance = pMP->GetMinDistanceInvariance();
-    cv::Mat PO = p3Dw - Ow;
-    const float dist3D = cv::norm(PO);
+  const float ur = u - bf * invz;
 
-    // Depth must be inside the scale pyramid of the image
-    if(dist3D < minDistance || dist3D > maxDistance)
-      continue;
+  const float maxDistance = 1.2f * position.maxDistance;
+  const float minDistance = 0.8f * position.minDistance;
+  const Eigen::Vector3f PO = p3Dw - Ow;
+  const float dist3D = PO.norm();
 
-    // Viewing angle must be less than 60 deg
-    cv::Mat Pn = pMP->GetNormal();
+  // Depth must be inside the scale pyramid of the image
+  if(dist3D < minDistance || dist3D > maxDistance)
+    return -1;
 
-    if(PO.dot(Pn) < 0.5 * dist3D)
-      continue;
+  // Viewing angle must be less than 60 deg
+  if(PO.dot(position.normal) < 0.5 * dist3D)
+    return -1;
 
-    int nPredictedLevel = pMP->PredictScale(dist3D, pKF);
+  int nPredictedLevel = pMP->PredictScale(dist3D, pKF);
 
-    // Search in a radius
-    const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
+  // Search in a radius
+  const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-    const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+  pKF->GetFeaturesInArea(u, v, radius, vIndices);
 
-    if(vIndices.empty())
-      continue;
+  if(vIndices.empty())
+    return -1;
 
-    // Match to the most similar keypoint in the radius
+  // Match to the most similar keypoint in the radius
 
-    const cv::Mat dMP = pMP->GetDescriptor();
+  const DescriptorBlock dMP = pMP->GetDescriptor();
 
-    int bestDist = 256;
-    int bestIdx = -1;
-    for(unsigned long idx : vIndices) {
-      const cv::KeyPoint &kp = pKF->mvKeysUn[idx];
+  vCandidates.clear();
+  for(unsigned long idx : vIndices) {
+    const cv::KeyPoint &kp = pKF->mvKeysUn[idx];
 
-      const int &kpLevel = kp.octave;
+    const int &kpLevel = kp.octave;
 
-      if(kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
+    if(kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
+      continue;
+
+    if(pKF->mvuRight[idx] >= 0) {
+      // Check reprojection error in stereo
+      const float &kpx = kp.pt.x;
+      const float &kpy = kp.pt.y;
+      const float &kpr = pKF->mvuRight[idx];
+      const float ex = u - kpx;
+      const float ey = v - kpy;
+      const float er = ur - kpr;
+      const float e2 = ex * ex + ey * ey + er * er;
+
+      if(e2 * pKF->mvInvLevelSigma2[kpLevel] > 7.8)
         continue;
+    } else {
+      const float &kpx = kp.pt.x;
+      const float &kpy = kp.pt.y;
+      const float ex = u - kpx;
+      const float ey = v - kpy;
+      const float e2 = ex * ex + ey * ey;
 
-      if(pKF->mvuRight[idx] >= 0) {
-        // Check reprojection error in stereo
-        const float &kpx = kp.pt.x;
-        const float &kpy = kp.pt.y;
-        const float &kpr = pKF->mvuRight[idx];
-        const float ex = u - kpx;
-        const float ey = v - kpy;
-        const float er = ur - kpr;
-        const float e2 = ex * ex + ey * ey + er * er;
-
-        if(e2 * pKF->mvInvLevelSigma2[kpLevel] > 7.8)
-          continue;
-      } else {
-        const float &kpx = kp.pt.x;
-        const float &kpy = kp.pt.y;
-        const float ex = u - kpx;
-        const float ey = v - kpy;
-        const float e2 = ex * ex + ey * ey;
+      if(e2 * pKF->mvInvLevelSigma2[kpLevel] > 5.99)
+        continue;
+    }
 
-        if(e2 * pKF->mvInvLevelSigma2[kpLevel] > 5.99)
-          continue;
-      }
+    vCandidates.push_back(idx);
+  }
 
-      const cv::Mat &dKF = pKF->mDescriptors.row(idx);
+  const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), pKF->mDescriptors, vCandidates);
 
-      const int dist = DescriptorDistance(dMP, dKF);
+  if(best.dist > TH_LOW)
+    return -1;
 
-      if(dist < bestDist) {
-        bestDist = dist;
-        bestIdx = idx;
-      }
-    }
+  return best.idx;
+}
 
-    // If there is already a MapPoint replace otherwise add new measurement
-    if(bestDist <= TH_LOW) {
-      MapPoint *pMPinKF = pKF->GetMapPoint(bestIdx);
-      if(pMPinKF) {
-        if(!pMPinKF->isBad()) {
-          if(pMPinKF->Observations() > pMP->Observations())
-            pMP->Replace(pMPinKF);
-          else
-            pMPinKF->Replace(pMP);
-        }
-      } else {
-        pMP->AddObservation(pKF, bestIdx);
-        pKF->AddMapPoint(pMP, bestIdx);
-      }
-      nFused++;
+void ORBmatcher::ApplyFuse(KeyFrame *pKF, MapPoint *pMP, const int bestIdx) {
+  // If there is already a MapPoint replace otherwise add new measurement
+  MapPoint *pMPinKF = pKF->GetMapPoint(bestIdx);
+  if(pMPinKF) {
+    if(!pMPinKF->isBad()) {
+      if(pMPinKF->Observations() > pMP->Observations())
+        pMP->Replace(pMPinKF);
+      else
+        pMPinKF->Replace(pMP);
     }
+  } else {
+    pMP->AddObservation(pKF, bestIdx);
+    pKF->AddMapPoint(pMP, bestIdx);
   }
-
-  return nFused;
 }
 
-int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoints, float th, vector<MapPoint *> &vpReplacePoint) {
+int ORBmatcher::Fuse(KeyFrame *pKF, const Eigen::Matrix4f &Scw, const vector<MapPoint *> &vpPoints, float th, vector<MapPoint *> &vpReplacePoint) {
   // Get Calibration Parameters for later projection
   const float &fx = pKF->fx;
   const float &fy = pKF->fy;
@@ -855,11 +948,11 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
   const float &cy = pKF->cy;
 
   // Decompose Scw
-  cv::Mat sRcw = Scw.rowRange(0, 3).colRange(0, 3);
-  const float scw = sqrt(sRcw.row(0).dot(sRcw.row(0)));
-  cv::Mat Rcw = sRcw / scw;
-  cv::Mat tcw = Scw.rowRange(0, 3).col(3) / scw;
-  cv::Mat Ow = -Rcw.t() * tcw;
+  const Eigen::Matrix3f sRcw = Scw.topLeftCorner<3, 3>();
+  const float scw = sRcw.row(0).norm();
+  const Eigen::Matrix3f Rcw = sRcw / scw;
+  const Eigen::Vector3f tcw = Scw.topRightCorner<3, 1>() / scw;
+  const Eigen::Vector3f Ow = -Rcw.transpose() * tcw;
 
   // Set of MapPoints already found in the KeyFrame
   const set<MapPoint *> spAlreadyFound = pKF->GetMapPoints();
@@ -868,6 +961,10 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
 
   const int nPoints = vpPoints.size();
 
+  // Candidates of one query, the buffers are reused by all of them
+  vector<size_t> vIndices;
+  vector<size_t> vCandidates;
+
   // For each candidate MapPoint project and match
   for(int iMP = 0; iMP < nPoints; iMP++) {
     MapPoint *pMP = vpPoints[iMP];
@@ -877,19 +974,20 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
       continue;
 
     // Get 3D Coords.
-    cv::Mat p3Dw = pMP->GetWorldPos();
+    const MapPoint::PositionState position = pMP->GetPositionState();
+    const Eigen::Vector3f &p3Dw = position.worldPos;
 
     // Transform into Camera Coords.
-    cv::Mat p3Dc = Rcw * p3Dw + tcw;
+    const Eigen::Vector3f p3Dc = Rcw * p3Dw + tcw;
 
     // Depth must be positive
-    if(p3Dc.at<float>(2) < 0.0f)
+    if(p3Dc(2) < 0.0f)
       continue;
 
     // Project into Image
-    const float invz = 1.0F / p3Dc.at<float>(2);
-    const float x = p3Dc.at<float>(0) * invz;
-    const float y = p3Dc.at<float>(1) * invz;
+    const float invz = 1.0F / p3Dc(2);
+    const float x = p3Dc(0) * invz;
+    const float y = p3Dc(1) * invz;
 
     const float u = fx * x + cx;
     const float v = fy * y + cy;
@@ -899,18 +997,16 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
       continue;
 
     // Depth must be inside the scale pyramid of the image
-    const float maxDistance = pMP->GetMaxDistanceInvariance();
-    const float minDistance = pMP->GetMinDistanceInvariance();
-    cv::Mat PO = p3Dw - Ow;
-    const float dist3D = cv::norm(PO);
+    const float maxDistance = 1.2f * position.maxDistance;
+    const float minDistance = 0.8f * position.minDistance;
+    const Eigen::Vector3f PO = p3Dw - Ow;
+    const float dist3D = PO.norm();
 
     if(dist3D < minDistance || dist3D > maxDistance)
       continue;
 
     // Viewing angle must be less than 60 deg
-    cv::Mat Pn = pMP->GetNormal();
-
-    if(PO.dot(Pn) < 0.5 * dist3D)
+    if(PO.dot(position.normal) < 0.5 * dist3D)
       continue;
 
     // Compute predicted scale level
@@ -919,33 +1015,29 @@ int ORBmatcher::Fuse(KeyFrame *pKF, cv::Mat Scw, const vector<MapPoint *> &vpPoi
     // Search in a radius
     const float radius = th * pKF->mvScaleFactors[nPredictedLevel];
 
-    const vector<size_t> vIndices = pKF->GetFeaturesInArea(u, v, radius);
+    pKF->GetFeaturesInArea(u, v, radius, vIndices);
 
     if(vIndices.empty())
       continue;
 
     // Match to the most similar keypoint in the radius
 
-    const cv::Mat dMP = pMP->GetDescriptor();
+    const DescriptorBlock dMP = pMP->GetDescriptor();
 
-    int bestDist = INT_MAX;
-    int bestIdx = -1;
+    vCandidates.clear();
     for(unsigned long idx : vIndices) {
       const int &kpLevel = pKF->mvKeysUn[idx].octave;
 
       if(kpLevel < nPredictedLevel - 1 || kpLevel > nPredictedLevel)
         continue;
 
-      const cv::Mat &dKF = pKF->mDescriptors.row(idx);
-
-      int dist = DescriptorDistance(dMP, dKF);
-
-      if(dist < bestDist) {
-        bestDist = dist;
-        bestIdx = idx;
-      }
+      vCandidates.push_back(idx);
     }
 
+    const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), pKF->mDescriptors, vCandidates);
+    const int bestDist = best.dist;
+    const int bestIdx = best.idx;
+
     // If there is already a MapPoint replace otherwise add new measurement
     if(bestDist <= TH_LOW) {
       MapPoint *pMPinKF = pKF->GetMapPoint(bestIdx);
@@ -967,8 +1059,8 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
                              KeyFrame *pKF2,
                              vector<MapPoint *> &vpMatches12,
                              const float &s12,
-                             const cv::Mat &R12,
-                             const cv::Mat &t12,
+                             const Eigen::Matrix3f &R12,
+                             const Eigen::Vector3f &t12,
                              const float th) {
   const float &fx = pKF1->fx;
   const float &fy = pKF1->fy;
@@ -976,17 +1068,19 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
   const float &cy = pKF1->cy;
 
   // Camera 1 from world
-  cv::Mat R1w = pKF1->GetRotation();
-  cv::Mat t1w = pKF1->GetTranslation();
+  const Eigen::Matrix4f T1w = pKF1->GetPose();
+  const Eigen::Matrix3f R1w = T1w.topLeftCorner<3, 3>();
+  const Eigen::Vector3f t1w = T1w.topRightCorner<3, 1>();
 
   //Camera 2 from world
-  cv::Mat R2w = pKF2->GetRotation();
-  cv::Mat t2w = pKF2->GetTranslation();
+  const Eigen::Matrix4f T2w = pKF2->GetPose();
+  const Eigen::Matrix3f R2w = T2w.topLeftCorner<3, 3>();
+  const Eigen::Vector3f t2w = T2w.topRightCorner<3, 1>();
 
   //Transformation between cameras
-  cv::Mat sR12 = s12 * R12;
-  cv::Mat sR21 = (1.0 / s12) * R12.t();
-  cv::Mat t21 = -sR21 * t12;
+  const Eigen::Matrix3f sR12 = s12 * R12;
+  const Eigen::Matrix3f sR21 = (1.0f / s12) * R12.transpose();
+  const Eigen::Vector3f t21 = -sR21 * t12;
 
   const vector<MapPoint *> vpMapPoints1 = pKF1->GetMapPointMatches();
   const int N1 = vpMapPoints1.size();
@@ -1010,6 +1104,10 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
   vector<int> vnMatch1(N1, -1);
   vector<int> vnMatch2(N2, -1);
 
+  // Candidates of one query, the buffers are reused by all of them
+  vector<size_t> vIndices;
+  vector<size_t> vCandidates;
+
   // Transform from KF1 to KF2 and search
   for(int i1 = 0; i1 < N1; i1++) {
     MapPoint *pMP = vpMapPoints1[i1];
@@ -1020,17 +1118,17 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
     if(pMP->isBad())
       continue;
 
-    cv::Mat p3Dw = pMP->GetWorldPos();
-    cv::Mat p3Dc1 = R1w * p3Dw + t1w;
-    cv::Mat p3Dc2 = sR21 * p3Dc1 + t21;
+    const Eigen::Vector3f p3Dw = pMP->GetWorldPos();
+    const Eigen::Vector3f p3Dc1 = R1w * p3Dw + t1w;
+    const Eigen::Vector3f p3Dc2 = sR21 * p3Dc1 + t21;
 
     // Depth must be positive
-    if(p3Dc2.at<float>(2) < 0.0)
+    if(p3Dc2(2) < 0.0)
       continue;
 
-    const float invz = 1.0F / p3Dc2.at<float>(2);
-    const float x = p3Dc2.at<float>(0) * invz;
-    const float y = p3Dc2.at<float>(1) * invz;
+    const float invz = 1.0F / p3Dc2(2);
+    const float x = p3Dc2(0) * invz;
+    const float y = p3Dc2(1) * invz;
 
     const float u = fx * x + cx;
     const float v = fy * y + cy;
@@ -1041,7 +1139,7 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
 
     const float maxDistance = pMP->GetMaxDistanceInvariance();
     const float minDistance = pMP->GetMinDistanceInvariance();
-    const float dist3D = cv::norm(p3Dc2);
+    const float dist3D = p3Dc2.norm();
 
     // Depth must be inside the scale invariance region
     if(dist3D < minDistance || dist3D > maxDistance)
@@ -1053,34 +1151,28 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
     // Search in a radius
     const float radius = th * pKF2->mvScaleFactors[nPredictedLevel];
 
-    const vector<size_t> vIndices = pKF2->GetFeaturesInArea(u, v, radius);
+    pKF2->GetFeaturesInArea(u, v, radius, vIndices);
 
     if(vIndices.empty())
       continue;
 
     // Match to the most similar keypoint in the radius
-    const cv::Mat dMP = pMP->GetDescriptor();
+    const DescriptorBlock dMP = pMP->GetDescriptor();
 
-    int bestDist = INT_MAX;
-    int bestIdx = -1;
+    vCandidates.clear();
     for(unsigned long idx : vIndices) {
       const cv::KeyPoint &kp = pKF2->mvKeysUn[idx];
 
       if(kp.octave < nPredictedLevel - 1 || kp.octave > nPredictedLevel)
         continue;
 
-      const cv::Mat &dKF = pKF2->mDescriptors.row(idx);
-
-      const int dist = DescriptorDistance(dMP, dKF);
-
-      if(dist < bestDist) {
-        bestDist = dist;
-        bestIdx = idx;
-      }
+      vCandidates.push_back(idx);
     }
 
-    if(bestDist <= TH_HIGH) {
-      vnMatch1[i1] = bestIdx;
+    const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), pKF2->mDescriptors, vCandidates);
+
+    if(best.dist <= TH_HIGH) {
+      vnMatch1[i1] = best.idx;
     }
   }
 
@@ -1094,17 +1186,17 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
     if(pMP->isBad())
       continue;
 
-    cv::Mat p3Dw = pMP->GetWorldPos();
-    cv::Mat p3Dc2 = R2w * p3Dw + t2w;
-    cv::Mat p3Dc1 = sR12 * p3Dc2 + t12;
+    const Eigen::Vector3f p3Dw = pMP->GetWorldPos();
+    const Eigen::Vector3f p3Dc2 = R2w * p3Dw + t2w;
+    const Eigen::Vector3f p3Dc1 = sR12 * p3Dc2 + t12;
 
     // Depth must be positive
-    if(p3Dc1.at<float>(2) < 0.0)
+    if(p3Dc1(2) < 0.0)
       continue;
 
-    const float invz = 1.0F / p3Dc1.at<float>(2);
-    const float x = p3Dc1.at<float>(0) * invz;
-    const float y = p3Dc1.at<float>(1) * invz;
+    const float invz = 1.0F / p3Dc1(2);
+    const float x = p3Dc1(0) * invz;
+    const float y = p3Dc1(1) * invz;
 
     const float u = fx * x + cx;
     const float v = fy * y + cy;
@@ -1115,7 +1207,7 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
 
     const float maxDistance = pMP->GetMaxDistanceInvariance();
     const float minDistance = pMP->GetMinDistanceInvariance();
-    const float dist3D = cv::norm(p3Dc1);
+    const float dist3D = p3Dc1.norm();
 
     // Depth must be inside the scale pyramid of the image
     if(dist3D < minDistance || dist3D > maxDistance)
@@ -1127,34 +1219,28 @@ int ORBmatcher::SearchBySim3(KeyFrame *pKF1,
     // Search in a radius of 2.5*sigma(ScaleLevel)
     const float radius = th * pKF1->mvScaleFactors[nPredictedLevel];
 
-    const vector<size_t> vIndices = pKF1->GetFeaturesInArea(u, v, radius);
+    pKF1->GetFeaturesInArea(u, v, radius, vIndices);
 
     if(vIndices.empty())
       continue;
 
     // Match to the most similar keypoint in the radius
-    const cv::Mat dMP = pMP->GetDescriptor();
+    const DescriptorBlock dMP = pMP->GetDescriptor();
 
-    int bestDist = INT_MAX;
-    int bestIdx = -1;
+    vCandidates.clear();
     for(unsigned long idx : vIndices) {
       const cv::KeyPoint &kp = pKF1->mvKeysUn[idx];
 
       if(kp.octave < nPredictedLevel - 1 || kp.octave > nPredictedLevel)
         continue;
 
-      const cv::Mat &dKF = pKF1->mDescriptors.row(idx);
-
-      const int dist = DescriptorDistance(dMP, dKF);
-
-      if(dist < bestDist) {
-        bestDist = dist;
-        bestIdx = idx;
-      }
+      vCandidates.push_back(idx);
     }
 
-    if(bestDist <= TH_HIGH) {
-      vnMatch2[i2] = bestIdx;
+    const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), pKF1->mDescriptors, vCandidates);
+
+    if(best.dist <= TH_HIGH) {
+      vnMatch2[i2] = best.idx;
     }
   }
 
@@ -1185,18 +1271,22 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
     i.reserve(500);
   const float factor = 1.0f / HISTO_LENGTH;
 
-  const cv::Mat Rcw = CurrentFrame.mTcw.rowRange(0, 3).colRange(0, 3);
-  const cv::Mat tcw = CurrentFrame.mTcw.rowRange(0, 3).col(3);
+  const Eigen::Matrix3f Rcw = CurrentFrame.mTcw.topLeftCorner<3, 3>();
+  const Eigen::Vector3f tcw = CurrentFrame.mTcw.topRightCorner<3, 1>();
 
-  const cv::Mat twc = -Rcw.t() * tcw;
+  const Eigen::Vector3f twc = -Rcw.transpose() * tcw;
 
-  const cv::Mat Rlw = LastFrame.mTcw.rowRange(0, 3).colRange(0, 3);
-  const cv::Mat tlw = LastFrame.mTcw.rowRange(0, 3).col(3);
+  const Eigen::Matrix3f Rlw = LastFrame.mTcw.topLeftCorner<3, 3>();
+  const Eigen::Vector3f tlw = LastFrame.mTcw.topRightCorner<3, 1>();
 
-  const cv::Mat tlc = Rlw * twc + tlw;
+  const Eigen::Vector3f tlc = Rlw * twc + tlw;
 
-  const bool bForward = tlc.at<float>(2) > CurrentFrame.mb && !bMono;
-  const bool bBackward = -tlc.at<float>(2) > CurrentFrame.mb && !bMono;
+  const bool bForward = tlc(2) > CurrentFrame.mb && !bMono;
+  const bool bBackward = -tlc(2) > CurrentFrame.mb && !bMono;
+
+  // Candidates of one query, the buffers are reused by all of them
+  vector<size_t> vIndices2;
+  vector<size_t> vCandidates;
 
   for(int i = 0; i < LastFrame.N; i++) {
     MapPoint *pMP = LastFrame.mvpMapPoints[i];
@@ -1204,12 +1294,12 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
     if(pMP) {
       if(!LastFrame.mvbOutlier[i]) {
         // Project
-        cv::Mat x3Dw = pMP->GetWorldPos();
-        cv::Mat x3Dc = Rcw * x3Dw + tcw;
+        const Eigen::Vector3f x3Dw = pMP->GetPositionState().worldPos;
+        const Eigen::Vector3f x3Dc = Rcw * x3Dw + tcw;
 
-        const float xc = x3Dc.at<float>(0);
-        const float yc = x3Dc.at<float>(1);
-        const float invzc = 1.0 / x3Dc.at<float>(2);
+        const float xc = x3Dc(0);
+        const float yc = x3Dc(1);
+        const float invzc = 1.0f / x3Dc(2);
 
         if(invzc < 0)
           continue;
@@ -1227,23 +1317,19 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
         // Search in a window. Size depends on scale
         float radius = th * CurrentFrame.mvScaleFactors[nLastOctave];
 
-        vector<size_t> vIndices2;
-
         if(bForward)
-          vIndices2 = CurrentFrame.GetFeaturesInArea(u, v, radius, nLastOctave);
+          CurrentFrame.GetFeaturesInArea(u, v, radius, vIndices2, nLastOctave);
         else if(bBackward)
-          vIndices2 = CurrentFrame.GetFeaturesInArea(u, v, radius, 0, nLastOctave);
+          CurrentFrame.GetFeaturesInArea(u, v, radius, vIndices2, 0, nLastOctave);
         else
-          vIndices2 = CurrentFrame.GetFeaturesInArea(u, v, radius, nLastOctave - 1, nLastOctave + 1);
+          CurrentFrame.GetFeaturesInArea(u, v, radius, vIndices2, nLastOctave - 1, nLastOctave + 1);
 
         if(vIndices2.empty())
           continue;
 
-        const cv::Mat dMP = pMP->GetDescriptor();
-
-        int bestDist = 256;
-        int bestIdx2 = -1;
+        const DescriptorBlock dMP = pMP->GetDescriptor();
 
+        vCandidates.clear();
         for(unsigned long i2 : vIndices2) {
           if(CurrentFrame.mvpMapPoints[i2])
             if(CurrentFrame.mvpMapPoints[i2]->Observations() > 0)
@@ -1256,17 +1342,13 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
               continue;
           }
 
-          const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
-
-          const int dist = DescriptorDistance(dMP, d);
-
-          if(dist < bestDist) {
-            bestDist = dist;
-            bestIdx2 = i2;
-          }
+          vCandidates.push_back(i2);
         }
 
-        if(bestDist <= TH_HIGH) {
+        const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), CurrentFrame.mDescriptors, vCandidates);
+        const int bestIdx2 = best.idx;
+
+        if(best.dist <= TH_HIGH) {
           CurrentFrame.mvpMapPoints[bestIdx2] = pMP;
           nmatches++;
 
@@ -1309,9 +1391,9 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, const Frame &LastFrame,
 int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set<MapPoint *> &sAlreadyFound, const float th, const int ORBdist) {
   int nmatches = 0;
 
-  const cv::Mat Rcw = CurrentFrame.mTcw.rowRange(0, 3).colRange(0, 3);
-  const cv::Mat tcw = CurrentFrame.mTcw.rowRange(0, 3).col(3);
-  const cv::Mat Ow = -Rcw.t() * tcw;
+  const Eigen::Matrix3f Rcw = CurrentFrame.mTcw.topLeftCorner<3, 3>();
+  const Eigen::Vector3f tcw = CurrentFrame.mTcw.topRightCorner<3, 1>();
+  const Eigen::Vector3f Ow = -Rcw.transpose() * tcw;
 
   // Rotation Histogram (to check rotation consistency)
   vector<int> rotHist[HISTO_LENGTH];
@@ -1321,18 +1403,22 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
 
   const vector<MapPoint *> vpMPs = pKF->GetMapPointMatches();
 
+  // Candidates of one query, the buffers are reused by all of them
+  vector<size_t> vIndices2;
+  vector<size_t> vCandidates;
+
   for(size_t i = 0, iend = vpMPs.size(); i < iend; i++) {
     MapPoint *pMP = vpMPs[i];
 
     if(pMP) {
       if(!pMP->isBad() && !sAlreadyFound.count(pMP)) {
         //Project
-        cv::Mat x3Dw = pMP->GetWorldPos();
-        cv::Mat x3Dc = Rcw * x3Dw + tcw;
+        const Eigen::Vector3f x3Dw = pMP->GetPositionState().worldPos;
+        const Eigen::Vector3f x3Dc = Rcw * x3Dw + tcw;
 
-        const float xc = x3Dc.at<float>(0);
-        const float yc = x3Dc.at<float>(1);
-        const float invzc = 1.0 / x3Dc.at<float>(2);
+        const float xc = x3Dc(0);
+        const float yc = x3Dc(1);
+        const float invzc = 1.0f / x3Dc(2);
 
         const float u = CurrentFrame.fx * xc * invzc + CurrentFrame.cx;
         const float v = CurrentFrame.fy * yc * invzc + CurrentFrame.cy;
@@ -1343,8 +1429,7 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
           continue;
 
         // Compute predicted scale level
-        cv::Mat PO = x3Dw - Ow;
-        float dist3D = cv::norm(PO);
+        const float dist3D = (x3Dw - Ow).norm();
 
         const float maxDistance = pMP->GetMaxDistanceInvariance();
         const float minDistance = pMP->GetMinDistanceInvariance();
@@ -1358,31 +1443,25 @@ int ORBmatcher::SearchByProjection(Frame &CurrentFrame, KeyFrame *pKF, const set
         // Search in a window
         const float radius = th * CurrentFrame.mvScaleFactors[nPredictedLevel];
 
-        const vector<size_t> vIndices2 = CurrentFrame.GetFeaturesInArea(u, v, radius, nPredictedLevel - 1, nPredictedLevel + 1);
+        CurrentFrame.GetFeaturesInArea(u, v, radius, vIndices2, nPredictedLevel - 1, nPredictedLevel + 1);
 
         if(vIndices2.empty())
           continue;
 
-        const cv::Mat dMP = pMP->GetDescriptor();
-
-        int bestDist = 256;
-        int bestIdx2 = -1;
+        const DescriptorBlock dMP = pMP->GetDescriptor();
 
+        vCandidates.clear();
         for(unsigned long i2 : vIndices2) {
           if(CurrentFrame.mvpMapPoints[i2])
             continue;
 
-          const cv::Mat &d = CurrentFrame.mDescriptors.row(i2);
-
-          const int dist = DescriptorDistance(dMP, d);
-
-          if(dist < bestDist) {
-            bestDist = dist;
-            bestIdx2 = i2;
-          }
+          vCandidates.push_back(i2);
         }
 
-        if(bestDist <= ORBdist) {
+        const HammingDistance::Best best = HammingDistance::FindBest(dMP.data(), CurrentFrame.mDescriptors, vCandidates);
+        const int bestIdx2 = best.idx;
+
+        if(best.dist <= ORBdist) {
           CurrentFrame.mvpMapPoints[bestIdx2] = pMP;
           nmatches++;
 
@@ -1454,22 +1533,8 @@ void ORBmatcher::ComputeThreeMaxima(vector<int> *histo, const int L, int &ind1,
   }
 }
 
-// Bit set count operation from
-// http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
 int ORBmatcher::DescriptorDistance(const cv::Mat &a, const cv::Mat &b) {
-  const int *pa = a.ptr<int32_t>();
-  const int *pb = b.ptr<int32_t>();
-
-  int dist = 0;
-
-  for(int i = 0; i < 8; i++, pa++, pb++) {
-    unsigned int v = *pa ^ *pb;
-    v = v - ((v >> 1) & 0x55555555);
-    v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
-    dist += (((v + (v >> 4)) & 0xF0F0F0F) * 0x1010101) >> 24;
-  }
-
-  return dist;
+  return HammingDistance::Distance(a.ptr<uint8_t>(), b.ptr<uint8_t>());
 }
 
 }  // namespace ORB_SLAM2
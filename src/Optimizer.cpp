@@ -91,17 +91,17 @@ void BundleAdjustment(const vector<KeyFrame *> &vpKFs,
     if(pMP->isBad())
       continue;
     g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-    vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+    vPoint->setEstimate(pMP->GetWorldPos().cast<double>());
     const int id = pMP->mnId + maxKFid + 1;
     vPoint->setId(id);
     vPoint->setMarginalized(true);
     optimizer.addVertex(vPoint);
 
-    const map<KeyFrame *, size_t> observations = pMP->GetObservations();
+    const ObservationList observations = pMP->GetObservations();
 
     int nEdges = 0;
     //SET EDGES
-    for(map<KeyFrame *, size_t>::const_iterator mit = observations.begin(); mit != observations.end(); ++mit) {
+    for(ObservationList::const_iterator mit = observations.begin(); mit != observations.end(); ++mit) {
 
       KeyFrame *pKF = mit->first;
       if(pKF->isBad() || pKF->mnId > maxKFid)
@@ -187,10 +187,9 @@ void BundleAdjustment(const vector<KeyFrame *> &vpKFs,
     g2o::VertexSE3Expmap *vSE3 = static_cast<g2o::VertexSE3Expmap *>(optimizer.vertex(pKF->mnId));
     g2o::SE3Quat SE3quat = vSE3->estimate();
     if(nLoopKF == 0) {
-      pKF->SetPose(Converter::toCvMat(SE3quat));
+      pKF->SetPose(Converter::toMatrix4f(SE3quat));
     } else {
-      pKF->mTcwGBA.create(4, 4, CV_32F);
-      Converter::toCvMat(SE3quat).copyTo(pKF->mTcwGBA);
+      pKF->mTcwGBA = Converter::toMatrix4f(SE3quat);
       pKF->mnBAGlobalForKF = nLoopKF;
     }
   }
@@ -207,11 +206,10 @@ void BundleAdjustment(const vector<KeyFrame *> &vpKFs,
     g2o::VertexSBAPointXYZ *vPoint = static_cast<g2o::VertexSBAPointXYZ *>(optimizer.vertex(pMP->mnId + maxKFid + 1));
 
     if(nLoopKF == 0) {
-      pMP->SetWorldPos(Converter::toCvMat(vPoint->estimate()));
+      pMP->SetWorldPos(vPoint->estimate().cast<float>());
       pMP->UpdateNormalAndDepth();
     } else {
-      pMP->mPosGBA.create(3, 1, CV_32F);
-      Converter::toCvMat(vPoint->estimate()).copyTo(pMP->mPosGBA);
+      pMP->mPosGBA = vPoint->estimate().cast<float>();
       pMP->mnBAGlobalForKF = nLoopKF;
     }
   }
@@ -283,10 +281,7 @@ int PoseOptimization(Frame *pFrame) {
           e->fy = pFrame->fy;
           e->cx = pFrame->cx;
           e->cy = pFrame->cy;
-          cv::Mat Xw = pMP->GetWorldPos();
-          e->Xw[0] = Xw.at<float>(0);
-          e->Xw[1] = Xw.at<float>(1);
-          e->Xw[2] = Xw.at<float>(2);
+          e->Xw = pMP->GetWorldPos().cast<double>();
 
           optimizer.addEdge(e);
 
@@ -320,10 +315,7 @@ int PoseOptimization(Frame *pFrame) {
           e->cx = pFrame->cx;
           e->cy = pFrame->cy;
           e->bf = pFrame->mbf;
-          cv::Mat Xw = pMP->GetWorldPos();
-          e->Xw[0] = Xw.at<float>(0);
-          e->Xw[1] = Xw.at<float>(1);
-          e->Xw[2] = Xw.at<float>(2);
+          e->Xw = pMP->GetWorldPos().cast<double>();
 
           optimizer.addEdge(e);
 
@@ -408,8 +400,7 @@ int PoseOptimization(Frame *pFrame) {
   // Recover optimized pose and return number of inliers
   g2o::VertexSE3Expmap *vSE3_recov = static_cast<g2o::VertexSE3Expmap *>(optimizer.vertex(0));
   g2o::SE3Quat SE3quat_recov = vSE3_recov->estimate();
-  cv::Mat pose = Converter::toCvMat(SE3quat_recov);
-  pFrame->SetPose(pose);
+  pFrame->SetPose(Converter::toMatrix4f(SE3quat_recov));
 
   return nInitialCorrespondences - nBad;
 }
@@ -447,8 +438,8 @@ void LocalBundleAdjustment(KeyFrame *pKF, bool *pbStopFlag, Map *pMap) {
   // Fixed Keyframes. Keyframes that see Local MapPoints but that are not Local Keyframes
   list<KeyFrame *> lFixedCameras;
   for(list<MapPoint *>::iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end(); lit != lend; ++lit) {
-    map<KeyFrame *, size_t> observations = (*lit)->GetObservations();
-    for(map<KeyFrame *, size_t>::iterator mit = observations.begin(), mend = observations.end(); mit != mend; ++mit) {
+    ObservationList observations = (*lit)->GetObservations();
+    for(ObservationList::const_iterator mit = observations.begin(), mend = observations.end(); mit != mend; ++mit) {
       KeyFrame *pKFi = mit->first;
 
       if(pKFi->mnBALocalForKF != pKF->mnId && pKFi->mnBAFixedForKF != pKF->mnId) {
@@ -526,16 +517,16 @@ void LocalBundleAdjustment(KeyFrame *pKF, bool *pbStopFlag, Map *pMap) {
   for(list<MapPoint *>::iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end(); lit != lend; ++lit) {
     MapPoint *pMP = *lit;
     g2o::VertexSBAPointXYZ *vPoint = new g2o::VertexSBAPointXYZ();
-    vPoint->setEstimate(Converter::toVector3d(pMP->GetWorldPos()));
+    vPoint->setEstimate(pMP->GetWorldPos().cast<double>());
     int id = pMP->mnId + maxKFid + 1;
     vPoint->setId(id);
     vPoint->setMarginalized(true);
     optimizer.addVertex(vPoint);
 
-    const map<KeyFrame *, size_t> observations = pMP->GetObservations();
+    const ObservationList observations = pMP->GetObservations();
 
     //Set edges
-    for(map<KeyFrame *, size_t>::const_iterator mit = observations.begin(), mend = observations.end(); mit != mend; ++mit) {
+    for(ObservationList::const_iterator mit = observations.begin(), mend = observations.end(); mit != mend; ++mit) {
       KeyFrame *pKFi = mit->first;
 
       if(!pKFi->isBad()) {
@@ -700,14 +691,14 @@ void LocalBundleAdjustment(KeyFrame *pKF, bool *pbStopFlag, Map *pMap) {
     KeyFrame *pKeyFrame = *lit;
     g2o::VertexSE3Expmap *vSE3 = static_cast<g2o::VertexSE3Expmap *>(optimizer.vertex(pKeyFrame->mnId));
     g2o::SE3Quat SE3quat = vSE3->estimate();
-    pKeyFrame->SetPose(Converter::toCvMat(SE3quat));
+    pKeyFrame->SetPose(Converter::toMatrix4f(SE3quat));
   }
 
   //Points
   for(list<MapPoint *>::iterator lit = lLocalMapPoints.begin(), lend = lLocalMapPoints.end(); lit != lend; ++lit) {
     MapPoint *pMP = *lit;
     g2o::VertexSBAPointXYZ *vPoint = static_cast<g2o::VertexSBAPointXYZ *>(optimizer.vertex(pMP->mnId + maxKFid + 1));
-    pMP->SetWorldPos(Converter::toCvMat(vPoint->estimate()));
+    pMP->SetWorldPos(vPoint->estimate().cast<float>());
     pMP->UpdateNormalAndDepth();
   }
 }
@@ -755,9 +746,8 @@ void OptimizeEssentialGraph(Map *pMap,
       vScw[nIDi] = it->second;
       VSim3->setEstimate(it->second);
     } else {
-      Eigen::Matrix<double, 3, 3> Rcw = Converter::toMatrix3d(pKF->GetRotation());
-      Eigen::Matrix<double, 3, 1> tcw = Converter::toVector3d(pKF->GetTranslation());
-      g2o::Sim3 Siw(Rcw, tcw, 1.0);
+      const Eigen::Matrix4f Tcw = pKF->GetPose();
+      g2o::Sim3 Siw(Tcw.topLeftCorner<3, 3>().cast<double>(), Tcw.topRightCorner<3, 1>().cast<double>(), 1.0);
       vScw[nIDi] = Siw;
       VSim3->setEstimate(Siw);
     }
@@ -924,7 +914,9 @@ void OptimizeEssentialGraph(Map *pMap,
 
     eigt *= (1. / s);  //[R t/s;0 1]
 
-    cv::Mat Tiw = Converter::toCvSE3(eigR, eigt);
+    Eigen::Matrix4f Tiw = Eigen::Matrix4f::Identity();
+    Tiw.topLeftCorner<3, 3>() = eigR.cast<float>();
+    Tiw.topRightCorner<3, 1>() = eigt.cast<float>();
 
     pKFi->SetPose(Tiw);
   }
@@ -947,12 +939,10 @@ void OptimizeEssentialGraph(Map *pMap,
     g2o::Sim3 Srw = vScw[nIDr];
     g2o::Sim3 correctedSwr = vCorrectedSwc[nIDr];
 
-    cv::Mat P3Dw = pMP->GetWorldPos();
-    Eigen::Matrix<double, 3, 1> eigP3Dw = Converter::toVector3d(P3Dw);
-    Eigen::Matrix<double, 3, 1> eigCorrectedP3Dw = correctedSwr.map(Srw.map(eigP3Dw));
+    const Eigen::Vector3d eigP3Dw = pMP->GetWorldPos().cast<double>();
+    const Eigen::Vector3d eigCorrectedP3Dw = correctedSwr.map(Srw.map(eigP3Dw));
 
-    cv::Mat cvCorrectedP3Dw = Converter::toCvMat(eigCorrectedP3Dw);
-    pMP->SetWorldPos(cvCorrectedP3Dw);
+    pMP->SetWorldPos(eigCorrectedP3Dw.cast<float>());
 
     pMP->UpdateNormalAndDepth();
   }
@@ -974,10 +964,12 @@ int OptimizeSim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &vpMatches1,
   const cv::Mat &K2 = pKF2->mK;
 
   // Camera poses
-  const cv::Mat R1w = pKF1->GetRotation();
-  const cv::Mat t1w = pKF1->GetTranslation();
-  const cv::Mat R2w = pKF2->GetRotation();
-  const cv::Mat t2w = pKF2->GetTranslation();
+  const Eigen::Matrix4f T1w = pKF1->GetPose();
+  const Eigen::Matrix3f R1w = T1w.topLeftCorner<3, 3>();
+  const Eigen::Vector3f t1w = T1w.topRightCorner<3, 1>();
+  const Eigen::Matrix4f T2w = pKF2->GetPose();
+  const Eigen::Matrix3f R2w = T2w.topLeftCorner<3, 3>();
+  const Eigen::Vector3f t2w = T2w.topRightCorner<3, 1>();
 
   // Set Sim3 vertex
   g2o::VertexSim3Expmap *vSim3 = new g2o::VertexSim3Expmap();
@@ -1026,17 +1018,15 @@ int OptimizeSim3(KeyFrame *pKF1, KeyFrame *pKF2, vector<MapPoint *> &vpMatches1,
     if(pMP1 && pMP2) {
       if(!pMP1->isBad() && !pMP2->isBad() && i2 >= 0) {
         g2o::VertexSBAPointXYZ *vPoint1 = new g2o::VertexSBAPointXYZ();
-        cv::Mat P3D1w = pMP1->GetWorldPos();
-        cv::Mat P3D1c = R1w * P3D1w + t1w;
-        vPoint1->setEstimate(Converter::toVector3d(P3D1c));
+        const Eigen::Vector3f P3D1c = R1w * pMP1->GetWorldPos() + t1w;
+        vPoint1->setEstimate(P3D1c.cast<double>());
         vPoint1->setId(id1);
         vPoint1->setFixed(true);
         optimizer.addVertex(vPoint1);
 
         g2o::VertexSBAPointXYZ *vPoint2 = new g2o::VertexSBAPointXYZ();
-        cv::Mat P3D2w = pMP2->GetWorldPos();
-        cv::Mat P3D2c = R2w * P3D2w + t2w;
-        vPoint2->setEstimate(Converter::toVector3d(P3D2c));
+        const Eigen::Vector3f P3D2c = R2w * pMP2->GetWorldPos() + t2w;
+        vPoint2->setEstimate(P3D2c.cast<double>());
         vPoint2->setId(id2);
         vPoint2->setFixed(true);
         optimizer.addVertex(vPoint2);
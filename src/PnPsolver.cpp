@@ -79,8 +79,8 @@ PnPsolver::PnPsolver(const Frame &F, const vector<MapPoint *> &vpMapPointMatches
         mvP2D.push_back(kp.pt);
         mvSigma2.push_back(F.mvLevelSigma2[kp.octave]);
 
-        cv::Mat Pos = pMP->GetWorldPos();
-        mvP3Dw.emplace_back(Pos.at<float>(0), Pos.at<float>(1), Pos.at<float>(2));
+        const Eigen::Vector3f Pos = pMP->GetWorldPos();
+        mvP3Dw.emplace_back(Pos(0), Pos(1), Pos(2));
 
         mvKeyPointIndices.push_back(i);
         mvAllIndices.push_back(idx);
@@ -144,12 +144,12 @@ void PnPsolver::SetRansacParameters(double probability, int minInliers, int maxI
     mvMaxError[i] = mvSigma2[i] * th2;
 }
 
-cv::Mat PnPsolver::find(vector<bool> &vbInliers, int &nInliers) {
+bool PnPsolver::find(vector<bool> &vbInliers, int &nInliers, Eigen::Matrix4f &Tcw) {
   bool bFlag;
-  return iterate(mRansacMaxIts, bFlag, vbInliers, nInliers);
+  return iterate(mRansacMaxIts, bFlag, vbInliers, nInliers, Tcw);
 }
 
-cv::Mat PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInliers, int &nInliers) {
+bool PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInliers, int &nInliers, Eigen::Matrix4f &Tcw) {
   bNoMore = false;
   vbInliers.clear();
   nInliers = 0;
@@ -158,7 +158,7 @@ cv::Mat PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInlie
 
   if(N < mRansacMinInliers) {
     bNoMore = true;
-    return cv::Mat();
+    return false;
   }
 
   vector<size_t> vAvailableIndices;
@@ -195,13 +195,7 @@ cv::Mat PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInlie
         mvbBestInliers = mvbInliersi;
         mnBestInliers = mnInliersi;
 
-        cv::Mat Rcw(3, 3, CV_64F, mRi);
-        cv::Mat tcw(3, 1, CV_64F, mti);
-        Rcw.convertTo(Rcw, CV_32F);
-        tcw.convertTo(tcw, CV_32F);
-        mBestTcw = cv::Mat::eye(4, 4, CV_32F);
-        Rcw.copyTo(mBestTcw.rowRange(0, 3).colRange(0, 3));
-        tcw.copyTo(mBestTcw.rowRange(0, 3).col(3));
+        mBestTcw = CurrentPose();
       }
 
       if(Refine()) {
@@ -211,7 +205,8 @@ cv::Mat PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInlie
           if(mvbRefinedInliers[i])
             vbInliers[mvKeyPointIndices[i]] = true;
         }
-        return mRefinedTcw.clone();
+        Tcw = mRefinedTcw;
+        return true;
       }
     }
   }
@@ -225,11 +220,19 @@ cv::Mat PnPsolver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInlie
         if(mvbBestInliers[i])
           vbInliers[mvKeyPointIndices[i]] = true;
       }
-      return mBestTcw.clone();
+      Tcw = mBestTcw;
+      return true;
     }
   }
 
-  return cv::Mat();
+  return false;
+}
+
+Eigen::Matrix4f PnPsolver::CurrentPose() const {
+  Eigen::Matrix4f Tcw = Eigen::Matrix4f::Identity();
+  Tcw.topLeftCorner<3, 3>() = Eigen::Map<const Eigen::Matrix<double, 3, 3, Eigen::RowMajor>>(&mRi[0][0]).cast<float>();
+  Tcw.topRightCorner<3, 1>() = Eigen::Map<const Eigen::Vector3d>(mti).cast<float>();
+  return Tcw;
 }
 
 bool PnPsolver::Refine() {
@@ -260,13 +263,7 @@ bool PnPsolver::Refine() {
   mvbRefinedInliers = mvbInliersi;
 
   if(mnInliersi > mRansacMinInliers) {
-    cv::Mat Rcw(3, 3, CV_64F, mRi);
-    cv::Mat tcw(3, 1, CV_64F, mti);
-    Rcw.convertTo(Rcw, CV_32F);
-    tcw.convertTo(tcw, CV_32F);
-    mRefinedTcw = cv::Mat::eye(4, 4, CV_32F);
-    Rcw.copyTo(mRefinedTcw.rowRange(0, 3).colRange(0, 3));
-    tcw.copyTo(mRefinedTcw.rowRange(0, 3).col(3));
+    mRefinedTcw = CurrentPose();
     return true;
   }
 
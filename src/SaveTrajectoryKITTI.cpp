@@ -25,7 +25,7 @@ bool SaveTrajectoryKITTI::save(std::ofstream &outputStream, const System &system
 
   // Transform all keyframes so that the first keyframe is at the origin.
   // After a loop closure the first keyframe might not be at the origin.
-  cv::Mat Two = vpKFs[0]->GetPoseInverse();
+  const Eigen::Matrix4f Two = vpKFs[0]->GetPoseState().Twc;
 
   outputStream << fixed;
 
@@ -41,23 +41,23 @@ bool SaveTrajectoryKITTI::save(std::ofstream &outputStream, const System &system
       lit++, lRit++, lT++) {
     ORB_SLAM2::KeyFrame *pKF = *lRit;
 
-    cv::Mat Trw = cv::Mat::eye(4, 4, CV_32F);
+    Eigen::Matrix4f Trw = Eigen::Matrix4f::Identity();
 
     while(pKF->isBad()) {
       Trw = Trw * pKF->mTcp;
       pKF = pKF->GetParent();
     }
 
-    Trw = Trw * pKF->GetPose() * Two;
+    Trw = Trw * pKF->GetPoseState().Tcw * Two;
 
-    cv::Mat Tcw = (*lit) * Trw;
-    cv::Mat Rwc = Tcw.rowRange(0, 3).colRange(0, 3).t();
-    cv::Mat twc = -Rwc * Tcw.rowRange(0, 3).col(3);
+    const Eigen::Matrix4f Tcw = (*lit) * Trw;
+    const Eigen::Matrix3f Rwc = Tcw.topLeftCorner<3, 3>().transpose();
+    const Eigen::Vector3f twc = -Rwc * Tcw.topRightCorner<3, 1>();
 
-    outputStream << setprecision(9) << Rwc.at<float>(0, 0) << " " << Rwc.at<float>(0, 1) << " " << Rwc.at<float>(0, 2) << " "
-                 << twc.at<float>(0) << " " << Rwc.at<float>(1, 0) << " " << Rwc.at<float>(1, 1) << " " << Rwc.at<float>(1, 2)
-                 << " " << twc.at<float>(1) << " " << Rwc.at<float>(2, 0) << " " << Rwc.at<float>(2, 1) << " "
-                 << Rwc.at<float>(2, 2) << " " << twc.at<float>(2) << endl;
+    outputStream << setprecision(9) << Rwc(0, 0) << " " << Rwc(0, 1) << " " << Rwc(0, 2) << " "
+                 << twc(0) << " " << Rwc(1, 0) << " " << Rwc(1, 1) << " " << Rwc(1, 2)
+                 << " " << twc(1) << " " << Rwc(2, 0) << " " << Rwc(2, 1) << " "
+                 << Rwc(2, 2) << " " << twc(2) << endl;
   }
   //f.close();
   spdlog::debug("trajectory saved!");
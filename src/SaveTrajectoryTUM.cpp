@@ -26,7 +26,7 @@ bool SaveTrajectoryTUM::save(std::ofstream &outputStream, const System &system)
 
   // Transform all keyframes so that the first keyframe is at the origin.
   // After a loop closure the first keyframe might not be at the origin.
-  const cv::Mat tWO = vpKFs[0]->GetPoseInverse();
+  const Eigen::Matrix4f tWO = vpKFs[0]->GetPoseState().Twc;
 
   /*
   std::ofstream f(fileName);
@@ -54,7 +54,7 @@ bool SaveTrajectoryTUM::save(std::ofstream &outputStream, const System &system)
 
     KeyFrame *pKF = *lRit;
 
-    cv::Mat tRW = cv::Mat::eye(4, 4, CV_32F);
+    Eigen::Matrix4f tRW = Eigen::Matrix4f::Identity();
 
     // If the reference keyframe was culled, traverse the spanning tree to get a suitable keyframe.
     while(pKF->isBad()) {
@@ -62,16 +62,16 @@ bool SaveTrajectoryTUM::save(std::ofstream &outputStream, const System &system)
       pKF = pKF->GetParent();
     }
 
-    tRW = tRW * pKF->GetPose() * tWO;
+    tRW = tRW * pKF->GetPoseState().Tcw * tWO;
 
-    cv::Mat tCW = (*lit) * tRW;
-    cv::Mat rWC = tCW.rowRange(0, 3).colRange(0, 3).t();
-    cv::Mat twc = -rWC * tCW.rowRange(0, 3).col(3);
+    const Eigen::Matrix4f tCW = (*lit) * tRW;
+    const Eigen::Matrix3f rWC = tCW.topLeftCorner<3, 3>().transpose();
+    const Eigen::Vector3f twc = -rWC * tCW.topRightCorner<3, 1>();
 
     std::vector<float> q = Converter::toQuaternion(rWC);
 
-    outputStream << setprecision(6) << *lT << " " << setprecision(9) << twc.at<float>(0) << " " << twc.at<float>(1) << " "
-      << twc.at<float>(2) << " " << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << endl;
+    outputStream << setprecision(6) << *lT << " " << setprecision(9) << twc(0) << " " << twc(1) << " "
+      << twc(2) << " " << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << endl;
   }
   //f.close();
   spdlog::debug("trajectory saved!");
@@ -98,11 +98,12 @@ bool SaveTrajectoryTUM::saveKeyFrame(std::ofstream &outputStream, const System &
       continue;
     }
 
-    const cv::Mat R = pKF->GetRotation().t();
+    const KeyFrame::PoseState pose = pKF->GetPoseState();
+    const Eigen::Matrix3f R = pose.Twc.topLeftCorner<3, 3>();
     std::vector<float> q = Converter::toQuaternion(R);
-    cv::Mat t = pKF->GetCameraCenter();
-    outputStream << setprecision(6) << pKF->mTimeStamp << setprecision(7) << " " << t.at<float>(0) << " " << t.at<float>(1) << " "
-                 << t.at<float>(2) << " " << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << endl;
+    const Eigen::Vector3f &t = pose.Ow;
+    outputStream << setprecision(6) << pKF->mTimeStamp << setprecision(7) << " " << t(0) << " " << t(1) << " "
+                 << t(2) << " " << q[0] << " " << q[1] << " " << q[2] << " " << q[3] << endl;
   }
   //f.close();
   spdlog::debug("trajectory saved!");
@@ -22,6 +22,7 @@
 //
 #include "KeyFrame.hpp"
 #include "MapPoint.hpp"
+#include "Converter.hpp"
 #include "ORBmatcher.hpp"
 // DBoW2
 #include <DBoW2/DUtils/Random.h>
@@ -44,10 +45,12 @@ Sim3Solver::Sim3Solver(KeyFrame *pKF1, KeyFrame *pKF2, const vector<MapPoint *>
   mvX3Dc1.reserve(mN1);
   mvX3Dc2.reserve(mN1);
 
-  cv::Mat Rcw1 = pKF1->GetRotation();
-  cv::Mat tcw1 = pKF1->GetTranslation();
-  cv::Mat Rcw2 = pKF2->GetRotation();
-  cv::Mat tcw2 = pKF2->GetTranslation();
+  const Eigen::Matrix4f Tcw1 = pKF1->GetPose();
+  const Eigen::Matrix3f Rcw1 = Tcw1.topLeftCorner<3, 3>();
+  const Eigen::Vector3f tcw1 = Tcw1.topRightCorner<3, 1>();
+  const Eigen::Matrix4f Tcw2 = pKF2->GetPose();
+  const Eigen::Matrix3f Rcw2 = Tcw2.topLeftCorner<3, 3>();
+  const Eigen::Vector3f tcw2 = Tcw2.topRightCorner<3, 1>();
 
   mvAllIndices.reserve(mN1);
 
@@ -82,19 +85,17 @@ Sim3Solver::Sim3Solver(KeyFrame *pKF1, KeyFrame *pKF2, const vector<MapPoint *>
       mvpMapPoints2.push_back(pMP2);
       mvnIndices1.push_back(i1);
 
-      cv::Mat X3D1w = pMP1->GetWorldPos();
-      mvX3Dc1.push_back(Rcw1 * X3D1w + tcw1);
+      mvX3Dc1.push_back(Rcw1 * pMP1->GetWorldPos() + tcw1);
 
-      cv::Mat X3D2w = pMP2->GetWorldPos();
-      mvX3Dc2.push_back(Rcw2 * X3D2w + tcw2);
+      mvX3Dc2.push_back(Rcw2 * pMP2->GetWorldPos() + tcw2);
 
       mvAllIndices.push_back(idx);
       idx++;
     }
   }
 
-  mK1 = pKF1->mK;
-  mK2 = pKF2->mK;
+  mK1 = Converter::toMatrix3f(pKF1->mK);
+  mK2 = Converter::toMatrix3f(pKF2->mK);
 
   FromCameraToImage(mvX3Dc1, mvP1im1, mK1);
   FromCameraToImage(mvX3Dc2, mvP2im2, mK2);
@@ -128,20 +129,20 @@ void Sim3Solver::SetRansacParameters(double probability, int minInliers, int max
   mnIterations = 0;
 }
 
-cv::Mat Sim3Solver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInliers, int &nInliers) {
+bool Sim3Solver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInliers, int &nInliers, Eigen::Matrix4f &T12) {
   bNoMore = false;
   vbInliers = vector<bool>(mN1, false);
   nInliers = 0;
 
   if(N < mRansacMinInliers) {
     bNoMore = true;
-    return cv::Mat();
+    return false;
   }
 
   vector<size_t> vAvailableIndices;
 
-  cv::Mat P3Dc1i(3, 3, CV_32F);
-  cv::Mat P3Dc2i(3, 3, CV_32F);
+  Eigen::Matrix3f P3Dc1i;
+  Eigen::Matrix3f P3Dc2i;
 
   int nCurrentIterations = 0;
   while(mnIterations < mRansacMaxIts && nCurrentIterations < nIterations) {
@@ -156,8 +157,8 @@ cv::Mat Sim3Solver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInli
 
       int idx = vAvailableIndices[randi];
 
-      mvX3Dc1[idx].copyTo(P3Dc1i.col(i));
-      mvX3Dc2[idx].copyTo(P3Dc2i.col(i));
+      P3Dc1i.col(i) = mvX3Dc1[idx];
+      P3Dc2i.col(i) = mvX3Dc2[idx];
 
       vAvailableIndices[randi] = vAvailableIndices.back();
       vAvailableIndices.pop_back();
@@ -170,9 +171,9 @@ cv::Mat Sim3Solver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInli
     if(mnInliersi >= mnBestInliers) {
       mvbBestInliers = mvbInliersi;
       mnBestInliers = mnInliersi;
-      mBestT12 = mT12i.clone();
-      mBestRotation = mR12i.clone();
-      mBestTranslation = mt12i.clone();
+      mBestT12 = mT12i;
+      mBestRotation = mR12i;
+      mBestTranslation = mt12i;
       mBestScale = ms12i;
 
       if(mnInliersi > mRansacMinInliers) {
@@ -180,7 +181,8 @@ cv::Mat Sim3Solver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInli
         for(int i = 0; i < N; i++)
           if(mvbInliersi[i])
             vbInliers[mvnIndices1[i]] = true;
-        return mBestT12;
+        T12 = mBestT12;
+        return true;
       }
     }
   }
@@ -188,96 +190,72 @@ cv::Mat Sim3Solver::iterate(int nIterations, bool &bNoMore, vector<bool> &vbInli
   if(mnIterations >= mRansacMaxIts)
     bNoMore = true;
 
-  return cv::Mat();
+  return false;
 }
 
-cv::Mat Sim3Solver::find(vector<bool> &vbInliers12, int &nInliers) {
+bool Sim3Solver::find(vector<bool> &vbInliers12, int &nInliers, Eigen::Matrix4f &T12) {
   bool bFlag;
-  return iterate(mRansacMaxIts, bFlag, vbInliers12, nInliers);
+  return iterate(mRansacMaxIts, bFlag, vbInliers12, nInliers, T12);
 }
 
-void Sim3Solver::ComputeCentroid(cv::Mat &P, cv::Mat &Pr, cv::Mat &C) {
-  cv::reduce(P, C, 1, CV_REDUCE_SUM);
-  C = C / P.cols;
-
-  for(int i = 0; i < P.cols; i++) {
-    Pr.col(i) = P.col(i) - C;
-  }
+void Sim3Solver::ComputeCentroid(const Eigen::Matrix3f &P, Eigen::Matrix3f &Pr, Eigen::Vector3f &C) {
+  C = P.rowwise().mean();
+  Pr = P.colwise() - C;
 }
 
-void Sim3Solver::ComputeSim3(cv::Mat &P1, cv::Mat &P2) {
+void Sim3Solver::ComputeSim3(const Eigen::Matrix3f &P1, const Eigen::Matrix3f &P2) {
   // Custom implementation of:
   // Horn 1987, Closed-form solution of absolute orientataion using unit quaternions
 
   // Step 1: Centroid and relative coordinates
 
-  cv::Mat Pr1(P1.size(), P1.type());  // Relative coordinates to centroid (set 1)
-  cv::Mat Pr2(P2.size(), P2.type());  // Relative coordinates to centroid (set 2)
-  cv::Mat O1(3, 1, Pr1.type());       // Centroid of P1
-  cv::Mat O2(3, 1, Pr2.type());       // Centroid of P2
+  Eigen::Matrix3f Pr1;  // Relative coordinates to centroid (set 1)
+  Eigen::Matrix3f Pr2;  // Relative coordinates to centroid (set 2)
+  Eigen::Vector3f O1;   // Centroid of P1
+  Eigen::Vector3f O2;   // Centroid of P2
 
   ComputeCentroid(P1, Pr1, O1);
   ComputeCentroid(P2, Pr2, O2);
 
   // Step 2: Compute M matrix
 
-  cv::Mat M = Pr2 * Pr1.t();
+  const Eigen::Matrix3f M = Pr2 * Pr1.transpose();
 
   // Step 3: Compute N matrix
 
   double N11, N12, N13, N14, N22, N23, N24, N33, N34, N44;
 
-  cv::Mat NMat(4, 4, P1.type());
-
-  N11 = M.at<float>(0, 0) + M.at<float>(1, 1) + M.at<float>(2, 2);
-  N12 = M.at<float>(1, 2) - M.at<float>(2, 1);
-  N13 = M.at<float>(2, 0) - M.at<float>(0, 2);
-  N14 = M.at<float>(0, 1) - M.at<float>(1, 0);
-  N22 = M.at<float>(0, 0) - M.at<float>(1, 1) - M.at<float>(2, 2);
-  N23 = M.at<float>(0, 1) + M.at<float>(1, 0);
-  N24 = M.at<float>(2, 0) + M.at<float>(0, 2);
-  N33 =-M.at<float>(0, 0) + M.at<float>(1, 1) - M.at<float>(2, 2);
-  N34 = M.at<float>(1, 2) + M.at<float>(2, 1);
-  N44 =-M.at<float>(0, 0) - M.at<float>(1, 1) + M.at<float>(2, 2);
-
-  NMat = (cv::Mat_<float>(4, 4) << N11, N12, N13, N14, N12, N22, N23, N24, N13, N23, N33, N34, N14, N24, N34, N44);
-
-  // Step 4: Eigenvector of the highest eigenvalue
-
-  cv::Mat eval, evec;
-
-  cv::eigen(NMat, eval, evec);  //evec[0] is the quaternion of the desired rotation
+  N11 = M(0, 0) + M(1, 1) + M(2, 2);
+  N12 = M(1, 2) - M(2, 1);
+  N13 = M(2, 0) - M(0, 2);
+  N14 = M(0, 1) - M(1, 0);
+  N22 = M(0, 0) - M(1, 1) - M(2, 2);
+  N23 = M(0, 1) + M(1, 0);
+  N24 = M(2, 0) + M(0, 2);
+  N33 =-M(0, 0) + M(1, 1) - M(2, 2);
+  N34 = M(1, 2) + M(2, 1);
+  N44 =-M(0, 0) - M(1, 1) + M(2, 2);
 
-  cv::Mat vec(1, 3, evec.type());
-  (evec.row(0).colRange(1, 4)).copyTo(vec);  //extract imaginary part of the quaternion (sin*axis)
+  Eigen::Matrix4f NMat;
+  NMat << N11, N12, N13, N14, N12, N22, N23, N24, N13, N23, N33, N34, N14, N24, N34, N44;
 
-  // Rotation angle. sin is the norm of the imaginary part, cos is the real part
-  double ang = atan2(norm(vec), evec.at<float>(0, 0));
+  // Step 4: Eigenvector of the highest eigenvalue. The eigenvalues are in increasing order,
+  // the last eigenvector is the quaternion (w, x, y, z) of the desired rotation
 
-  vec = 2 * ang * vec / norm(vec);  //Angle-axis representation. quaternion angle is the half
+  const Eigen::SelfAdjointEigenSolver<Eigen::Matrix4f> eigenSolver(NMat);
+  const Eigen::Vector4f q = eigenSolver.eigenvectors().col(3);
 
-  mR12i.create(3, 3, P1.type());
-
-  cv::Rodrigues(vec, mR12i);  // computes the rotation matrix from angle-axis
+  mR12i = Eigen::Quaternionf(q(0), q(1), q(2), q(3)).normalized().toRotationMatrix();
 
   // Step 5: Rotate set 2
 
-  cv::Mat P3 = mR12i * Pr2;
+  const Eigen::Matrix3f P3 = mR12i * Pr2;
 
   // Step 6: Scale
 
   if(!mbFixScale) {
-    double nom = Pr1.dot(P3);
-    cv::Mat aux_P3(P3.size(), P3.type());
-    aux_P3 = P3;
-    cv::pow(P3, 2, aux_P3);
-    double den = 0;
-
-    for(int i = 0; i < aux_P3.rows; i++) {
-      for(int j = 0; j < aux_P3.cols; j++) {
-        den += aux_P3.at<float>(i, j);
-      }
-    }
+    const double nom = Pr1.cwiseProduct(P3).sum();
+    const double den = P3.squaredNorm();
 
     ms12i = nom / den;
   } else {
@@ -285,43 +263,34 @@ void Sim3Solver::ComputeSim3(cv::Mat &P1, cv::Mat &P2) {
   }
 
   // Step 7: Translation
-  mt12i.create(1, 3, P1.type());
   mt12i = O1 - ms12i * mR12i * O2;
 
   // Step 8: Transformation
 
   // Step 8.1 T12
-  mT12i = cv::Mat::eye(4, 4, P1.type());
-
-  cv::Mat sR = ms12i * mR12i;
-
-  sR.copyTo(mT12i.rowRange(0, 3).colRange(0, 3));
-  mt12i.copyTo(mT12i.rowRange(0, 3).col(3));
+  mT12i.setIdentity();
+  mT12i.topLeftCorner<3, 3>() = ms12i * mR12i;
+  mT12i.topRightCorner<3, 1>() = mt12i;
 
   // Step 8.2 T21
 
-  mT21i = cv::Mat::eye(4, 4, P1.type());
-
-  cv::Mat sRinv = (1.0 / ms12i) * mR12i.t();
+  const Eigen::Matrix3f sRinv = (1.0f / ms12i) * mR12i.transpose();
 
-  sRinv.copyTo(mT21i.rowRange(0, 3).colRange(0, 3));
-  cv::Mat tinv = -sRinv * mt12i;
-  tinv.copyTo(mT21i.rowRange(0, 3).col(3));
+  mT21i.setIdentity();
+  mT21i.topLeftCorner<3, 3>() = sRinv;
+  mT21i.topRightCorner<3, 1>() = -sRinv * mt12i;
 }
 
 void Sim3Solver::CheckInliers() {
-  vector<cv::Mat> vP1im2, vP2im1;
+  vector<Eigen::Vector2f> vP1im2, vP2im1;
   Project(mvX3Dc2, vP2im1, mT12i, mK1);
   Project(mvX3Dc1, vP1im2, mT21i, mK2);
 
   mnInliersi = 0;
 
   for(size_t i = 0; i < mvP1im1.size(); i++) {
-    cv::Mat dist1 = mvP1im1[i] - vP2im1[i];
-    cv::Mat dist2 = vP1im2[i] - mvP2im2[i];
-
-    const float err1 = dist1.dot(dist1);
-    const float err2 = dist2.dot(dist2);
+    const float err1 = (mvP1im1[i] - vP2im1[i]).squaredNorm();
+    const float err2 = (vP1im2[i] - mvP2im2[i]).squaredNorm();
 
     if(err1 < mvnMaxError1[i] && err2 < mvnMaxError2[i]) {
       mvbInliersi[i] = true;
@@ -331,48 +300,48 @@ void Sim3Solver::CheckInliers() {
   }
 }
 
-cv::Mat Sim3Solver::GetEstimatedRotation() { return mBestRotation.clone(); }
+Eigen::Matrix3f Sim3Solver::GetEstimatedRotation() const { return mBestRotation; }
 
-cv::Mat Sim3Solver::GetEstimatedTranslation() { return mBestTranslation.clone(); }
+Eigen::Vector3f Sim3Solver::GetEstimatedTranslation() const { return mBestTranslation; }
 
 float Sim3Solver::GetEstimatedScale() const { return mBestScale; }
 
-void Sim3Solver::Project(const vector<cv::Mat> &vP3Dw, vector<cv::Mat> &vP2D, const cv::Mat& Tcw, cv::Mat K) {
-  cv::Mat Rcw = Tcw.rowRange(0, 3).colRange(0, 3);
-  cv::Mat tcw = Tcw.rowRange(0, 3).col(3);
-  const float &fx = K.at<float>(0, 0);
-  const float &fy = K.at<float>(1, 1);
-  const float &cx = K.at<float>(0, 2);
-  const float &cy = K.at<float>(1, 2);
+void Sim3Solver::Project(const vector<Eigen::Vector3f> &vP3Dw, vector<Eigen::Vector2f> &vP2D, const Eigen::Matrix4f &Tcw, const Eigen::Matrix3f &K) {
+  const Eigen::Matrix3f Rcw = Tcw.topLeftCorner<3, 3>();
+  const Eigen::Vector3f tcw = Tcw.topRightCorner<3, 1>();
+  const float fx = K(0, 0);
+  const float fy = K(1, 1);
+  const float cx = K(0, 2);
+  const float cy = K(1, 2);
 
   vP2D.clear();
   vP2D.reserve(vP3Dw.size());
 
   for(const auto & i : vP3Dw) {
-    cv::Mat P3Dc = Rcw * i + tcw;
-    const float invz = 1 / (P3Dc.at<float>(2));
-    const float x = P3Dc.at<float>(0) * invz;
-    const float y = P3Dc.at<float>(1) * invz;
+    const Eigen::Vector3f P3Dc = Rcw * i + tcw;
+    const float invz = 1 / P3Dc(2);
+    const float x = P3Dc(0) * invz;
+    const float y = P3Dc(1) * invz;
 
-    vP2D.push_back((cv::Mat_<float>(2, 1) << fx * x + cx, fy * y + cy));
+    vP2D.emplace_back(fx * x + cx, fy * y + cy);
   }
 }
 
-void Sim3Solver::FromCameraToImage(const vector<cv::Mat> &vP3Dc, vector<cv::Mat> &vP2D, cv::Mat K) {
-  const float &fx = K.at<float>(0, 0);
-  const float &fy = K.at<float>(1, 1);
-  const float &cx = K.at<float>(0, 2);
-  const float &cy = K.at<float>(1, 2);
+void Sim3Solver::FromCameraToImage(const vector<Eigen::Vector3f> &vP3Dc, vector<Eigen::Vector2f> &vP2D, const Eigen::Matrix3f &K) {
+  const float fx = K(0, 0);
+  const float fy = K(1, 1);
+  const float cx = K(0, 2);
+  const float cy = K(1, 2);
 
   vP2D.clear();
   vP2D.reserve(vP3Dc.size());
 
   for(const auto & i : vP3Dc) {
-    const float invz = 1 / (i.at<float>(2));
-    const float x = i.at<float>(0) * invz;
-    const float y = i.at<float>(1) * invz;
+    const float invz = 1 / i(2);
+    const float x = i(0) * invz;
+    const float y = i(1) * invz;
 
-    vP2D.push_back((cv::Mat_<float>(2, 1) << fx * x + cx, fy * y + cy));
+    vP2D.emplace_back(fx * x + cx, fy * y + cy);
   }
 }
 
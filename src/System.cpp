@@ -108,17 +108,11 @@ System::System(const string &strVocFile, const string &strSettingsFile,
   }
 
   //Load ORB Vocabulary
-  spdlog::debug("Loading ORB Vocabulary. This could take a while...");
+  spdlog::debug("Loading ORB Vocabulary. Convert it to the flat format to load it instantly.");
 
   mpVocabulary = new ORBVocabulary();
 
-  bool bVocLoad = false;
-  auto found = strVocFile.rfind(".txt");
-  if(found) {
-    bVocLoad = mpVocabulary->loadFromTextFile(strVocFile);
-  } else {
-    bVocLoad = mpVocabulary->loadFromBinFile(strVocFile);
-  }
+  const bool bVocLoad = mpVocabulary->Load(strVocFile);
 
   if(!bVocLoad) {
     spdlog::error("Wrong path to vocabulary. ");
@@ -215,6 +209,7 @@ cv::Mat System::trackStereo(const cv::Mat &imLeft, const cv::Mat &imRight, const
   mTrackingState      = static_cast<int>(mpTracker->mState); // TODO(Hussein): Remove convertion
   mTrackedMapPoints   = mpTracker->mCurrentFrame.mvpMapPoints;
   mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+  mFeatureBudget      = mpTracker->GetFeatureBudget();
 
   return tCW;
 }
@@ -262,6 +257,7 @@ cv::Mat System::trackRGBD(const cv::Mat &im, const cv::Mat &depthmap, const doub
   mTrackingState = static_cast<int>(mpTracker->mState); // TODO(Hussein): Remove casting
   mTrackedMapPoints = mpTracker->mCurrentFrame.mvpMapPoints;
   mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+  mFeatureBudget = mpTracker->GetFeatureBudget();
 
   return Tcw;
 }
@@ -309,6 +305,7 @@ cv::Mat System::trackMonocular(const cv::Mat &im, const double &timestamp) {
   mTrackingState = static_cast<int>(mpTracker->mState); // TODO(Hussein): Remove casting
   mTrackedMapPoints = mpTracker->mCurrentFrame.mvpMapPoints;
   mTrackedKeyPointsUn = mpTracker->mCurrentFrame.mvKeysUn;
+  mFeatureBudget = mpTracker->GetFeatureBudget();
 
   return Tcw;
 }
@@ -389,6 +386,11 @@ std::vector<MapPoint *> System::GetTrackedMapPoints() {
   return mTrackedMapPoints;
 }
 
+int System::GetFeatureBudget() {
+  std::unique_lock<std::mutex> lock(mMutexState);
+  return mFeatureBudget;
+}
+
 std::vector<cv::KeyPoint> System::GetTrackedKeyPointsUn() {
   std::unique_lock<std::mutex> lock(mMutexState);
   return mTrackedKeyPointsUn;
@@ -0,0 +1,194 @@
+// Internal
+#include "ThreadPool.hpp"
+// STL
+#include <memory>
+#include <algorithm>
+
+
+namespace utilities {
+
+namespace {
+
+// State of one parallelFor call, shared with the helper tasks that may still
+// sit in the queue after the caller has returned.
+struct ParallelForState {
+  ParallelForState(std::size_t count, const std::function<void(std::size_t)> &function) :
+    n{count}, body{function} {}
+
+  // Grab indices until none are left.
+  void work() {
+    for(std::size_t i = next++; i < n; i = next++) {
+      try {
+        body(i);
+      } catch(...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(!error) {
+          error = std::current_exception();
+        }
+      }
+
+      if(++done == n) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.notify_all();
+      }
+    }
+  }
+
+  const std::size_t n;
+  const std::function<void(std::size_t)> &body;
+
+  std::atomic<std::size_t> next{0};
+  std::atomic<std::size_t> done{0};
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::exception_ptr error;
+};
+
+} // namespace
+
+struct ThreadPool::ClaimableTask::State {
+  explicit State(std::function<void()> function) : task{std::move(function)} {}
+
+  std::function<void()> task;
+  std::atomic<bool> claimed{false};
+  std::promise<void> done;
+};
+
+ThreadPool::ClaimableTask::~ClaimableTask() noexcept {
+  if(!mpState || mbWaited) {
+    return;
+  }
+
+  if(mpState->claimed.exchange(true)) {
+    mpState->done.get_future().wait();
+  }
+}
+
+void ThreadPool::ClaimableTask::wait() {
+  mbWaited = true;
+  if(!mpState->claimed.exchange(true)) {
+    mpState->task();
+    return;
+  }
+  mpState->done.get_future().get();
+}
+
+ThreadPool::ThreadPool(std::size_t nThreads) {
+  mWorkers.reserve(nThreads);
+  for(std::size_t i = 0; i < nThreads; ++i) {
+    mWorkers.emplace_back([this]() { run(); });
+  }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStopping = true;
+  }
+  mCondition.notify_all();
+
+  for(auto &worker : mWorkers) {
+    worker.join();
+  }
+}
+
+ThreadPool& ThreadPool::shared() {
+  static ThreadPool pool(std::max(1U, std::thread::hardware_concurrency()) - 1);
+  return pool;
+}
+
+std::future<void> ThreadPool::submit(std::function<void()> task) {
+  auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+  auto future = packaged->get_future();
+
+  if(mWorkers.empty()) {
+    (*packaged)();
+    return future;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTasks.emplace_back([packaged]() { (*packaged)(); });
+  }
+  mCondition.notify_one();
+
+  return future;
+}
+
+ThreadPool::ClaimableTask ThreadPool::submitClaimable(std::function<void()> task) {
+  auto state = std::make_shared<ClaimableTask::State>(std::move(task));
+
+  // Without workers the task waits for the caller to run it
+  if(!mWorkers.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mTasks.emplace_back([state]() {
+        if(state->claimed.exchange(true)) {
+          return;
+        }
+
+        try {
+          state->task();
+          state->done.set_value();
+        } catch(...) {
+          state->done.set_exception(std::current_exception());
+        }
+      });
+    }
+    mCondition.notify_one();
+  }
+
+  return ClaimableTask(std::move(state));
+}
+
+void ThreadPool::parallelFor(std::size_t n, const std::function<void(std::size_t)> &body) {
+  if(n == 0) {
+    return;
+  }
+
+  auto state = std::make_shared<ParallelForState>(n, body);
+
+  const std::size_t nHelpers = std::min(mWorkers.size(), n - 1);
+  if(nHelpers > 0) {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      for(std::size_t i = 0; i < nHelpers; ++i) {
+        mTasks.emplace_back([state]() { state->work(); });
+      }
+    }
+    mCondition.notify_all();
+  }
+
+  state->work();
+
+  {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->done == state->n; });
+  }
+
+  if(state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+void ThreadPool::run() {
+  while(true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+
+      if(mTasks.empty()) {
+        return;
+      }
+
+      task = std::move(mTasks.front());
+      mTasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+} // namespace utilities
@@ -34,6 +34,7 @@
 #include "Initializer.hpp"
 #include "LoopClosing.hpp"
 #include "ORBextractor.hpp"
+#include "ThreadPool.hpp"
 #include "LocalMapping.hpp"
 #include "KeyFrameDatabase.hpp"
 // TESTING
@@ -133,12 +134,76 @@ Tracking::Tracking(System *pSys,
     mpIniORBextractor = new ORBextractor(2 * nFeatures, fScaleFactor, nLevels, fIniThFAST, fMinThFAST);
   }
 
+  // Optional: extract the pyramid levels on the shared worker pool
+  const int nParallel = fSettings["ORBextractor.parallel"];
+  if(nParallel != 0) {
+    utilities::ThreadPool *pThreadPool = &utilities::ThreadPool::shared();
+    mpORBextractorLeft->SetThreadPool(pThreadPool);
+    if(sensor == System::STEREO) {
+      mpORBextractorRight->SetThreadPool(pThreadPool);
+    }
+    if(sensor == System::MONOCULAR) {
+      mpIniORBextractor->SetThreadPool(pThreadPool);
+    }
+  }
+
+  // Optional: mask image of the (left) camera, features are only extracted on its non-zero pixels
+  const cv::FileNode maskNode = fSettings["ORBextractor.mask"];
+  if(!maskNode.empty() && maskNode.isString()) {
+    const std::string maskFile = static_cast<std::string>(maskNode);
+    cv::Mat mask = cv::imread(maskFile, cv::IMREAD_GRAYSCALE);
+    const int maskWidth = fSettings["Camera.width"];
+    const int maskHeight = fSettings["Camera.height"];
+    if(mask.empty()) {
+      spdlog::error("Failed to load ORB extractor mask: {}", maskFile);
+    } else if(maskWidth > 0 && maskHeight > 0 && (mask.cols != maskWidth || mask.rows != maskHeight)) {
+      spdlog::error("ORB extractor mask {} is {}x{}, the camera is {}x{}, ignoring it", maskFile, mask.cols, mask.rows, maskWidth, maskHeight);
+    } else {
+      mpORBextractorLeft->SetMask(mask);
+      if(sensor == System::MONOCULAR) {
+        mpIniORBextractor->SetMask(mask);
+      }
+      spdlog::debug("ORB Extractor Mask: {}", maskFile);
+    }
+  }
+
+  // Optional: adapt the number of features and the FAST threshold to the frame time
+  const int nAdaptive = fSettings["ORBextractor.adaptive"];
+  if(nAdaptive != 0) {
+    FeatureBudgetController::Settings budgetSettings{};
+    budgetSettings.minFeatures = fSettings["ORBextractor.minFeatures"];
+    budgetSettings.maxFeatures = fSettings["ORBextractor.maxFeatures"];
+    const double targetFrameTime = fSettings["ORBextractor.targetFrameTime"];
+    budgetSettings.targetInliers = fSettings["ORBextractor.targetInliers"];
+    if(budgetSettings.minFeatures <= 0)
+      budgetSettings.minFeatures = nFeatures / 2;
+    if(budgetSettings.maxFeatures < budgetSettings.minFeatures)
+      budgetSettings.maxFeatures = std::max(nFeatures, budgetSettings.minFeatures);
+    // Milliseconds in the settings file, one camera period by default
+    budgetSettings.targetFrameTime = targetFrameTime > 0 ? targetFrameTime / 1000.0 : 1.0 / fps;
+    if(budgetSettings.targetInliers <= 0)
+      budgetSettings.targetInliers = 100;
+    budgetSettings.minIniThFAST = fMinThFAST;
+    budgetSettings.maxIniThFAST = std::max(fIniThFAST, fMinThFAST);
+
+    mpFeatureBudget = std::make_unique<FeatureBudgetController>(budgetSettings, nFeatures, fIniThFAST);
+    mpORBextractorLeft->SetFeatureBudget(mpFeatureBudget->GetFeatureBudget());
+    if(sensor == System::STEREO) {
+      mpORBextractorRight->SetFeatureBudget(mpFeatureBudget->GetFeatureBudget());
+    }
+
+    spdlog::debug("ORB Extractor Adaptive Budget: [{}, {}] features, {} ms, {} inliers",
+                  budgetSettings.minFeatures, budgetSettings.maxFeatures,
+                  budgetSettings.targetFrameTime * 1000.0, budgetSettings.targetInliers);
+  }
+
   spdlog::debug("ORB Extractor Parameters: ");
   spdlog::debug("- Number of Features: {}", nFeatures);
   spdlog::debug("- Scale Levels: {}", nLevels);
   spdlog::debug("- Scale Factor: {}", fScaleFactor);
   spdlog::debug("- Initial Fast Threshold: {}", fIniThFAST);
   spdlog::debug("- Minimum Fast Threshold: {}", fMinThFAST);
+  spdlog::debug("- Parallel Extraction: {}", nParallel != 0);
 
   if(sensor == System::STEREO || sensor == System::RGBD) {
     mThDepth = mbf * static_cast<float>(fSettings["ThDepth"]) / fx;
@@ -176,6 +241,8 @@ inline void convertColorToGray(cv::Mat& image, bool bRGB) {
 }
 
 cv::Mat Tracking::GrabImageStereo(const cv::Mat &imRectLeft, const cv::Mat &imRectRight, const double &timestamp) {
+  const auto tStart = std::chrono::steady_clock::now();
+
   mImGray             = imRectLeft;
   cv::Mat imGrayRight = imRectRight;
 
@@ -186,10 +253,14 @@ cv::Mat Tracking::GrabImageStereo(const cv::Mat &imRectLeft, const cv::Mat &imRe
 
   Track();
 
-  return mCurrentFrame.mTcw.clone();
+  UpdateFeatureBudget(std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+
+  return mCurrentFrame.HasPose() ? Converter::toCvMat(mCurrentFrame.mTcw) : cv::Mat();
 }
 
 cv::Mat Tracking::GrabImageRGBD(const cv::Mat &imRGB, const cv::Mat &imD, const double &timestamp) {
+  const auto tStart = std::chrono::steady_clock::now();
+
   mImGray = imRGB;
   cv::Mat imDepth = imD;
 
@@ -212,10 +283,14 @@ cv::Mat Tracking::GrabImageRGBD(const cv::Mat &imRGB, const cv::Mat &imD, const
 
   Track();
 
-  return mCurrentFrame.mTcw.clone();
+  UpdateFeatureBudget(std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+
+  return mCurrentFrame.HasPose() ? Converter::toCvMat(mCurrentFrame.mTcw) : cv::Mat();
 }
 
 cv::Mat Tracking::GrabImageMonocular(const cv::Mat &im, const double &timestamp) {
+  const auto tStart = std::chrono::steady_clock::now();
+
   mImGray = im;
 
   if(mImGray.channels() == 3) {
@@ -237,7 +312,30 @@ cv::Mat Tracking::GrabImageMonocular(const cv::Mat &im, const double &timestamp)
 
   Track();
 
-  return mCurrentFrame.mTcw.clone();
+  UpdateFeatureBudget(std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count());
+
+  return mCurrentFrame.HasPose() ? Converter::toCvMat(mCurrentFrame.mTcw) : cv::Mat();
+}
+
+void Tracking::UpdateFeatureBudget(double frameTime) {
+  // Initialization has its own requirements (and the monocular one its own extractor)
+  if(!mpFeatureBudget || mState == eTrackingState::NOT_INITIALIZED)
+    return;
+
+  mpFeatureBudget->Update(frameTime, mnMatchesInliers, mState == eTrackingState::OK);
+
+  const int nFeatures = mpFeatureBudget->GetFeatureBudget();
+  const int iniThFAST = mpFeatureBudget->GetIniThFAST();
+  mpORBextractorLeft->SetFeatureBudget(nFeatures);
+  mpORBextractorLeft->SetFASTThresholds(iniThFAST, mpORBextractorLeft->GetMinimumFASTThreshold());
+  if(mSensor == System::STEREO) {
+    mpORBextractorRight->SetFeatureBudget(nFeatures);
+    mpORBextractorRight->SetFASTThresholds(iniThFAST, mpORBextractorRight->GetMinimumFASTThreshold());
+  }
+}
+
+int Tracking::GetFeatureBudget() const {
+  return mpORBextractorLeft->GetFeatureBudget();
 }
 
 void Tracking::Track() {
@@ -276,7 +374,7 @@ void Tracking::Track() {
         // Local Mapping might have changed some MapPoints tracked in last frame
         CheckReplacedInLastFrame();
 
-        if(mVelocity.empty() || mCurrentFrame.mnId < mnLastRelocFrameId + 2) {
+        if(!mbVelocity || mCurrentFrame.mnId < mnLastRelocFrameId + 2) {
           bOK = TrackReferenceKeyFrame();
         } else {
           bOK = TrackWithMotionModel();
@@ -295,7 +393,7 @@ void Tracking::Track() {
         if(!mbVO) {
           // In last frame we tracked enough MapPoints in the map
 
-          if(!mVelocity.empty()) {
+          if(mbVelocity) {
             bOK = TrackWithMotionModel();
           } else {
             bOK = TrackReferenceKeyFrame();
@@ -311,12 +409,12 @@ void Tracking::Track() {
           bool bOKReloc = false;
           vector<MapPoint *> vpMPsMM;
           vector<bool> vbOutMM;
-          cv::Mat TcwMM;
-          if(!mVelocity.empty()) {
+          Eigen::Matrix4f TcwMM;
+          if(mbVelocity) {
             bOKMM = TrackWithMotionModel();
             vpMPsMM = mCurrentFrame.mvpMapPoints;
             vbOutMM = mCurrentFrame.mvbOutlier;
-            TcwMM = mCurrentFrame.mTcw.clone();
+            TcwMM = mCurrentFrame.mTcw;
           }
           bOKReloc = Relocalization();
 
@@ -368,13 +466,11 @@ void Tracking::Track() {
     // If tracking were good, check if we insert a keyframe
     if(bOK) {
       // Update motion model
-      if(!mLastFrame.mTcw.empty()) {
-        cv::Mat LastTwc = cv::Mat::eye(4, 4, CV_32F);
-        mLastFrame.GetRotationInverse().copyTo(LastTwc.rowRange(0, 3).colRange(0, 3));
-        mLastFrame.GetCameraCenter().copyTo(LastTwc.rowRange(0, 3).col(3));
-        mVelocity = mCurrentFrame.mTcw * LastTwc;
+      if(mLastFrame.HasPose()) {
+        mVelocity = mCurrentFrame.mTcw * mLastFrame.GetPoseInverse();
+        mbVelocity = true;
       } else
-        mVelocity = cv::Mat();
+        mbVelocity = false;
 
       if(mpMapDrawer != nullptr) {
         mpMapDrawer->SetCurrentCameraPose(mCurrentFrame.mTcw);
@@ -427,8 +523,8 @@ void Tracking::Track() {
   }
 
   // Store frame pose information to retrieve the complete camera trajectory afterwards.
-  if(!mCurrentFrame.mTcw.empty()) {
-    cv::Mat Tcr = mCurrentFrame.mTcw * mCurrentFrame.mpReferenceKF->GetPoseInverse();
+  if(mCurrentFrame.HasPose()) {
+    const Eigen::Matrix4f Tcr = mCurrentFrame.mTcw * mCurrentFrame.mpReferenceKF->GetPoseState().Twc;
     mlRelativeFramePoses.push_back(Tcr);
     mlpReferences.push_back(mpReferenceKF);
     mlFrameTimes.push_back(mCurrentFrame.mTimeStamp);
@@ -445,7 +541,7 @@ void Tracking::Track() {
 void Tracking::StereoInitialization() {
   if(mCurrentFrame.N > 500) {
     // Set Frame pose to the origin
-    mCurrentFrame.SetPose(cv::Mat::eye(4, 4, CV_32F));
+    mCurrentFrame.SetPose(Eigen::Matrix4f::Identity());
 
     // Create KeyFrame
     auto *pKFini = new KeyFrame(mCurrentFrame, mpMap, mpKeyFrameDB);
@@ -457,7 +553,7 @@ void Tracking::StereoInitialization() {
     for(int i = 0; i < mCurrentFrame.N; i++) {
       float z = mCurrentFrame.mvDepth[i];
       if(z > 0) {
-        cv::Mat x3D = mCurrentFrame.UnprojectStereo(i);
+        const Eigen::Vector3f x3D = mCurrentFrame.UnprojectStereo(i);
         auto *pNewMP = new MapPoint(x3D, pKFini, mpMap);
         pNewMP->AddObservation(pKFini, i);
         pKFini->AddMapPoint(pNewMP, i);
@@ -547,11 +643,8 @@ void Tracking::MonocularInitialization() {
       }
 
       // Set Frame Poses
-      mInitialFrame.SetPose(cv::Mat::eye(4, 4, CV_32F));
-      cv::Mat Tcw = cv::Mat::eye(4, 4, CV_32F);
-      Rcw.copyTo(Tcw.rowRange(0, 3).colRange(0, 3));
-      tcw.copyTo(Tcw.rowRange(0, 3).col(3));
-      mCurrentFrame.SetPose(Tcw);
+      mInitialFrame.SetPose(Eigen::Matrix4f::Identity());
+      mCurrentFrame.SetPose(Converter::toMatrix4f(Converter::toMatrix3f(Rcw), Converter::toVector3f(tcw)));
 
       CreateInitialMapMonocular();
     }
@@ -576,7 +669,7 @@ void Tracking::CreateInitialMapMonocular() {
       continue;
 
     //Create MapPoint.
-    cv::Mat worldPos(mvIniP3D[i]);
+    const Eigen::Vector3f worldPos(mvIniP3D[i].x, mvIniP3D[i].y, mvIniP3D[i].z);
 
     auto *pMP = new MapPoint(worldPos, pKFcur, mpMap);
 
@@ -617,8 +710,8 @@ void Tracking::CreateInitialMapMonocular() {
   }
 
   // Scale initial baseline
-  cv::Mat Tc2w = pKFcur->GetPose();
-  Tc2w.col(3).rowRange(0, 3) = Tc2w.col(3).rowRange(0, 3) * invMedianDepth;
+  Eigen::Matrix4f Tc2w = pKFcur->GetPoseState().Tcw;
+  Tc2w.topRightCorner<3, 1>() *= invMedianDepth;
   pKFcur->SetPose(Tc2w);
 
   // Scale points
@@ -626,14 +719,14 @@ void Tracking::CreateInitialMapMonocular() {
   for(auto & vpAllMapPoint : vpAllMapPoints) {
     if(vpAllMapPoint) {
       MapPoint *pMP = vpAllMapPoint;
-      pMP->SetWorldPos(pMP->GetWorldPos() * invMedianDepth);
+      pMP->SetWorldPos(Eigen::Vector3f(pMP->GetPositionState().worldPos * invMedianDepth));
     }
   }
 
   mpLocalMapper->InsertKeyFrame(pKFini);
   mpLocalMapper->InsertKeyFrame(pKFcur);
 
-  mCurrentFrame.SetPose(pKFcur->GetPose());
+  mCurrentFrame.SetPose(Tc2w);
   mnLastKeyFrameId = mCurrentFrame.mnId;
   mpLastKeyFrame = pKFcur;
 
@@ -648,7 +741,7 @@ void Tracking::CreateInitialMapMonocular() {
   mpMap->SetReferenceMapPoints(mvpLocalMapPoints);
 
   if(mpMapDrawer != nullptr) {
-    mpMapDrawer->SetCurrentCameraPose(pKFcur->GetPose());
+    mpMapDrawer->SetCurrentCameraPose(Tc2w);
   }
 
   mpMap->mvpKeyFrameOrigins.push_back(pKFini);
@@ -676,6 +769,7 @@ bool Tracking::TrackReferenceKeyFrame() {
   // We perform first an ORB matching with the reference keyframe
   // If enough matches are found we setup a PnP solver
   ORBmatcher matcher(0.7, true);
+  matcher.SetThreadPool(&utilities::ThreadPool::shared());
   vector<MapPoint *> vpMapPointMatches;
 
   int nmatches = matcher.SearchByBoW(mpReferenceKF, mCurrentFrame, vpMapPointMatches);
@@ -711,9 +805,9 @@ bool Tracking::TrackReferenceKeyFrame() {
 void Tracking::UpdateLastFrame() {
   // Update pose according to reference keyframe
   KeyFrame *pRef = mLastFrame.mpReferenceKF;
-  cv::Mat Tlr = mlRelativeFramePoses.back();
+  const Eigen::Matrix4f &Tlr = mlRelativeFramePoses.back();
 
-  mLastFrame.SetPose(Tlr * pRef->GetPose());
+  mLastFrame.SetPose(Tlr * pRef->GetPoseState().Tcw);
 
   if(mnLastKeyFrameId == mLastFrame.mnId || mSensor == System::MONOCULAR || !mbOnlyTracking)
     return;
@@ -750,7 +844,7 @@ void Tracking::UpdateLastFrame() {
     }
 
     if(bCreateNew) {
-      cv::Mat x3D = mLastFrame.UnprojectStereo(i);
+      const Eigen::Vector3f x3D = mLastFrame.UnprojectStereo(i);
       auto *pNewMP = new MapPoint(x3D, mpMap, &mLastFrame, i);
 
       mLastFrame.mvpMapPoints[i] = pNewMP;
@@ -982,7 +1076,7 @@ void Tracking::CreateNewKeyFrame() {
         }
 
         if(bCreateNew) {
-          cv::Mat x3D = mCurrentFrame.UnprojectStereo(i);
+          const Eigen::Vector3f x3D = mCurrentFrame.UnprojectStereo(i);
           auto *pNewMP = new MapPoint(x3D, pKF, mpMap);
           pNewMP->AddObservation(pKF, i);
           pKF->AddMapPoint(pNewMP, i);
@@ -1042,6 +1136,7 @@ void Tracking::SearchLocalPoints() {
 
   if(nToMatch > 0) {
     ORBmatcher matcher(0.8);
+    matcher.SetThreadPool(&utilities::ThreadPool::shared());
     int th = 1;
     if(mSensor == System::RGBD)
       th = 3;
@@ -1087,7 +1182,7 @@ void Tracking::UpdateLocalKeyFrames() {
     if(mCurrentFrame.mvpMapPoints[i]) {
       MapPoint *pMP = mCurrentFrame.mvpMapPoints[i];
       if(!pMP->isBad()) {
-        const map<KeyFrame *, size_t> observations = pMP->GetObservations();
+        const ObservationList observations = pMP->GetObservations();
         for(auto observation : observations)
           ++keyframeCounter[observation.first];
       } else {
@@ -1174,7 +1269,7 @@ bool Tracking::Relocalization() {
 
   // Relocalization is performed when tracking is lost
   // Track Lost: Query KeyFrame Database for keyframe candidates for relocalisation
-  vector<KeyFrame *> vpCandidateKFs = mpKeyFrameDB->DetectRelocalizationCandidates(&mCurrentFrame);
+  vector<KeyFrame *> vpCandidateKFs = mpKeyFrameDB->DetectRelocalizationCandidates(&mCurrentFrame, mRelocQuery);
 
   if(vpCandidateKFs.empty())
     return false;
@@ -1184,6 +1279,7 @@ bool Tracking::Relocalization() {
   // We perform first an ORB matching with each candidate
   // If enough matches are found we setup a PnP solver
   ORBmatcher matcher(0.75, true);
+  matcher.SetThreadPool(&utilities::ThreadPool::shared());
 
   vector<PnPsolver *> vpPnPsolvers;
   vpPnPsolvers.resize(nKFs);
@@ -1230,7 +1326,8 @@ bool Tracking::Relocalization() {
       bool bNoMore;
 
       PnPsolver *pSolver = vpPnPsolvers[i];
-      cv::Mat Tcw = pSolver->iterate(5, bNoMore, vbInliers, nInliers);
+      Eigen::Matrix4f Tcw;
+      const bool bFound = pSolver->iterate(5, bNoMore, vbInliers, nInliers, Tcw);
 
       // If Ransac reachs max. iterations discard keyframe
       if(bNoMore) {
@@ -1239,8 +1336,8 @@ bool Tracking::Relocalization() {
       }
 
       // If a Camera Pose is computed, optimize
-      if(!Tcw.empty()) {
-        Tcw.copyTo(mCurrentFrame.mTcw);
+      if(bFound) {
+        mCurrentFrame.SetPose(Tcw);
 
         set<MapPoint *> sFound;
 